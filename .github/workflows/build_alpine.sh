@@ -14,7 +14,6 @@ apk add \
     curl-dev \
     fcgi-dev \
     libxml2-dev \
-    protobuf-c-dev \
     freetype-dev \
     fribidi-dev \
     harfbuzz-dev \
@@ -22,6 +22,7 @@ cmake -G Ninja                                       \
     -DWITH_JAVA=0                                    \
     -DWITH_JPEG=1                                    \
     -DWITH_LIBXML2=1                                 \
+    -DWITH_MVT=0                                     \
     -DWITH_MYSQL=1                                   \
     -DWITH_ORACLESPATIAL=0                           \
     -DWITH_PERL=0                                    \
@@ -31,7 +32,6 @@ cmake -G Ninja                                       \
     -DWITH_POSTGIS=1                                 \
     -DWITH_POSTGRESQL=1                              \
     -DWITH_PROJ=1                                    \
-    -DWITH_PROTOBUFC=0                               \
     -DWITH_PYTHON=1                                  \
     -DWITH_RSVG=0                                    \
     -DWITH_SOS=1                                     \
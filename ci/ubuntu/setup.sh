@@ -17,7 +17,7 @@ sudo apt-add-repository -y 'deb https://apt.kitware.com/ubuntu/ noble main'
 
 sudo apt-get update
 
-sudo apt-get install -y --allow-unauthenticated build-essential protobuf-c-compiler libprotobuf-c-dev bison flex libfribidi-dev \
+sudo apt-get install -y --allow-unauthenticated build-essential bison flex libfribidi-dev \
             librsvg2-dev colordiff libpq-dev libpng-dev libjpeg-dev libgif-dev libgeos-dev libfreetype6-dev libfcgi-dev libcurl4-gnutls-dev \
             libcairo2-dev libgdal-dev libproj-dev libxml2-dev libexempi-dev lcov lftp postgis libharfbuzz-dev gdal-bin proj-bin ccache curl \
             libpcre2-dev \
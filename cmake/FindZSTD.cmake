@@ -0,0 +1,11 @@
+# Look for the header file.
+find_path(ZSTD_INCLUDE_DIR NAMES zstd.h)
+
+# Look for the library.
+find_library(ZSTD_LIBRARY NAMES zstd libzstd zstd_static)
+
+set(ZSTD_INCLUDE_DIRS ${ZSTD_INCLUDE_DIR})
+set(ZSTD_LIBRARIES ${ZSTD_LIBRARY})
+include(FindPackageHandleStandardArgs)
+find_package_handle_standard_args(ZSTD DEFAULT_MSG ZSTD_LIBRARY ZSTD_INCLUDE_DIR)
+mark_as_advanced(ZSTD_LIBRARY ZSTD_INCLUDE_DIR)
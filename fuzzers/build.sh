@@ -68,7 +68,7 @@ cd $SRC/MapServer
 mkdir build
 cd build
 cmake -DCMAKE_BUILD_TYPE=Debug -DBUILD_STATIC=ON \
--DWITH_PROTOBUFC=0 -DWITH_FRIBIDI=0 -DWITH_HARFBUZZ=0 -DWITH_CAIRO=0 -DWITH_FCGI=0 \
+-DWITH_MVT=0 -DWITH_FRIBIDI=0 -DWITH_HARFBUZZ=0 -DWITH_CAIRO=0 -DWITH_FCGI=0 \
 -DWITH_GEOS=0 -DWITH_POSTGIS=0 -DWITH_GIF=0 ../
 #While using undefined sanitizer, Project cannot compile binary but can compile library.
 make -j$(nproc) mapserver_static
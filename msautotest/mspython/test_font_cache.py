@@ -0,0 +1,88 @@
+#!/usr/bin/env python
+# -*- coding: utf-8 -*-
+###############################################################################
+# $Id$
+#
+# Project:  MapServer
+# Purpose:  Test the lifetime of the glyphs of the shared font cache.
+# Author:   MapServer Project
+#
+###############################################################################
+#  Copyright (c) 2026, MapServer Project
+#
+#  Permission is hereby granted, free of charge, to any person obtaining a
+#  copy of this software and associated documentation files (the "Software"),
+#  to deal in the Software without restriction, including without limitation
+#  the rights to use, copy, modify, merge, publish, distribute, sublicense,
+#  and/or sell copies of the Software, and to permit persons to whom the
+#  Software is furnished to do so, subject to the following conditions:
+#
+#  The above copyright notice and this permission notice shall be included
+#  in all copies or substantial portions of the Software.
+#
+#  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+#  OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+#  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+#  THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+#  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+#  FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+#  DEALINGS IN THE SOFTWARE.
+
+import os
+
+import pytest
+
+mapscript_available = False
+try:
+    import mapscript
+
+    mapscript_available = True
+except ImportError:
+    pass
+
+pytestmark = pytest.mark.skipif(
+    not mapscript_available, reason="mapscript not available"
+)
+
+
+def get_relpath_to_this(filename):
+    return os.path.join(os.path.dirname(__file__), filename)
+
+
+MAP = """
+MAP
+    SIZE 200 60
+    EXTENT 0 0 200 60
+    FONTSET "../misc/fonts.lst"
+    IMAGETYPE png
+    LAYER
+        NAME "labels"
+        TYPE POINT
+        STATUS DEFAULT
+        FEATURE POINTS 100 30 END TEXT "%s" END
+        CLASS LABEL FONT "%s" SIZE 14 COLOR 0 0 0 END END
+    END
+END
+"""
+
+
+###############################################################################
+# The label cache of a map drawn layer by layer still references glyphs of
+# the font cache when another map is drawn in between: its labels must be
+# drawn as if nothing had happened.
+
+
+def test_label_cache_across_maps():
+
+    path = get_relpath_to_this("")
+    map = mapscript.fromstring(MAP % ("Kept glyphs", "sans"), path)
+    expected = map.draw().getBytes()
+
+    image = map.prepareImage()
+    map.getLayer(0).draw(map, image)
+
+    other = mapscript.fromstring(MAP % ("Other text, other font", "lucida"), path)
+    other.draw()
+
+    map.drawLabelCache(image)
+    assert image.getBytes() == expected
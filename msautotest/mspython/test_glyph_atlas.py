@@ -0,0 +1,102 @@
+#!/usr/bin/env python
+# -*- coding: utf-8 -*-
+###############################################################################
+# $Id$
+#
+# Project:  MapServer
+# Purpose:  Test the glyph atlas of the AGG renderer.
+# Author:   MapServer Project
+#
+###############################################################################
+#  Copyright (c) 2026, MapServer Project
+#
+#  Permission is hereby granted, free of charge, to any person obtaining a
+#  copy of this software and associated documentation files (the "Software"),
+#  to deal in the Software without restriction, including without limitation
+#  the rights to use, copy, modify, merge, publish, distribute, sublicense,
+#  and/or sell copies of the Software, and to permit persons to whom the
+#  Software is furnished to do so, subject to the following conditions:
+#
+#  The above copyright notice and this permission notice shall be included
+#  in all copies or substantial portions of the Software.
+#
+#  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+#  OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+#  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+#  THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+#  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+#  FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+#  DEALINGS IN THE SOFTWARE.
+
+import os
+import threading
+
+import pytest
+
+mapscript_available = False
+try:
+    import mapscript
+
+    mapscript_available = True
+except ImportError:
+    pass
+
+pytestmark = pytest.mark.skipif(
+    not mapscript_available, reason="mapscript not available"
+)
+
+
+def get_relpath_to_this(filename):
+    return os.path.join(os.path.dirname(__file__), filename)
+
+
+MAP = """
+MAP
+    SIZE 200 40
+    EXTENT 0 0 200 40
+    FONTSET "../misc/fonts.lst"
+    IMAGETYPE png
+    CONFIG "MS_AGG_GLYPH_ATLAS" "YES"
+    LAYER
+        NAME "first"
+        TYPE POINT
+        STATUS DEFAULT
+        FEATURE POINTS 50 20 END TEXT "Atlas" END
+        CLASS LABEL FONT "%s" SIZE 12 COLOR 0 0 0 END END
+    END
+    LAYER
+        NAME "second"
+        TYPE POINT
+        STATUS DEFAULT
+        FEATURE POINTS 150 20 END TEXT "Atlas" END
+        CLASS LABEL FONT "%s" SIZE 12 COLOR 0 0 0 END END
+    END
+END
+"""
+
+
+def draw(map):
+    return map.draw().getBytes()
+
+
+###############################################################################
+# Swapping the fonts of the labels of a map that already filled its glyph
+# atlas, and drawing it from another thread, with other font caches, gives
+# the same image as a map drawn with the swapped fonts from the start.
+
+
+def test_glyph_atlas_two_fonts():
+
+    map = mapscript.fromstring(MAP % ("sans", "lucida"), get_relpath_to_this(""))
+    first = draw(map)
+
+    map.getLayer(0).getClass(0).getLabel(0).font = "lucida"
+    map.getLayer(1).getClass(0).getLabel(0).font = "sans"
+    result = []
+    thread = threading.Thread(target=lambda: result.append(draw(map)))
+    thread.start()
+    thread.join()
+
+    swapped = mapscript.fromstring(MAP % ("lucida", "sans"), get_relpath_to_this(""))
+    assert result[0] == draw(swapped)
+    assert result[0] != first
@@ -0,0 +1,109 @@
+#!/usr/bin/env python
+# -*- coding: utf-8 -*-
+###############################################################################
+# $Id$
+#
+# Project:  MapServer
+# Purpose:  Test the prewarming of the MS_PREWARM_MAPS mapfiles.
+# Author:   MapServer Project
+#
+###############################################################################
+#  Copyright (c) 2026, MapServer Project
+#
+#  Permission is hereby granted, free of charge, to any person obtaining a
+#  copy of this software and associated documentation files (the "Software"),
+#  to deal in the Software without restriction, including without limitation
+#  the rights to use, copy, modify, merge, publish, distribute, sublicense,
+#  and/or sell copies of the Software, and to permit persons to whom the
+#  Software is furnished to do so, subject to the following conditions:
+#
+#  The above copyright notice and this permission notice shall be included
+#  in all copies or substantial portions of the Software.
+#
+#  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+#  OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+#  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+#  THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+#  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+#  FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+#  DEALINGS IN THE SOFTWARE.
+
+import os
+import threading
+
+import pytest
+
+mapscript_available = False
+try:
+    import mapscript
+
+    mapscript_available = True
+except ImportError:
+    pass
+
+pytestmark = pytest.mark.skipif(
+    not mapscript_available, reason="mapscript not available"
+)
+
+
+def get_relpath_to_this(filename):
+    return os.path.join(os.path.dirname(__file__), filename)
+
+
+MAP = """
+MAP
+    NAME "prewarm"
+    EXTENT -180 -90 180 90
+    SIZE 100 50
+    CONFIG "MS_ERRORFILE" "%s"
+    LAYER
+        NAME "popplace"
+        TYPE POINT
+        STATUS ON
+        DATA "%s"
+    END
+    LAYER
+        NAME "inline"
+        TYPE POINT
+        STATUS ON
+        FEATURE POINTS 0 0 END END
+    END
+END
+"""
+
+CONFIG = """
+CONFIG
+    ENV
+        MS_PREWARM_MAPS "PREWARM"
+    END
+    MAPS
+        PREWARM "%s"
+    END
+END
+"""
+
+
+###############################################################################
+# The loading of each mapfile and the layers opened are logged with the time
+# spent. The prewarming runs in a thread of its own so that the error file
+# set by the mapfile does not outlive the test.
+
+
+def test_prewarm_logs_time(tmp_path):
+
+    log = tmp_path / "prewarm.log"
+    mapfile = tmp_path / "prewarm.map"
+    mapfile.write_text(
+        MAP % (log, os.path.abspath(get_relpath_to_this("../wxs/data/popplace")))
+    )
+    configfile = tmp_path / "prewarm.conf"
+    configfile.write_text(CONFIG % mapfile)
+    config = mapscript.configObj(str(configfile))
+
+    thread = threading.Thread(target=mapscript.msConfigPrewarm, args=(config,))
+    thread.start()
+    thread.join()
+
+    lines = log.read_text()
+    assert "msConfigPrewarm(): PREWARM prewarmed in " in lines
+    assert "s, 1 of 2 layers opened." in lines
@@ -0,0 +1,128 @@
+#!/usr/bin/env python
+# -*- coding: utf-8 -*-
+###############################################################################
+# $Id$
+#
+# Project:  MapServer
+# Purpose:  Test the cache of raster reprojection grids.
+# Author:   MapServer Project
+#
+###############################################################################
+#  Copyright (c) 2026, MapServer Project
+#
+#  Permission is hereby granted, free of charge, to any person obtaining a
+#  copy of this software and associated documentation files (the "Software"),
+#  to deal in the Software without restriction, including without limitation
+#  the rights to use, copy, modify, merge, publish, distribute, sublicense,
+#  and/or sell copies of the Software, and to permit persons to whom the
+#  Software is furnished to do so, subject to the following conditions:
+#
+#  The above copyright notice and this permission notice shall be included
+#  in all copies or substantial portions of the Software.
+#
+#  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+#  OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+#  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+#  THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+#  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+#  FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+#  DEALINGS IN THE SOFTWARE.
+
+import os
+import threading
+
+import pytest
+
+mapscript_available = False
+try:
+    import mapscript
+
+    mapscript_available = True
+except ImportError:
+    pass
+
+pytestmark = pytest.mark.skipif(
+    not mapscript_available, reason="mapscript not available"
+)
+
+
+def get_relpath_to_this(filename):
+    return os.path.join(os.path.dirname(__file__), filename)
+
+
+MAP = """
+MAP
+    SIZE 173 151
+    EXTENT 500001 3762155.98 536808.88 3795492.60
+    IMAGETYPE png
+    CONFIG "MS_RESAMPLE_GRID_CACHE_SIZE" "%s"
+    %s
+    PROJECTION
+        "proj=utm"
+        "zone=11"
+        "datum=WGS84"
+    END
+    LAYER
+        NAME "grey"
+        TYPE RASTER
+        STATUS DEFAULT
+        DEBUG %s
+        DATA "../gdal/data/grey_raw.tif"
+        PROJECTION
+            "proj=latlong"
+            "datum=WGS84"
+        END
+        EXTENT -117 34 -116.6 34.3
+    END
+END
+"""
+
+OTHER_EXTENT = (505001, 3767155.98, 531808.88, 3790492.60)
+
+
+def draw(map, extent=None):
+    if extent:
+        map.setExtent(*extent)
+    return map.draw().getBytes()
+
+
+###############################################################################
+# Drawing a map twice with the cache on reuses the reprojection grid of the
+# first draw, and another extent computes a new one. The images are the same
+# as with the cache off. The drawing runs in a thread of its own so that the
+# error file set by the mapfile does not outlive the test.
+
+
+def test_resample_grid_cache(tmp_path):
+
+    uncached = mapscript.fromstring(MAP % ("0", "", "OFF"), get_relpath_to_this(""))
+    expected = draw(uncached)
+    expected_other = draw(uncached, OTHER_EXTENT)
+
+    log = tmp_path / "resample.log"
+    cached = mapscript.fromstring(
+        MAP % ("32", 'CONFIG "MS_ERRORFILE" "%s"' % log, "ON"),
+        get_relpath_to_this(""),
+    )
+    result = []
+    thread = threading.Thread(
+        target=lambda: result.extend(
+            (draw(cached), draw(cached), draw(cached, OTHER_EXTENT))
+        )
+    )
+    thread.start()
+    thread.join()
+
+    assert result == [expected, expected, expected_other]
+    assert expected != expected_other
+
+    grids = [
+        line.split("msResampleGDALToMap(): ")[1]
+        for line in log.read_text().splitlines()
+        if "reprojection grid." in line
+    ]
+    assert grids == [
+        "Computing reprojection grid.",
+        "Reusing cached reprojection grid.",
+        "Computing reprojection grid.",
+    ]
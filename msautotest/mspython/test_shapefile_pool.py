@@ -0,0 +1,140 @@
+#!/usr/bin/env python
+# -*- coding: utf-8 -*-
+###############################################################################
+# $Id$
+#
+# Project:  MapServer
+# Purpose:  Test that pooled tiled shapefile handles notice rewritten files.
+# Author:   MapServer Project
+#
+###############################################################################
+#  Copyright (c) 2026, MapServer Project
+#
+#  Permission is hereby granted, free of charge, to any person obtaining a
+#  copy of this software and associated documentation files (the "Software"),
+#  to deal in the Software without restriction, including without limitation
+#  the rights to use, copy, modify, merge, publish, distribute, sublicense,
+#  and/or sell copies of the Software, and to permit persons to whom the
+#  Software is furnished to do so, subject to the following conditions:
+#
+#  The above copyright notice and this permission notice shall be included
+#  in all copies or substantial portions of the Software.
+#
+#  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+#  OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+#  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+#  THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+#  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+#  FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+#  DEALINGS IN THE SOFTWARE.
+###############################################################################
+
+import os
+import struct
+
+import pytest
+
+mapscript_available = False
+try:
+    import mapscript
+
+    mapscript_available = True
+except ImportError:
+    pass
+
+pytestmark = pytest.mark.skipif(
+    not mapscript_available, reason="mapscript not available"
+)
+
+###############################################################################
+# Minimal shapefile writers: one record, one character field.
+
+
+def write_shapefile(basename, shape_type, content, bounds, field, value):
+    def header(length):
+        return (
+            struct.pack(">i", 9994)
+            + b"\0" * 20
+            + struct.pack(">i", length // 2)
+            + struct.pack("<ii", 1000, shape_type)
+            + struct.pack("<4d", *bounds)
+            + b"\0" * 32
+        )
+
+    record = struct.pack(">ii", 1, len(content) // 2) + content
+    with open(basename + ".shp", "wb") as f:
+        f.write(header(100 + len(record)) + record)
+    with open(basename + ".shx", "wb") as f:
+        f.write(header(108) + struct.pack(">ii", 50, len(content) // 2))
+    write_dbf(basename + ".dbf", field, value)
+
+
+def write_dbf(filename, field, value):
+    header = struct.pack("<BBBBIHH", 3, 126, 1, 1, 1, 65, 21) + b"\0" * 20
+    header += field.encode().ljust(11, b"\0") + b"C" + b"\0" * 4
+    header += bytes([20, 0]) + b"\0" * 14 + b"\r"
+    with open(filename, "wb") as f:
+        f.write(header + b" " + value.encode().ljust(20) + b"\x1a")
+
+
+def read_tile_value(mapfile):
+    map = mapscript.mapObj(mapfile)
+    layer = map.getLayer(0)
+    layer.open()
+    try:
+        assert layer.whichShapes(map.extent) == mapscript.MS_SUCCESS
+        shape = layer.nextShape()
+        assert shape is not None
+        return shape.getValue(0)
+    finally:
+        layer.close()
+
+
+###############################################################################
+# Rewrite the .dbf of a tile between two requests of the same process: the
+# pooled handle must not be reused.
+
+
+def test_shapefile_pool_rewritten_dbf(tmp_path):
+
+    tile = str(tmp_path / "tile")
+    write_shapefile(
+        tile, 1, struct.pack("<i2d", 1, 5, 5), (5, 5, 5, 5), "name", "one"
+    )
+    ring = struct.pack("<10d", 0, 0, 0, 10, 10, 10, 10, 0, 0, 0)
+    polygon = struct.pack("<i4dii", 5, 0, 0, 10, 10, 1, 5) + struct.pack(
+        "<i", 0
+    )
+    write_shapefile(
+        str(tmp_path / "tindex"),
+        5,
+        polygon + ring,
+        (0, 0, 10, 10),
+        "location",
+        "tile",
+    )
+
+    mapfile = str(tmp_path / "pool.map")
+    with open(mapfile, "w") as f:
+        f.write(
+            """MAP
+  EXTENT 0 0 10 10
+  SIZE 100 100
+  LAYER
+    NAME "tiles"
+    TYPE POINT
+    STATUS ON
+    TILEINDEX "tindex"
+    TILEITEM "location"
+  END
+END
+"""
+        )
+
+    assert read_tile_value(mapfile) == "one"
+
+    write_dbf(tile + ".dbf", "name", "two")
+    mtime = os.stat(tile + ".shp").st_mtime + 10
+    os.utime(tile + ".dbf", (mtime, mtime))
+
+    assert read_tile_value(mapfile) == "two"
@@ -0,0 +1,124 @@
+#!/usr/bin/env python
+# -*- coding: utf-8 -*-
+###############################################################################
+# $Id$
+#
+# Project:  MapServer
+# Purpose:  Test the cache of shaped label text.
+# Author:   MapServer Project
+#
+###############################################################################
+#  Copyright (c) 2026, MapServer Project
+#
+#  Permission is hereby granted, free of charge, to any person obtaining a
+#  copy of this software and associated documentation files (the "Software"),
+#  to deal in the Software without restriction, including without limitation
+#  the rights to use, copy, modify, merge, publish, distribute, sublicense,
+#  and/or sell copies of the Software, and to permit persons to whom the
+#  Software is furnished to do so, subject to the following conditions:
+#
+#  The above copyright notice and this permission notice shall be included
+#  in all copies or substantial portions of the Software.
+#
+#  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+#  OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+#  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+#  THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+#  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+#  FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+#  DEALINGS IN THE SOFTWARE.
+
+import os
+import re
+import threading
+
+import pytest
+
+mapscript_available = False
+try:
+    import mapscript
+
+    mapscript_available = True
+except ImportError:
+    pass
+
+pytestmark = pytest.mark.skipif(
+    not mapscript_available, reason="mapscript not available"
+)
+
+
+def get_relpath_to_this(filename):
+    return os.path.join(os.path.dirname(__file__), filename)
+
+
+MAP = """
+MAP
+    SIZE 200 60
+    EXTENT 0 0 200 60
+    FONTSET "../misc/fonts.lst"
+    IMAGETYPE png
+    CONFIG "MS_TEXT_LAYOUT_CACHE_SIZE" "%s"
+    %s
+    LAYER
+        NAME "labels"
+        TYPE POINT
+        STATUS DEFAULT
+        FEATURE POINTS 50 20 END END
+        FEATURE POINTS 150 40 END END
+        CLASS
+            TEXT "%s"
+            LABEL FONT "sans" SIZE 10 COLOR 0 0 0 END
+        END
+    END
+END
+"""
+
+
+def load(size, text, log=None):
+    return mapscript.fromstring(
+        MAP % (size, 'DEBUG 2 CONFIG "MS_ERRORFILE" "%s"' % log if log else "", text),
+        get_relpath_to_this(""),
+    )
+
+
+def draw(map):
+    return map.draw().getBytes()
+
+
+###############################################################################
+# Drawing labels twice with the cache on shapes their text once, another text
+# is shaped again, and the images are the same as with the cache off. The
+# drawing runs in a thread of its own so that the error file set by the
+# mapfile does not outlive the test.
+
+
+def test_text_layout_cache(tmp_path):
+
+    expected = draw(load("0", "Cached label"))
+    expected_other = draw(load("0", "Other label"))
+
+    log = tmp_path / "textlayout.log"
+    result = []
+
+    def run():
+        cached = load("8", "Cached label", log)
+        result.extend((draw(cached), draw(cached)))
+        result.append(draw(load("8", "Other label", log)))
+
+    thread = threading.Thread(target=run)
+    thread.start()
+    thread.join()
+
+    assert result == [expected, expected, expected_other]
+    assert expected != expected_other
+
+    stats = [
+        tuple(int(n) for n in match.groups())
+        for match in re.finditer(
+            r"text layout cache, (\d+) hits, (\d+) misses", log.read_text()
+        )
+    ]
+    assert len(stats) == 3
+    assert stats[0][1] > 0
+    assert stats[1][0] > 0 and stats[1][1] == 0
+    assert stats[2][1] > 0
@@ -207,6 +207,46 @@ def demime_file(filename):
     return
 
 
+###############################################################################
+# Decode the body of this file according to its Content-Encoding header, so
+# that compressed responses are compared on their headers and content rather
+# than on the output of a particular compression library.
+
+
+def decompress_file(filename):
+
+    import zlib
+
+    data = open(filename, "rb").read()
+
+    end = data.find(b"\r\n\r\n")
+    if end != -1:
+        end += 4
+    else:
+        end = data.find(b"\n\n")
+        if end == -1:
+            return
+        end += 2
+
+    encoding = None
+    for line in data[:end].splitlines():
+        if line.lower().startswith(b"content-encoding:"):
+            encoding = line[len(b"content-encoding:") :].strip().lower()
+
+    if encoding == b"gzip":
+        body = zlib.decompress(data[end:], 16 + zlib.MAX_WBITS)
+    elif encoding == b"deflate":
+        body = zlib.decompress(data[end:])
+    elif encoding == b"zstd":
+        import zstandard
+
+        body = zstandard.ZstdDecompressor().decompressobj().decompress(data[end:])
+    else:
+        return
+
+    open(filename, "wb").write(data[:end] + body)
+
+
 ###############################################################################
 # Strip MapServer version comment from file.
 
@@ -588,6 +628,11 @@ def _run(map, out_file, command, extra_args):
         else:
             deversion = 0
 
+    if command.find("[RESULT_DECOMPRESS]") != -1:
+        decompress = 1
+    else:
+        decompress = 0
+
     if command.find("[EXTRACT_SERVICE_VERSION]") != -1:
         extractserviceversion = 1
     else:
@@ -597,6 +642,7 @@ def _run(map, out_file, command, extra_args):
     command = command.replace("[RESULT_DEMIME]", "result/" + out_file)
     command = command.replace("[RESULT_DEVERSION]", "result/" + out_file)
     command = command.replace("[RESULT_DEMIME_DEVERSION]", "result/" + out_file)
+    command = command.replace("[RESULT_DECOMPRESS]", "result/" + out_file)
     command = command.replace("[EXTRACT_SERVICE_VERSION]", "result/" + out_file)
     command = command.replace("[MAPFILE]", os.path.basename(map))
     command = command.replace("[MAP2IMG]", map2img)
@@ -648,6 +694,8 @@ def _run(map, out_file, command, extra_args):
     command = command.replace("[MAPSERV]", "mapserv")
     command = command.replace("[LEGEND]", "legend")
     command = command.replace("[SCALEBAR]", "scalebar")
+    command = command.replace("[MAP2TILES]", "map2tiles")
+    command = command.replace("[MSREPLAY]", "msreplay")
 
     (command, strip_items) = collect_strip_requests(command)
 
@@ -691,6 +739,8 @@ def _run(map, out_file, command, extra_args):
     for envirkey in envir_keys:
         del os.environ[envirkey]
 
+    if decompress:
+        decompress_file("result/" + out_file)
     if demime:
         demime_file("result/" + out_file)
     if deversion:
@@ -0,0 +1,838 @@
+/******************************************************************************
+ * $Id$
+ *
+ * Project:  MapServer
+ * Purpose:  Commandline utility to pre-generate a pyramid of map tiles.
+ * Author:   MapServer Project
+ *
+ ******************************************************************************
+ * Copyright (c) 2026, MapServer Project
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies of this Software or works derived from this Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ ****************************************************************************/
+
+/*
+** Tiles are drawn exactly as mapserv draws mode=tile requests (Google Maps
+** addressing, spherical mercator): a metatile is set up with msTileSetup()
+** and msTileSetExtent(), drawn once with msDrawMap(), and the tiles are
+** then clipped out of it with msTileExtractSubTile().
+**
+** Each worker thread loads its own copy of the mapfile and picks the next
+** metatile to draw from a shared counter. Tiles are written either to a
+** z/x/y directory tree or to a SQLite file following the MBTiles layout.
+**
+** Vector tiles (MVT) cannot be clipped out of a larger tile, so they are
+** written one at a time by msMVTWriteTileEx() into a stdout buffer, like
+** mapserv answers mode=tile requests for an MVT output format.
+*/
+
+#include <math.h>
+
+#include "../mapserver.h"
+#include "../maptile.h"
+#include "../maptime.h"
+
+#include "cpl_conv.h"
+#include "cpl_multiproc.h"
+#include "cpl_string.h"
+#include "cpl_vsi.h"
+#include "gdal.h"
+
+#define SEED_MAX_ZOOM 30
+#define SEED_MAX_THREADS 256
+#define SEED_MAX_LATITUDE 85.0511287798066
+#define SEED_MBTILES_COMMIT_INTERVAL 1000
+
+typedef struct {
+  int zoom;
+  int level; /* metatile level actually used at this zoom */
+  int minx, miny, maxx, maxy; /* tile range */
+  int metaminx, metaminy, nmetax, nmetay;
+  long firstjob;
+} seedZoomObj;
+
+typedef struct {
+  /* options */
+  const char *mapfile;
+  const char *output;
+  const char *format;
+  const char *layers;
+  configObj *config;
+  double minlon, minlat, maxlon, maxlat;
+  int metatile_level;
+  int map_edge_buffer;
+  int keep_empty;
+  int debug;
+  int vector; /* MVT output, written tile by tile */
+
+  /* work */
+  seedZoomObj zooms[SEED_MAX_ZOOM + 1];
+  int numzooms;
+  long numjobs;
+  long nextjob;
+
+  /* output */
+  GDALDatasetH hMBTiles; /* NULL when writing to a directory */
+  const char *extension;
+  int uncommitted;
+
+  /* statistics */
+  long tiles_written;
+  long tiles_empty;
+  int failed;
+
+  CPLMutex *mutex;
+} seedContextObj;
+
+/************************************************************************/
+/*                           seedTileRange()                            */
+/*                                                                      */
+/*      Range of Google Maps tile coordinates covering a lon/lat box.   */
+/************************************************************************/
+
+static void seedTileRange(const seedContextObj *ctx, int zoom, int *minx,
+                          int *miny, int *maxx, int *maxy) {
+  const double n = pow(2.0, zoom);
+  const double minlat = MS_MAX(ctx->minlat, -SEED_MAX_LATITUDE);
+  const double maxlat = MS_MIN(ctx->maxlat, SEED_MAX_LATITUDE);
+  double fx, fy;
+
+  fx = (ctx->minlon + 180.0) / 360.0 * n;
+  *minx = (int)MS_MAX(0.0, floor(fx));
+  fx = (ctx->maxlon + 180.0) / 360.0 * n;
+  *maxx = (int)MS_MIN(n - 1, ceil(fx) - 1);
+
+  fy = (1.0 - asinh(tan(maxlat * MS_PI / 180.0)) / MS_PI) / 2.0 * n;
+  *miny = (int)MS_MAX(0.0, floor(fy));
+  fy = (1.0 - asinh(tan(minlat * MS_PI / 180.0)) / MS_PI) / 2.0 * n;
+  *maxy = (int)MS_MIN(n - 1, ceil(fy) - 1);
+
+  *maxx = MS_MAX(*maxx, *minx);
+  *maxy = MS_MAX(*maxy, *miny);
+}
+
+/************************************************************************/
+/*                           seedLoadMap()                              */
+/*                                                                      */
+/*      Load the mapfile and apply the command line overrides.          */
+/************************************************************************/
+
+static mapObj *seedLoadMap(const seedContextObj *ctx) {
+  mapObj *map;
+  char buffer[32];
+  int i, j;
+
+  map = msLoadMap(ctx->mapfile, NULL, ctx->config);
+  if (!map)
+    return NULL;
+  msApplyDefaultSubstitutions(map);
+  msApplyStyleItemsToLayers(map);
+
+  if (ctx->debug) {
+    map->debug = ctx->debug;
+    for (i = 0; i < map->numlayers; i++)
+      GET_LAYER(map, i)->debug = ctx->debug;
+  }
+
+  if (ctx->format) {
+    outputFormatObj *format = msSelectOutputFormat(map, ctx->format);
+    if (format == NULL) {
+      msSetError(MS_MISCERR, "No such OUTPUTFORMAT as %s.", "map2tiles()",
+                 ctx->format);
+      msFreeMap(map);
+      return NULL;
+    }
+    msFree((char *)map->imagetype);
+    map->imagetype = msStrdup(ctx->format);
+    msApplyOutputFormat(&(map->outputformat), format, MS_NOOVERRIDE);
+  }
+
+  if (ctx->layers) {
+    int num_layers = 0;
+    char **layers = msStringSplit(ctx->layers, ' ', &num_layers);
+
+    for (j = 0; j < num_layers; j++) {
+      int layer_found = 0;
+      for (i = 0; i < map->numlayers; i++) {
+        layerObj *layer = GET_LAYER(map, i);
+        if ((layer->name && strcasecmp(layer->name, layers[j]) == 0) ||
+            (layer->group && strcasecmp(layer->group, layers[j]) == 0)) {
+          layer_found = 1;
+          break;
+        }
+      }
+      if (!layer_found) {
+        msSetError(MS_MISCERR, "Layer (-l) \"%s\" not found", "map2tiles()",
+                   layers[j]);
+        msFreeCharArray(layers, num_layers);
+        msFreeMap(map);
+        return NULL;
+      }
+    }
+
+    for (i = 0; i < map->numlayers; i++) {
+      layerObj *layer = GET_LAYER(map, i);
+      if (layer->status == MS_DEFAULT)
+        continue;
+      layer->status = MS_OFF;
+      for (j = 0; j < num_layers; j++) {
+        if ((layer->name && strcasecmp(layer->name, layers[j]) == 0) ||
+            (layer->group && strcasecmp(layer->group, layers[j]) == 0)) {
+          layer->status = MS_ON;
+          break;
+        }
+      }
+    }
+    msFreeCharArray(layers, num_layers);
+  }
+
+  if (ctx->map_edge_buffer >= 0) {
+    snprintf(buffer, sizeof(buffer), "%d", ctx->map_edge_buffer);
+    msInsertHashTable(&(map->web.metadata), "tile_map_edge_buffer", buffer);
+  }
+
+  return map;
+}
+
+/************************************************************************/
+/*                          seedIsEmptyImage()                          */
+/*                                                                      */
+/*      An image is empty if it is fully transparent, or if it has no   */
+/*      alpha channel and only contains the map background color.       */
+/************************************************************************/
+
+static int seedIsEmptyImage(const mapObj *map, imageObj *img) {
+  rendererVTableObj *renderer = MS_IMAGE_RENDERER(img);
+  rasterBufferObj rb;
+  unsigned int x, y;
+
+  if (!MS_RENDERER_PLUGIN(img->format) || !renderer->supports_pixel_buffer ||
+      renderer->getRasterBufferHandle(img, &rb) != MS_SUCCESS ||
+      rb.type != MS_BUFFER_BYTE_RGBA)
+    return MS_FALSE;
+
+  for (y = 0; y < rb.height; y++) {
+    const unsigned int row = y * rb.data.rgba.row_step;
+    for (x = 0; x < rb.width; x++) {
+      const unsigned int off = row + x * rb.data.rgba.pixel_step;
+      if (rb.data.rgba.a) {
+        if (rb.data.rgba.a[off] != 0)
+          return MS_FALSE;
+      } else if (rb.data.rgba.r[off] != map->imagecolor.red ||
+                 rb.data.rgba.g[off] != map->imagecolor.green ||
+                 rb.data.rgba.b[off] != map->imagecolor.blue) {
+        return MS_FALSE;
+      }
+    }
+  }
+  return MS_TRUE;
+}
+
+/************************************************************************/
+/*                       seedIsVectorTileFormat()                       */
+/************************************************************************/
+
+static int seedIsVectorTileFormat(outputFormatObj *format) {
+  const char *mime = MS_IMAGE_MIME_TYPE(format);
+  return strcmp(mime, "application/vnd.mapbox-vector-tile") == 0 ||
+         strcmp(mime, "application/x-protobuf") == 0;
+}
+
+/************************************************************************/
+/*                           seedWriteTile()                            */
+/************************************************************************/
+
+static int seedWriteTile(seedContextObj *ctx, int zoom, int x, int y,
+                         const unsigned char *data, int size) {
+  if (ctx->hMBTiles) {
+    /* MBTiles rows are numbered from the bottom (TMS) */
+    char *hex = CPLBinaryToHex(size, data);
+    const size_t sql_size = strlen(hex) + 128;
+    char *sql = (char *)msSmallMalloc(sql_size);
+    int status = MS_SUCCESS;
+
+    snprintf(sql, sql_size,
+             "INSERT OR REPLACE INTO tiles VALUES (%d, %d, %d, X'%s')", zoom,
+             x, (1 << zoom) - 1 - y, hex);
+    CPLFree(hex);
+
+    CPLAcquireMutex(ctx->mutex, 1000.0);
+    if (ctx->uncommitted == 0)
+      GDALDatasetStartTransaction(ctx->hMBTiles, FALSE);
+    CPLErrorReset();
+    GDALDatasetExecuteSQL(ctx->hMBTiles, sql, NULL, NULL);
+    if (CPLGetLastErrorType() == CE_Failure) {
+      msSetError(MS_IOERR, "Failed to write tile %d/%d/%d: %s",
+                 "map2tiles()", zoom, x, y, CPLGetLastErrorMsg());
+      status = MS_FAILURE;
+    } else if (++ctx->uncommitted == SEED_MBTILES_COMMIT_INTERVAL) {
+      GDALDatasetCommitTransaction(ctx->hMBTiles);
+      ctx->uncommitted = 0;
+    }
+    CPLReleaseMutex(ctx->mutex);
+
+    msFree(sql);
+    return status;
+  } else {
+    char path[MS_MAXPATHLEN];
+    VSILFILE *fp;
+
+    snprintf(path, sizeof(path), "%s/%d/%d", ctx->output, zoom, x);
+    VSIMkdirRecursive(path, 0755);
+    snprintf(path, sizeof(path), "%s/%d/%d/%d.%s", ctx->output, zoom, x, y,
+             ctx->extension);
+    fp = VSIFOpenL(path, "wb");
+    if (fp == NULL) {
+      msSetError(MS_IOERR, "Failed to create %s", "map2tiles()", path);
+      return MS_FAILURE;
+    }
+    if (VSIFWriteL(data, 1, size, fp) != (size_t)size) {
+      VSIFCloseL(fp);
+      msSetError(MS_IOERR, "Failed to write %s", "map2tiles()", path);
+      return MS_FAILURE;
+    }
+    VSIFCloseL(fp);
+    return MS_SUCCESS;
+  }
+}
+
+/************************************************************************/
+/*                          seedVectorTile()                            */
+/*                                                                      */
+/*      Write one vector tile, as for a mapserv mode=tile request.      */
+/************************************************************************/
+
+static int seedVectorTile(seedContextObj *ctx, mapservObj *mapserv,
+                          const seedZoomObj *zoom, int x, int y) {
+  mapObj *map = mapserv->map;
+  msIOBuffer *buf;
+  char value[64];
+  int status, numfeatures;
+  long written = 0, empty = 0;
+
+  msFree(mapserv->TileCoords);
+  snprintf(value, sizeof(value), "%d %d %d", x, y, zoom->zoom);
+  mapserv->TileCoords = msStrdup(value);
+
+  if (msTileSetup(mapserv) != MS_SUCCESS ||
+      msTileSetExtent(mapserv) != MS_SUCCESS)
+    return MS_FAILURE;
+
+  msIO_installStdoutToBuffer();
+  status = msMVTWriteTileEx(map, MS_FALSE, &numfeatures);
+  buf = (msIOBuffer *)msIO_getHandler(stdout)->cbData;
+  if (status == MS_SUCCESS) {
+    if (numfeatures == 0 && !ctx->keep_empty) {
+      empty++;
+    } else {
+      status = seedWriteTile(ctx, zoom->zoom, x, y, buf->data,
+                             (int)buf->data_offset);
+      if (status == MS_SUCCESS)
+        written++;
+    }
+  }
+  msIO_resetHandlers();
+
+  CPLAcquireMutex(ctx->mutex, 1000.0);
+  ctx->tiles_written += written;
+  ctx->tiles_empty += empty;
+  CPLReleaseMutex(ctx->mutex);
+
+  return status;
+}
+
+/************************************************************************/
+/*                           seedMetatile()                             */
+/*                                                                      */
+/*      Draw one metatile, then slice and write the tiles it covers.    */
+/************************************************************************/
+
+static int seedMetatile(seedContextObj *ctx, mapservObj *mapserv,
+                        const seedZoomObj *zoom, int metax, int metay) {
+  mapObj *map = mapserv->map;
+  imageObj *metatile;
+  char value[64];
+  int x, y, status = MS_SUCCESS;
+  long written = 0, empty = 0;
+  const int minx = MS_MAX(zoom->minx, metax << zoom->level);
+  const int maxx = MS_MIN(zoom->maxx, ((metax + 1) << zoom->level) - 1);
+  const int miny = MS_MAX(zoom->miny, metay << zoom->level);
+  const int maxy = MS_MIN(zoom->maxy, ((metay + 1) << zoom->level) - 1);
+  const char *edge_buffer;
+  int extract;
+
+  if (ctx->vector)
+    return seedVectorTile(ctx, mapserv, zoom, metax, metay);
+
+  snprintf(value, sizeof(value), "%d", zoom->level);
+  msInsertHashTable(&(map->web.metadata), "tile_metatile_level", value);
+
+  msFree(mapserv->TileCoords);
+  snprintf(value, sizeof(value), "%d %d %d", minx, miny, zoom->zoom);
+  mapserv->TileCoords = msStrdup(value);
+
+  if (msTileSetup(mapserv) != MS_SUCCESS ||
+      msTileSetExtent(mapserv) != MS_SUCCESS)
+    return MS_FAILURE;
+
+  metatile = msDrawMap(map, MS_FALSE);
+  if (!metatile)
+    return MS_FAILURE;
+
+  /* as in msTileDraw(), only clip when there is more than the tile */
+  edge_buffer =
+      msLookupHashTable(&(map->web.metadata), "tile_map_edge_buffer");
+  extract = zoom->level > 0 || (edge_buffer && atoi(edge_buffer) > 0);
+
+  if (!ctx->keep_empty && seedIsEmptyImage(map, metatile)) {
+    empty = (long)(maxx - minx + 1) * (maxy - miny + 1);
+    goto done;
+  }
+
+  for (y = miny; y <= maxy && status == MS_SUCCESS; y++) {
+    for (x = minx; x <= maxx && status == MS_SUCCESS; x++) {
+      imageObj *tile = metatile;
+      unsigned char *data;
+      int size = 0;
+
+      if (extract) {
+        msFree(mapserv->TileCoords);
+        snprintf(value, sizeof(value), "%d %d %d", x, y, zoom->zoom);
+        mapserv->TileCoords = msStrdup(value);
+        tile = msTileExtractSubTile(mapserv, metatile);
+        if (!tile) {
+          status = MS_FAILURE;
+          break;
+        }
+        if (!ctx->keep_empty && seedIsEmptyImage(map, tile)) {
+          msFreeImage(tile);
+          empty++;
+          continue;
+        }
+      }
+
+      data = msSaveImageBuffer(tile, &size, map->outputformat);
+      if (tile != metatile)
+        msFreeImage(tile);
+      if (!data) {
+        status = MS_FAILURE;
+        break;
+      }
+      status = seedWriteTile(ctx, zoom->zoom, x, y, data, size);
+      msFree(data);
+      if (status == MS_SUCCESS)
+        written++;
+    }
+  }
+
+done:
+  msFreeImage(metatile);
+
+  CPLAcquireMutex(ctx->mutex, 1000.0);
+  ctx->tiles_written += written;
+  ctx->tiles_empty += empty;
+  CPLReleaseMutex(ctx->mutex);
+
+  return status;
+}
+
+/************************************************************************/
+/*                            seedWorker()                              */
+/************************************************************************/
+
+static void seedWorker(void *arg) {
+  seedContextObj *ctx = (seedContextObj *)arg;
+  mapservObj *mapserv;
+  mapObj *map = seedLoadMap(ctx);
+
+  if (!map) {
+    CPLAcquireMutex(ctx->mutex, 1000.0);
+    msWriteError(stderr);
+    ctx->failed = MS_TRUE;
+    CPLReleaseMutex(ctx->mutex);
+    msResetErrorList();
+    return;
+  }
+
+  mapserv = msAllocMapServObj();
+  mapserv->map = map;
+  mapserv->TileMode = TILE_GMAP;
+  mapserv->sendheaders = MS_FALSE;
+
+  for (;;) {
+    const seedZoomObj *zoom = NULL;
+    long job;
+    int i;
+
+    CPLAcquireMutex(ctx->mutex, 1000.0);
+    job = ctx->failed ? ctx->numjobs : ctx->nextjob++;
+    CPLReleaseMutex(ctx->mutex);
+    if (job >= ctx->numjobs)
+      break;
+
+    for (i = ctx->numzooms - 1; i >= 0; i--) {
+      if (job >= ctx->zooms[i].firstjob) {
+        zoom = &(ctx->zooms[i]);
+        break;
+      }
+    }
+    job -= zoom->firstjob;
+
+    if (seedMetatile(ctx, mapserv, zoom, zoom->metaminx + job % zoom->nmetax,
+                     zoom->metaminy + job / zoom->nmetax) != MS_SUCCESS) {
+      CPLAcquireMutex(ctx->mutex, 1000.0);
+      msWriteError(stderr);
+      ctx->failed = MS_TRUE;
+      CPLReleaseMutex(ctx->mutex);
+      break;
+    }
+  }
+
+  msFreeMapServObj(mapserv);
+  msResetErrorList();
+  msFontCacheThreadCleanup();
+}
+
+/************************************************************************/
+/*                         seedWriteMetadata()                          */
+/************************************************************************/
+
+static void seedWriteMetadata(seedContextObj *ctx, const char *name,
+                              const char *value) {
+  char *escaped = msReplaceSubstring(msStrdup(value), "'", "''");
+  char *sql = msStringConcatenate(
+      msStrdup("INSERT OR REPLACE INTO metadata VALUES ('"), name);
+  sql = msStringConcatenate(sql, "', '");
+  sql = msStringConcatenate(sql, escaped);
+  sql = msStringConcatenate(sql, "')");
+  GDALDatasetExecuteSQL(ctx->hMBTiles, sql, NULL, NULL);
+  msFree(sql);
+  msFree(escaped);
+}
+
+/************************************************************************/
+/*                          seedOpenOutput()                            */
+/************************************************************************/
+
+static int seedOpenOutput(seedContextObj *ctx, mapObj *map, int minzoom,
+                          int maxzoom) {
+  const char *ext = CPLGetExtension(ctx->output);
+  char value[256];
+
+  if (!EQUAL(ext, "mbtiles") && !EQUAL(ext, "sqlite")) {
+    if (VSIMkdirRecursive(ctx->output, 0755) != 0) {
+      VSIStatBufL sStat;
+      if (VSIStatL(ctx->output, &sStat) != 0 || !VSI_ISDIR(sStat.st_mode)) {
+        msSetError(MS_IOERR, "Failed to create directory %s", "map2tiles()",
+                   ctx->output);
+        return MS_FAILURE;
+      }
+    }
+    return MS_SUCCESS;
+  } else {
+    GDALDriverH hDriver = GDALGetDriverByName("SQLite");
+    char **options = CSLSetNameValue(NULL, "METADATA", "NO");
+    const char *const statements[] = {
+        "CREATE TABLE IF NOT EXISTS metadata (name TEXT, value TEXT)",
+        "CREATE UNIQUE INDEX IF NOT EXISTS name ON metadata (name)",
+        "CREATE TABLE IF NOT EXISTS tiles (zoom_level INTEGER, tile_column "
+        "INTEGER, tile_row INTEGER, tile_data BLOB)",
+        "CREATE UNIQUE INDEX IF NOT EXISTS tile_index ON tiles (zoom_level, "
+        "tile_column, tile_row)",
+        NULL};
+    int i;
+
+    if (hDriver == NULL) {
+      msSetError(MS_MISCERR, "GDAL is built without the SQLite driver.",
+                 "map2tiles()");
+      CSLDestroy(options);
+      return MS_FAILURE;
+    }
+    CPLPushErrorHandler(CPLQuietErrorHandler);
+    ctx->hMBTiles = GDALOpenEx(ctx->output, GDAL_OF_VECTOR | GDAL_OF_UPDATE,
+                               NULL, NULL, NULL);
+    CPLPopErrorHandler();
+    if (ctx->hMBTiles == NULL)
+      ctx->hMBTiles =
+          GDALCreate(hDriver, ctx->output, 0, 0, 0, GDT_Unknown, options);
+    CSLDestroy(options);
+    if (ctx->hMBTiles == NULL) {
+      msSetError(MS_IOERR, "Failed to create %s: %s", "map2tiles()",
+                 ctx->output, CPLGetLastErrorMsg());
+      return MS_FAILURE;
+    }
+
+    for (i = 0; statements[i]; i++)
+      GDALDatasetExecuteSQL(ctx->hMBTiles, statements[i], NULL, NULL);
+
+    snprintf(value, sizeof(value), "%.8g,%.8g,%.8g,%.8g", ctx->minlon,
+             ctx->minlat, ctx->maxlon, ctx->maxlat);
+    seedWriteMetadata(ctx, "bounds", value);
+    seedWriteMetadata(ctx, "format", ctx->extension);
+    snprintf(value, sizeof(value), "%d", maxzoom);
+    seedWriteMetadata(ctx, "maxzoom", value);
+    snprintf(value, sizeof(value), "%d", minzoom);
+    seedWriteMetadata(ctx, "minzoom", value);
+    seedWriteMetadata(ctx, "name", map->name ? map->name : "");
+    seedWriteMetadata(ctx, "type", "baselayer");
+    seedWriteMetadata(ctx, "version", "1.1");
+
+    return MS_SUCCESS;
+  }
+}
+
+/************************************************************************/
+/*                                main()                                */
+/************************************************************************/
+
+static void usage(void) {
+  fprintf(stdout, "\nPurpose: pre-generate map tiles from a mapfile\n\n");
+  fprintf(stdout,
+          "Syntax: map2tiles -m mapfile -o output -z minzoom maxzoom\n"
+          "               [-e minlon minlat maxlon maxlat] [-l \"layer1 "
+          "[layers2...]\"]\n"
+          "               [-i format] [-metatile n] [-buffer n] [-t n]\n"
+          "               [-keep_empty] [-all_debug n] [-conf filename]\n");
+  fprintf(stdout, "  -m mapfile: Map file to operate on - required\n");
+  fprintf(stdout, "  -o output: output directory (tiles written as "
+                  "z/x/y.ext), or .mbtiles file\n");
+  fprintf(stdout, "  -z minzoom maxzoom: zoom levels to generate\n");
+  fprintf(stdout, "  -e minlon minlat maxlon maxlat: area to generate "
+                  "(default: whole world)\n");
+  fprintf(stdout, "  -l layers: layers / groups to enable - make sure they "
+                  "are quoted and space separated if more than one listed\n");
+  fprintf(
+      stdout,
+      "  -i format: Override the IMAGETYPE value to pick output format\n");
+  fprintf(stdout, "  -metatile n: draw metatiles of 2^n x 2^n tiles "
+                  "(default: tile_metatile_level, or 0), ignored for MVT\n");
+  fprintf(stdout, "  -buffer n: metatile edge buffer in pixels (default: "
+                  "tile_map_edge_buffer, or 0)\n");
+  fprintf(stdout, "  -t n: number of worker threads, or ALL_CPUS (default: "
+                  "1)\n");
+  fprintf(stdout, "  -keep_empty: also write tiles where nothing was drawn\n");
+  fprintf(stdout, "  -all_debug n: Set debug level for map and all layers\n");
+  fprintf(
+      stdout,
+      "  -conf filename: filename of the MapServer configuration file.\n");
+}
+
+int main(int argc, char *argv[]) {
+  seedContextObj ctx;
+  mapObj *map;
+  const char *config_filename = NULL;
+  const char *metatile_level;
+  int minzoom = -1, maxzoom = -1, numthreads = 1, i;
+  int status = 0;
+  struct mstimeval starttime, endtime;
+  double elapsed;
+
+  if (argc > 1 && strcmp(argv[1], "-v") == 0) {
+    printf("%s\n", msGetVersion());
+    exit(0);
+  }
+  if (argc < 3) {
+    usage();
+    exit(0);
+  }
+
+  memset(&ctx, 0, sizeof(ctx));
+  ctx.minlon = -180.0;
+  ctx.minlat = -SEED_MAX_LATITUDE;
+  ctx.maxlon = 180.0;
+  ctx.maxlat = SEED_MAX_LATITUDE;
+  ctx.metatile_level = -1;
+  ctx.map_edge_buffer = -1;
+
+  for (i = 1; i < argc; i++) {
+    const int remaining = argc - i - 1;
+    if (strcmp(argv[i], "-m") == 0 && remaining >= 1) {
+      ctx.mapfile = argv[++i];
+    } else if (strcmp(argv[i], "-o") == 0 && remaining >= 1) {
+      ctx.output = argv[++i];
+    } else if (strcmp(argv[i], "-z") == 0 && remaining >= 2) {
+      minzoom = atoi(argv[++i]);
+      maxzoom = atoi(argv[++i]);
+    } else if (strcmp(argv[i], "-e") == 0 && remaining >= 4) {
+      ctx.minlon = atof(argv[++i]);
+      ctx.minlat = atof(argv[++i]);
+      ctx.maxlon = atof(argv[++i]);
+      ctx.maxlat = atof(argv[++i]);
+    } else if (strcmp(argv[i], "-l") == 0 && remaining >= 1) {
+      ctx.layers = argv[++i];
+    } else if (strcmp(argv[i], "-i") == 0 && remaining >= 1) {
+      ctx.format = argv[++i];
+    } else if (strcmp(argv[i], "-metatile") == 0 && remaining >= 1) {
+      ctx.metatile_level = atoi(argv[++i]);
+    } else if (strcmp(argv[i], "-buffer") == 0 && remaining >= 1) {
+      ctx.map_edge_buffer = MS_MAX(0, atoi(argv[++i]));
+    } else if (strcmp(argv[i], "-t") == 0 && remaining >= 1) {
+      i++;
+      numthreads =
+          EQUAL(argv[i], "ALL_CPUS") ? CPLGetNumCPUs() : atoi(argv[i]);
+    } else if (strcmp(argv[i], "-keep_empty") == 0) {
+      ctx.keep_empty = MS_TRUE;
+    } else if (strcmp(argv[i], "-all_debug") == 0 && remaining >= 1) {
+      ctx.debug = atoi(argv[++i]);
+      msSetGlobalDebugLevel(ctx.debug);
+    } else if (strcmp(argv[i], "-conf") == 0 && remaining >= 1) {
+      config_filename = argv[++i];
+    } else {
+      fprintf(stderr, "Unknown or incomplete argument %s.\n", argv[i]);
+      exit(1);
+    }
+  }
+
+  if (!ctx.mapfile || !ctx.output || minzoom < 0 || maxzoom < minzoom ||
+      maxzoom > SEED_MAX_ZOOM) {
+    fprintf(stderr, "The -m, -o and -z options are required, with 0 <= "
+                    "minzoom <= maxzoom <= %d.\n",
+            SEED_MAX_ZOOM);
+    exit(1);
+  }
+  if (ctx.minlon >= ctx.maxlon || ctx.minlat >= ctx.maxlat) {
+    fprintf(stderr, "Invalid -e extent.\n");
+    exit(1);
+  }
+  numthreads = MS_MAX(1, MS_MIN(numthreads, SEED_MAX_THREADS));
+#ifndef USE_THREAD
+  if (numthreads > 1) {
+    fprintf(stderr, "MapServer is built without thread support, using a "
+                    "single thread.\n");
+    numthreads = 1;
+  }
+#endif
+
+  if (ctx.debug && msGetErrorFile() == NULL)
+    msSetErrorFile("stderr", NULL);
+
+  if (msSetup() != MS_SUCCESS) {
+    msWriteError(stderr);
+    exit(1);
+  }
+  ctx.config = msLoadConfig(config_filename);
+  msFontCacheBoundGlyphStore();
+  msProjDataInitFromEnv();
+  if (msDebugInitFromEnv() != MS_SUCCESS) {
+    msWriteError(stderr);
+    msCleanup();
+    msFreeConfig(ctx.config);
+    exit(1);
+  }
+
+  /* Validate the options once, before starting the workers. */
+  map = seedLoadMap(&ctx);
+  if (!map) {
+    msWriteError(stderr);
+    msCleanup();
+    msFreeConfig(ctx.config);
+    exit(1);
+  }
+  ctx.vector = seedIsVectorTileFormat(map->outputformat);
+  if (!ctx.vector && (!MS_RENDERER_PLUGIN(map->outputformat) ||
+                      !MS_MAP_RENDERER(map)->supports_pixel_buffer)) {
+    fprintf(stderr, "Output format %s cannot be sliced into tiles.\n",
+            map->outputformat->name);
+    msFreeMap(map);
+    msCleanup();
+    msFreeConfig(ctx.config);
+    exit(1);
+  }
+  ctx.extension = map->outputformat->extension ? map->outputformat->extension
+                                               : "img";
+
+  if (ctx.metatile_level < 0) {
+    metatile_level =
+        msLookupHashTable(&(map->web.metadata), "tile_metatile_level");
+    ctx.metatile_level = metatile_level ? atoi(metatile_level) : 0;
+  }
+  /* same limit as msTileSetup() */
+  ctx.metatile_level = MS_MAX(0, MS_MIN(ctx.metatile_level, 2));
+  if (ctx.vector) {
+    /* vector tiles are written one by one, without a pixel buffer */
+    ctx.metatile_level = 0;
+    ctx.map_edge_buffer = 0;
+  }
+
+  if (seedOpenOutput(&ctx, map, minzoom, maxzoom) != MS_SUCCESS) {
+    msWriteError(stderr);
+    msFreeMap(map);
+    msCleanup();
+    msFreeConfig(ctx.config);
+    exit(1);
+  }
+  msFreeMap(map);
+
+  /* Enumerate the metatiles of each zoom level. */
+  for (i = minzoom; i <= maxzoom; i++) {
+    seedZoomObj *zoom = &(ctx.zooms[ctx.numzooms++]);
+    zoom->zoom = i;
+    /* msTileSetup() only metatiles below the requested zoom */
+    zoom->level = MS_MIN(ctx.metatile_level, MS_MAX(i - 1, 0));
+    seedTileRange(&ctx, i, &zoom->minx, &zoom->miny, &zoom->maxx,
+                  &zoom->maxy);
+    zoom->metaminx = zoom->minx >> zoom->level;
+    zoom->metaminy = zoom->miny >> zoom->level;
+    zoom->nmetax = (zoom->maxx >> zoom->level) - zoom->metaminx + 1;
+    zoom->nmetay = (zoom->maxy >> zoom->level) - zoom->metaminy + 1;
+    zoom->firstjob = ctx.numjobs;
+    ctx.numjobs += (long)zoom->nmetax * zoom->nmetay;
+  }
+  numthreads = (int)MS_MIN(numthreads, ctx.numjobs);
+
+  ctx.mutex = CPLCreateMutex(); /* created acquired */
+  CPLReleaseMutex(ctx.mutex);
+
+  msGettimeofday(&starttime, NULL);
+  if (numthreads <= 1) {
+    seedWorker(&ctx);
+  } else {
+    CPLJoinableThread **threads = (CPLJoinableThread **)msSmallCalloc(
+        numthreads, sizeof(CPLJoinableThread *));
+    for (i = 0; i < numthreads; i++)
+      threads[i] = CPLCreateJoinableThread(seedWorker, &ctx);
+    for (i = 0; i < numthreads; i++)
+      if (threads[i])
+        CPLJoinThread(threads[i]);
+    msFree(threads);
+  }
+  msGettimeofday(&endtime, NULL);
+
+  if (ctx.hMBTiles) {
+    if (ctx.uncommitted > 0)
+      GDALDatasetCommitTransaction(ctx.hMBTiles);
+    GDALClose(ctx.hMBTiles);
+  }
+  CPLDestroyMutex(ctx.mutex);
+
+  elapsed = (endtime.tv_sec + endtime.tv_usec / 1.0e6) -
+            (starttime.tv_sec + starttime.tv_usec / 1.0e6);
+  fprintf(stdout,
+          "%ld metatiles, %ld tiles written, %ld empty tiles skipped in "
+          "%.3fs (%.1f tiles/s, %d threads)\n",
+          ctx.numjobs, ctx.tiles_written, ctx.tiles_empty, elapsed,
+          elapsed > 0 ? (ctx.tiles_written + ctx.tiles_empty) / elapsed : 0.0,
+          numthreads);
+  if (ctx.failed)
+    status = 1;
+
+  msCleanup();
+  msFreeConfig(ctx.config);
+  return status;
+}
@@ -32,6 +32,7 @@
 #endif
 
 #include "mapserver-config.h"
+#include <ctype.h>
 #include <stdbool.h>
 #include <stdlib.h>
 #include <string.h>
@@ -43,12 +44,19 @@
 
 #include "mapserv.h"
 #include "../mapio.h"
+#include "../mapmetrics.h"
 #include "../maptime.h"
 
+#include "cpl_atomic_ops.h"
 #include "cpl_conv.h"
+#include "cpl_multiproc.h"
 
 #ifndef _WIN32
 #include <signal.h>
+#if defined(USE_FASTCGI) && defined(USE_THREAD)
+#include <pthread.h>
+#include <sys/socket.h>
+#endif
 #endif
 
 /************************************************************************/
@@ -131,15 +139,494 @@ static int msIO_installFastCGIRedirect()
 }
 
 #endif
+
+/************************************************************************/
+/*                           Request workers.                           */
+/************************************************************************/
+
+/*
+** The settings used to process requests, and the state of the thread
+** processing them: the whole process, or one of the threads of the
+** threaded FastCGI mode, each with its own copy.
+*/
+typedef struct {
+  configObj *config;
+  int sendheaders;
+  int metrics;
+  int metrics_file; /* write MS_METRICS_FILE, only under FastCGI */
+  int trace;
+  const char *index_dir;
+  const char *metrics_path;
+  const char *compression;
+  int compression_level;
+  double request_timeout; /* seconds, 0 for no time budget */
+
+  msIOContext metrics_stdout_context; /* handler wrapped by the metrics */
+  size_t metrics_bytes_out;
+} mapservWorker;
+
+/************************************************************************/
+/*                          Request metrics.                            */
+/************************************************************************/
+
+static int msIO_metricsWrite(void *cbData, void *data, int byteCount)
+
+{
+  mapservWorker *worker = (mapservWorker *)cbData;
+  msIOContext *context = &worker->metrics_stdout_context;
+  int nWritten = context->readWriteFunc(context->cbData, data, byteCount);
+  if (nWritten > 0)
+    worker->metrics_bytes_out += nWritten;
+  return nWritten;
+}
+
+/* Wraps the current stdout handler to count the bytes sent to the client. */
+static void msIO_installMetricsRedirect(mapservWorker *worker)
+
+{
+  msIOContext stdout_ctx;
+
+  worker->metrics_stdout_context = *msIO_getHandler(stdout);
+
+  stdout_ctx.label = worker->metrics_stdout_context.label;
+  stdout_ctx.write_channel = MS_TRUE;
+  stdout_ctx.readWriteFunc = msIO_metricsWrite;
+  stdout_ctx.cbData = (void *)worker;
+
+  msIO_installHandlers(msIO_getHandler(stdin), &stdout_ctx,
+                       msIO_getHandler(stderr));
+}
+
+/* Is this a request for the metrics, from the local host? */
+static int msCGIIsMetricsRequest(const char *metrics_path) {
+  const char *path_info = msIO_getenv("PATH_INFO");
+  const char *remote_addr = msIO_getenv("REMOTE_ADDR");
+
+  if (!metrics_path || !path_info || strcmp(path_info, metrics_path) != 0)
+    return MS_FALSE;
+  return remote_addr == NULL || strcmp(remote_addr, "127.0.0.1") == 0 ||
+         strcmp(remote_addr, "::1") == 0;
+}
+
+/*
+** Time budget of the request in seconds, or 0 for none: the configured
+** timeout, lowered by the X-Request-Timeout header if the client wants an
+** answer sooner.
+*/
+static double msCGIGetRequestTimeout(double configured) {
+  const char *header = msIO_getenv("HTTP_X_REQUEST_TIMEOUT");
+  const double requested = header ? atof(header) : 0;
+
+  if (requested > 0 && (configured <= 0 || requested < configured))
+    return requested;
+  return configured > 0 ? configured : 0;
+}
+
+static void msCGIWriteMetrics(void) {
+  char *text = msMetricsToPrometheus();
+
+  msIO_setHeader("Content-Type", "text/plain; version=0.0.4");
+  msIO_sendHeaders();
+  msIO_fwrite(text, 1, strlen(text), stdout);
+  free(text);
+}
+
+/************************************************************************/
+/*                         msCGIHandleRequest()                         */
+/*                                                                      */
+/*      Processes the request whose input, output and environment       */
+/*      are set up for the calling thread.                              */
+/************************************************************************/
+static void msCGIHandleRequest(mapservWorker *worker)
+
+{
+  struct mstimeval requeststarttime, requestendtime;
+  mapservObj *mapserv = NULL;
+  int metrics_request = MS_FALSE, trace = MS_FALSE, compress = MS_FALSE;
+  double metricsstarttime = 0;
+  responseCacheRequest *response_cache = NULL;
+
+  /* glyphs used by the previous request of this thread are not in use */
+  msFontCacheQuiesce();
+
+  /* -------------------------------------------------------------------- */
+  /*      Process a request.                                              */
+  /* -------------------------------------------------------------------- */
+  mapserv = msAllocMapServObj();
+  /* override the default if necessary (via command line -nh switch) */
+  mapserv->sendheaders = worker->sendheaders;
+
+  /* compress textual responses for the clients accepting it */
+  compress = worker->sendheaders &&
+             msIO_pushStdoutCompression(worker->compression,
+                                        msIO_getenv("HTTP_ACCEPT_ENCODING"),
+                                        worker->compression_level);
+
+  metricsstarttime = msMetricsTime();
+  if (worker->metrics) {
+    worker->metrics_bytes_out = 0;
+    metrics_request = msCGIIsMetricsRequest(worker->metrics_path);
+    if (metrics_request) {
+      msCGIWriteMetrics();
+      goto end_request;
+    }
+  }
+  trace = worker->trace && msTraceStart();
+
+  mapserv->request->NumParams =
+      loadParams(mapserv->request, NULL, NULL, 0, NULL);
+
+  if (msCGIIsAPIRequest(mapserv) == MS_FALSE &&
+      mapserv->request->NumParams == -1) { /* no QUERY_STRING or PATH_INFO */
+    if (worker->index_dir != NULL) {
+      // return the landing page
+      msCGIDispatchIndexRequest(mapserv, worker->config);
+      goto end_request;
+    }
+    msCGIWriteError(mapserv);
+    goto end_request;
+  }
+
+  mapserv->map = msCGILoadMap(mapserv, worker->config);
+  if (!mapserv->map) {
+    for (int i = 0; i < mapserv->request->NumParams;
+         i++) { /* a map parameter was sent */
+      if (strcasecmp(mapserv->request->ParamNames[i], "map") == 0) {
+        msCGIWriteError(mapserv);
+        goto end_request;
+      }
+    }
+    if (worker->index_dir != NULL && mapserv->request->path_info != NULL &&
+        strcmp(mapserv->request->path_info, "/") == 0) {
+      // return the landing page
+      msCGIDispatchIndexRequest(mapserv, worker->config);
+      goto end_request;
+    }
+    msCGIWriteError(mapserv);
+    goto end_request;
+  }
+
+  /* the time budget counts from the loading of the mapfile */
+  msMapSetTimeout(mapserv->map,
+                  msCGIGetRequestTimeout(worker->request_timeout));
+
+  if (mapserv->map->debug >= MS_DEBUGLEVEL_TUNING)
+    msGettimeofday(&requeststarttime, NULL);
+
+#ifdef USE_FASTCGI
+  if (mapserv->map->debug) {
+    /* counted across the worker threads */
+    static volatile int nRequestCounter = 0;
+
+    msDebug("CGI Request %d on process %d\n", CPLAtomicInc(&nRequestCounter),
+            getpid());
+  }
+#endif
+
+  /* serve identical map and tile requests from the response cache */
+  if (msResponseCacheBegin(mapserv, worker->config, &response_cache) == MS_DONE)
+    goto end_request;
+
+  if (mapserv->request->api_path != NULL) {
+    switch (mapserv->request->api_path_length) {
+    case 0: // just in case, treat as normal
+      if (msCGIDispatchRequest(mapserv) != MS_SUCCESS) {
+        msCGIWriteError(mapserv);
+        goto end_request;
+      }
+      break;
+
+    case 1:
+      if (worker->index_dir != NULL) {
+        // Try normal dispatch first
+        if (msCGIDispatchRequest(mapserv) != MS_SUCCESS) {
+          errorObj *ms_error = msGetErrorObj();
+          int show_index = MS_FALSE;
+          if (mapserv->request->NumParams == 0) {
+            show_index = MS_TRUE;
+          } else if (ms_error != NULL && ms_error->code == MS_WEBERR) {
+            if (strstr(ms_error->message, "No query information to decode") !=
+                    NULL ||
+                strstr(ms_error->message,
+                       "Traditional BROWSE mode requires a TEMPLATE") !=
+                    NULL) {
+              // Fallback to landing page
+              show_index = MS_TRUE;
+            }
+          }
+
+          if (show_index && msCGIDispatchMapIndexRequest(
+                                mapserv, worker->config) == MS_SUCCESS) {
+          } else {
+            msCGIWriteError(mapserv);
+            goto end_request;
+          }
+        }
+      } else {
+        if (msCGIDispatchRequest(mapserv) != MS_SUCCESS) {
+          msCGIWriteError(mapserv);
+          goto end_request;
+        }
+      }
+      break;
+
+    default: // length > 1
+      if (msCGIDispatchAPIRequest(mapserv) != MS_SUCCESS) {
+        msCGIWriteError(mapserv);
+        goto end_request;
+      }
+      break;
+    }
+  } else {
+    // api_path == NULL
+    if (msCGIDispatchRequest(mapserv) != MS_SUCCESS) {
+      msCGIWriteError(mapserv);
+      goto end_request;
+    }
+  }
+
+end_request:
+  if (response_cache) {
+    errorObj *ms_error = msGetErrorObj();
+    msResponseCacheEnd(response_cache, ms_error->code == MS_NOERR);
+    response_cache = NULL;
+  }
+  if (compress) {
+    msIO_popStdoutCompression();
+    compress = MS_FALSE;
+  }
+  if (mapserv->map && mapserv->map->debug >= MS_DEBUGLEVEL_TUNING) {
+    msGettimeofday(&requestendtime, NULL);
+    msDebug("mapserv request processing time (msLoadMap not incl.): %.3fs\n",
+            (requestendtime.tv_sec + requestendtime.tv_usec / 1.0e6) -
+                (requeststarttime.tv_sec + requeststarttime.tv_usec / 1.0e6));
+  }
+  if ((worker->metrics || trace) && !metrics_request) {
+    char type[64];
+    msCGIGetRequestType(mapserv, type, sizeof(type));
+    if (worker->metrics) {
+      msMetricsAdd(MS_METRIC_REQUESTS, type, 1);
+      msMetricsAdd(MS_METRIC_REQUEST_DURATION, type,
+                   msMetricsTime() - metricsstarttime);
+      msMetricsAdd(MS_METRIC_RESPONSE_BYTES, type,
+                   worker->metrics_bytes_out);
+      if (worker->metrics_file)
+        msMetricsWriteFile(MS_FALSE);
+    }
+    if (trace)
+      msTraceAdd("mapserv request", type, metricsstarttime);
+  }
+  if (trace)
+    msTraceWrite();
+  if (mapserv->map)
+    msResetMapConfigOptions(mapserv->map);
+  msFreeMapServObj(mapserv);
+}
+
+/************************************************************************/
+/*                          msCGIRunRequests()                          */
+/*                                                                      */
+/*      Processes the CGI request, or in the FastCGI case loops         */
+/*      processing requests one at a time.                              */
+/************************************************************************/
+static void msCGIRunRequests(mapservWorker *worker)
+
+{
+#ifdef USE_FASTCGI
+  msIO_installFastCGIRedirect();
+#endif
+
+  if (worker->metrics)
+    msIO_installMetricsRedirect(worker);
+
+#ifdef USE_FASTCGI
+  /* In FastCGI case we loop accepting multiple requests.  In normal CGI */
+  /* use we only accept and process one request.  */
+  while (!finish_process && FCGI_Accept() >= 0) {
+#endif /* def USE_FASTCGI */
+
+    msCGIHandleRequest(worker);
+
+#ifdef USE_FASTCGI
+    /* FCGI_ --- return to top of loop */
+    msResetErrorList();
+  } /* end fastcgi loop */
+#endif
+}
+
+#if defined(USE_FASTCGI) && defined(USE_THREAD)
+
+/************************************************************************/
+/*                          msIO_fcgxRead()                             */
+/************************************************************************/
+
+static int msIO_fcgxRead(void *cbData, void *data, int byteCount)
+
+{
+  return FCGX_GetStr((char *)data, byteCount, (FCGX_Stream *)cbData);
+}
+
+/************************************************************************/
+/*                          msIO_fcgxWrite()                            */
+/************************************************************************/
+
+static int msIO_fcgxWrite(void *cbData, void *data, int byteCount)
+
+{
+  return FCGX_PutStr((const char *)data, byteCount, (FCGX_Stream *)cbData);
+}
+
+/************************************************************************/
+/*                 msIO_installFastCGIRequestRedirect()                 */
+/*                                                                      */
+/*      Redirects the msIO channels of the calling thread to the        */
+/*      streams of a FastCGI request, and its environment to the one    */
+/*      of the request.                                                 */
+/************************************************************************/
+static void msIO_installFastCGIRequestRedirect(FCGX_Request *request)
+
+{
+  msIOContext stdin_ctx, stdout_ctx, stderr_ctx;
+
+  stdin_ctx.label = "fcgi";
+  stdin_ctx.write_channel = MS_FALSE;
+  stdin_ctx.readWriteFunc = msIO_fcgxRead;
+  stdin_ctx.cbData = (void *)request->in;
+
+  stdout_ctx.label = "fcgi";
+  stdout_ctx.write_channel = MS_TRUE;
+  stdout_ctx.readWriteFunc = msIO_fcgxWrite;
+  stdout_ctx.cbData = (void *)request->out;
+
+  stderr_ctx.label = "fcgi";
+  stderr_ctx.write_channel = MS_TRUE;
+  stderr_ctx.readWriteFunc = msIO_fcgxWrite;
+  stderr_ctx.cbData = (void *)request->err;
+
+  msIO_installHandlers(&stdin_ctx, &stdout_ctx, &stderr_ctx);
+  msIO_setRequestEnvironment(request->envp);
+}
+
+#ifndef _WIN32
+static pthread_t mainThread;
+#endif
+
+/************************************************************************/
+/*                         msCGIWorkerThread()                          */
+/************************************************************************/
+static void msCGIWorkerThread(void *arg)
+
+{
+  mapservWorker worker = *(mapservWorker *)arg;
+  FCGX_Request request;
+
+  FCGX_InitRequest(&request, 0, 0);
+
+  while (!finish_process) {
+    int rc;
+
+    /* one thread at a time waits in accept(), see the libfcgi examples */
+    msAcquireLock(TLOCK_FCGI);
+    rc = finish_process ? -1 : FCGX_Accept_r(&request);
+    msReleaseLock(TLOCK_FCGI);
+    if (rc < 0)
+      break;
+
+    msIO_installFastCGIRequestRedirect(&request);
+    if (worker.metrics)
+      msIO_installMetricsRedirect(&worker);
+
+    msCGIHandleRequest(&worker);
+
+    msIO_setRequestEnvironment(NULL);
+    msIO_installHandlers(NULL, NULL, NULL);
+    FCGX_Finish_r(&request);
+    msResetErrorList();
+  }
+
+  FCGX_Free(&request, MS_TRUE);
+  msFontCacheThreadCleanup();
+
+#ifndef _WIN32
+  /* accept() failed: have the main thread stop the other workers */
+  if (!finish_process)
+    pthread_kill(mainThread, SIGTERM);
+#endif
+}
+
+/************************************************************************/
+/*                       msCGIRunWorkerThreads()                        */
+/*                                                                      */
+/*      Threaded FastCGI mode: the requests are processed               */
+/*      concurrently by threads sharing the caches and connection       */
+/*      pools of the process.                                           */
+/*                                                                      */
+/*      SIGUSR1 and SIGTERM are blocked in the workers, which inherit   */
+/*      the signal mask of the main thread, and waited for by the       */
+/*      latter: it then shuts the listen socket down so that the        */
+/*      worker blocked in accept() returns, while the others finish     */
+/*      their request.                                                  */
+/************************************************************************/
+static void msCGIRunWorkerThreads(mapservWorker *worker, int threads)
+
+{
+  CPLJoinableThread **handles = (CPLJoinableThread **)msSmallCalloc(
+      threads, sizeof(CPLJoinableThread *));
+#ifndef _WIN32
+  sigset_t signals, oldsignals;
+  int sig, started = 0;
+
+  sigemptyset(&signals);
+  sigaddset(&signals, SIGUSR1);
+  sigaddset(&signals, SIGTERM);
+  pthread_sigmask(SIG_BLOCK, &signals, &oldsignals);
+  mainThread = pthread_self();
+#endif
+
+  /* the CONFIG options of the mapfile of a request only apply to the
+   * thread processing it */
+  msSetMapConfigOptionsPerThread(MS_TRUE);
+  FCGX_Init();
+
+  for (int i = 0; i < threads; i++) {
+    handles[i] = CPLCreateJoinableThread(msCGIWorkerThread, worker);
+#ifndef _WIN32
+    if (handles[i])
+      started++;
+#endif
+  }
+
+#ifndef _WIN32
+  while (started > 0 && sigwait(&signals, &sig) != 0)
+    ;
+  finish_process = 1;
+  FCGX_ShutdownPending();
+  /* the listen socket, as passed to FCGX_InitRequest() */
+  shutdown(0, SHUT_RDWR);
+#endif
+
+  for (int i = 0; i < threads; i++) {
+    if (handles[i])
+      CPLJoinThread(handles[i]);
+  }
+
+#ifndef _WIN32
+  pthread_sigmask(SIG_SETMASK, &oldsignals, NULL);
+#endif
+  free(handles);
+}
+
+#endif /* USE_FASTCGI && USE_THREAD */
+
 /************************************************************************/
 /*                                main()                                */
 /************************************************************************/
 int main(int argc, char *argv[]) {
   int sendheaders = MS_TRUE;
   struct mstimeval execstarttime, execendtime;
-  struct mstimeval requeststarttime, requestendtime;
   mapservObj *mapserv = NULL;
   configObj *config = NULL;
+  mapservWorker worker;
 
   /*
   ** Process -v and -h command line arguments  first end exit. We want to avoid
@@ -216,8 +703,13 @@ int main(int argc, char *argv[]) {
     exit(0);
   }
 
-  const char *ms_index_dir =
-      msConfigGetEnv(config, "MS_INDEX_TEMPLATE_DIRECTORY");
+  /* a request holds no glyph once the next one starts */
+  msFontCacheBoundGlyphStore();
+
+  const char *ms_compression_level =
+      msConfigGetEnv(config, "MS_HTTP_COMPRESSION_LEVEL");
+  const char *ms_request_timeout =
+      msConfigGetEnv(config, "MS_REQUEST_TIMEOUT");
 
   if (msGetGlobalDebugLevel() >= MS_DEBUGLEVEL_TUNING)
     msGettimeofday(&execstarttime, NULL);
@@ -269,139 +761,50 @@ int main(int argc, char *argv[]) {
   }
 #endif
 
+  memset(&worker, 0, sizeof(worker));
+  worker.config = config;
+  worker.sendheaders = sendheaders;
+  worker.metrics = msMetricsEnabled();
 #ifdef USE_FASTCGI
-  msIO_installFastCGIRedirect();
-
-  /* In FastCGI case we loop accepting multiple requests.  In normal CGI */
-  /* use we only accept and process one request.  */
-  while (!finish_process && FCGI_Accept() >= 0) {
-#endif /* def USE_FASTCGI */
-
-    /* -------------------------------------------------------------------- */
-    /*      Process a request.                                              */
-    /* -------------------------------------------------------------------- */
-    mapserv = msAllocMapServObj();
-    mapserv->sendheaders = sendheaders; /* override the default if necessary
-                                           (via command line -nh switch) */
-
-    mapserv->request->NumParams =
-        loadParams(mapserv->request, NULL, NULL, 0, NULL);
-
-    if (msCGIIsAPIRequest(mapserv) == MS_FALSE &&
-        mapserv->request->NumParams == -1) { /* no QUERY_STRING or PATH_INFO */
-      if (ms_index_dir != NULL) {
-        // return the landing page
-        msCGIDispatchIndexRequest(mapserv, config);
-        goto end_request;
-      }
-      msCGIWriteError(mapserv);
-      goto end_request;
-    }
-
-    mapserv->map = msCGILoadMap(mapserv, config);
-    if (!mapserv->map) {
-      for (int i = 0; i < mapserv->request->NumParams;
-           i++) { /* a map parameter was sent */
-        if (strcasecmp(mapserv->request->ParamNames[i], "map") == 0) {
-          msCGIWriteError(mapserv);
-          goto end_request;
-        }
-      }
-      if (ms_index_dir != NULL && mapserv->request->path_info != NULL &&
-          strcmp(mapserv->request->path_info, "/") == 0) {
-        // return the landing page
-        msCGIDispatchIndexRequest(mapserv, config);
-        goto end_request;
-      }
-      msCGIWriteError(mapserv);
-      goto end_request;
-    }
-
-    if (mapserv->map->debug >= MS_DEBUGLEVEL_TUNING)
-      msGettimeofday(&requeststarttime, NULL);
+  /* a CGI process serves a single request, its metrics file would be
+   * rewritten on every request */
+  worker.metrics_file = worker.metrics && !FCGX_IsCGI();
+#endif
+  worker.trace = MS_TRUE;
+  worker.index_dir = msConfigGetEnv(config, "MS_INDEX_TEMPLATE_DIRECTORY");
+  worker.metrics_path = msConfigGetEnv(config, "MS_METRICS_PATH");
+  worker.compression = msConfigGetEnv(config, "MS_HTTP_COMPRESSION");
+  worker.compression_level =
+      ms_compression_level ? atoi(ms_compression_level) : 0;
+  worker.request_timeout = ms_request_timeout ? atof(ms_request_timeout) : 0;
 
 #ifdef USE_FASTCGI
-    if (mapserv->map->debug) {
-      static int nRequestCounter = 1;
-
-      msDebug("CGI Request %d on process %d\n", nRequestCounter, getpid());
-      nRequestCounter++;
-    }
+  /* load the mapfiles and datasets once per FastCGI process, rather than in
+   * its first requests */
+  if (!FCGX_IsCGI())
+    msConfigPrewarm(config);
 #endif
 
-    if (mapserv->request->api_path != NULL) {
-      switch (mapserv->request->api_path_length) {
-      case 0: // just in case, treat as normal
-        if (msCGIDispatchRequest(mapserv) != MS_SUCCESS) {
-          msCGIWriteError(mapserv);
-          goto end_request;
-        }
-        break;
-
-      case 1:
-        if (ms_index_dir != NULL) {
-          // Try normal dispatch first
-          if (msCGIDispatchRequest(mapserv) != MS_SUCCESS) {
-            errorObj *ms_error = msGetErrorObj();
-            int show_index = MS_FALSE;
-            if (mapserv->request->NumParams == 0) {
-              show_index = MS_TRUE;
-            } else if (ms_error != NULL && ms_error->code == MS_WEBERR) {
-              if (strstr(ms_error->message, "No query information to decode") !=
-                      NULL ||
-                  strstr(ms_error->message,
-                         "Traditional BROWSE mode requires a TEMPLATE") !=
-                      NULL) {
-                // Fallback to landing page
-                show_index = MS_TRUE;
-              }
-            }
-
-            if (show_index &&
-                msCGIDispatchMapIndexRequest(mapserv, config) == MS_SUCCESS) {
-            } else {
-              msCGIWriteError(mapserv);
-              goto end_request;
-            }
-          }
-        } else {
-          if (msCGIDispatchRequest(mapserv) != MS_SUCCESS) {
-            msCGIWriteError(mapserv);
-            goto end_request;
-          }
-        }
-        break;
+#if defined(USE_FASTCGI) && defined(USE_THREAD)
+  {
+    const char *ms_fcgi_threads = msConfigGetEnv(config, "MS_FCGI_THREADS");
+    const int threads = ms_fcgi_threads ? atoi(ms_fcgi_threads) : 1;
 
-      default: // length > 1
-        if (msCGIDispatchAPIRequest(mapserv) != MS_SUCCESS) {
-          msCGIWriteError(mapserv);
-          goto end_request;
-        }
-        break;
-      }
+    if (threads > 1 && !FCGX_IsCGI()) {
+      /* the trace collects the spans of a single request at a time */
+      worker.trace = MS_FALSE;
+      msCGIRunWorkerThreads(&worker, threads);
     } else {
-      // api_path == NULL
-      if (msCGIDispatchRequest(mapserv) != MS_SUCCESS) {
-        msCGIWriteError(mapserv);
-        goto end_request;
-      }
+      msCGIRunRequests(&worker);
     }
-
-  end_request:
-    if (mapserv->map && mapserv->map->debug >= MS_DEBUGLEVEL_TUNING) {
-      msGettimeofday(&requestendtime, NULL);
-      msDebug("mapserv request processing time (msLoadMap not incl.): %.3fs\n",
-              (requestendtime.tv_sec + requestendtime.tv_usec / 1.0e6) -
-                  (requeststarttime.tv_sec + requeststarttime.tv_usec / 1.0e6));
-    }
-    msFreeMapServObj(mapserv);
-#ifdef USE_FASTCGI
-    /* FCGI_ --- return to top of loop */
-    msResetErrorList();
-    continue;
-  } /* end fastcgi loop */
+  }
+#else
+  msCGIRunRequests(&worker);
 #endif
 
+  if (worker.metrics_file)
+    msMetricsWriteFile(MS_TRUE);
+
   /* normal case, processing is complete */
   if (msGetGlobalDebugLevel() >= MS_DEBUGLEVEL_TUNING) {
     msGettimeofday(&execendtime, NULL);
@@ -75,5 +75,14 @@ MS_DLL_EXPORT int msCGIDispatchRequest(mapservObj *mapserv);
 
 MS_DLL_EXPORT int msCGIIsAPIRequest(mapservObj *mapserv);
 MS_DLL_EXPORT int msCGIDispatchAPIRequest(mapservObj *mapserv);
+MS_DLL_EXPORT void msCGIGetRequestType(mapservObj *mapserv, char *type,
+                                       size_t size);
+
+/* in mapserv-cache.c */
+typedef struct responseCacheRequest responseCacheRequest;
+MS_DLL_EXPORT int msResponseCacheBegin(mapservObj *mapserv, configObj *config,
+                                       responseCacheRequest **request);
+MS_DLL_EXPORT void msResponseCacheEnd(responseCacheRequest *request,
+                                      int success);
 
 #endif /* MAPSERV_H */
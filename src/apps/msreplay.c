@@ -0,0 +1,707 @@
+/******************************************************************************
+ * $Id$
+ *
+ * Project:  MapServer
+ * Purpose:  Load generator replaying recorded requests against the library,
+ *           in-process and without a web server.
+ * Author:   MapServer Project
+ *
+ ******************************************************************************
+ * Copyright (c) 2026, MapServer Project
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies of this Software or works derived from this Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ ****************************************************************************/
+
+#include <limits.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "mapserv.h"
+#include "../mapio.h"
+#include "../mapmetrics.h"
+#include "../mapthread.h"
+
+#include "cpl_multiproc.h"
+
+#ifndef _WIN32
+#include <sys/wait.h>
+#include <unistd.h>
+#endif
+
+/*
+** A request of the log: a query string ("map=...&SERVICE=WMS&..."), a path
+** with an optional query string ("/mymap/ogcapi/collections?f=json"), a URL
+** or a "GET ... HTTP/1.1" access log request line.
+*/
+typedef struct {
+  char *line;
+  char **envp; /* CGI environment, see msIO_setRequestEnvironment() */
+  int type;    /* index in replayContext.types */
+} replayRequest;
+
+typedef struct {
+  int request; /* index in replayContext.requests */
+  int status;  /* HTTP status of the response */
+  double duration;
+  double bytes;
+} replaySample;
+
+typedef struct {
+  configObj *config;
+  double request_timeout;
+  replayRequest *requests;
+  int numrequests;
+  char **types;
+  int numtypes;
+  int passes;
+  int warmup;
+  int numworkers;
+} replayContext;
+
+typedef struct {
+  replayContext *context;
+  int index;
+  replaySample *samples;
+  int numsamples;
+  double starttime, endtime;
+} replayWorker;
+
+/* Status of the response in the stdout buffer, from its headers. */
+static int msReplayGetStatus(const msIOBuffer *buf) {
+  const char *data = (const char *)buf->data;
+  int i = 0;
+
+  while (i < buf->data_offset) {
+    const char *line = data + i;
+    int len = 0;
+
+    while (i + len < buf->data_offset && line[len] != '\n')
+      len++;
+    if (len == 0 || (len == 1 && line[0] == '\r'))
+      break; /* end of the headers */
+    if (len > 8 && strncasecmp(line, "Status: ", 8) == 0)
+      return atoi(line + 8);
+    i += len + 1;
+  }
+  return 200;
+}
+
+/************************************************************************/
+/*                          msReplayRequest()                           */
+/*                                                                      */
+/*      Processes a request like msCGIHandleRequest() in mapserv,       */
+/*      with the response written to a discarded buffer.                */
+/************************************************************************/
+static void msReplayRequest(replayContext *context, int index,
+                            replaySample *sample)
+
+{
+  mapservObj *mapserv = msAllocMapServObj();
+  msIOBuffer *buf;
+  double starttime;
+  int status = MS_FAILURE;
+
+  msFontCacheQuiesce();
+  msIO_setRequestEnvironment(context->requests[index].envp);
+  msIO_installStdoutToBuffer();
+  starttime = msMetricsTime();
+
+  mapserv->request->NumParams =
+      loadParams(mapserv->request, NULL, NULL, 0, NULL);
+
+  if (msCGIIsAPIRequest(mapserv) == MS_FALSE &&
+      mapserv->request->NumParams == -1) {
+    msCGIWriteError(mapserv);
+  } else if ((mapserv->map = msCGILoadMap(mapserv, context->config)) ==
+             NULL) {
+    msCGIWriteError(mapserv);
+  } else {
+    msMapSetTimeout(mapserv->map, context->request_timeout);
+
+    if (mapserv->request->api_path != NULL &&
+        mapserv->request->api_path_length > 1)
+      status = msCGIDispatchAPIRequest(mapserv);
+    else
+      status = msCGIDispatchRequest(mapserv);
+    if (status != MS_SUCCESS)
+      msCGIWriteError(mapserv);
+  }
+  msFreeMapServObj(mapserv);
+
+  buf = (msIOBuffer *)msIO_getHandler(stdout)->cbData;
+  sample->request = index;
+  sample->duration = msMetricsTime() - starttime;
+  sample->bytes = (double)buf->data_offset;
+  sample->status = msReplayGetStatus(buf);
+  if (status != MS_SUCCESS && sample->status < 400)
+    sample->status = 500; /* CGI mode errors are sent with a 200 status */
+
+  msIO_resetHandlers();
+  msIO_setRequestEnvironment(NULL);
+  msResetErrorList();
+}
+
+/*
+** The passes over the requests are interleaved between the workers: worker
+** w processes the requests w, w + numworkers, ... of the whole sequence.
+*/
+static void msReplayWorker(void *arg)
+
+{
+  replayWorker *worker = (replayWorker *)arg;
+  replayContext *context = worker->context;
+  const int total = context->numrequests * context->passes;
+  replaySample warmup;
+
+  for (int i = 0; i < context->warmup && i < context->numrequests; i++)
+    msReplayRequest(context, (worker->index + i) % context->numrequests,
+                    &warmup);
+
+  worker->samples = (replaySample *)msSmallCalloc(
+      total / context->numworkers + 1, sizeof(replaySample));
+  worker->numsamples = 0;
+
+  worker->starttime = msMetricsTime();
+  for (int i = worker->index; i < total; i += context->numworkers) {
+    msReplayRequest(context, i % context->numrequests,
+                    &worker->samples[worker->numsamples]);
+    worker->numsamples++;
+  }
+  worker->endtime = msMetricsTime();
+  msFontCacheThreadCleanup();
+}
+
+/* ----------------------------------------------------------------------- */
+
+#ifndef _WIN32
+
+static int msReplayWriteAll(int fd, const void *data, size_t size) {
+  const char *p = (const char *)data;
+
+  while (size > 0) {
+    const ssize_t n = write(fd, p, size);
+    if (n <= 0)
+      return MS_FAILURE;
+    p += n;
+    size -= n;
+  }
+  return MS_SUCCESS;
+}
+
+static int msReplayReadAll(int fd, void *data, size_t size) {
+  char *p = (char *)data;
+
+  while (size > 0) {
+    const ssize_t n = read(fd, p, size);
+    if (n <= 0)
+      return MS_FAILURE;
+    p += n;
+    size -= n;
+  }
+  return MS_SUCCESS;
+}
+
+/*
+** Runs the workers in forked processes, which send their samples back
+** through a pipe once they are done.
+*/
+static int msReplayRunProcesses(replayWorker *workers, int numworkers) {
+  int *fds = (int *)msSmallCalloc(numworkers, sizeof(int));
+  pid_t *pids = (pid_t *)msSmallCalloc(numworkers, sizeof(pid_t));
+  int status = MS_SUCCESS;
+
+  for (int i = 0; i < numworkers; i++) {
+    int pipefd[2];
+
+    if (pipe(pipefd) != 0 || (pids[i] = fork()) < 0) {
+      fprintf(stderr, "Unable to start the worker process %d.\n", i);
+      numworkers = i;
+      status = MS_FAILURE;
+      break;
+    }
+    if (pids[i] == 0) {
+      replayWorker *worker = &workers[i];
+
+      close(pipefd[0]);
+      msReplayWorker(worker);
+      if (msReplayWriteAll(pipefd[1], &worker->numsamples, sizeof(int)) ||
+          msReplayWriteAll(pipefd[1], &worker->starttime, sizeof(double)) ||
+          msReplayWriteAll(pipefd[1], &worker->endtime, sizeof(double)) ||
+          msReplayWriteAll(pipefd[1], worker->samples,
+                           sizeof(replaySample) * worker->numsamples))
+        _exit(1);
+      _exit(0);
+    }
+    close(pipefd[1]);
+    fds[i] = pipefd[0];
+  }
+
+  for (int i = 0; i < numworkers; i++) {
+    replayWorker *worker = &workers[i];
+
+    if (msReplayReadAll(fds[i], &worker->numsamples, sizeof(int)) ||
+        msReplayReadAll(fds[i], &worker->starttime, sizeof(double)) ||
+        msReplayReadAll(fds[i], &worker->endtime, sizeof(double))) {
+      fprintf(stderr, "Worker process %d failed.\n", i);
+      worker->numsamples = 0;
+      status = MS_FAILURE;
+    } else {
+      worker->samples = (replaySample *)msSmallCalloc(
+          worker->numsamples + 1, sizeof(replaySample));
+      if (msReplayReadAll(fds[i], worker->samples,
+                    sizeof(replaySample) * worker->numsamples)) {
+        fprintf(stderr, "Worker process %d failed.\n", i);
+        worker->numsamples = 0;
+        status = MS_FAILURE;
+      }
+    }
+    close(fds[i]);
+    waitpid(pids[i], NULL, 0);
+  }
+
+  free(fds);
+  free(pids);
+  return status;
+}
+
+#endif /* ndef _WIN32 */
+
+static int msReplayRunThreads(replayWorker *workers, int numworkers) {
+  CPLJoinableThread **handles;
+
+  if (numworkers == 1) {
+    msReplayWorker(&workers[0]);
+    return MS_SUCCESS;
+  }
+
+  handles = (CPLJoinableThread **)msSmallCalloc(numworkers,
+                                                sizeof(CPLJoinableThread *));
+  for (int i = 0; i < numworkers; i++)
+    handles[i] = CPLCreateJoinableThread(msReplayWorker, &workers[i]);
+  for (int i = 0; i < numworkers; i++) {
+    if (handles[i])
+      CPLJoinThread(handles[i]);
+  }
+  free(handles);
+  return MS_SUCCESS;
+}
+
+/* ----------------------------------------------------------------------- */
+
+/*
+** Splits a request line in its PATH_INFO and QUERY_STRING and builds its
+** CGI environment. Returns MS_FAILURE for blank lines and comments.
+*/
+static int msReplayParseRequest(char *line, const char *prefix,
+                                replayRequest *request) {
+  char *request_uri, *query, *c;
+  char *path = NULL;
+  int n = 0;
+
+  msStringTrim(line);
+  if (line[0] == '\0' || line[0] == '#')
+    return MS_FAILURE;
+  request->line = msStrdup(line);
+  request_uri = line;
+
+  /* access log request line */
+  if (strncmp(request_uri, "GET ", 4) == 0) {
+    request_uri += 4;
+    if ((c = strstr(request_uri, " HTTP/")) != NULL)
+      *c = '\0';
+  }
+  /* drop the scheme and host of an absolute URL, leaving alone the URLs
+   * found in the values of a query string (WMS layer, SLD...) */
+  if (strncasecmp(request_uri, "http://", 7) == 0 ||
+      strncasecmp(request_uri, "https://", 8) == 0) {
+    c = strstr(request_uri, "://") + 3;
+    request_uri = c + strcspn(c, "/?");
+  }
+  if (prefix && strncmp(request_uri, prefix, strlen(prefix)) == 0)
+    request_uri += strlen(prefix);
+
+  if (request_uri[0] == '/') {
+    path = request_uri;
+    query = strchr(request_uri, '?');
+    if (query)
+      *query++ = '\0';
+  } else {
+    query = request_uri[0] == '?' ? request_uri + 1 : request_uri;
+  }
+
+  request->envp = (char **)msSmallCalloc(8, sizeof(char *));
+  request->envp[n++] = msStrdup("REQUEST_METHOD=GET");
+  request->envp[n++] = msStrdup("SERVER_NAME=localhost");
+  request->envp[n++] = msStrdup("SERVER_PORT=80");
+  request->envp[n++] = msStrdup("REMOTE_ADDR=127.0.0.1");
+  request->envp[n] = msStrdup("SCRIPT_NAME=");
+  request->envp[n] = msStringConcatenate(request->envp[n],
+                                         prefix ? prefix : "/mapserv");
+  n++;
+  request->envp[n] = msStrdup("QUERY_STRING=");
+  request->envp[n] = msStringConcatenate(request->envp[n], query ? query : "");
+  n++;
+  if (path) {
+    request->envp[n] = msStrdup("PATH_INFO=");
+    request->envp[n] = msStringConcatenate(request->envp[n], path);
+    n++;
+  }
+  return MS_SUCCESS;
+}
+
+/* Labels the request with its type, see msCGIGetRequestType(). */
+static void msReplayClassifyRequest(replayContext *context,
+                                    replayRequest *request) {
+  mapservObj *mapserv = msAllocMapServObj();
+  char type[64];
+  int i;
+
+  msIO_setRequestEnvironment(request->envp);
+  msIO_installStdoutToBuffer();
+  mapserv->request->NumParams =
+      loadParams(mapserv->request, NULL, NULL, 0, NULL);
+  msCGIIsAPIRequest(mapserv);
+  msCGIGetRequestType(mapserv, type, sizeof(type));
+  msFreeMapServObj(mapserv);
+  msIO_resetHandlers();
+  msIO_setRequestEnvironment(NULL);
+  msResetErrorList();
+
+  for (i = 0; i < context->numtypes; i++) {
+    if (strcmp(context->types[i], type) == 0)
+      break;
+  }
+  if (i == context->numtypes) {
+    context->types = (char **)msSmallRealloc(
+        context->types, sizeof(char *) * (context->numtypes + 1));
+    context->types[context->numtypes++] = msStrdup(type);
+  }
+  request->type = i;
+}
+
+/*
+** Reads a whole line, whatever its length, in *line of *size bytes grown as
+** needed. Returns MS_DONE at the end of the file.
+*/
+static int msReplayReadLine(FILE *fp, char **line, size_t *size) {
+  size_t len = 0;
+
+  while (MS_TRUE) {
+    if (*size - len < 2) {
+      *size = *size * 2 + MS_BUFFER_LENGTH;
+      *line = (char *)msSmallRealloc(*line, *size);
+    }
+    if (fgets(*line + len, (int)MS_MIN(*size - len, INT_MAX), fp) == NULL)
+      return len > 0 ? MS_SUCCESS : MS_DONE;
+    len += strlen(*line + len);
+    if (len > 0 && (*line)[len - 1] == '\n')
+      return MS_SUCCESS;
+  }
+}
+
+static int msReplayLoadRequests(replayContext *context, const char *filename,
+                                const char *prefix) {
+  FILE *fp = strcmp(filename, "-") == 0 ? stdin : fopen(filename, "r");
+  char *line = NULL;
+  size_t size = 0;
+
+  if (fp == NULL) {
+    fprintf(stderr, "Unable to open the request file %s.\n", filename);
+    return MS_FAILURE;
+  }
+
+  while (msReplayReadLine(fp, &line, &size) == MS_SUCCESS) {
+    replayRequest request = {0};
+
+    if (msReplayParseRequest(line, prefix, &request) != MS_SUCCESS)
+      continue;
+    msReplayClassifyRequest(context, &request);
+    context->requests = (replayRequest *)msSmallRealloc(
+        context->requests, sizeof(replayRequest) * (context->numrequests + 1));
+    context->requests[context->numrequests++] = request;
+  }
+  free(line);
+  if (fp != stdin)
+    fclose(fp);
+
+  if (context->numrequests == 0) {
+    fprintf(stderr, "No requests found in %s.\n", filename);
+    return MS_FAILURE;
+  }
+  return MS_SUCCESS;
+}
+
+/* ----------------------------------------------------------------------- */
+
+static int msReplayCompareDouble(const void *a, const void *b) {
+  const double da = *(const double *)a, db = *(const double *)b;
+  return da < db ? -1 : da > db ? 1 : 0;
+}
+
+/* Nearest rank percentile of n sorted values. */
+static double msReplayPercentile(const double *values, int n, double p) {
+  int rank = (int)(p / 100.0 * n + 0.999999);
+  return values[MS_MAX(0, MS_MIN(n - 1, rank - 1))];
+}
+
+/* One line of the report, for the samples of type type or all if -1. */
+static void msReplayWriteStats(FILE *fp, const char *label,
+                               const replayWorker *workers, int numworkers,
+                               const replayContext *context, int type) {
+  double *durations = NULL;
+  double sum = 0, bytes = 0;
+  int n = 0, errors = 0, total = 0;
+
+  for (int w = 0; w < numworkers; w++)
+    total += workers[w].numsamples;
+  durations = (double *)msSmallMalloc(sizeof(double) * (total + 1));
+
+  for (int w = 0; w < numworkers; w++) {
+    for (int i = 0; i < workers[w].numsamples; i++) {
+      const replaySample *sample = &workers[w].samples[i];
+      if (type >= 0 && context->requests[sample->request].type != type)
+        continue;
+      durations[n++] = sample->duration * 1000.0;
+      sum += sample->duration * 1000.0;
+      bytes += sample->bytes;
+      if (sample->status >= 400)
+        errors++;
+    }
+  }
+
+  if (n > 0) {
+    qsort(durations, n, sizeof(double), msReplayCompareDouble);
+    fprintf(fp,
+            "%-28s %8d %7d %9.2f %9.2f %9.2f %9.2f %9.2f %9.2f %12.0f\n",
+            label, n, errors, sum / n, msReplayPercentile(durations, n, 50),
+            msReplayPercentile(durations, n, 90),
+            msReplayPercentile(durations, n, 95),
+            msReplayPercentile(durations, n, 99), durations[n - 1], bytes / n);
+  }
+  free(durations);
+}
+
+static void msReplayWriteReport(FILE *fp, const replayWorker *workers,
+                                int numworkers, const replayContext *context) {
+  double starttime = 0, endtime = 0, elapsed;
+  int total = 0, errors = 0;
+
+  for (int w = 0; w < numworkers; w++) {
+    if (workers[w].numsamples == 0)
+      continue;
+    if (total == 0 || workers[w].starttime < starttime)
+      starttime = workers[w].starttime;
+    if (workers[w].endtime > endtime)
+      endtime = workers[w].endtime;
+    total += workers[w].numsamples;
+    for (int i = 0; i < workers[w].numsamples; i++) {
+      if (workers[w].samples[i].status >= 400)
+        errors++;
+    }
+  }
+  elapsed = endtime - starttime;
+
+  fprintf(fp, "Requests:   %d in %.3fs with %d worker(s), %d error(s)\n",
+          total, elapsed, numworkers, errors);
+  fprintf(fp, "Throughput: %.2f requests/s\n\n",
+          elapsed > 0 ? total / elapsed : 0);
+  fprintf(fp, "%-28s %8s %7s %9s %9s %9s %9s %9s %9s %12s\n", "Request type",
+          "Count", "Errors", "Mean ms", "p50", "p90", "p95", "p99", "Max",
+          "Mean bytes");
+  for (int t = 0; t < context->numtypes; t++)
+    msReplayWriteStats(fp, context->types[t], workers, numworkers, context,
+                       t);
+  msReplayWriteStats(fp, "All", workers, numworkers, context, -1);
+}
+
+/* The samples as CSV, in the order they were run by each worker. */
+static int msReplayWriteSamples(const char *filename,
+                                const replayWorker *workers, int numworkers,
+                                const replayContext *context) {
+  FILE *fp = fopen(filename, "w");
+
+  if (fp == NULL) {
+    fprintf(stderr, "Unable to write %s.\n", filename);
+    return MS_FAILURE;
+  }
+  fprintf(fp, "worker,type,status,duration_ms,bytes,request\n");
+  for (int w = 0; w < numworkers; w++) {
+    for (int i = 0; i < workers[w].numsamples; i++) {
+      const replaySample *sample = &workers[w].samples[i];
+      const replayRequest *request = &context->requests[sample->request];
+      char *line = msReplaceSubstring(msStrdup(request->line), "\"", "\"\"");
+
+      fprintf(fp, "%d,%s,%d,%.3f,%.0f,\"%s\"\n", w,
+              context->types[request->type], sample->status,
+              sample->duration * 1000.0, sample->bytes, line);
+      free(line);
+    }
+  }
+  fclose(fp);
+  return MS_SUCCESS;
+}
+
+static void msReplayUsage(void) {
+  fprintf(stdout,
+          "\nPurpose: replay recorded mapserv requests in-process and "
+          "report their\n         throughput and latencies\n\n");
+  fprintf(stdout,
+          "Syntax: msreplay -f requests [-t threads | -p processes] "
+          "[-n passes]\n"
+          "                [-w warmup] [-prefix path] [-o samples.csv] "
+          "[-conf filename]\n");
+  fprintf(stdout,
+          "  -f requests: file of query strings, API paths (starting with "
+          "/) or URLs,\n"
+          "               one per line, - for stdin - required\n");
+  fprintf(stdout, "  -t threads: number of threads replaying the requests\n");
+  fprintf(stdout, "  -p processes: number of processes replaying the "
+                  "requests\n");
+  fprintf(stdout, "  -n passes: number of times the requests are replayed\n");
+  fprintf(stdout, "  -w warmup: requests run by each worker before the "
+                  "measurements\n");
+  fprintf(stdout, "  -prefix path: script path removed from the request "
+                  "paths, like /cgi-bin/mapserv\n");
+  fprintf(stdout, "  -o samples.csv: write the duration of every request\n");
+  fprintf(stdout,
+          "  -conf filename: filename of the MapServer configuration file.\n");
+}
+
+int main(int argc, char *argv[]) {
+  replayContext context = {0};
+  replayWorker *workers = NULL;
+  const char *requests_filename = NULL, *samples_filename = NULL;
+  const char *prefix = NULL, *config_filename = NULL;
+  int threads = 1, processes = 0, status;
+
+  if (argc > 1 && strcmp(argv[1], "-v") == 0) {
+    printf("%s\n", msGetVersion());
+    exit(0);
+  }
+
+  context.passes = 1;
+  for (int i = 1; i < argc; i++) {
+    const bool has_value = i + 1 < argc;
+
+    if (strcmp(argv[i], "-f") == 0 && has_value)
+      requests_filename = argv[++i];
+    else if (strcmp(argv[i], "-t") == 0 && has_value)
+      threads = atoi(argv[++i]);
+    else if (strcmp(argv[i], "-p") == 0 && has_value)
+      processes = atoi(argv[++i]);
+    else if (strcmp(argv[i], "-n") == 0 && has_value)
+      context.passes = atoi(argv[++i]);
+    else if (strcmp(argv[i], "-w") == 0 && has_value)
+      context.warmup = atoi(argv[++i]);
+    else if (strcmp(argv[i], "-prefix") == 0 && has_value)
+      prefix = argv[++i];
+    else if (strcmp(argv[i], "-o") == 0 && has_value)
+      samples_filename = argv[++i];
+    else if (strcmp(argv[i], "-conf") == 0 && has_value)
+      config_filename = argv[++i];
+    else {
+      msReplayUsage();
+      exit(1);
+    }
+  }
+
+  if (requests_filename == NULL || threads < 1 || processes < 0 ||
+      context.passes < 1 || context.warmup < 0) {
+    msReplayUsage();
+    exit(1);
+  }
+#ifdef _WIN32
+  if (processes > 0) {
+    fprintf(stderr, "-p is not supported on Windows, use -t.\n");
+    exit(1);
+  }
+#endif
+#ifndef USE_THREAD
+  if (threads > 1) {
+    fprintf(stderr, "MapServer is built without thread safety, "
+                    "use -p to run several workers.\n");
+    exit(1);
+  }
+#endif
+
+  if (msSetup() != MS_SUCCESS) {
+    msWriteError(stderr);
+    exit(1);
+  }
+
+  /* Use PROJ_DATA/PROJ_LIB env vars if set */
+  msProjDataInitFromEnv();
+
+  /* Use MS_ERRORFILE and MS_DEBUGLEVEL env vars if set */
+  if (msDebugInitFromEnv() != MS_SUCCESS) {
+    msWriteError(stderr);
+    msCleanup();
+    exit(1);
+  }
+
+  context.config = msLoadConfig(config_filename);
+  if (context.config == NULL) {
+    msWriteError(stderr);
+    msCleanup();
+    exit(1);
+  }
+  msFontCacheBoundGlyphStore();
+  if (msConfigGetEnv(context.config, "MS_REQUEST_TIMEOUT"))
+    context.request_timeout =
+        atof(msConfigGetEnv(context.config, "MS_REQUEST_TIMEOUT"));
+
+  status = msReplayLoadRequests(&context, requests_filename, prefix);
+  if (status == MS_SUCCESS) {
+    context.numworkers = processes > 0 ? processes : threads;
+    workers = (replayWorker *)msSmallCalloc(context.numworkers,
+                                            sizeof(replayWorker));
+    for (int i = 0; i < context.numworkers; i++) {
+      workers[i].context = &context;
+      workers[i].index = i;
+    }
+
+#ifndef _WIN32
+    if (processes > 0)
+      status = msReplayRunProcesses(workers, context.numworkers);
+    else
+#endif
+      status = msReplayRunThreads(workers, context.numworkers);
+
+    msReplayWriteReport(stdout, workers, context.numworkers, &context);
+    if (samples_filename &&
+        msReplayWriteSamples(samples_filename, workers, context.numworkers,
+                             &context) != MS_SUCCESS)
+      status = MS_FAILURE;
+
+    for (int i = 0; i < context.numworkers; i++)
+      free(workers[i].samples);
+    free(workers);
+  }
+
+  for (int i = 0; i < context.numrequests; i++) {
+    free(context.requests[i].line);
+    msFreeCharArray(context.requests[i].envp, 8);
+  }
+  free(context.requests);
+  msFreeCharArray(context.types, context.numtypes);
+  msFreeConfig(context.config);
+  msCleanup();
+  return status == MS_SUCCESS ? 0 : 1;
+}
@@ -3,6 +3,9 @@
 #include "feature_generated.h"
 #include "geometryreader.h"
 #include "packedrtree.h"
+#include "cpl_conv.h"
+#include "cpl_error.h"
+#include "cpl_string.h"
 #include <stdexcept>
 
 using namespace mapserver::flatbuffers;
@@ -14,6 +17,13 @@ uint8_t flatgeobuf_magicbytes[] = { 0x66, 0x67, 0x62, 0x03, 0x66, 0x67, 0x62, 0x
 uint8_t FLATGEOBUF_MAGICBYTES_SIZE = sizeof(flatgeobuf_magicbytes);
 uint32_t INIT_BUFFER_SIZE = 1024 * 4;
 
+// features of the search result closer than this are read with one request
+#define FLATGEOBUF_RANGE_GAP (64 * 1024)
+// largest coalesced read
+#define FLATGEOBUF_RANGE_MAX (8 * 1024 * 1024)
+// bytes read past the start of the last feature of a coalesced read
+#define FLATGEOBUF_RANGE_TAIL (4 * 1024)
+
 template <typename T>
 bool parse_value(uint8_t *data, uint32_t size, char **values, uint16_t i, uint32_t &offset, bool found)
 {
@@ -52,6 +62,10 @@ void flatgeobuf_free_ctx(ctx *ctx)
         free(ctx->search_result);
     if (ctx->buf)
         free(ctx->buf);
+    if (ctx->range_buf)
+        free(ctx->range_buf);
+    if (ctx->vmem)
+        CPLVirtualMemFree(ctx->vmem);
     if (ctx->wkt)
         free(ctx->wkt);
     free(ctx);
@@ -110,13 +124,106 @@ int flatgeobuf_ensure_buf(ctx *ctx, uint32_t size)
     return 0;
 }
 
+int flatgeobuf_map_file(ctx *ctx)
+{
+    if (!CPLIsVirtualMemFileMapAvailable())
+        return -1;
+    if (!CPLTestBool(CPLGetConfigOption("MS_FLATGEOBUF_MMAP", "NO")))
+        return -1;
+    const auto pos = VSIFTellL(ctx->file);
+    if (VSIFSeekL(ctx->file, 0, SEEK_END) == -1)
+        return -1;
+    const auto size = VSIFTellL(ctx->file);
+    if (VSIFSeekL(ctx->file, pos, SEEK_SET) == -1 || size == 0)
+        return -1;
+    if (static_cast<uint64_t>(static_cast<size_t>(size)) != size)
+        return -1;
+    CPLPushErrorHandler(CPLQuietErrorHandler);
+    ctx->vmem = CPLVirtualMemFileMapNew(ctx->file, 0, size, VIRTUALMEM_READONLY, NULL, NULL);
+    CPLPopErrorHandler();
+    if (!ctx->vmem)
+        return -1;
+    ctx->map = (const uint8_t *) CPLVirtualMemGetAddr(ctx->vmem);
+    ctx->map_size = size;
+    return 0;
+}
+
+// read size bytes at offset from the mapping, the coalesced range or the file
+static uint32_t flatgeobuf_read_at(ctx *ctx, uint64_t offset, void *dst, uint32_t size)
+{
+    if (ctx->map) {
+        if (offset >= ctx->map_size)
+            return 0;
+        const uint32_t n = (uint32_t) std::min<uint64_t>(size, ctx->map_size - offset);
+        memcpy(dst, ctx->map + offset, n);
+        return n;
+    }
+    if (ctx->range_size > 0 && offset >= ctx->range_offset &&
+        offset + size <= ctx->range_offset + ctx->range_size) {
+        memcpy(dst, ctx->range_buf + (offset - ctx->range_offset), size);
+        return size;
+    }
+    if (VSIFTellL(ctx->file) != offset && VSIFSeekL(ctx->file, offset, SEEK_SET) == -1)
+        return 0;
+    return (uint32_t) VSIFReadL(dst, 1, size, ctx->file);
+}
+
+int flatgeobuf_prefetch_features(ctx *ctx, uint32_t index)
+{
+    if (ctx->map || !ctx->search_result || index >= ctx->search_result_len)
+        return 0;
+
+    const uint64_t start = ctx->feature_offset + ctx->search_result[index].offset;
+    if (ctx->range_size > 0 && start >= ctx->range_offset &&
+        start + sizeof(uint32_t) <= ctx->range_offset + ctx->range_size)
+        return 0;
+
+    // extend the read over the next features of the search result as long as
+    // they are contiguous or close enough
+    uint32_t last = index;
+    while (last + 1 < ctx->search_result_len) {
+        const auto &cur = ctx->search_result[last];
+        const auto &next = ctx->search_result[last + 1];
+        if (next.offset <= cur.offset)
+            break;
+        if (next.index != cur.index + 1 && next.offset - cur.offset > FLATGEOBUF_RANGE_GAP)
+            break;
+        if (next.offset - ctx->search_result[index].offset + FLATGEOBUF_RANGE_TAIL > FLATGEOBUF_RANGE_MAX)
+            break;
+        last++;
+    }
+    if (last == index)
+        return 0; // a single feature, read it directly
+
+    const uint64_t size = ctx->search_result[last].offset - ctx->search_result[index].offset + FLATGEOBUF_RANGE_TAIL;
+    if (ctx->range_buf_size < size) {
+        auto buf = (uint8_t *) realloc(ctx->range_buf, size);
+        if (buf == NULL) {
+            msSetError(MS_FGBERR, "Failed to allocate buffer", "flatgeobuf_prefetch_features");
+            return -1;
+        }
+        ctx->range_buf = buf;
+        ctx->range_buf_size = size;
+    }
+    ctx->range_size = 0;
+    if (VSIFSeekL(ctx->file, start, SEEK_SET) == -1) {
+        msSetError(MS_FGBERR, "Unable to seek in file", "flatgeobuf_prefetch_features");
+        return -1;
+    }
+    // may be short at the end of the file
+    ctx->range_size = VSIFReadL(ctx->range_buf, 1, (size_t) size, ctx->file);
+    ctx->range_offset = start;
+    return 0;
+}
+
 int flatgeobuf_decode_feature(ctx *ctx, layerObj *layer, shapeObj *shape)
 {
     ctx->is_null_geom = false;
 
     uint32_t featureSize;
-    if (VSIFReadL(&featureSize, sizeof(featureSize), 1, ctx->file) != 1) {
-        if (VSIFEofL(ctx->file)) {
+    const uint32_t n = flatgeobuf_read_at(ctx, ctx->offset, &featureSize, sizeof(featureSize));
+    if (n != sizeof(featureSize)) {
+        if (n == 0 && (ctx->map || VSIFEofL(ctx->file))) {
             ctx->done = true;
             return 0;
         }
@@ -128,7 +235,7 @@ int flatgeobuf_decode_feature(ctx *ctx, layerObj *layer, shapeObj *shape)
         return -1;
     }
 
-    if (VSIFReadL(ctx->buf, 1, featureSize, ctx->file) != featureSize) {
+    if (flatgeobuf_read_at(ctx, ctx->offset, ctx->buf, featureSize) != featureSize) {
         msSetError(MS_FGBERR, "Failed to read feature", "flatgeobuf_decode_feature");
         return -1;
     }
@@ -358,6 +465,12 @@ int flatgeobuf_index_search(ctx *ctx, rectObj *rect)
 {
     const auto treeOffset = ctx->offset;
     const auto readNode = [treeOffset, ctx] (uint8_t *buf, size_t i, size_t s) {
+        if (ctx->map) {
+            if (treeOffset + i + s > ctx->map_size)
+                throw std::runtime_error("Unable to read file");
+            memcpy(buf, ctx->map + treeOffset + i, s);
+            return;
+        }
         if (VSIFSeekL(ctx->file, treeOffset + i, SEEK_SET) == -1)
             throw std::runtime_error("Unable to seek in file");
         if (VSIFReadL(buf, 1, s, ctx->file) != s)
@@ -366,6 +479,9 @@ int flatgeobuf_index_search(ctx *ctx, rectObj *rect)
     NodeItem n { rect->minx, rect->miny, rect->maxx, rect->maxy, 0 };
     try {
         const auto foundItems = PackedRTree::streamSearch(ctx->features_count, ctx->index_node_size, n, readNode);
+        free(ctx->search_result);
+        ctx->search_index = 0;
+        ctx->range_size = 0;
         ctx->search_result = (flatgeobuf_search_item *) malloc(foundItems.size() * sizeof(flatgeobuf_search_item));
         memcpy(ctx->search_result, foundItems.data(), foundItems.size() * sizeof(flatgeobuf_search_item));
         ctx->search_result_len = (uint32_t) foundItems.size();
@@ -4,6 +4,7 @@
 #include "../../mapserver.h"
 #include "../../maperror.h"
 #include "../../mapprimitive.h"
+#include "cpl_virtualmem.h"
 #include <stdbool.h>
 #include <stdint.h>
 
@@ -111,6 +112,17 @@ typedef struct flatgeobuf_ctx
 	int ms_type;
     uint8_t *properties;
 	uint32_t properties_size;
+
+	// memory mapped file (local files only)
+	CPLVirtualMem *vmem;
+	const uint8_t *map;
+	uint64_t map_size;
+
+	// coalesced read of the features of the index search result
+	uint8_t *range_buf;
+	uint64_t range_buf_size;
+	uint64_t range_offset;
+	uint64_t range_size;
 } flatgeobuf_ctx;
 
 flatgeobuf_ctx *flatgeobuf_init_ctx();
@@ -120,6 +132,9 @@ int flatgeobuf_ensure_buf(flatgeobuf_ctx *ctx, uint32_t size);
 void flatgeobuf_ensure_line(flatgeobuf_ctx *ctx, uint32_t len);
 void flatgeobuf_ensure_point(flatgeobuf_ctx *ctx, uint32_t len);
 
+int flatgeobuf_map_file(flatgeobuf_ctx *ctx);
+int flatgeobuf_prefetch_features(flatgeobuf_ctx *ctx, uint32_t index);
+
 int flatgeobuf_check_magicbytes(flatgeobuf_ctx *ctx);
 int flatgeobuf_decode_header(flatgeobuf_ctx *ctx);
 int flatgeobuf_decode_feature(flatgeobuf_ctx *ctx, layerObj *layer, shapeObj *shape);
@@ -37,6 +37,7 @@ typedef struct {
   FT_Library library;
   face_element *face_cache;
   glyph_element *bitmap_glyph_cache;
+  unsigned int generation; /* oldest glyph store generation referenced */
 } ft_cache;
 
 #ifdef USE_THREAD
@@ -44,6 +45,7 @@ typedef struct ft_thread_cache ft_thread_cache;
 struct ft_thread_cache {
   void *thread_id;
   ft_thread_cache *next;
+  int released; /* freed by an exited thread, can be reused */
   ft_cache cache;
 };
 ft_thread_cache *ft_caches;
@@ -52,32 +54,141 @@ int use_global_ft_cache;
 ft_cache global_ft_cache;
 #endif
 
+/* ==================================================================== */
+/*      Shared glyph store.                                             */
+/*                                                                      */
+/*      Glyph metrics and outlines are stored once per process, keyed   */
+/*      by font key, size and glyph index, so that threads do not load */
+/*      and keep their own copy of every glyph. Each thread keeps a     */
+/*      lock-free index of the entries it has used in its face_element, */
+/*      and only takes TLOCK_GLYPHCACHE when that index misses.         */
+/*                                                                      */
+/*      The store is unbounded unless MS_GLYPH_CACHE_SIZE is set or     */
+/*      the program calls msFontCacheBoundGlyphStore(). When a bounded  */
+/*      store grows past its size, the whole current generation is     */
+/*      retired and a new one started. Retired generations are freed    */
+/*      once every thread has reached a quiescent point                 */
+/*      (msFontCacheQuiesce(), at the start of a request or of          */
+/*      msDrawMap()) after the retirement, or has exited                */
+/*      (msFontCacheThreadCleanup()), as threads may still hold         */
+/*      pointers to them. The generation a thread references is only   */
+/*      read and written under TLOCK_TTF.                               */
+/* ==================================================================== */
+
+typedef struct {
+  char *font;
+  glyph_element *glyph_cache;
+  outline_element *outline_cache;
+  UT_hash_handle hh;
+} shared_face_element;
+
+typedef struct glyph_generation glyph_generation;
+struct glyph_generation {
+  unsigned int id;
+  shared_face_element *faces;
+  size_t size;
+  glyph_generation *next;
+};
+
+static glyph_generation *glyph_store = NULL;
+static glyph_generation *glyph_store_retired = NULL;
+static size_t glyph_store_max_size = 0; /* 0: unbounded */
+
+static void msFreeGlyphGeneration(glyph_generation *g) {
+  shared_face_element *cur_face, *tmp_face;
+  UT_HASH_ITER(hh, g->faces, cur_face, tmp_face) {
+    glyph_element *cur_glyph, *tmp_glyph;
+    outline_element *cur_outline, *tmp_outline;
+    UT_HASH_ITER(hh, cur_face->outline_cache, cur_outline, tmp_outline) {
+      UT_HASH_DEL(cur_face->outline_cache, cur_outline);
+      free(cur_outline->outline.points);
+      free(cur_outline->outline.tags);
+      free(cur_outline->outline.contours);
+      free(cur_outline);
+    }
+    UT_HASH_ITER(hh, cur_face->glyph_cache, cur_glyph, tmp_glyph) {
+      UT_HASH_DEL(cur_face->glyph_cache, cur_glyph);
+      free(cur_glyph);
+    }
+    UT_HASH_DEL(g->faces, cur_face);
+    free(cur_face->font);
+    free(cur_face);
+  }
+  free(g);
+}
+
+/* must be called with TLOCK_GLYPHCACHE held */
+static glyph_generation *msGetGlyphStore() {
+  if (!glyph_store)
+    glyph_store = msSmallCalloc(1, sizeof(glyph_generation));
+  return glyph_store;
+}
+
+/* must be called with TLOCK_GLYPHCACHE held */
+static shared_face_element *msGetSharedFace(const char *font) {
+  glyph_generation *g = msGetGlyphStore();
+  shared_face_element *sf;
+  UT_HASH_FIND_STR(g->faces, font, sf);
+  if (!sf) {
+    sf = msSmallCalloc(1, sizeof(shared_face_element));
+    sf->font = msStrdup(font);
+    UT_HASH_ADD_KEYPTR(hh, g->faces, sf->font, strlen(sf->font), sf);
+  }
+  return sf;
+}
+
+/*
+** Make room for size bytes in the store, retiring the current generation
+** if it is full. Must be called with TLOCK_GLYPHCACHE held, and before
+** looking up the shared face the new entry goes into.
+*/
+static void msReserveGlyphStore(size_t size) {
+  glyph_generation *g = msGetGlyphStore();
+  if (glyph_store_max_size > 0 && g->size > 0 &&
+      g->size + size > glyph_store_max_size) {
+    g->next = glyph_store_retired;
+    glyph_store_retired = g;
+    glyph_store = msSmallCalloc(1, sizeof(glyph_generation));
+    glyph_store->id = g->id + 1;
+  }
+  glyph_store->size += size;
+}
+
+static void msFreeFontCacheReferences(ft_cache *c) {
+  face_element *cur_face, *tmp_face;
+  UT_HASH_ITER(hh, c->face_cache, cur_face, tmp_face) {
+    glyph_ref_element *cur_glyph, *tmp_glyph;
+    outline_ref_element *cur_outline, *tmp_outline;
+    UT_HASH_ITER(hh, cur_face->outline_cache, cur_outline, tmp_outline) {
+      UT_HASH_DEL(cur_face->outline_cache, cur_outline);
+      free(cur_outline);
+    }
+    UT_HASH_ITER(hh, cur_face->glyph_cache, cur_glyph, tmp_glyph) {
+      UT_HASH_DEL(cur_face->glyph_cache, cur_glyph);
+      free(cur_glyph);
+    }
+  }
+}
+
 void msInitFontCache(ft_cache *c) {
   memset(c, 0, sizeof(ft_cache));
   FT_Init_FreeType(&c->library);
+  msAcquireLock(TLOCK_GLYPHCACHE);
+  c->generation = msGetGlyphStore()->id;
+  msReleaseLock(TLOCK_GLYPHCACHE);
 }
 
 void msFreeFontCache(ft_cache *c) {
   /* ... TODO ... */
   face_element *cur_face, *tmp_face;
   glyph_element *cur_bitmap, *tmp_bitmap;
+  msFreeFontCacheReferences(c);
   UT_HASH_ITER(hh, c->face_cache, cur_face, tmp_face) {
     index_element *cur_index, *tmp_index;
-    outline_element *cur_outline, *tmp_outline;
-    glyph_element *cur_glyph, *tmp_glyph;
     UT_HASH_ITER(hh, cur_face->index_cache, cur_index, tmp_index) {
       UT_HASH_DEL(cur_face->index_cache, cur_index);
       free(cur_index);
     }
-    UT_HASH_ITER(hh, cur_face->outline_cache, cur_outline, tmp_outline) {
-      UT_HASH_DEL(cur_face->outline_cache, cur_outline);
-      FT_Outline_Done(c->library, &cur_outline->outline);
-      free(cur_outline);
-    }
-    UT_HASH_ITER(hh, cur_face->glyph_cache, cur_glyph, tmp_glyph) {
-      UT_HASH_DEL(cur_face->glyph_cache, cur_glyph);
-      free(cur_glyph);
-    }
 #ifdef USE_HARFBUZZ
     if (cur_face->hbfont) {
       hb_font_destroy(cur_face->hbfont->hbfont);
@@ -110,7 +221,7 @@ ft_cache *msGetFontCache() {
   if (!use_global_ft_cache)
     nThreadId = msGetThreadId();
 
-  if (cur != NULL && cur->thread_id == nThreadId)
+  if (cur != NULL && cur->thread_id == nThreadId && !cur->released)
     return &cur->cache;
 
   /* -------------------------------------------------------------------- */
@@ -128,7 +239,21 @@ ft_cache *msGetFontCache() {
   /*      If we found it, make sure it is pushed to the front of the      */
   /*      link for faster finding next time, and return it.               */
   /* -------------------------------------------------------------------- */
+  if (cur == NULL) {
+    /* reuse the cache of an exited thread if there is one */
+    prev = NULL;
+    cur = ft_caches;
+    while (cur != NULL && !cur->released) {
+      prev = cur;
+      cur = cur->next;
+    }
+  }
   if (cur != NULL) {
+    if (cur->released) {
+      cur->thread_id = nThreadId;
+      msInitFontCache(&cur->cache);
+      cur->released = MS_FALSE;
+    }
     if (prev != NULL) {
       prev->next = cur->next;
       cur->next = ft_caches;
@@ -144,6 +269,7 @@ ft_cache *msGetFontCache() {
   /* -------------------------------------------------------------------- */
   cur = msSmallMalloc(sizeof(ft_thread_cache));
   cur->next = NULL;
+  cur->released = MS_FALSE;
   cur->thread_id = nThreadId;
   msInitFontCache(&cur->cache);
   cur->next = ft_caches;
@@ -156,6 +282,7 @@ ft_cache *msGetFontCache() {
 }
 
 void msFontCacheSetup() {
+  const char *max_size = CPLGetConfigOption("MS_GLYPH_CACHE_SIZE", NULL);
 #ifndef USE_THREAD
   ft_cache *c = msGetFontCache();
   msInitFontCache(c);
@@ -169,6 +296,36 @@ void msFontCacheSetup() {
 
   ft_caches = NULL;
 #endif
+
+  /* unbounded unless asked for: see msFontCacheBoundGlyphStore() */
+  glyph_store_max_size =
+      max_size ? (size_t)MS_MAX(0, atoi(max_size)) * 1024 * 1024 : 0;
+#ifdef USE_THREAD
+  /* with a single cache shared by all threads there is no point where
+   * retired glyphs are known to be unused */
+  if (use_global_ft_cache)
+    glyph_store_max_size = 0;
+#endif
+}
+
+/*
+** Bound the shared glyph store to MS_GLYPH_CACHE_SIZE megabytes, 32 by
+** default. Only for programs that hold no glyph or outline pointer across
+** a call to msFontCacheQuiesce(), such as mapserv answering one request at
+** a time: an application that keeps the label cache of a map while drawing
+** another one (mapscript) must leave the store unbounded. Must be called
+** before starting threads.
+*/
+void msFontCacheBoundGlyphStore() {
+  const char *max_size = CPLGetConfigOption("MS_GLYPH_CACHE_SIZE", NULL);
+
+  glyph_store_max_size = max_size
+                             ? (size_t)MS_MAX(0, atoi(max_size)) * 1024 * 1024
+                             : 32 * 1024 * 1024;
+#ifdef USE_THREAD
+  if (use_global_ft_cache)
+    glyph_store_max_size = 0;
+#endif
 }
 
 void msFontCacheCleanup() {
@@ -180,7 +337,8 @@ void msFontCacheCleanup() {
   msAcquireLock(TLOCK_TTF);
   cur = ft_caches;
   while (cur != NULL) {
-    msFreeFontCache(&cur->cache);
+    if (!cur->released)
+      msFreeFontCache(&cur->cache);
     next = cur->next;
     free(cur);
     cur = next;
@@ -188,6 +346,125 @@ void msFontCacheCleanup() {
   ft_caches = NULL;
   msReleaseLock(TLOCK_TTF);
 #endif
+
+  msAcquireLock(TLOCK_GLYPHCACHE);
+  while (glyph_store_retired) {
+    glyph_generation *next = glyph_store_retired->next;
+    msFreeGlyphGeneration(glyph_store_retired);
+    glyph_store_retired = next;
+  }
+  if (glyph_store) {
+    msFreeGlyphGeneration(glyph_store);
+    glyph_store = NULL;
+  }
+  msReleaseLock(TLOCK_GLYPHCACHE);
+}
+
+/*
+** Free the retired generations of the shared glyph store that no thread
+** references anymore. oldest is the generation referenced by the calling
+** thread, or the current one if it has none.
+*/
+static void msFreeUnusedGlyphGenerations(unsigned int oldest) {
+  glyph_generation **g;
+
+#ifdef USE_THREAD
+  {
+    ft_thread_cache *cur;
+    msAcquireLock(TLOCK_TTF);
+    for (cur = ft_caches; cur != NULL; cur = cur->next) {
+      if (cur->cache.generation < oldest)
+        oldest = cur->cache.generation;
+    }
+    msReleaseLock(TLOCK_TTF);
+  }
+#endif
+
+  msAcquireLock(TLOCK_GLYPHCACHE);
+  g = &glyph_store_retired;
+  while (*g) {
+    if ((*g)->id < oldest) {
+      glyph_generation *next = (*g)->next;
+      msFreeGlyphGeneration(*g);
+      *g = next;
+    } else {
+      g = &(*g)->next;
+    }
+  }
+  msReleaseLock(TLOCK_GLYPHCACHE);
+}
+
+/*
+** Called by a thread at a point where it holds no glyph or outline
+** pointers obtained earlier (i.e. before processing a request or rendering
+** a new map). Drops the thread's references to retired generations of the
+** shared glyph store and frees the generations no thread references
+** anymore.
+*/
+void msFontCacheQuiesce() {
+  ft_cache *c;
+  unsigned int current;
+
+#ifdef USE_THREAD
+  if (use_global_ft_cache)
+    return;
+#endif
+
+  c = msGetFontCache();
+  msAcquireLock(TLOCK_GLYPHCACHE);
+  current = msGetGlyphStore()->id;
+  msReleaseLock(TLOCK_GLYPHCACHE);
+
+  msAcquireLock(TLOCK_TTF);
+  if (c->generation == current) {
+    msReleaseLock(TLOCK_TTF);
+    return;
+  }
+  msReleaseLock(TLOCK_TTF);
+
+  msFreeFontCacheReferences(c);
+
+  msAcquireLock(TLOCK_TTF);
+  c->generation = current;
+  msReleaseLock(TLOCK_TTF);
+
+  msFreeUnusedGlyphGenerations(current);
+}
+
+/*
+** Called by a thread that is about to exit: frees its font cache, so that
+** the glyph store generations it referenced can be released. The list
+** entry is kept for reuse, as msGetFontCache() reads the list head without
+** holding TLOCK_TTF.
+*/
+void msFontCacheThreadCleanup() {
+#ifdef USE_THREAD
+  void *nThreadId = msGetThreadId();
+  ft_thread_cache *cur;
+  unsigned int current;
+
+  if (use_global_ft_cache)
+    return;
+
+  msAcquireLock(TLOCK_TTF);
+  cur = ft_caches;
+  while (cur != NULL && (cur->thread_id != nThreadId || cur->released))
+    cur = cur->next;
+  if (cur != NULL) {
+    msFreeFontCache(&cur->cache);
+    cur->cache.generation = UINT_MAX; /* references nothing */
+    cur->released = MS_TRUE;
+  }
+  msReleaseLock(TLOCK_TTF);
+
+  if (cur == NULL)
+    return;
+
+  msAcquireLock(TLOCK_GLYPHCACHE);
+  current = msGetGlyphStore()->id;
+  msReleaseLock(TLOCK_GLYPHCACHE);
+  msFreeUnusedGlyphGenerations(current);
+#endif
 }
 
 unsigned int msGetGlyphIndex(face_element *face, unsigned int unicode) {
@@ -276,8 +553,46 @@ face_element *msGetFontFace(const char *key, fontSetObj *fontset) {
   return fc;
 }
 
+static glyph_element *msLoadGlyph(face_element *face,
+                                  const glyph_element_key *key) {
+  glyph_element *gc;
+  FT_Error error;
+  if (MS_NINT(key->size * 96.0 / 72.0) != face->face->size->metrics.x_ppem) {
+    FT_Set_Pixel_Sizes(face->face, 0, MS_NINT(key->size * 96 / 72.0));
+  }
+  error = FT_Load_Glyph(face->face, key->codepoint,
+                        FT_LOAD_DEFAULT | FT_LOAD_NO_BITMAP |
+                            FT_LOAD_NO_HINTING |
+                            FT_LOAD_IGNORE_GLOBAL_ADVANCE_WIDTH);
+  if (error) {
+    msDebug("Unable to load glyph %u for font \"%s\". Using ? as fallback.\n",
+            key->codepoint, face->font);
+    // If we can't find a glyph then try to fallback to a question mark.
+    unsigned int fallbackCodepoint = msGetGlyphIndex(face, 0x3F);
+    error = FT_Load_Glyph(face->face, fallbackCodepoint,
+                          FT_LOAD_DEFAULT | FT_LOAD_NO_BITMAP |
+                              FT_LOAD_NO_HINTING |
+                              FT_LOAD_IGNORE_GLOBAL_ADVANCE_WIDTH);
+  }
+  if (error) {
+    msSetError(MS_MISCERR, "unable to load glyph %u for font \"%s\"",
+               "msGetGlyphByIndex()", key->codepoint, face->font);
+    return NULL;
+  }
+  gc = msSmallMalloc(sizeof(glyph_element));
+  gc->metrics.minx = face->face->glyph->metrics.horiBearingX / 64.0;
+  gc->metrics.maxx = gc->metrics.minx + face->face->glyph->metrics.width / 64.0;
+  gc->metrics.maxy = face->face->glyph->metrics.horiBearingY / 64.0;
+  gc->metrics.miny =
+      gc->metrics.maxy - face->face->glyph->metrics.height / 64.0;
+  gc->metrics.advance = face->face->glyph->metrics.horiAdvance / 64.0;
+  gc->key = *key;
+  return gc;
+}
+
 glyph_element *msGetGlyphByIndex(face_element *face, unsigned int size,
                                  unsigned int codepoint) {
+  glyph_ref_element *ref;
   glyph_element *gc;
   glyph_element_key key;
   memset(&key, 0, sizeof(glyph_element_key));
@@ -287,113 +602,166 @@ glyph_element *msGetGlyphByIndex(face_element *face, unsigned int size,
   if (use_global_ft_cache)
     msAcquireLock(TLOCK_TTF);
 #endif
-  UT_HASH_FIND(hh, face->glyph_cache, &key, sizeof(glyph_element_key), gc);
-  if (!gc) {
-    FT_Error error;
-    gc = msSmallMalloc(sizeof(glyph_element));
-    if (MS_NINT(size * 96.0 / 72.0) != face->face->size->metrics.x_ppem) {
-      FT_Set_Pixel_Sizes(face->face, 0, MS_NINT(size * 96 / 72.0));
-    }
-    error =
-        FT_Load_Glyph(face->face, key.codepoint,
-                      FT_LOAD_DEFAULT | FT_LOAD_NO_BITMAP | FT_LOAD_NO_HINTING |
-                          FT_LOAD_IGNORE_GLOBAL_ADVANCE_WIDTH);
-    if (error) {
-      msDebug("Unable to load glyph %u for font \"%s\". Using ? as fallback.\n",
-              key.codepoint, face->font);
-      // If we can't find a glyph then try to fallback to a question mark.
-      unsigned int fallbackCodepoint = msGetGlyphIndex(face, 0x3F);
-      error = FT_Load_Glyph(face->face, fallbackCodepoint,
-                            FT_LOAD_DEFAULT | FT_LOAD_NO_BITMAP |
-                                FT_LOAD_NO_HINTING |
-                                FT_LOAD_IGNORE_GLOBAL_ADVANCE_WIDTH);
-    }
-    if (error) {
-      msSetError(MS_MISCERR, "unable to load glyph %u for font \"%s\"",
-                 "msGetGlyphByIndex()", key.codepoint, face->font);
-      free(gc);
+  UT_HASH_FIND(hh, face->glyph_cache, &key, sizeof(glyph_element_key), ref);
+  if (!ref) {
+    msAcquireLock(TLOCK_GLYPHCACHE);
+    UT_HASH_FIND(hh, msGetSharedFace(face->font)->glyph_cache, &key,
+                 sizeof(glyph_element_key), gc);
+    msReleaseLock(TLOCK_GLYPHCACHE);
+    if (!gc) {
+      glyph_element *loaded = msLoadGlyph(face, &key);
+      shared_face_element *sf;
+      if (!loaded) {
 #ifdef USE_THREAD
-      if (use_global_ft_cache)
-        msReleaseLock(TLOCK_TTF);
+        if (use_global_ft_cache)
+          msReleaseLock(TLOCK_TTF);
 #endif
-      return NULL;
+        return NULL;
+      }
+      msAcquireLock(TLOCK_GLYPHCACHE);
+      sf = msGetSharedFace(face->font);
+      UT_HASH_FIND(hh, sf->glyph_cache, &key, sizeof(glyph_element_key), gc);
+      if (gc) { /* loaded concurrently by another thread */
+        free(loaded);
+      } else {
+        msReserveGlyphStore(sizeof(glyph_element));
+        sf = msGetSharedFace(face->font);
+        gc = loaded;
+        UT_HASH_ADD(hh, sf->glyph_cache, key, sizeof(glyph_element_key), gc);
+      }
+      msReleaseLock(TLOCK_GLYPHCACHE);
     }
-    gc->metrics.minx = face->face->glyph->metrics.horiBearingX / 64.0;
-    gc->metrics.maxx =
-        gc->metrics.minx + face->face->glyph->metrics.width / 64.0;
-    gc->metrics.maxy = face->face->glyph->metrics.horiBearingY / 64.0;
-    gc->metrics.miny =
-        gc->metrics.maxy - face->face->glyph->metrics.height / 64.0;
-    gc->metrics.advance = face->face->glyph->metrics.horiAdvance / 64.0;
-    gc->key = key;
-    UT_HASH_ADD(hh, face->glyph_cache, key, sizeof(glyph_element_key), gc);
+    ref = msSmallMalloc(sizeof(glyph_ref_element));
+    ref->key = key;
+    ref->glyph = gc;
+    UT_HASH_ADD(hh, face->glyph_cache, key, sizeof(glyph_element_key), ref);
   }
 #ifdef USE_THREAD
   if (use_global_ft_cache)
     msReleaseLock(TLOCK_TTF);
 #endif
-  return gc;
+  return ref->glyph;
+}
+
+static outline_element *msLoadGlyphOutline(face_element *face,
+                                           glyph_element *glyph) {
+  outline_element *oc;
+  FT_Outline *src;
+  FT_Matrix matrix;
+  FT_Vector pen;
+  FT_Error error;
+  if (MS_NINT(glyph->key.size * 96.0 / 72.0) !=
+      face->face->size->metrics.x_ppem) {
+    FT_Set_Pixel_Sizes(face->face, 0, MS_NINT(glyph->key.size * 96 / 72.0));
+  }
+  matrix.xx = matrix.yy = 0x10000L;
+  matrix.xy = matrix.yx = 0x00000L;
+  pen.x = pen.y = 0;
+  FT_Set_Transform(face->face, &matrix, &pen);
+  error = FT_Load_Glyph(
+      face->face, glyph->key.codepoint,
+      FT_LOAD_DEFAULT | FT_LOAD_NO_BITMAP /*|FT_LOAD_IGNORE_TRANSFORM*/ |
+          FT_LOAD_NO_HINTING | FT_LOAD_IGNORE_GLOBAL_ADVANCE_WIDTH);
+  if (error) {
+    msDebug("Unable to load glyph %u for font \"%s\". Using ? as fallback.\n",
+            glyph->key.codepoint, face->font);
+    // If we can't find a glyph then try to fallback to a question mark.
+    unsigned int fallbackCodepoint = msGetGlyphIndex(face, 0x3F);
+    error = FT_Load_Glyph(
+        face->face, fallbackCodepoint,
+        FT_LOAD_DEFAULT | FT_LOAD_NO_BITMAP /*|FT_LOAD_IGNORE_TRANSFORM*/ |
+            FT_LOAD_NO_HINTING | FT_LOAD_IGNORE_GLOBAL_ADVANCE_WIDTH);
+  }
+  if (error) {
+    msSetError(MS_MISCERR, "unable to load glyph %u for font \"%s\"",
+               "msGetGlyphOutline()", glyph->key.codepoint, face->font);
+    return NULL;
+  }
+
+  /* copy the outline with our own allocations, as it outlives this thread's
+   * FT_Library */
+  src = &face->face->glyph->outline;
+  oc = msSmallCalloc(1, sizeof(outline_element));
+  oc->key.glyph = glyph->key;
+  oc->outline.n_points = src->n_points;
+  oc->outline.n_contours = src->n_contours;
+  oc->outline.points =
+      msSmallMalloc(MS_MAX(1, src->n_points) * sizeof(*src->points));
+  oc->outline.tags =
+      msSmallMalloc(MS_MAX(1, src->n_points) * sizeof(*src->tags));
+  oc->outline.contours =
+      msSmallMalloc(MS_MAX(1, src->n_contours) * sizeof(*src->contours));
+  memcpy(oc->outline.points, src->points, src->n_points * sizeof(*src->points));
+  memcpy(oc->outline.tags, src->tags, src->n_points * sizeof(*src->tags));
+  memcpy(oc->outline.contours, src->contours,
+         src->n_contours * sizeof(*src->contours));
+  oc->outline.flags = src->flags & ~FT_OUTLINE_OWNER;
+  return oc;
+}
+
+static size_t msGlyphOutlineSize(const outline_element *oc) {
+  const FT_Outline *o = &oc->outline;
+  return sizeof(outline_element) +
+         o->n_points * (sizeof(*o->points) + sizeof(*o->tags)) +
+         o->n_contours * sizeof(*o->contours);
 }
 
 outline_element *msGetGlyphOutline(face_element *face, glyph_element *glyph) {
+  outline_ref_element *ref;
   outline_element *oc;
   outline_element_key key;
-  ft_cache *cache = msGetFontCache();
   memset(&key, 0, sizeof(outline_element_key));
-  key.glyph = glyph;
+  key.glyph = glyph->key;
 #ifdef USE_THREAD
   if (use_global_ft_cache)
     msAcquireLock(TLOCK_TTF);
 #endif
-  UT_HASH_FIND(hh, face->outline_cache, &key, sizeof(outline_element_key), oc);
-  if (!oc) {
-    FT_Matrix matrix;
-    FT_Vector pen;
-    FT_Error error;
-    oc = msSmallMalloc(sizeof(outline_element));
-    if (MS_NINT(glyph->key.size * 96.0 / 72.0) !=
-        face->face->size->metrics.x_ppem) {
-      FT_Set_Pixel_Sizes(face->face, 0, MS_NINT(glyph->key.size * 96 / 72.0));
-    }
-    matrix.xx = matrix.yy = 0x10000L;
-    matrix.xy = matrix.yx = 0x00000L;
-    pen.x = pen.y = 0;
-    FT_Set_Transform(face->face, &matrix, &pen);
-    error = FT_Load_Glyph(
-        face->face, glyph->key.codepoint,
-        FT_LOAD_DEFAULT | FT_LOAD_NO_BITMAP /*|FT_LOAD_IGNORE_TRANSFORM*/ |
-            FT_LOAD_NO_HINTING | FT_LOAD_IGNORE_GLOBAL_ADVANCE_WIDTH);
-    if (error) {
-      msDebug("Unable to load glyph %u for font \"%s\". Using ? as fallback.\n",
-              glyph->key.codepoint, face->font);
-      // If we can't find a glyph then try to fallback to a question mark.
-      unsigned int fallbackCodepoint = msGetGlyphIndex(face, 0x3F);
-      error = FT_Load_Glyph(
-          face->face, fallbackCodepoint,
-          FT_LOAD_DEFAULT | FT_LOAD_NO_BITMAP /*|FT_LOAD_IGNORE_TRANSFORM*/ |
-              FT_LOAD_NO_HINTING | FT_LOAD_IGNORE_GLOBAL_ADVANCE_WIDTH);
-    }
-    if (error) {
-      msSetError(MS_MISCERR, "unable to load glyph %u for font \"%s\"",
-                 "msGetGlyphOutline()", glyph->key.codepoint, face->font);
+  UT_HASH_FIND(hh, face->outline_cache, &key, sizeof(outline_element_key),
+               ref);
+  if (!ref) {
+    msAcquireLock(TLOCK_GLYPHCACHE);
+    UT_HASH_FIND(hh, msGetSharedFace(face->font)->outline_cache, &key,
+                 sizeof(outline_element_key), oc);
+    msReleaseLock(TLOCK_GLYPHCACHE);
+    if (!oc) {
+      outline_element *loaded = msLoadGlyphOutline(face, glyph);
+      shared_face_element *sf;
+      if (!loaded) {
 #ifdef USE_THREAD
-      if (use_global_ft_cache)
-        msReleaseLock(TLOCK_TTF);
+        if (use_global_ft_cache)
+          msReleaseLock(TLOCK_TTF);
 #endif
-      return NULL;
+        return NULL;
+      }
+      msAcquireLock(TLOCK_GLYPHCACHE);
+      sf = msGetSharedFace(face->font);
+      UT_HASH_FIND(hh, sf->outline_cache, &key, sizeof(outline_element_key),
+                   oc);
+      if (oc) { /* loaded concurrently by another thread */
+        free(loaded->outline.points);
+        free(loaded->outline.tags);
+        free(loaded->outline.contours);
+        free(loaded);
+      } else {
+        msReserveGlyphStore(msGlyphOutlineSize(loaded));
+        sf = msGetSharedFace(face->font);
+        oc = loaded;
+        UT_HASH_ADD(hh, sf->outline_cache, key, sizeof(outline_element_key),
+                    oc);
+      }
+      msReleaseLock(TLOCK_GLYPHCACHE);
     }
-    error = FT_Outline_New(cache->library, face->face->glyph->outline.n_points,
-                           face->face->glyph->outline.n_contours, &oc->outline);
-    (void)error;
-    FT_Outline_Copy(&face->face->glyph->outline, &oc->outline);
-    oc->key = key;
-    UT_HASH_ADD(hh, face->outline_cache, key, sizeof(outline_element_key), oc);
+    ref = msSmallMalloc(sizeof(outline_ref_element));
+    ref->key = key;
+    ref->outline = oc;
+    UT_HASH_ADD(hh, face->outline_cache, key, sizeof(outline_element_key),
+                ref);
   }
 #ifdef USE_THREAD
   if (use_global_ft_cache)
     msReleaseLock(TLOCK_TTF);
 #endif
-  return oc;
+  return ref->outline;
 }
 
 int msIsGlyphASpace(glyphObj *glyph) {
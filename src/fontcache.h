@@ -44,7 +44,7 @@ struct glyph_element {
 };
 
 typedef struct {
-  glyph_element *glyph;
+  glyph_element_key glyph;
 } outline_element_key;
 
 typedef struct {
@@ -53,6 +53,19 @@ typedef struct {
   UT_hash_handle hh;
 } outline_element;
 
+/* thread local references to the glyphs and outlines of the shared store */
+typedef struct {
+  glyph_element_key key;
+  glyph_element *glyph;
+  UT_hash_handle hh;
+} glyph_ref_element;
+
+typedef struct {
+  outline_element_key key;
+  outline_element *outline;
+  UT_hash_handle hh;
+} outline_ref_element;
+
 typedef struct {
   glyph_element *glyph;
 } bitmap_element_key;
@@ -67,12 +80,20 @@ struct face_element {
   char *font;
   FT_Face face;
   index_element *index_cache;
-  glyph_element *glyph_cache;
-  outline_element *outline_cache;
+  glyph_ref_element *glyph_cache;
+  outline_ref_element *outline_cache;
   hb_font_element *hbfont;
   UT_hash_handle hh;
 };
 
+/*
+** The glyph and outline pointers returned below (and kept in the glyphObj
+** of a textPathObj) point into the glyph store shared by the threads. When
+** the store is bounded (msFontCacheBoundGlyphStore()) they are only valid
+** until the calling thread's next msFontCacheQuiesce(), which msDrawMap(),
+** msDrawLegend() and msDrawScalebar() call first: a label cache must not be
+** kept across the drawing of another map.
+*/
 face_element *msGetFontFace(const char *key, fontSetObj *fontset);
 outline_element *msGetGlyphOutline(face_element *face, glyph_element *glyph);
 glyph_element *msGetBitmapGlyph(rendererVTableObj *renderer, unsigned int size,
@@ -64,6 +64,7 @@ int msInsertClass(layerObj *layer, classObj *classobj, int nIndex) {
     classobj->layer = layer;
     MS_REFCNT_INCR(classobj);
     layer->numclasses++;
+    msLayerFreeClassDispatch(layer);
     return layer->numclasses - 1;
   } else {
 
@@ -85,6 +86,7 @@ int msInsertClass(layerObj *layer, classObj *classobj, int nIndex) {
     MS_REFCNT_INCR(classobj);
     /* increment number of classes and return */
     layer->numclasses++;
+    msLayerFreeClassDispatch(layer);
     return nIndex;
   }
 }
@@ -128,6 +130,7 @@ classObj *msRemoveClass(layerObj *layer, int nIndex) {
 
     /* decrement number of layers and return copy of removed layer */
     layer->numclasses--;
+    msLayerFreeClassDispatch(layer);
     return classobj;
   }
 }
@@ -143,6 +146,7 @@ int msMoveClassUp(layerObj *layer, int nClassIndex) {
     layer->class[nClassIndex] = layer->class[nClassIndex - 1];
 
     layer->class[nClassIndex - 1] = psTmpClass;
+    msLayerFreeClassDispatch(layer);
 
     return (MS_SUCCESS);
   }
@@ -161,6 +165,7 @@ int msMoveClassDown(layerObj *layer, int nClassIndex) {
     layer->class[nClassIndex] = layer->class[nClassIndex + 1];
 
     layer->class[nClassIndex + 1] = psTmpClass;
+    msLayerFreeClassDispatch(layer);
 
     return (MS_SUCCESS);
   }
@@ -73,6 +73,8 @@
 #include <limits>
 #include <memory>
 #include <new>
+#include <string>
+#include <unordered_map>
 #include <vector>
 
 typedef mapserver::order_bgra band_order;
@@ -111,10 +113,51 @@ static const color_type AGG_NO_COLOR = color_type(0, 0, 0, 0);
 #define aggColor(c)                                                            \
   mapserver::rgba8_pre((c)->red, (c)->green, (c)->blue, (c)->alpha)
 
+/* glyphs are cached at this many sub-pixel offsets in each direction */
+#define AGG_GLYPH_ATLAS_SUBPIXELS 4
+/* largest glyph size (in points) drawn from the atlas */
+#define AGG_GLYPH_ATLAS_MAX_GLYPH_SIZE 32
+#define AGG_GLYPH_ATLAS_MAX_BYTES (4 * 1024 * 1024)
+
+/* glyphs are keyed on the font key of their face, not on the face_element:
+ * one freed with the font cache of a thread may be reallocated at the same
+ * address for another font */
+struct glyphAtlasKey {
+  std::string font;
+  unsigned int size;
+  unsigned int codepoint;
+  int phase; /* sub-pixel offset, y * AGG_GLYPH_ATLAS_SUBPIXELS + x */
+  bool operator==(const glyphAtlasKey &o) const {
+    return size == o.size && codepoint == o.codepoint && phase == o.phase &&
+           font == o.font;
+  }
+};
+
+struct glyphAtlasKeyHash {
+  size_t operator()(const glyphAtlasKey &k) const {
+    return std::hash<std::string>()(k.font) ^
+           (size_t(k.codepoint) * 2654435761U) ^ (size_t(k.size) << 20) ^
+           (size_t(k.phase) << 28);
+  }
+};
+
+/* coverage bitmap of a glyph, stored at offset in the atlas, with its top
+ * left corner at (x,y) relative to the glyph origin pixel */
+struct glyphAtlasEntry {
+  size_t offset;
+  int x, y, width, height;
+};
+
 class aggRendererCache {
 public:
   font_engine_type m_feng;
   font_manager_type m_fman;
+  bool use_glyph_atlas = false;
+  std::vector<mapserver::int8u> glyph_atlas{};
+  std::unordered_map<glyphAtlasKey, glyphAtlasEntry, glyphAtlasKeyHash>
+      glyph_atlas_index{};
+  mapserver::rasterizer_scanline_aa<> glyph_rasterizer{};
+  mapserver::scanline_u8 glyph_scanline{};
   aggRendererCache() : m_fman(m_feng) {}
 };
 
@@ -547,6 +590,98 @@ int agg2RenderPolygonTiled(imageObj *img, shapeObj *p, imageObj *tile) {
   return MS_SUCCESS;
 }
 
+/*
+** Return the coverage bitmap of a glyph at a given sub-pixel offset,
+** rasterizing it into the atlas on first use.
+*/
+static const glyphAtlasEntry *aggGetAtlasGlyph(aggRendererCache *cache,
+                                               glyphObj *gl, int phase_x,
+                                               int phase_y) {
+  glyphAtlasKey key;
+  key.font = gl->face->font;
+  key.size = gl->glyph->key.size;
+  key.codepoint = gl->glyph->key.codepoint;
+  key.phase = phase_y * AGG_GLYPH_ATLAS_SUBPIXELS + phase_x;
+  auto it = cache->glyph_atlas_index.find(key);
+  if (it != cache->glyph_atlas_index.end())
+    return &it->second;
+
+  outline_element *ol = msGetGlyphOutline(gl->face, gl->glyph);
+  if (!ol)
+    return NULL;
+  mapserver::path_storage path;
+  mapserver::trans_affine trans;
+  trans.translate(double(phase_x) / AGG_GLYPH_ATLAS_SUBPIXELS,
+                  double(phase_y) / AGG_GLYPH_ATLAS_SUBPIXELS);
+  decompose_ft_outline(ol->outline, true, trans, path);
+  mapserver::conv_curve<mapserver::path_storage> curves(path);
+
+  glyphAtlasEntry entry = {0, 0, 0, 0, 0};
+  mapserver::rasterizer_scanline_aa<> &ras = cache->glyph_rasterizer;
+  mapserver::scanline_u8 &sl = cache->glyph_scanline;
+  ras.reset();
+  ras.filling_rule(mapserver::fill_non_zero);
+  ras.add_path(curves);
+  if (ras.rewind_scanlines()) {
+    entry.x = ras.min_x();
+    entry.y = ras.min_y();
+    entry.width = ras.max_x() - ras.min_x() + 1;
+    entry.height = ras.max_y() - ras.min_y() + 1;
+    const size_t bytes = size_t(entry.width) * entry.height;
+    if (cache->glyph_atlas.size() + bytes > AGG_GLYPH_ATLAS_MAX_BYTES) {
+      cache->glyph_atlas.clear();
+      cache->glyph_atlas_index.clear();
+    }
+    entry.offset = cache->glyph_atlas.size();
+    cache->glyph_atlas.resize(entry.offset + bytes, 0);
+    sl.reset(ras.min_x(), ras.max_x());
+    while (ras.sweep_scanline(sl)) {
+      mapserver::int8u *row = &cache->glyph_atlas[entry.offset] +
+                              size_t(sl.y() - entry.y) * entry.width;
+      unsigned num_spans = sl.num_spans();
+      auto span = sl.begin();
+      for (; num_spans; --num_spans, ++span) {
+        memcpy(row + (span->x - entry.x), span->covers, span->len);
+      }
+    }
+  }
+  return &(cache->glyph_atlas_index[key] = entry);
+}
+
+/*
+** Fast path for small, horizontal, haloless text: blit cached coverage
+** bitmaps instead of rasterizing the glyph outlines.
+*/
+static int agg2RenderGlyphsAtlas(imageObj *img, const textPathObj *tp,
+                                 colorObj *c) {
+  AGG2Renderer *r = AGG_RENDERER(img);
+  aggRendererCache *cache = (aggRendererCache *)MS_IMAGE_RENDERER_CACHE(img);
+  const color_type color = aggColor(c);
+  for (int i = 0; i < tp->numglyphs; i++) {
+    glyphObj *gl = tp->glyphs + i;
+    double ox = floor(gl->pnt.x), oy = floor(gl->pnt.y);
+    int phase_x = MS_NINT((gl->pnt.x - ox) * AGG_GLYPH_ATLAS_SUBPIXELS);
+    int phase_y = MS_NINT((gl->pnt.y - oy) * AGG_GLYPH_ATLAS_SUBPIXELS);
+    if (phase_x == AGG_GLYPH_ATLAS_SUBPIXELS) {
+      phase_x = 0;
+      ox += 1;
+    }
+    if (phase_y == AGG_GLYPH_ATLAS_SUBPIXELS) {
+      phase_y = 0;
+      oy += 1;
+    }
+    const glyphAtlasEntry *e = aggGetAtlasGlyph(cache, gl, phase_x, phase_y);
+    if (!e)
+      return MS_FAILURE;
+    const mapserver::int8u *covers = cache->glyph_atlas.data() + e->offset;
+    for (int row = 0; row < e->height; row++, covers += e->width) {
+      r->m_renderer_base.blend_solid_hspan(int(ox) + e->x, int(oy) + e->y + row,
+                                           e->width, color, covers);
+    }
+  }
+  return MS_SUCCESS;
+}
+
 int agg2RenderGlyphsPath(imageObj *img, const textSymbolObj *ts, colorObj *c,
                          colorObj *oc, int ow, int /*isMarker*/) {
 
@@ -554,6 +689,21 @@ int agg2RenderGlyphsPath(imageObj *img, const textSymbolObj *ts, colorObj *c,
   mapserver::path_storage glyphs;
   mapserver::trans_affine trans;
   AGG2Renderer *r = AGG_RENDERER(img);
+  aggRendererCache *cache = (aggRendererCache *)MS_IMAGE_RENDERER_CACHE(img);
+
+  if (cache->use_glyph_atlas && c && !oc && tp->numglyphs > 0) {
+    bool use_atlas = true;
+    for (int i = 0; i < tp->numglyphs; i++) {
+      if (tp->glyphs[i].rot != 0.0 ||
+          tp->glyphs[i].glyph->key.size > AGG_GLYPH_ATLAS_MAX_GLYPH_SIZE) {
+        use_atlas = false;
+        break;
+      }
+    }
+    if (use_atlas)
+      return agg2RenderGlyphsAtlas(img, tp, c);
+  }
+
   r->m_rasterizer_aa.filling_rule(mapserver::fill_non_zero);
   for (int i = 0; i < tp->numglyphs; i++) {
     glyphObj *gl = tp->glyphs + i;
@@ -920,6 +1070,8 @@ int agg2FreeSymbol(symbolObj * /*symbol*/) { return MS_SUCCESS; }
 
 int agg2InitCache(void **vcache) {
   aggRendererCache *cache = new aggRendererCache();
+  cache->use_glyph_atlas =
+      CPLTestBool(CPLGetConfigOption("MS_AGG_GLYPH_ATLAS", "NO"));
   *vcache = (void *)cache;
   return MS_SUCCESS;
 }
@@ -66,6 +66,10 @@ typedef int (*clusterCompareRegionFunc)(clusterInfo *current,
 /* cluster algorithm */
 #define MSCLUSTER_ALGORITHM_FULL 0
 #define MSCLUSTER_ALGORITHM_SIMPLE 1
+#define MSCLUSTER_ALGORITHM_GRID 2
+
+/* initial number of buckets of the grid hash */
+#define MSCLUSTER_GRID_MIN_BUCKETS 1024
 
 /* cluster data */
 struct cluster_info {
@@ -88,6 +92,8 @@ struct cluster_info {
   clusterInfo *siblings;
   /* next shape in the linked list */
   clusterInfo *next;
+  /* next shape in the same grid hash bucket */
+  clusterInfo *gridnext;
   /* current group */
   char *group;
   int filter;
@@ -142,6 +148,12 @@ struct cluster_layer_info {
   int depth;
   /* processing algorithm */
   int algorithm;
+  /* grid hash of the cluster centers (GRID algorithm) */
+  clusterInfo **grid;
+  int numGridBuckets;
+  int numGridShapes;
+  double gridCellSizeX;
+  double gridCellSizeY;
 };
 
 extern int yyparse(parseObj *p);
@@ -279,6 +291,7 @@ static clusterInfo *clusterInfoCreate(msClusterLayerInfo *layerinfo) {
   feature->numcollected = 0;
   feature->numremoved = 0;
   feature->next = NULL;
+  feature->gridnext = NULL;
   feature->group = NULL;
   feature->node = NULL;
   feature->siblings = NULL;
@@ -355,7 +368,16 @@ static void clusterTreeNodeDestroyList(msClusterLayerInfo *layerinfo,
   }
 }
 
+static void clusterGridDestroy(msClusterLayerInfo *layerinfo) {
+  msFree(layerinfo->grid);
+  layerinfo->grid = NULL;
+  layerinfo->numGridBuckets = 0;
+  layerinfo->numGridShapes = 0;
+}
+
 void clusterDestroyData(msClusterLayerInfo *layerinfo) {
+  clusterGridDestroy(layerinfo);
+
   if (layerinfo->finalized) {
     clusterInfoDestroyList(layerinfo, layerinfo->finalized);
     layerinfo->finalized = NULL;
@@ -389,6 +411,110 @@ void clusterDestroyData(msClusterLayerInfo *layerinfo) {
   layerinfo->numNodes = 0;
 }
 
+/* grid hash bucket of a cell */
+static int clusterGridBucket(msClusterLayerInfo *layerinfo, long cellx,
+                             long celly) {
+  unsigned long h = (unsigned long)cellx * 73856093UL ^
+                    (unsigned long)celly * 19349663UL;
+  return (int)(h & (unsigned long)(layerinfo->numGridBuckets - 1));
+}
+
+static long clusterGridCellX(msClusterLayerInfo *layerinfo, double x) {
+  return (long)floor(x / layerinfo->gridCellSizeX);
+}
+
+static long clusterGridCellY(msClusterLayerInfo *layerinfo, double y) {
+  return (long)floor(y / layerinfo->gridCellSizeY);
+}
+
+static void clusterGridInit(msClusterLayerInfo *layerinfo, double cellSizeX,
+                            double cellSizeY) {
+  clusterGridDestroy(layerinfo);
+  /* a cell is the size of the cluster distance, so that every cluster a
+   * shape may belong to is found in the 3x3 cells around the shape */
+  layerinfo->gridCellSizeX = cellSizeX > 0 ? cellSizeX : 1;
+  layerinfo->gridCellSizeY = cellSizeY > 0 ? cellSizeY : 1;
+  layerinfo->numGridBuckets = MSCLUSTER_GRID_MIN_BUCKETS;
+  layerinfo->grid = (clusterInfo **)msSmallCalloc(layerinfo->numGridBuckets,
+                                                  sizeof(clusterInfo *));
+}
+
+/* add a cluster center to the grid hash, growing it as needed */
+static void clusterGridAddShape(msClusterLayerInfo *layerinfo,
+                                clusterInfo *shape) {
+  int bucket;
+
+  if (layerinfo->numGridShapes >= 2 * layerinfo->numGridBuckets) {
+    clusterInfo **old = layerinfo->grid;
+    int i, numOld = layerinfo->numGridBuckets;
+    layerinfo->numGridBuckets *= 4;
+    layerinfo->grid = (clusterInfo **)msSmallCalloc(layerinfo->numGridBuckets,
+                                                    sizeof(clusterInfo *));
+    for (i = 0; i < numOld; i++) {
+      clusterInfo *s = old[i];
+      while (s) {
+        clusterInfo *next = s->gridnext;
+        bucket =
+            clusterGridBucket(layerinfo, clusterGridCellX(layerinfo, s->x),
+                              clusterGridCellY(layerinfo, s->y));
+        s->gridnext = layerinfo->grid[bucket];
+        layerinfo->grid[bucket] = s;
+        s = next;
+      }
+    }
+    msFree(old);
+  }
+
+  bucket = clusterGridBucket(layerinfo, clusterGridCellX(layerinfo, shape->x),
+                             clusterGridCellY(layerinfo, shape->y));
+  shape->gridnext = layerinfo->grid[bucket];
+  layerinfo->grid[bucket] = shape;
+  ++layerinfo->numGridShapes;
+}
+
+/* find the cluster a shape belongs to in the neighbouring grid cells, same
+ * semantics as findRelatedShapes2() */
+static void findRelatedShapesGrid(msClusterLayerInfo *layerinfo,
+                                  clusterInfo *current) {
+  long cellx = clusterGridCellX(layerinfo, current->x);
+  long celly = clusterGridCellY(layerinfo, current->y);
+  int visited[9];
+  int numVisited = 0;
+  long i, j;
+
+  for (j = celly - 1; j <= celly + 1; j++) {
+    for (i = cellx - 1; i <= cellx + 1; i++) {
+      int k, bucket = clusterGridBucket(layerinfo, i, j);
+      clusterInfo *s;
+      /* several cells may share a bucket */
+      for (k = 0; k < numVisited; k++) {
+        if (visited[k] == bucket)
+          break;
+      }
+      if (k < numVisited)
+        continue;
+      visited[numVisited++] = bucket;
+
+      for (s = layerinfo->grid[bucket]; s; s = s->gridnext) {
+        if (!layerinfo->fnCompare(s, current))
+          continue;
+        if (layerinfo->rank > 0) {
+          double r = (current->x - s->x) * (current->x - s->x) +
+                     (current->y - s->y) * (current->y - s->y);
+          if (r < layerinfo->rank) {
+            layerinfo->current = s;
+            layerinfo->rank = r;
+          }
+        } else {
+          /* no rank was specified, return immediately */
+          layerinfo->current = s;
+          return;
+        }
+      }
+    }
+  }
+}
+
 /* traverse the quadtree to find the neighbouring shapes and update some data
 on the related shapes (when adding a new feature)*/
 static void findRelatedShapes(msClusterLayerInfo *layerinfo,
@@ -634,6 +760,9 @@ static int BuildFeatureAttributes(layerObj *layer,
   int i;
   int *itemindexes = layer->iteminfo;
 
+  /* aggregated values are updated as strings only */
+  msShapeAllocTypedValues(shape, 0);
+
   if (layer->numitems == layerinfo->srcLayer.numitems)
     return MS_SUCCESS; /* we don't have custom attributes, no need to
                           reconstruct the array */
@@ -1055,6 +1184,8 @@ int RebuildClusters(layerObj *layer, int isQuery) {
   pszProcessing = msLayerGetProcessingKey(layer, "CLUSTER_ALGORITHM");
   if (pszProcessing && !strncasecmp(pszProcessing, "SIMPLE", 6))
     layerinfo->algorithm = MSCLUSTER_ALGORITHM_SIMPLE;
+  else if (pszProcessing && !strncasecmp(pszProcessing, "GRID", 4))
+    layerinfo->algorithm = MSCLUSTER_ALGORITHM_GRID;
   else
     layerinfo->algorithm = MSCLUSTER_ALGORITHM_FULL;
 
@@ -1150,6 +1281,9 @@ int RebuildClusters(layerObj *layer, int isQuery) {
     clusterTreeNodeDestroy(layerinfo, layerinfo->root);
   layerinfo->root = clusterTreeNodeCreate(layerinfo, searchrect);
 
+  if (layerinfo->algorithm == MSCLUSTER_ALGORITHM_GRID)
+    clusterGridInit(layerinfo, maxDistanceX, maxDistanceY);
+
   srcLayer = &layerinfo->srcLayer;
 
   /* start retrieving the shapes */
@@ -1239,6 +1373,25 @@ int RebuildClusters(layerObj *layer, int isQuery) {
           return MS_FAILURE;
         }
       }
+    } else if (layerinfo->algorithm == MSCLUSTER_ALGORITHM_GRID) {
+      /* same as the simple algorithm, using the grid hash for the lookups */
+      layerinfo->rank = 0;
+      layerinfo->current = NULL;
+      findRelatedShapesGrid(layerinfo, current);
+      if (layerinfo->current) {
+        /* store these points until all clusters are created */
+        current->next = layerinfo->finalizedSiblings;
+        layerinfo->finalizedSiblings = current;
+      } else {
+        /* the cluster centers are all kept in the root node */
+        if (treeNodeAddShape(layerinfo, layerinfo->root, current, 1) !=
+            MS_SUCCESS) {
+          clusterInfoDestroyList(layerinfo, current);
+          msProjectDestroyReprojector(reprojector);
+          return MS_FAILURE;
+        }
+        clusterGridAddShape(layerinfo, current);
+      }
     }
 
     if ((current = clusterInfoCreate(layerinfo)) == NULL) {
@@ -1380,14 +1533,18 @@ int RebuildClusters(layerObj *layer, int isQuery) {
       }
 #endif
     }
-  } else if (layerinfo->algorithm == MSCLUSTER_ALGORITHM_SIMPLE) {
+  } else if (layerinfo->algorithm == MSCLUSTER_ALGORITHM_SIMPLE ||
+             layerinfo->algorithm == MSCLUSTER_ALGORITHM_GRID) {
     /* assingn stired points to clusters */
     while (layerinfo->finalizedSiblings) {
       current = layerinfo->finalizedSiblings;
       layerinfo->rank =
           maxDistanceX * maxDistanceX + maxDistanceY * maxDistanceY;
       layerinfo->current = NULL;
-      findRelatedShapes2(layerinfo, layerinfo->root, current);
+      if (layerinfo->algorithm == MSCLUSTER_ALGORITHM_GRID)
+        findRelatedShapesGrid(layerinfo, current);
+      else
+        findRelatedShapes2(layerinfo, layerinfo->root, current);
       if (layerinfo->current) {
         clusterInfo *s = layerinfo->current;
         /* found a matching cluster */
@@ -1407,6 +1564,7 @@ int RebuildClusters(layerObj *layer, int isQuery) {
 
     /* collecting the shapes of the cluster */
     collectClusterShapes2(layer, layerinfo, layerinfo->root);
+    clusterGridDestroy(layerinfo);
   }
 
   /* set the pointer to the first shape */
@@ -1681,6 +1839,10 @@ msClusterLayerInfo *msClusterInitialize(layerObj *layer) {
   layerinfo->finalizedNodes = NULL;
   layerinfo->numFinalizedNodes = 0;
 
+  layerinfo->grid = NULL;
+  layerinfo->numGridBuckets = 0;
+  layerinfo->numGridShapes = 0;
+
   return layerinfo;
 }
 
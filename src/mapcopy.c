@@ -1255,6 +1255,7 @@ int msCopyMap(mapObj *dst, const mapObj *src) {
     }
   }
   MS_COPYSTELEM(debug);
+  MS_COPYSTELEM(deadline);
   MS_COPYSTRING(dst->datapattern, src->datapattern);
   MS_COPYSTRING(dst->templatepattern, src->templatepattern);
 
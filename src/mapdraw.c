@@ -31,6 +31,7 @@
 #include <math.h>
 #include "mapserver.h"
 #include "maptime.h"
+#include "mapmetrics.h"
 #include "mapcopy.h"
 #include "mapfile.h"
 #include "mapows.h"
@@ -314,6 +315,10 @@ imageObj *msDrawMap(mapObj *map, int querymap) {
   imageObj *image = NULL;
   struct mstimeval mapstarttime = {0}, mapendtime = {0};
   struct mstimeval starttime = {0}, endtime = {0};
+  unsigned long text_hits = 0, text_misses = 0;
+  const int metrics = msMetricsEnabled();
+  const int trace = msTraceEnabled();
+  double mapstart = 0, layerstart = 0;
 
 #if defined(USE_WMS_LYR) || defined(USE_WFS_LYR)
   enum MS_CONNECTION_TYPE lastconnectiontype;
@@ -323,8 +328,16 @@ imageObj *msDrawMap(mapObj *map, int querymap) {
   wmsParamsObj sLastWMSParams;
 #endif
 
-  if (map->debug >= MS_DEBUGLEVEL_TUNING)
+  if (map->debug >= MS_DEBUGLEVEL_TUNING) {
     msGettimeofday(&mapstarttime, NULL);
+    msTextLayoutCacheGetStats(&text_hits, &text_misses);
+  }
+  if (trace)
+    mapstart = msMetricsTime();
+
+  /* glyphs referenced by a previous map are no longer in use (see the
+   * contract in fontcache.h) */
+  msFontCacheQuiesce();
 
   if (querymap) { /* use queryMapObj image dimensions */
     if (map->querymap.width > 0 && map->querymap.width <= map->maxsize)
@@ -459,6 +472,8 @@ imageObj *msDrawMap(mapObj *map, int querymap) {
       if (map->debug >= MS_DEBUGLEVEL_TUNING ||
           lp->debug >= MS_DEBUGLEVEL_TUNING)
         msGettimeofday(&starttime, NULL);
+      if (metrics || trace)
+        layerstart = msMetricsTime();
 
       if (!msLayerIsVisible(map, lp))
         continue;
@@ -527,6 +542,11 @@ imageObj *msDrawMap(mapObj *map, int querymap) {
                 (endtime.tv_sec + endtime.tv_usec / 1.0e6) -
                     (starttime.tv_sec + starttime.tv_usec / 1.0e6));
       }
+      if (metrics)
+        msMetricsAdd(MS_METRIC_LAYER_DRAW, lp->name,
+                     msMetricsTime() - layerstart);
+      if (trace)
+        msTraceAdd("msDrawLayer", lp->name, layerstart);
 
       /* Flush layer cache in-between layers if requested by PROCESSING
        * directive*/
@@ -613,6 +633,8 @@ imageObj *msDrawMap(mapObj *map, int querymap) {
 
     if (map->debug >= MS_DEBUGLEVEL_TUNING || lp->debug >= MS_DEBUGLEVEL_TUNING)
       msGettimeofday(&starttime, NULL);
+    if (metrics || trace)
+      layerstart = msMetricsTime();
 
     if (lp->connectiontype == MS_WMS) {
 #ifdef USE_WMS_LYR
@@ -652,6 +674,11 @@ imageObj *msDrawMap(mapObj *map, int querymap) {
               (endtime.tv_sec + endtime.tv_usec / 1.0e6) -
                   (starttime.tv_sec + starttime.tv_usec / 1.0e6));
     }
+    if (metrics)
+      msMetricsAdd(MS_METRIC_LAYER_DRAW, lp->name,
+                   msMetricsTime() - layerstart);
+    if (trace)
+      msTraceAdd("msDrawLayer", lp->name, layerstart);
   }
 
   /* Do we need to fake out stuff for rotated support? */
@@ -703,11 +730,21 @@ imageObj *msDrawMap(mapObj *map, int querymap) {
   }
 #endif
 
+  if (trace)
+    msTraceAdd("msDrawMap", map->name, mapstart);
+
   if (map->debug >= MS_DEBUGLEVEL_TUNING) {
     msGettimeofday(&mapendtime, NULL);
     msDebug("msDrawMap() total time: %.3fs\n",
             (mapendtime.tv_sec + mapendtime.tv_usec / 1.0e6) -
                 (mapstarttime.tv_sec + mapstarttime.tv_usec / 1.0e6));
+    {
+      unsigned long hits, misses;
+      msTextLayoutCacheGetStats(&hits, &misses);
+      if (hits != text_hits || misses != text_misses)
+        msDebug("msDrawMap(): text layout cache, %lu hits, %lu misses\n",
+                hits - text_hits, misses - text_misses);
+    }
   }
 
   return (image);
@@ -839,6 +876,9 @@ int msDrawLayer(mapObj *map, layerObj *layer, imageObj *image) {
   if (!msLayerIsVisible(map, layer))
     return MS_SUCCESS;
 
+  if (msMapCheckDeadline(map, "msDrawLayer()") != MS_SUCCESS)
+    return MS_FAILURE;
+
   if (layer->compositer && !layer->compositer->next &&
       layer->compositer->opacity == 0)
     return MS_SUCCESS; /* layer is completely transparent, skip it */
@@ -1030,6 +1070,7 @@ int msDrawLayer(mapObj *map, layerObj *layer, imageObj *image) {
   } else if (image != image_draw) {
     rendererVTableObj *renderer = MS_IMAGE_RENDERER(image_draw);
     rasterBufferObj rb;
+    double compositestart = 0;
     memset(&rb, 0, sizeof(rasterBufferObj));
 
     renderer->endLayer(image_draw, map, layer);
@@ -1070,6 +1111,8 @@ int msDrawLayer(mapObj *map, layerObj *layer, imageObj *image) {
         }
       }
     }
+    if (msTraceEnabled())
+      compositestart = msMetricsTime();
     if (!layer->compositer) {
       /*we have a mask layer with no composition configured, do a nomral blend
        */
@@ -1078,6 +1121,8 @@ int msDrawLayer(mapObj *map, layerObj *layer, imageObj *image) {
     } else {
       retcode = msCompositeRasterBuffer(map, image, &rb, layer->compositer);
     }
+    if (msTraceEnabled())
+      msTraceAdd("compositing", layer->name, compositestart);
     if (MS_UNLIKELY(retcode == MS_FAILURE)) {
       goto imagedraw_cleanup;
     }
@@ -1105,6 +1150,9 @@ int msDrawVectorLayer(mapObj *map, layerObj *layer, imageObj *image) {
   double minfeaturesize = -1;
   int maxfeatures = -1;
   int featuresdrawn = 0;
+  int featuresread = 0;
+  const int metrics = msMetricsEnabled();
+  double metricsstart = 0, nextshapetime = 0;
 
   if (image)
     maxfeatures = msLayerGetMaxFeaturesToDraw(layer, image->format);
@@ -1179,7 +1227,12 @@ int msDrawVectorLayer(mapObj *map, layerObj *layer, imageObj *image) {
     searchrect.maxy = map->height - 1;
   }
 
+  if (metrics)
+    metricsstart = msMetricsTime();
   status = msLayerWhichShapes(layer, searchrect, MS_FALSE);
+  if (metrics)
+    msMetricsAdd(MS_METRIC_LAYER_WHICHSHAPES, layer->name,
+                 msMetricsTime() - metricsstart);
 
   if (layer->connectiontype == MS_UVRASTER) {
     msUVRASTERLayerUseMapExtentAndProjectionForNextWhichShapes(layer, NULL);
@@ -1239,10 +1292,22 @@ int msDrawVectorLayer(mapObj *map, layerObj *layer, imageObj *image) {
     int rendermode;
     if (classindex == -1) {
       msFreeShape(&shape);
+      if (metrics)
+        metricsstart = msMetricsTime();
       status = msLayerNextShape(layer, &shape);
+      if (metrics)
+        nextshapetime += msMetricsTime() - metricsstart;
       if (status != MS_SUCCESS) {
         break;
       }
+      featuresread++;
+
+      /* Checking the clock for every feature would be wasteful */
+      if ((featuresread & 63) == 0 &&
+          msMapCheckDeadline(map, "msDrawVectorLayer()") != MS_SUCCESS) {
+        retcode = MS_FAILURE;
+        break;
+      }
 
       /* Check if the shape size is ok to be drawn */
       if ((shape.type == MS_SHAPE_LINE || shape.type == MS_SHAPE_POLYGON) &&
@@ -1425,6 +1490,12 @@ int msDrawVectorLayer(mapObj *map, layerObj *layer, imageObj *image) {
   if (classgroup)
     msFree(classgroup);
 
+  if (metrics) {
+    msMetricsAdd(MS_METRIC_LAYER_NEXTSHAPE, layer->name, nextshapetime);
+    msMetricsAdd(MS_METRIC_LAYER_FEATURES_READ, layer->name, featuresread);
+    msMetricsAdd(MS_METRIC_LAYER_FEATURES_DRAWN, layer->name, featuresdrawn);
+  }
+
   if (status != MS_DONE || retcode == MS_FAILURE) {
     msLayerClose(layer);
     if (shpcache) {
@@ -2039,10 +2110,13 @@ static int pointLayerDrawShape(mapObj *map, imageObj *image, layerObj *layer,
 
   if (layer->project && layer->transform == MS_TRUE) {
     reprojectionObj *reprojector = msLayerGetReprojectorToMap(layer, map);
+    const double start = msTraceEnabled() ? msMetricsTime() : 0;
     if (reprojector == NULL) {
       return MS_FAILURE;
     }
     msProjectShapeEx(reprojector, shape);
+    if (start > 0)
+      msTraceAccumulate("msProjectShape", layer->name, start);
   }
 
   // Only take into account map rotation if the label and style angles are
@@ -2421,10 +2495,13 @@ int msDrawShape(mapObj *map, layerObj *layer, shapeObj *shape, imageObj *image,
 
   if (layer->project && layer->transform == MS_TRUE) {
     reprojectionObj *reprojector = msLayerGetReprojectorToMap(layer, map);
+    const double start = msTraceEnabled() ? msMetricsTime() : 0;
     if (reprojector == NULL) {
       return MS_FAILURE;
     }
     msProjectShapeEx(reprojector, shape);
+    if (start > 0)
+      msTraceAccumulate("msProjectShape", layer->name, start);
   }
 
   /* check if we'll need the unclipped shape */
@@ -3446,9 +3523,14 @@ static int getLabelPositionFromString(char *pszString) {
 int msDrawLabelCache(mapObj *map, imageObj *image) {
   int nReturnVal = MS_SUCCESS;
   struct mstimeval starttime = {0}, endtime = {0};
+  const int metrics = msMetricsEnabled();
+  const int trace = msTraceEnabled();
+  double metricsstart = 0;
 
   if (map->debug >= MS_DEBUGLEVEL_TUNING)
     msGettimeofday(&starttime, NULL);
+  if (metrics || trace)
+    metricsstart = msMetricsTime();
 
   if (image) {
     if (MS_RENDERER_PLUGIN(image->format)) {
@@ -3502,6 +3584,10 @@ int msDrawLabelCache(mapObj *map, imageObj *image) {
         cacheslot = &(map->labelcache.slots[priority]);
 
         for (l = cacheslot->numlabels - 1; l >= 0; l--) {
+          if ((l & 63) == 0 &&
+              msMapCheckDeadline(map, "msDrawLabelCache()") != MS_SUCCESS)
+            return MS_FAILURE;
+
           cachePtr =
               &(cacheslot
                     ->labels[l]); /* point to right spot in the label cache */
@@ -4189,6 +4275,11 @@ int msDrawLabelCache(mapObj *map, imageObj *image) {
             (endtime.tv_sec + endtime.tv_usec / 1.0e6) -
                 (starttime.tv_sec + starttime.tv_usec / 1.0e6));
   }
+  if (metrics)
+    msMetricsAdd(MS_METRIC_LABELCACHE_DURATION, NULL,
+                 msMetricsTime() - metricsstart);
+  if (trace)
+    msTraceAdd("msDrawLabelCache", NULL, metricsstart);
 
   return nReturnVal;
 }
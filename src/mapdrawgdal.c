@@ -69,6 +69,14 @@ static int msDrawRasterLayerGDAL_16BitClassification(
     int src_xoff, int src_yoff, int src_xsize, int src_ysize, int dst_xoff,
     int dst_yoff, int dst_xsize, int dst_ysize);
 
+static char *msClassLUTGetKey(layerObj *layer, const char *pszDomain);
+static int msClassLUTCacheGet(const char *pszKey, int nEntries,
+                              unsigned char *rb_cmap[4],
+                              unsigned char *pabyDone);
+static void msClassLUTCachePut(const char *pszKey, int nEntries,
+                               unsigned char *rb_cmap[4],
+                               const unsigned char *pabyDone);
+
 /*
  * rasterBufferObj setting macros.
  */
@@ -588,11 +596,44 @@ int msDrawRasterLayerGDAL(mapObj *map, layerObj *layer, imageObj *image,
 
     int color_count = GDALGetColorEntryCount(hColorMap);
     const bool bScaleColors = bScaled && !isDefaultGreyscale;
+    unsigned char *rb_cmap_planes[4] = {rb_cmap[0], rb_cmap[1], rb_cmap[2],
+                                        rb_cmap[3]};
+    char *pszLUTKey = NULL;
+    bool bLUTFromCache = false;
 
     if (!bScaleColors && color_count > 256)
       color_count = 256;
 
-    for (i = 0; i < color_count; i++) {
+    /* -------------------------------------------------------------------- */
+    /*      The classified color map only depends on the classes and on     */
+    /*      the color table, so try to reuse one computed by a previous     */
+    /*      request.                                                        */
+    /* -------------------------------------------------------------------- */
+    {
+      char *pszDomain = msStrdup(
+          CPLSPrintf("8bit|%d|%d|%.17g|%.17g|%.17g|%d|%d,%d,%d|", color_count,
+                     (int)bScaleColors, dfScaleMin, dfScaleRatio, gamma,
+                     (int)iRangeColorspace, layer->offsite.red,
+                     layer->offsite.green, layer->offsite.blue));
+      for (i = 0; i < color_count; i++) {
+        GDALColorEntry sEntry;
+        GDALGetColorEntryAsRGB(hColorMap, i, &sEntry);
+        pszDomain = msStringConcatenate(
+            pszDomain, CPLSPrintf("%02x%02x%02x", sEntry.c1 & 0xff,
+                                  sEntry.c2 & 0xff, sEntry.c3 & 0xff));
+      }
+      pszLUTKey = msClassLUTGetKey(layer, pszDomain);
+      msFree(pszDomain);
+    }
+
+    if (pszLUTKey != NULL &&
+        msClassLUTCacheGet(pszLUTKey, MAXCOLORS, rb_cmap_planes, NULL)) {
+      if (layer->debug >= MS_DEBUGLEVEL_TUNING)
+        msDebug("msDrawGDAL(): reusing cached classification color map.\n");
+      bLUTFromCache = true;
+    }
+
+    for (i = 0; !bLUTFromCache && i < color_count; i++) {
       colorObj pixel;
       int colormap_index;
       GDALColorEntry sEntry;
@@ -669,6 +710,12 @@ int msDrawRasterLayerGDAL(mapObj *map, layerObj *layer, imageObj *image,
         }
       }
     }
+
+    if (pszLUTKey != NULL) {
+      if (!bLUTFromCache)
+        msClassLUTCachePut(pszLUTKey, MAXCOLORS, rb_cmap_planes, NULL);
+      msFree(pszLUTKey);
+    }
   } else if (hBand2 == NULL && hColorMap != NULL &&
              rb->type == MS_BUFFER_BYTE_RGBA) {
     int color_count;
@@ -1235,6 +1282,22 @@ static int ApplyLUT(int iColorIndex, const char *lut_def, const void *pInBuffer,
   return err;
 }
 
+/************************************************************************/
+/*                         DeadlineProgress()                           */
+/*                                                                      */
+/*      GDAL progress callback used to interrupt long RasterIO calls    */
+/*      once the map deadline has passed. It may be called from GDAL    */
+/*      worker threads, so the error is set by the caller of RasterIO.  */
+/************************************************************************/
+
+static int CPL_STDCALL DeadlineProgress(double dfComplete,
+                                        const char *pszMessage,
+                                        void *pProgressArg) {
+  (void)dfComplete;
+  (void)pszMessage;
+  return msMapGetRemainingTime((const mapObj *)pProgressArg) != 0;
+}
+
 /************************************************************************/
 /*                           LoadGDALImages()                           */
 /*                                                                      */
@@ -1256,6 +1319,13 @@ static int LoadGDALImages(GDALDatasetH hDS, int band_numbers[4], int band_count,
   CPLErr eErr;
   float *pafWholeRawData;
   char **papszLUTs;
+  GDALRasterIOExtraArg sExtraArg;
+
+  INIT_RASTERIO_EXTRA_ARG(sExtraArg);
+  if (layer->map && layer->map->deadline > 0) {
+    sExtraArg.pfnProgress = DeadlineProgress;
+    sExtraArg.pProgressData = layer->map;
+  }
 
   *pbScaled = false;
   *pdfScaleMin = 0;
@@ -1315,13 +1385,14 @@ static int LoadGDALImages(GDALDatasetH hDS, int band_numbers[4], int band_count,
     } else
       pBuffer = pabyWholeBuffer;
 
-    eErr = GDALDatasetRasterIO(hDS, GF_Read, src_xoff, src_yoff, src_xsize,
-                               src_ysize, pBuffer, dst_xsize, dst_ysize, eDT,
-                               band_count, band_numbers, 0, 0, 0);
+    eErr = GDALDatasetRasterIOEx(hDS, GF_Read, src_xoff, src_yoff, src_xsize,
+                                 src_ysize, pBuffer, dst_xsize, dst_ysize, eDT,
+                                 band_count, band_numbers, 0, 0, 0, &sExtraArg);
 
     if (eErr != CE_None) {
-      msSetError(MS_IOERR, "GDALDatasetRasterIO() failed: %s", "drawGDAL()",
-                 CPLGetLastErrorMsg());
+      if (msMapCheckDeadline(layer->map, "drawGDAL()") == MS_SUCCESS)
+        msSetError(MS_IOERR, "GDALDatasetRasterIO() failed: %s", "drawGDAL()",
+                   CPLGetLastErrorMsg());
       FreeLUTs(papszLUTs);
       msFree(panBuffer);
       return -1;
@@ -1370,13 +1441,15 @@ static int LoadGDALImages(GDALDatasetH hDS, int band_numbers[4], int band_count,
     return -1;
   }
 
-  eErr = GDALDatasetRasterIO(hDS, GF_Read, src_xoff, src_yoff, src_xsize,
-                             src_ysize, pafWholeRawData, dst_xsize, dst_ysize,
-                             GDT_Float32, band_count, band_numbers, 0, 0, 0);
+  eErr = GDALDatasetRasterIOEx(
+      hDS, GF_Read, src_xoff, src_yoff, src_xsize, src_ysize, pafWholeRawData,
+      dst_xsize, dst_ysize, GDT_Float32, band_count, band_numbers, 0, 0, 0,
+      &sExtraArg);
 
   if (eErr != CE_None) {
-    msSetError(MS_IOERR, "GDALDatasetRasterIO() failed: %s", "drawGDAL()",
-               CPLGetLastErrorMsg());
+    if (msMapCheckDeadline(layer->map, "drawGDAL()") == MS_SUCCESS)
+      msSetError(MS_IOERR, "GDALDatasetRasterIO() failed: %s", "drawGDAL()",
+                 CPLGetLastErrorMsg());
 
     free(pafWholeRawData);
     return -1;
@@ -1953,6 +2026,9 @@ static int msDrawRasterLayerGDAL_16BitClassification(
   rasterBufferObj *mask_rb = NULL;
   rasterBufferObj s_mask_rb;
   int lastC;
+  unsigned char *pabyBucketDone;
+  int iFirstBucket, iLastBucket, nComputedBuckets = 0;
+  char *pszLUTKey;
   struct mstimeval starttime = {0}, endtime = {0};
 
   const char *pszClassifyScaled;
@@ -2061,13 +2137,26 @@ static int msDrawRasterLayerGDAL_16BitClassification(
   /* -------------------------------------------------------------------- */
   if (eDataType == GDT_Byte || eDataType == GDT_Int16 ||
       eDataType == GDT_UInt16) {
-    if (pszScaleInfo == NULL) {
-      dfScaleMin = fDataMin - 0.5;
-      dfScaleMax = fDataMax + 0.5;
-    }
+    if (pszScaleInfo == NULL && pszBuckets == NULL && !bClassifyScaled) {
+      /* One bucket per possible value of the data type, rather than per */
+      /* value of this block, so that the lookup table does not depend   */
+      /* on the block contents and can be reused by later requests.      */
+      const double dfTypeMin = (eDataType == GDT_Int16) ? -32768.0 : 0.0;
+      const double dfTypeMax = (eDataType == GDT_Byte)    ? 255.0
+                               : (eDataType == GDT_Int16) ? 32767.0
+                                                          : 65535.0;
+      dfScaleMin = dfTypeMin - 0.5;
+      dfScaleMax = dfTypeMax + 0.5;
+      nBucketCount = (int)(dfTypeMax - dfTypeMin) + 1;
+    } else {
+      if (pszScaleInfo == NULL) {
+        dfScaleMin = fDataMin - 0.5;
+        dfScaleMax = fDataMax + 0.5;
+      }
 
-    if (pszBuckets == NULL) {
-      nBucketCount = (int)floor(fDataMax - fDataMin + 1.1);
+      if (pszBuckets == NULL) {
+        nBucketCount = (int)floor(fDataMax - fDataMin + 1.1);
+      }
     }
   }
 
@@ -2120,6 +2209,7 @@ static int msDrawRasterLayerGDAL_16BitClassification(
   rb_cmap[1] = (unsigned char *)msSmallCalloc(1, nBucketCount);
   rb_cmap[2] = (unsigned char *)msSmallCalloc(1, nBucketCount);
   rb_cmap[3] = (unsigned char *)msSmallCalloc(1, nBucketCount);
+  pabyBucketDone = (unsigned char *)msSmallCalloc(1, nBucketCount);
 
   if (layer->debug >= MS_DEBUGLEVEL_TUNING) {
     msGettimeofday(&starttime, NULL);
@@ -2128,12 +2218,45 @@ static int msDrawRasterLayerGDAL_16BitClassification(
   const char *sgamma = msLayerGetProcessingKey(layer, "GAMMA");
   const double gamma = sgamma ? CPLAtof(sgamma) : 1.0;
 
+  /* -------------------------------------------------------------------- */
+  /*      Only the buckets spanned by the values of this block are        */
+  /*      needed.  Note that the first pixel is not accounted for in      */
+  /*      fDataMin/fDataMax.                                              */
+  /* -------------------------------------------------------------------- */
+  {
+    double dfFirstBucket = floor((fDataMin - dfScaleMin) * dfScaleRatio);
+    double dfLastBucket = floor((fDataMax - dfScaleMin) * dfScaleRatio);
+    if (nPixelCount > 0 && !CPLIsNan(pafRawData[0]) &&
+        !(bGotNoData && IsNoData(pafRawData[0], fNoDataValue))) {
+      const double dfBucket =
+          floor((pafRawData[0] - dfScaleMin) * dfScaleRatio);
+      dfFirstBucket = MS_MIN(dfFirstBucket, dfBucket);
+      dfLastBucket = MS_MAX(dfLastBucket, dfBucket);
+    }
+    iFirstBucket = (int)MS_MAX(0.0, MS_MIN(dfFirstBucket, nBucketCount - 1.0));
+    iLastBucket = (int)MS_MAX(0.0, MS_MIN(dfLastBucket, nBucketCount - 1.0));
+  }
+
+  /* -------------------------------------------------------------------- */
+  /*      Fetch the buckets already computed by previous requests.        */
+  /* -------------------------------------------------------------------- */
+  pszLUTKey = msClassLUTGetKey(
+      layer, CPLSPrintf("16bit|%d|%.17g|%.17g|%d|%.17g", bClassifyScaled,
+                        dfScaleMin, dfScaleRatio, nBucketCount, gamma));
+  if (pszLUTKey != NULL)
+    msClassLUTCacheGet(pszLUTKey, nBucketCount, rb_cmap, pabyBucketDone);
+
   lastC = -1;
-  for (i = 0; i < nBucketCount; i++) {
+  for (i = iFirstBucket; i <= iLastBucket; i++) {
     double dfOriginalValue;
 
     cmap[i] = -1;
 
+    if (pabyBucketDone[i])
+      continue;
+    pabyBucketDone[i] = 1;
+    nComputedBuckets++;
+
     // i = (int) ((dfOriginalValue - dfScaleMin) * dfScaleRatio+1)-1;
     dfOriginalValue = (i + 0.5) / dfScaleRatio + dfScaleMin;
 
@@ -2192,12 +2315,20 @@ static int msDrawRasterLayerGDAL_16BitClassification(
     }
   }
 
+  if (pszLUTKey != NULL) {
+    if (nComputedBuckets > 0)
+      msClassLUTCachePut(pszLUTKey, nBucketCount, rb_cmap, pabyBucketDone);
+    msFree(pszLUTKey);
+  }
+
   if (layer->debug >= MS_DEBUGLEVEL_TUNING) {
     msGettimeofday(&endtime, NULL);
     msDebug(
-        "msDrawRasterGDAL_16BitClassification() bucket creation time: %.3fs\n",
+        "msDrawRasterGDAL_16BitClassification() bucket creation time: %.3fs "
+        "(%d buckets computed)\n",
         (endtime.tv_sec + endtime.tv_usec / 1.0e6) -
-            (starttime.tv_sec + starttime.tv_usec / 1.0e6));
+            (starttime.tv_sec + starttime.tv_usec / 1.0e6),
+        nComputedBuckets);
   }
 
   /* ==================================================================== */
@@ -2247,12 +2378,327 @@ static int msDrawRasterLayerGDAL_16BitClassification(
   free(rb_cmap[1]);
   free(rb_cmap[2]);
   free(rb_cmap[3]);
+  free(pabyBucketDone);
 
   assert(k == dst_xsize * dst_ysize);
 
   return 0;
 }
 
+/************************************************************************/
+/* ==================================================================== */
+/*      Classification lookup table cache.                              */
+/*                                                                      */
+/*      Classifying a raster evaluates the class expressions for each   */
+/*      color table entry or bucket, which gets expensive with many     */
+/*      classes.  The resulting value to RGBA tables only depend on     */
+/*      the layer classes and on the value domain, so they are kept in  */
+/*      a process wide LRU cache bounded by                             */
+/*      MS_RASTER_CLASS_LUT_CACHE_SIZE (in megabytes, 0 to disable).    */
+/*      Entries are only accessed with TLOCK_RASTERLUT held, and are    */
+/*      copied in and out by callers.                                   */
+/* ==================================================================== */
+/************************************************************************/
+
+#define MS_RASTER_CLASS_LUT_CACHE_DEFAULT_SIZE 16
+
+typedef struct msClassLUTCacheEntry msClassLUTCacheEntry;
+
+struct msClassLUTCacheEntry {
+  char *pszKey;
+  int nEntries;
+  unsigned char *pabyRGBA; /* 4 planes of nEntries values */
+  unsigned char *pabyDone; /* per entry: whether it has been computed */
+  size_t nBytes;
+  msClassLUTCacheEntry *psPrev;
+  msClassLUTCacheEntry *psNext;
+};
+
+static msClassLUTCacheEntry *psClassLUTCacheHead = NULL;
+static msClassLUTCacheEntry *psClassLUTCacheTail = NULL;
+static size_t nClassLUTCacheBytes = 0;
+
+/************************************************************************/
+/*                       msClassLUTCacheMaxBytes()                      */
+/************************************************************************/
+
+static size_t msClassLUTCacheMaxBytes(void)
+
+{
+  const char *pszSize =
+      CPLGetConfigOption("MS_RASTER_CLASS_LUT_CACHE_SIZE", NULL);
+  int nSizeMB = MS_RASTER_CLASS_LUT_CACHE_DEFAULT_SIZE;
+
+  if (pszSize != NULL)
+    nSizeMB = atoi(pszSize);
+
+  if (nSizeMB <= 0)
+    return 0;
+
+  return (size_t)nSizeMB * 1024 * 1024;
+}
+
+/************************************************************************/
+/*                          msClassLUTGetKey()                          */
+/*                                                                      */
+/*      Build the cache key from the value domain description and       */
+/*      from everything in the layer classes that affects raster        */
+/*      classification.  Returns NULL if caching is disabled.           */
+/************************************************************************/
+
+static char *msClassLUTGetKey(layerObj *layer, const char *pszDomain)
+
+{
+  char *pszKey;
+  int i, s;
+
+  if (msClassLUTCacheMaxBytes() == 0)
+    return NULL;
+
+  pszKey = msStrdup(pszDomain);
+  pszKey = msStringConcatenate(pszKey, "|group=");
+  if (layer->classgroup)
+    pszKey = msStringConcatenate(pszKey, layer->classgroup);
+
+  for (i = 0; i < layer->numclasses; i++) {
+    const classObj *psClass = layer->class[i];
+
+    pszKey = msStringConcatenate(
+        pszKey, CPLSPrintf("|class=%d,%d,%d,", psClass->expression.type,
+                           psClass->expression.flags, psClass->numstyles));
+    if (psClass->expression.string)
+      pszKey = msStringConcatenate(pszKey, psClass->expression.string);
+    pszKey = msStringConcatenate(pszKey, "|");
+    if (psClass->group)
+      pszKey = msStringConcatenate(pszKey, psClass->group);
+
+    for (s = 0; s < psClass->numstyles; s++) {
+      const styleObj *psStyle = psClass->styles[s];
+
+      /* msValueToRange() overwrites the color of range styles at every */
+      /* value, so only their range inputs are part of the key. */
+      if (MS_VALID_COLOR(psStyle->mincolor) &&
+          MS_VALID_COLOR(psStyle->maxcolor)) {
+        pszKey = msStringConcatenate(
+            pszKey,
+            CPLSPrintf("|range=%d,%d,%d,%d,%d,%d,%d,%d,%d,%.17g,%.17g,",
+                       psStyle->mincolor.red, psStyle->mincolor.green,
+                       psStyle->mincolor.blue, psStyle->mincolor.alpha,
+                       psStyle->maxcolor.red, psStyle->maxcolor.green,
+                       psStyle->maxcolor.blue, psStyle->maxcolor.alpha,
+                       psStyle->opacity, psStyle->minvalue,
+                       psStyle->maxvalue));
+        if (psStyle->rangeitem)
+          pszKey = msStringConcatenate(pszKey, psStyle->rangeitem);
+        continue;
+      }
+
+      pszKey = msStringConcatenate(
+          pszKey,
+          CPLSPrintf("|style=%d,%d,%d,%d,%d,%d,%d,%d,%d,%d,%d,%d,%d,%.17g,"
+                     "%.17g",
+                     psStyle->color.red, psStyle->color.green,
+                     psStyle->color.blue, psStyle->color.alpha,
+                     psStyle->mincolor.red, psStyle->mincolor.green,
+                     psStyle->mincolor.blue, psStyle->mincolor.alpha,
+                     psStyle->maxcolor.red, psStyle->maxcolor.green,
+                     psStyle->maxcolor.blue, psStyle->maxcolor.alpha,
+                     psStyle->opacity, psStyle->minvalue, psStyle->maxvalue));
+    }
+  }
+
+  return pszKey;
+}
+
+/************************************************************************/
+/*                      msClassLUTCacheFreeEntry()                      */
+/************************************************************************/
+
+static void msClassLUTCacheFreeEntry(msClassLUTCacheEntry *psEntry)
+
+{
+  msFree(psEntry->pszKey);
+  msFree(psEntry->pabyRGBA);
+  msFree(psEntry->pabyDone);
+  msFree(psEntry);
+}
+
+/************************************************************************/
+/*                       msClassLUTCacheUnlink()                        */
+/*                                                                      */
+/*      Must be called with TLOCK_RASTERLUT held.                       */
+/************************************************************************/
+
+static void msClassLUTCacheUnlink(msClassLUTCacheEntry *psEntry)
+
+{
+  if (psEntry->psPrev)
+    psEntry->psPrev->psNext = psEntry->psNext;
+  else
+    psClassLUTCacheHead = psEntry->psNext;
+  if (psEntry->psNext)
+    psEntry->psNext->psPrev = psEntry->psPrev;
+  else
+    psClassLUTCacheTail = psEntry->psPrev;
+  psEntry->psPrev = psEntry->psNext = NULL;
+  nClassLUTCacheBytes -= psEntry->nBytes;
+}
+
+/************************************************************************/
+/*                      msClassLUTCachePushFront()                      */
+/*                                                                      */
+/*      Must be called with TLOCK_RASTERLUT held.                       */
+/************************************************************************/
+
+static void msClassLUTCachePushFront(msClassLUTCacheEntry *psEntry)
+
+{
+  psEntry->psPrev = NULL;
+  psEntry->psNext = psClassLUTCacheHead;
+  if (psClassLUTCacheHead)
+    psClassLUTCacheHead->psPrev = psEntry;
+  else
+    psClassLUTCacheTail = psEntry;
+  psClassLUTCacheHead = psEntry;
+  nClassLUTCacheBytes += psEntry->nBytes;
+}
+
+/************************************************************************/
+/*                         msClassLUTCacheFind()                        */
+/*                                                                      */
+/*      Must be called with TLOCK_RASTERLUT held.  The entry found is   */
+/*      moved at the head of the LRU list.                              */
+/************************************************************************/
+
+static msClassLUTCacheEntry *msClassLUTCacheFind(const char *pszKey,
+                                                 int nEntries)
+
+{
+  msClassLUTCacheEntry *psEntry;
+
+  for (psEntry = psClassLUTCacheHead; psEntry != NULL;
+       psEntry = psEntry->psNext) {
+    if (psEntry->nEntries == nEntries && strcmp(psEntry->pszKey, pszKey) == 0)
+      break;
+  }
+
+  if (psEntry != NULL && psEntry != psClassLUTCacheHead) {
+    msClassLUTCacheUnlink(psEntry);
+    msClassLUTCachePushFront(psEntry);
+  }
+
+  return psEntry;
+}
+
+/************************************************************************/
+/*                         msClassLUTCacheGet()                         */
+/*                                                                      */
+/*      Copy the cached table matching pszKey, if any, into rb_cmap.    */
+/*      If pabyDone is not NULL it receives which entries have been     */
+/*      computed.  Returns MS_TRUE if the key was found.                */
+/************************************************************************/
+
+static int msClassLUTCacheGet(const char *pszKey, int nEntries,
+                              unsigned char *rb_cmap[4],
+                              unsigned char *pabyDone)
+
+{
+  msClassLUTCacheEntry *psEntry;
+  int iPlane;
+
+  msAcquireLock(TLOCK_RASTERLUT);
+  psEntry = msClassLUTCacheFind(pszKey, nEntries);
+  if (psEntry != NULL) {
+    for (iPlane = 0; iPlane < 4; iPlane++)
+      memcpy(rb_cmap[iPlane], psEntry->pabyRGBA + (size_t)iPlane * nEntries,
+             nEntries);
+    if (pabyDone != NULL)
+      memcpy(pabyDone, psEntry->pabyDone, nEntries);
+  }
+  msReleaseLock(TLOCK_RASTERLUT);
+
+  return psEntry != NULL;
+}
+
+/************************************************************************/
+/*                         msClassLUTCachePut()                         */
+/*                                                                      */
+/*      Store or update the table for pszKey.  Only entries flagged     */
+/*      in pabyDone are stored; all of them if pabyDone is NULL.        */
+/************************************************************************/
+
+static void msClassLUTCachePut(const char *pszKey, int nEntries,
+                               unsigned char *rb_cmap[4],
+                               const unsigned char *pabyDone)
+
+{
+  const size_t nMaxBytes = msClassLUTCacheMaxBytes();
+  msClassLUTCacheEntry *psEntry;
+  msClassLUTCacheEntry *psEvicted = NULL;
+  int i, iPlane;
+
+  msAcquireLock(TLOCK_RASTERLUT);
+
+  psEntry = msClassLUTCacheFind(pszKey, nEntries);
+  if (psEntry == NULL) {
+    const size_t nBytes = sizeof(msClassLUTCacheEntry) + strlen(pszKey) + 1 +
+                          (size_t)nEntries * 5;
+    if (nBytes > nMaxBytes) {
+      msReleaseLock(TLOCK_RASTERLUT);
+      return;
+    }
+
+    while (psClassLUTCacheTail != NULL &&
+           nClassLUTCacheBytes + nBytes > nMaxBytes) {
+      msClassLUTCacheEntry *psLast = psClassLUTCacheTail;
+      msClassLUTCacheUnlink(psLast);
+      psLast->psNext = psEvicted;
+      psEvicted = psLast;
+    }
+
+    psEntry =
+        (msClassLUTCacheEntry *)msSmallCalloc(1, sizeof(msClassLUTCacheEntry));
+    psEntry->pszKey = msStrdup(pszKey);
+    psEntry->nEntries = nEntries;
+    psEntry->pabyRGBA = (unsigned char *)msSmallCalloc(4, nEntries);
+    psEntry->pabyDone = (unsigned char *)msSmallCalloc(1, nEntries);
+    psEntry->nBytes = nBytes;
+    msClassLUTCachePushFront(psEntry);
+  }
+
+  for (i = 0; i < nEntries; i++) {
+    if (pabyDone != NULL && !pabyDone[i])
+      continue;
+    for (iPlane = 0; iPlane < 4; iPlane++)
+      psEntry->pabyRGBA[(size_t)iPlane * nEntries + i] = rb_cmap[iPlane][i];
+    psEntry->pabyDone[i] = 1;
+  }
+
+  msReleaseLock(TLOCK_RASTERLUT);
+
+  while (psEvicted != NULL) {
+    msClassLUTCacheEntry *psNext = psEvicted->psNext;
+    msClassLUTCacheFreeEntry(psEvicted);
+    psEvicted = psNext;
+  }
+}
+
+/************************************************************************/
+/*                    msRasterClassLUTCacheCleanup()                    */
+/************************************************************************/
+
+void msRasterClassLUTCacheCleanup(void)
+
+{
+  msAcquireLock(TLOCK_RASTERLUT);
+  while (psClassLUTCacheHead != NULL) {
+    msClassLUTCacheEntry *psEntry = psClassLUTCacheHead;
+    msClassLUTCacheUnlink(psEntry);
+    msClassLUTCacheFreeEntry(psEntry);
+  }
+  msReleaseLock(TLOCK_RASTERLUT);
+}
+
 /************************************************************************/
 /*                          IsNoData()                                  */
 /************************************************************************/
@@ -88,7 +88,8 @@ static char *const ms_errorCodes[MS_NUMERRORCODES] = {
     "Renderer error.",
     "V8 engine error.",
     "OCG API error.",
-    "Flatgeobuf error."};
+    "Flatgeobuf error.",
+    "Request time budget exceeded."};
 
 #ifndef USE_THREAD
 
@@ -718,6 +719,12 @@ char *msGetVersion() {
 #ifdef USE_PBF
   strcat(version, " SUPPORTS=PBF");
 #endif
+#ifdef USE_ZLIB
+  strcat(version, " SUPPORTS=ZLIB");
+#endif
+#ifdef USE_ZSTD
+  strcat(version, " SUPPORTS=ZSTD");
+#endif
 #ifdef USE_JPEG
   strcat(version, " INPUT=JPEG");
 #endif
@@ -41,6 +41,7 @@
 #include "mapfile.h"
 #include "mapthread.h"
 #include "maptime.h"
+#include "mapmetrics.h"
 #include "mapogcsld.h"
 
 #include "cpl_conv.h"
@@ -4009,6 +4010,7 @@ int initLayer(layerObj *layer, mapObj *map) {
 
   layer->classitem = NULL;
   layer->classitemindex = -1;
+  layer->classdispatch = NULL;
 
   layer->units = MS_METERS;
   if (msInitProjection(&(layer->projection)) == -1)
@@ -4145,6 +4147,7 @@ int freeLayer(layerObj *layer) {
 
   if (msLayerIsOpen(layer))
     msLayerClose(layer);
+  msLayerFreeClassDispatch(layer);
 
   msFree(layer->name);
   msFree(layer->encoding);
@@ -6556,6 +6559,16 @@ int msInitLabelCache(labelCacheObj *cache) {
   return MS_SUCCESS;
 }
 
+int msLabelCacheIsEmpty(labelCacheObj *cache) {
+  int p;
+
+  for (p = 0; p < MS_MAX_LABEL_PRIORITY; p++) {
+    if (cache->slots[p].numlabels > 0)
+      return MS_FALSE;
+  }
+  return MS_TRUE;
+}
+
 static void writeMap(FILE *stream, int indent, mapObj *map) {
   int i;
   colorObj c;
@@ -7077,6 +7090,9 @@ mapObj *msLoadMap(const char *filename, const char *new_mappath,
   struct mstimeval starttime = {0}, endtime = {0};
   char szPath[MS_MAXPATHLEN], szCWDPath[MS_MAXPATHLEN];
   int debuglevel;
+  const int metrics = msMetricsEnabled();
+  const int trace = msTraceEnabled();
+  double metricsstart = 0;
 
   debuglevel = (int)msGetGlobalDebugLevel();
 
@@ -7084,6 +7100,8 @@ mapObj *msLoadMap(const char *filename, const char *new_mappath,
     /* In debug mode, track time spent loading/parsing mapfile. */
     msGettimeofday(&starttime, NULL);
   }
+  if (metrics || trace)
+    metricsstart = msMetricsTime();
 
   if (!filename) {
     msSetError(MS_MISCERR, "Filename is undefined.", "msLoadMap()");
@@ -7193,6 +7211,11 @@ mapObj *msLoadMap(const char *filename, const char *new_mappath,
             (endtime.tv_sec + endtime.tv_usec / 1.0e6) -
                 (starttime.tv_sec + starttime.tv_usec / 1.0e6));
   }
+  if (metrics)
+    msMetricsAdd(MS_METRIC_LOADMAP_DURATION, NULL,
+                 msMetricsTime() - metricsstart);
+  if (trace)
+    msTraceAdd("msLoadMap", filename, metricsstart);
 
   return map;
 }
@@ -7215,9 +7238,12 @@ static void hashTableSubstituteString(hashTableObj *hash, const char *from,
 
 static void classSubstituteString(classObj *class, const char *from,
                                   const char *to) {
-  if (class->expression.string)
+  if (class->expression.string) {
     class->expression.string =
         msCaseReplaceSubstring(class->expression.string, from, to);
+    if (class->layer)
+      msLayerFreeClassDispatch(class->layer);
+  }
   if (class->text.string)
     class->text.string = msCaseReplaceSubstring(class->text.string, from, to);
   if (class->title)
@@ -161,6 +161,11 @@ int msFlatGeobufLayerOpen(layerObj *layer) {
     return MS_FAILURE;
   }
 
+  /* map local files in memory, others are read with coalesced requests */
+  if (!STARTS_WITH(szPath, "/vsi") && flatgeobuf_map_file(ctx) == 0 &&
+      layer->debug >= MS_DEBUGLEVEL_VV)
+    msDebug("msFlatGeobufLayerOpen(): %s is memory mapped.\n", szPath);
+
   if (layer->projection.numargs > 0 &&
       EQUAL(layer->projection.args[0], "auto")) {
     OGRSpatialReferenceH hSRS = OSRNewSpatialReference(NULL);
@@ -239,12 +244,8 @@ int msFlatGeobufLayerNextShape(layerObj *layer, shapeObj *shape) {
       if (ctx->search_index >= ctx->search_result_len)
         return MS_DONE;
       flatgeobuf_search_item item = ctx->search_result[ctx->search_index];
-      if (VSIFSeekL(ctx->file, ctx->feature_offset + item.offset, SEEK_SET) ==
-          -1) {
-        msSetError(MS_FGBERR, "Unable to seek in file",
-                   "msFlatGeobufLayerNextShape");
+      if (flatgeobuf_prefetch_features(ctx, ctx->search_index) == -1)
         return MS_FAILURE;
-      }
       ctx->offset = ctx->feature_offset + item.offset;
       ctx->search_index++;
       ctx->feature_index = item.index;
@@ -282,11 +283,7 @@ int msFlatGeobufLayerGetShape(layerObj *layer, shapeObj *shape,
   }
   uint64_t offset;
   flatgeobuf_read_feature_offset(ctx, i, &offset);
-  if (VSIFSeekL(ctx->file, ctx->feature_offset + offset, SEEK_SET) == -1) {
-    msSetError(MS_FGBERR, "Unable to seek in file",
-               "msFlatGeobufLayerGetShape");
-    return MS_FAILURE;
-  }
+  ctx->offset = ctx->feature_offset + offset;
   int ret = flatgeobuf_decode_feature(ctx, layer, shape);
   if (ret == -1)
     return MS_FAILURE;
@@ -298,8 +295,10 @@ int msFlatGeobufLayerClose(layerObj *layer) {
   ctx = layer->layerinfo;
   if (!ctx)
     return MS_SUCCESS;
-  VSIFCloseL(ctx->file);
+  VSILFILE *file = ctx->file;
+  /* unmap before closing the file */
   flatgeobuf_free_ctx(ctx);
+  VSIFCloseL(file);
   layer->layerinfo = NULL;
   return MS_SUCCESS;
 }
@@ -32,6 +32,13 @@
 #include "mapserver.h"
 #include "mapthread.h"
 
+#ifdef USE_ZLIB
+#include <zlib.h>
+#endif
+#ifdef USE_ZSTD
+#include <zstd.h>
+#endif
+
 #ifdef _WIN32
 #include <fcntl.h>
 #include <io.h>
@@ -50,6 +57,8 @@ typedef struct msIOContextGroup_t {
   msIOContext stdout_context;
   msIOContext stderr_context;
 
+  char **request_envp; /* see msIO_setRequestEnvironment() */
+
   void *thread_id;
   struct msIOContextGroup_t *next;
 } msIOContextGroup;
@@ -133,6 +142,7 @@ static msIOContextGroup *msIO_GetContextGroup()
   group->stdin_context = default_contexts.stdin_context;
   group->stdout_context = default_contexts.stdout_context;
   group->stderr_context = default_contexts.stderr_context;
+  group->request_envp = NULL;
   group->thread_id = nThreadId;
 
   group->next = io_context_list;
@@ -160,6 +170,50 @@ int msIO_isStdContext() {
   return MS_FALSE;
 }
 
+/************************************************************************/
+/*                     msIO_setRequestEnvironment()                     */
+/*                                                                      */
+/*      Sets the CGI environment ("NAME=value" strings, NULL            */
+/*      terminated) of the request served by the calling thread, for    */
+/*      servers handling several requests concurrently, like the        */
+/*      FastCGI worker threads of mapserv. NULL restores the process    */
+/*      environment.                                                    */
+/************************************************************************/
+
+void msIO_setRequestEnvironment(char **envp)
+
+{
+  msIOContextGroup *group = msIO_GetContextGroup();
+
+  if (group != NULL)
+    group->request_envp = envp;
+}
+
+/************************************************************************/
+/*                            msIO_getenv()                             */
+/*                                                                      */
+/*      getenv() for the CGI variables of the current request.          */
+/************************************************************************/
+
+char *msIO_getenv(const char *name)
+
+{
+  void *nThreadId = msGetThreadId();
+  msIOContextGroup *group = io_context_list;
+  const size_t len = strlen(name);
+
+  if (group == NULL || group->thread_id != nThreadId)
+    group = msIO_GetContextGroup();
+  if (group == NULL || group->request_envp == NULL)
+    return getenv(name);
+
+  for (char **env = group->request_envp; *env; env++) {
+    if (strncmp(*env, name, len) == 0 && (*env)[len] == '=')
+      return *env + len + 1;
+  }
+  return NULL;
+}
+
 /************************************************************************/
 /*                          msIO_getHandler()                           */
 /************************************************************************/
@@ -1064,3 +1118,398 @@ int msIO_bufferRead(void *cbData, void *data, int byteCount)
   /* not implemented yet. */
   return 0;
 }
+
+/* ==================================================================== */
+/*      compressed stdout (HTTP Content-Encoding) handling.             */
+/* ==================================================================== */
+
+#if defined(USE_ZLIB) || defined(USE_ZSTD)
+
+/* beyond this size the output is not considered to start with headers */
+#define MS_IO_COMPRESS_MAX_HEADERS 65536
+
+typedef enum {
+  MS_IO_ENCODING_GZIP,
+  MS_IO_ENCODING_DEFLATE,
+  MS_IO_ENCODING_ZSTD
+} msIOEncoding;
+
+typedef enum {
+  MS_IO_COMPRESS_HEADERS,    /* buffering the headers */
+  MS_IO_COMPRESS_BODY,       /* compressing the body */
+  MS_IO_COMPRESS_PASSTHROUGH /* content not compressed */
+} msIOCompressState;
+
+typedef struct {
+  msIOContext next; /* the wrapped stdout handler */
+  msIOEncoding encoding;
+  int level;
+  msIOCompressState state;
+  msIOBuffer headers;
+#ifdef USE_ZLIB
+  z_stream zstream;
+#endif
+#ifdef USE_ZSTD
+  ZSTD_CStream *zstdstream;
+#endif
+  unsigned char out[16384];
+} msIOCompressor;
+
+static const char *msIO_encodingName(msIOEncoding encoding) {
+  switch (encoding) {
+  case MS_IO_ENCODING_GZIP:
+    return "gzip";
+  case MS_IO_ENCODING_DEFLATE:
+    return "deflate";
+  default:
+    return "zstd";
+  }
+}
+
+/************************************************************************/
+/*                       msIO_isEncodingAccepted()                      */
+/*                                                                      */
+/*      Does an Accept-Encoding request header value accept the         */
+/*      encoding? An explicit entry takes precedence over "*", and a    */
+/*      q value of 0 means that the encoding is refused.                */
+/************************************************************************/
+
+static int msIO_isEncodingAccepted(const char *accept_encoding,
+                                   const char *encoding)
+
+{
+  int numtokens = 0, exact = -1, wildcard = MS_FALSE;
+  char **tokens = msStringSplit(accept_encoding, ',', &numtokens);
+
+  for (int i = 0; i < numtokens; i++) {
+    char *token = tokens[i];
+    char *params = strchr(token, ';');
+    double q = 1.0;
+
+    if (params) {
+      char *qparam = strstr(params + 1, "q=");
+      *params = '\0';
+      if (qparam)
+        q = atof(qparam + 2);
+    }
+    msStringTrim(token);
+    if (strcasecmp(token, encoding) == 0)
+      exact = (q > 0);
+    else if (strcmp(token, "*") == 0)
+      wildcard = (q > 0);
+  }
+  msFreeCharArray(tokens, numtokens);
+
+  return exact >= 0 ? exact : wildcard;
+}
+
+/************************************************************************/
+/*                      msIO_isCompressibleHeaders()                    */
+/*                                                                      */
+/*      Only textual content (XML, JSON, CSV, HTML...) is compressed,   */
+/*      and not if the response already has a Content-Encoding, a       */
+/*      Content-Length or a Status.                                     */
+/************************************************************************/
+
+static int msIO_isCompressibleHeaders(const char *headers)
+
+{
+  int compressible = MS_FALSE;
+  const char *line = headers;
+
+  while (*line && *line != '\r' && *line != '\n') {
+    const char *eol = line + strcspn(line, "\r\n");
+
+    if (strncasecmp(line, "Content-Type:", 13) == 0) {
+      char *type = msStrdup(line + 13);
+      type[eol - line - 13] = '\0';
+      msStringTrim(type);
+      compressible = strncasecmp(type, "text/", 5) == 0 ||
+                     strcasestr(type, "xml") != NULL ||
+                     strcasestr(type, "json") != NULL ||
+                     strcasestr(type, "javascript") != NULL ||
+                     strcasestr(type, "csv") != NULL;
+      free(type);
+    } else if (strncasecmp(line, "Content-Encoding:", 17) == 0 ||
+               strncasecmp(line, "Content-Length:", 15) == 0 ||
+               strncasecmp(line, "Status:", 7) == 0) {
+      return MS_FALSE;
+    }
+
+    line = eol;
+    if (*line == '\r')
+      line++;
+    if (*line == '\n')
+      line++;
+  }
+
+  return compressible;
+}
+
+/************************************************************************/
+/*                      msIO_compressorCompress()                       */
+/*                                                                      */
+/*      Compresses data, or with finish set ends the stream, and        */
+/*      writes the result to the wrapped handler.                       */
+/************************************************************************/
+
+static int msIO_compressorCompress(msIOCompressor *c, const void *data,
+                                   size_t size, int finish)
+
+{
+#ifdef USE_ZSTD
+  if (c->encoding == MS_IO_ENCODING_ZSTD) {
+    ZSTD_inBuffer in = {data, size, 0};
+    size_t remaining;
+
+    do {
+      ZSTD_outBuffer out = {c->out, sizeof(c->out), 0};
+      remaining = ZSTD_compressStream2(c->zstdstream, &out, &in,
+                                       finish ? ZSTD_e_end : ZSTD_e_continue);
+      if (ZSTD_isError(remaining))
+        return MS_FAILURE;
+      if (out.pos > 0 &&
+          msIO_contextWrite(&c->next, c->out, (int)out.pos) != (int)out.pos)
+        return MS_FAILURE;
+    } while (finish ? remaining != 0 : in.pos < in.size);
+    return MS_SUCCESS;
+  }
+#endif
+
+#ifdef USE_ZLIB
+  c->zstream.next_in = (Bytef *)data;
+  c->zstream.avail_in = (uInt)size;
+  do {
+    int nOut;
+
+    c->zstream.next_out = c->out;
+    c->zstream.avail_out = sizeof(c->out);
+    if (deflate(&c->zstream, finish ? Z_FINISH : Z_NO_FLUSH) ==
+        Z_STREAM_ERROR)
+      return MS_FAILURE;
+    nOut = (int)(sizeof(c->out) - c->zstream.avail_out);
+    if (nOut > 0 && msIO_contextWrite(&c->next, c->out, nOut) != nOut)
+      return MS_FAILURE;
+  } while (c->zstream.avail_out == 0);
+  return MS_SUCCESS;
+#else
+  (void)data;
+  (void)size;
+  (void)finish;
+  return MS_FAILURE;
+#endif
+}
+
+static int msIO_compressorStart(msIOCompressor *c)
+
+{
+#ifdef USE_ZSTD
+  if (c->encoding == MS_IO_ENCODING_ZSTD) {
+    c->zstdstream = ZSTD_createCStream();
+    if (!c->zstdstream)
+      return MS_FAILURE;
+    ZSTD_CCtx_setParameter(c->zstdstream, ZSTD_c_compressionLevel, c->level);
+    return MS_SUCCESS;
+  }
+#endif
+
+#ifdef USE_ZLIB
+  /* 15 window bits, plus 16 for a gzip rather than a zlib wrapper */
+  if (deflateInit2(&c->zstream,
+                   c->level > 0 ? MS_MIN(c->level, 9) : Z_DEFAULT_COMPRESSION,
+                   Z_DEFLATED,
+                   c->encoding == MS_IO_ENCODING_GZIP ? 15 + 16 : 15, 8,
+                   Z_DEFAULT_STRATEGY) != Z_OK)
+    return MS_FAILURE;
+  return MS_SUCCESS;
+#else
+  return MS_FAILURE;
+#endif
+}
+
+static void msIO_compressorEnd(msIOCompressor *c)
+
+{
+#ifdef USE_ZSTD
+  if (c->encoding == MS_IO_ENCODING_ZSTD) {
+    ZSTD_freeCStream(c->zstdstream);
+    return;
+  }
+#endif
+#ifdef USE_ZLIB
+  deflateEnd(&c->zstream);
+#endif
+}
+
+/************************************************************************/
+/*                        msIO_compressorWrite()                        */
+/*                                                                      */
+/*      The headers are buffered until the blank line that ends         */
+/*      them. If the content is compressible a Content-Encoding         */
+/*      header is added, and the body is compressed as it is written.   */
+/************************************************************************/
+
+static int msIO_compressorWrite(void *cbData, void *data, int byteCount)
+
+{
+  msIOCompressor *c = (msIOCompressor *)cbData;
+  const char *headers, *crlf, *lf;
+  size_t end, blank;
+
+  if (c->state == MS_IO_COMPRESS_BODY)
+    return msIO_compressorCompress(c, data, byteCount, MS_FALSE) == MS_SUCCESS
+               ? byteCount
+               : -1;
+  if (c->state == MS_IO_COMPRESS_PASSTHROUGH)
+    return msIO_contextWrite(&c->next, data, byteCount);
+
+  if (msIO_bufferWrite(&c->headers, data, byteCount) != byteCount)
+    return -1;
+
+  headers = (const char *)c->headers.data;
+  crlf = strstr(headers, "\r\n\r\n");
+  lf = strstr(headers, "\n\n");
+  if (crlf && (!lf || crlf < lf)) {
+    end = crlf - headers + 4;
+    blank = 2;
+  } else if (lf) {
+    end = lf - headers + 2;
+    blank = 1;
+  } else {
+    if (c->headers.data_offset > MS_IO_COMPRESS_MAX_HEADERS) {
+      c->state = MS_IO_COMPRESS_PASSTHROUGH;
+      msIO_contextWrite(&c->next, c->headers.data, c->headers.data_offset);
+    }
+    return byteCount;
+  }
+
+  if (msIO_isCompressibleHeaders(headers) &&
+      msIO_compressorStart(c) == MS_SUCCESS) {
+    char encoding[128];
+    const int len =
+        snprintf(encoding, sizeof(encoding),
+                 "Content-Encoding: %s%sVary: Accept-Encoding%s",
+                 msIO_encodingName(c->encoding), blank == 2 ? "\r\n" : "\n",
+                 blank == 2 ? "\r\n" : "\n");
+
+    c->state = MS_IO_COMPRESS_BODY;
+    msIO_contextWrite(&c->next, headers, (int)(end - blank));
+    msIO_contextWrite(&c->next, encoding, len);
+    msIO_contextWrite(&c->next, headers + end - blank, (int)blank);
+    if (msIO_compressorCompress(c, headers + end,
+                                c->headers.data_offset - end,
+                                MS_FALSE) != MS_SUCCESS)
+      return -1;
+  } else {
+    c->state = MS_IO_COMPRESS_PASSTHROUGH;
+    msIO_contextWrite(&c->next, c->headers.data, c->headers.data_offset);
+  }
+
+  return byteCount;
+}
+
+#endif /* USE_ZLIB || USE_ZSTD */
+
+/************************************************************************/
+/*                     msIO_pushStdoutCompression()                     */
+/*                                                                      */
+/*      Wraps the current stdout handler in one compressing the         */
+/*      response body with the first of the comma separated             */
+/*      encodings (gzip, deflate and zstd, or ON for all of them)       */
+/*      that is accepted by the client. Returns MS_TRUE if installed,   */
+/*      in which case msIO_popStdoutCompression() must be called once   */
+/*      the response is written.                                        */
+/************************************************************************/
+
+int msIO_pushStdoutCompression(const char *encodings,
+                               const char *accept_encoding, int level)
+
+{
+#if defined(USE_ZLIB) || defined(USE_ZSTD)
+  msIOContextGroup *group;
+  msIOCompressor *c;
+  msIOContext context;
+  char **tokens;
+  int numtokens = 0, found = MS_FALSE;
+  msIOEncoding encoding = MS_IO_ENCODING_GZIP;
+
+  if (!encodings || !accept_encoding || strcasecmp(encodings, "OFF") == 0)
+    return MS_FALSE;
+  if (strcasecmp(encodings, "ON") == 0)
+    encodings = "zstd,gzip,deflate";
+
+  tokens = msStringSplit(encodings, ',', &numtokens);
+  for (int i = 0; i < numtokens && !found; i++) {
+    msStringTrim(tokens[i]);
+#ifdef USE_ZSTD
+    if (strcasecmp(tokens[i], "zstd") == 0) {
+      encoding = MS_IO_ENCODING_ZSTD;
+      found = msIO_isEncodingAccepted(accept_encoding, "zstd");
+    }
+#endif
+#ifdef USE_ZLIB
+    if (strcasecmp(tokens[i], "gzip") == 0) {
+      encoding = MS_IO_ENCODING_GZIP;
+      found = msIO_isEncodingAccepted(accept_encoding, "gzip");
+    } else if (strcasecmp(tokens[i], "deflate") == 0) {
+      encoding = MS_IO_ENCODING_DEFLATE;
+      found = msIO_isEncodingAccepted(accept_encoding, "deflate");
+    }
+#endif
+  }
+  msFreeCharArray(tokens, numtokens);
+  if (!found)
+    return MS_FALSE;
+
+  group = msIO_GetContextGroup();
+  c = (msIOCompressor *)msSmallCalloc(1, sizeof(msIOCompressor));
+  c->next = group->stdout_context;
+  c->encoding = encoding;
+  c->level = level;
+  c->state = MS_IO_COMPRESS_HEADERS;
+
+  context.label = group->stdout_context.label;
+  context.write_channel = MS_TRUE;
+  context.readWriteFunc = msIO_compressorWrite;
+  context.cbData = c;
+  msIO_installHandlers(&group->stdin_context, &context,
+                       &group->stderr_context);
+  return MS_TRUE;
+#else
+  (void)encodings;
+  (void)accept_encoding;
+  (void)level;
+  return MS_FALSE;
+#endif
+}
+
+/************************************************************************/
+/*                      msIO_popStdoutCompression()                     */
+/*                                                                      */
+/*      Ends the compressed stream and restores the wrapped handler.    */
+/************************************************************************/
+
+void msIO_popStdoutCompression()
+
+{
+#if defined(USE_ZLIB) || defined(USE_ZSTD)
+  msIOContextGroup *group = msIO_GetContextGroup();
+  msIOCompressor *c;
+
+  if (group->stdout_context.readWriteFunc != msIO_compressorWrite)
+    return;
+  c = (msIOCompressor *)group->stdout_context.cbData;
+
+  if (c->state == MS_IO_COMPRESS_BODY) {
+    msIO_compressorCompress(c, NULL, 0, MS_TRUE);
+    msIO_compressorEnd(c);
+  } else if (c->state == MS_IO_COMPRESS_HEADERS && c->headers.data_offset > 0) {
+    msIO_contextWrite(&c->next, c->headers.data, c->headers.data_offset);
+  }
+
+  msIO_installHandlers(&group->stdin_context, &c->next,
+                       &group->stderr_context);
+  free(c->headers.data);
+  free(c);
+#endif
+}
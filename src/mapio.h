@@ -86,6 +86,8 @@ void MS_DLL_EXPORT msIO_setHeaderEnabled(int bFlag);
 void msIO_setHeader(const char *header, const char *value, ...)
     MS_PRINT_FUNC_FORMAT(2, 3);
 void msIO_sendHeaders(void);
+void MS_DLL_EXPORT msIO_setRequestEnvironment(char **envp);
+char MS_DLL_EXPORT *msIO_getenv(const char *name);
 
 /*
 ** These can be used instead of the stdio style functions if you have
@@ -118,6 +120,14 @@ hashTableObj MS_DLL_EXPORT *msIO_getAndStripStdoutBufferMimeHeaders(void);
 msIOContext *msIO_pushStdoutToBufferAndGetOldContext(void);
 void msIO_restoreOldStdoutContext(msIOContext *context_to_restore);
 
+/*
+** For compressing the response body (HTTP Content-Encoding).
+*/
+int MS_DLL_EXPORT msIO_pushStdoutCompression(const char *encodings,
+                                            const char *accept_encoding,
+                                            int level);
+void MS_DLL_EXPORT msIO_popStdoutCompression(void);
+
 int MS_DLL_EXPORT msIO_isStdContext(void);
 
 /* this is just for setting normal stdout's to binary mode on windows */
@@ -29,6 +29,7 @@
 
 #include "mapserver.h"
 #include "maptime.h"
+#include "mapmetrics.h"
 #include "mapogcfilter.h"
 #include "mapthread.h"
 #include "mapfile.h"
@@ -280,6 +281,12 @@ int msLayerOpen(layerObj *layer) {
       return rv;
   }
   cppcheck_assert(layer->vtable);
+  if (msTraceEnabled()) {
+    const double start = msMetricsTime();
+    rv = layer->vtable->LayerOpen(layer);
+    msTraceAdd("LayerOpen", layer->name, start);
+    return rv;
+  }
   return layer->vtable->LayerOpen(layer);
 }
 
@@ -384,6 +391,12 @@ int msLayerWhichShapes(layerObj *layer, rectObj rect, int isQuery) {
       return rv;
   }
   cppcheck_assert(layer->vtable);
+  if (msTraceEnabled()) {
+    const double start = msMetricsTime();
+    int rv = layer->vtable->LayerWhichShapes(layer, rect, isQuery);
+    msTraceAdd("LayerWhichShapes", layer->name, start);
+    return rv;
+  }
   return layer->vtable->LayerWhichShapes(layer, rect, isQuery);
 }
 
@@ -422,7 +435,12 @@ int msLayerNextShape(layerObj *layer, shapeObj *shape) {
 
   /* RFC 91: MapServer-based filtering is done at a more general level. */
   do {
-    rv = layer->vtable->LayerNextShape(layer, shape);
+    if (msTraceEnabled()) {
+      const double start = msMetricsTime();
+      rv = layer->vtable->LayerNextShape(layer, shape);
+      msTraceAccumulate("LayerNextShape", layer->name, start);
+    } else
+      rv = layer->vtable->LayerNextShape(layer, shape);
     if (rv != MS_SUCCESS)
       return rv;
 
@@ -489,7 +507,12 @@ int msLayerGetShape(layerObj *layer, shapeObj *shape, resultObj *record) {
   *name].
   */
 
-  rv = layer->vtable->LayerGetShape(layer, shape, record);
+  if (msTraceEnabled()) {
+    const double start = msMetricsTime();
+    rv = layer->vtable->LayerGetShape(layer, shape, record);
+    msTraceAccumulate("LayerGetShape", layer->name, start);
+  } else
+    rv = layer->vtable->LayerGetShape(layer, shape, record);
   if (rv != MS_SUCCESS)
     return rv;
 
@@ -561,6 +584,7 @@ void msLayerClose(layerObj *layer) {
 void msLayerFreeExpressions(layerObj *layer) {
   int i, j, k;
 
+  msLayerFreeClassDispatch(layer);
   msFreeExpressionTokens(&(layer->filter));
   msFreeExpressionTokens(&(layer->cluster.group));
   msFreeExpressionTokens(&(layer->cluster.filter));
@@ -723,6 +723,10 @@ imageObj *msDrawLegend(mapObj *map, int scale_independent,
   typedef struct legend_struct legendlabel;
   legendlabel *head = NULL;
 
+  /* unless embedded in a map whose labels still reference glyphs */
+  if (msLabelCacheIsEmpty(&(map->labelcache)))
+    msFontCacheQuiesce();
+
   if (!MS_RENDERER_PLUGIN(map->outputformat)) {
     msSetError(MS_MISCERR, "unsupported output format", "msDrawLegend()");
     return NULL;
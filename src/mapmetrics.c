@@ -0,0 +1,674 @@
+/******************************************************************************
+ * $Id$
+ *
+ * Project:  MapServer
+ * Purpose:  Request performance metrics, exported in Prometheus text format,
+ *           and Chrome trace-event output of the spans of a request.
+ * Author:   MapServer Project
+ *
+ ******************************************************************************
+ * Copyright (c) 2026, MapServer Project
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies of this Software or works derived from this Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ ****************************************************************************/
+
+#include <stdlib.h>
+#include <stdio.h>
+
+#include "mapserver.h"
+#include "mapmetrics.h"
+#include "mapthread.h"
+#include "maptime.h"
+
+#include "cpl_conv.h"
+#include "cpl_vsi.h"
+
+/* label values beyond this many per metric are folded into "other" */
+#define MS_METRICS_MAX_SERIES 256
+
+static const double msMetricsBuckets[] = {0.001, 0.0025, 0.005, 0.01, 0.025,
+                                          0.05,  0.1,    0.25,  0.5,  1,
+                                          2.5,   5,      10};
+#define MS_METRICS_NUM_BUCKETS                                                 \
+  ((int)(sizeof(msMetricsBuckets) / sizeof(msMetricsBuckets[0])))
+
+typedef struct {
+  const char *name;
+  const char *help;
+  const char *labelname; /* NULL for metrics without a label */
+  int histogram;
+} metricDefinition;
+
+static const metricDefinition msMetricDefinitions[MS_METRIC_COUNT] = {
+    {"mapserver_requests_total", "Requests processed.", "type", MS_FALSE},
+    {"mapserver_request_duration_seconds", "Request processing time.", "type",
+     MS_TRUE},
+    {"mapserver_response_bytes_total", "Bytes written to the client.", "type",
+     MS_FALSE},
+    {"mapserver_loadmap_duration_seconds", "Time spent in msLoadMap().", NULL,
+     MS_TRUE},
+    {"mapserver_layer_whichshapes_duration_seconds",
+     "Time spent in msLayerWhichShapes() when drawing a layer.", "layer",
+     MS_TRUE},
+    {"mapserver_layer_nextshape_duration_seconds",
+     "Time spent in msLayerNextShape() when drawing a layer.", "layer",
+     MS_TRUE},
+    {"mapserver_layer_draw_duration_seconds", "Time spent drawing a layer.",
+     "layer", MS_TRUE},
+    {"mapserver_layer_features_read_total", "Features read to draw a layer.",
+     "layer", MS_FALSE},
+    {"mapserver_layer_features_drawn_total", "Features drawn for a layer.",
+     "layer", MS_FALSE},
+    {"mapserver_labelcache_duration_seconds",
+     "Time spent in msDrawLabelCache().", NULL, MS_TRUE},
+    {"mapserver_encode_duration_seconds",
+     "Time spent encoding an image in msSaveImage().", "format", MS_TRUE},
+};
+
+typedef struct metricSeries {
+  char *label;
+  double value; /* counter value, or sum of the observations */
+  unsigned long count;
+  unsigned long buckets[MS_METRICS_NUM_BUCKETS];
+  struct metricSeries *next;
+} metricSeries;
+
+typedef struct {
+  int numseries;
+  metricSeries *first, *last;
+} metricFamily;
+
+static metricFamily msMetricFamilies[MS_METRIC_COUNT];
+static double msMetricsLastWrite = 0;
+
+/*
+** Metrics are collected when they are exported somewhere: MS_METRICS_FILE
+** names the per-process file rewritten at most every
+** MS_METRICS_FILE_INTERVAL seconds, MS_METRICS_PATH the PATH_INFO under which
+** mapserv serves the metrics of the process that handles the request.
+*/
+int msMetricsEnabled(void) {
+  const char *file = CPLGetConfigOption("MS_METRICS_FILE", NULL);
+  const char *path = CPLGetConfigOption("MS_METRICS_PATH", NULL);
+  return (file && *file) || (path && *path);
+}
+
+/* Returns the current time in seconds, for measuring durations. */
+double msMetricsTime(void) {
+  struct mstimeval t;
+  msGettimeofday(&t, NULL);
+  return t.tv_sec + t.tv_usec / 1.0e6;
+}
+
+static metricSeries *msMetricsGetSeries(metricFamily *family,
+                                        const char *label) {
+  metricSeries *series;
+
+  for (series = family->first; series; series = series->next) {
+    if (strcmp(series->label, label) == 0)
+      return series;
+  }
+  if (family->numseries >= MS_METRICS_MAX_SERIES &&
+      strcmp(label, "other") != 0)
+    return msMetricsGetSeries(family, "other");
+
+  series = (metricSeries *)msSmallCalloc(1, sizeof(metricSeries));
+  series->label = msStrdup(label);
+  if (family->last)
+    family->last->next = series;
+  else
+    family->first = series;
+  family->last = series;
+  family->numseries++;
+  return series;
+}
+
+/*
+** Increments a counter by value, or adds an observation of value seconds to
+** a histogram.
+*/
+void msMetricsAdd(MS_METRIC metric, const char *label, double value) {
+  const metricDefinition *def;
+  metricSeries *series;
+  int i;
+
+  if (metric < 0 || metric >= MS_METRIC_COUNT)
+    return;
+  def = &msMetricDefinitions[metric];
+  if (!def->labelname || !label)
+    label = "";
+
+  msAcquireLock(TLOCK_METRICS);
+  series = msMetricsGetSeries(&msMetricFamilies[metric], label);
+  series->value += value;
+  series->count++;
+  if (def->histogram) {
+    for (i = 0; i < MS_METRICS_NUM_BUCKETS; i++) {
+      if (value <= msMetricsBuckets[i])
+        series->buckets[i]++;
+    }
+  }
+  msReleaseLock(TLOCK_METRICS);
+}
+
+/*
+** Every sample carries a pid label: each process aggregates its own requests
+** only, see msMetricsWriteFile().
+*/
+static void msMetricsAppendLabels(msStringBuffer *sb,
+                                  const metricDefinition *def,
+                                  const metricSeries *series, const char *le) {
+  const char *c;
+  char buf[2] = {0, 0}, pid[32];
+
+  snprintf(pid, sizeof(pid), "{pid=\"%d\"", (int)getpid());
+  msStringBufferAppend(sb, pid);
+  if (def->labelname) {
+    msStringBufferAppend(sb, ",");
+    msStringBufferAppend(sb, def->labelname);
+    msStringBufferAppend(sb, "=\"");
+    for (c = series->label; *c; c++) {
+      if (*c == '\\')
+        msStringBufferAppend(sb, "\\\\");
+      else if (*c == '"')
+        msStringBufferAppend(sb, "\\\"");
+      else if (*c == '\n')
+        msStringBufferAppend(sb, "\\n");
+      else {
+        buf[0] = *c;
+        msStringBufferAppend(sb, buf);
+      }
+    }
+    msStringBufferAppend(sb, "\"");
+  }
+  if (le) {
+    msStringBufferAppend(sb, ",le=\"");
+    msStringBufferAppend(sb, le);
+    msStringBufferAppend(sb, "\"");
+  }
+  msStringBufferAppend(sb, "}");
+}
+
+static void msMetricsAppendSample(msStringBuffer *sb,
+                                  const metricDefinition *def,
+                                  const metricSeries *series,
+                                  const char *suffix, const char *le,
+                                  double value) {
+  char buf[64];
+
+  msStringBufferAppend(sb, def->name);
+  msStringBufferAppend(sb, suffix);
+  msMetricsAppendLabels(sb, def, series, le);
+  snprintf(buf, sizeof(buf), " %.17g\n", value);
+  msStringBufferAppend(sb, buf);
+}
+
+/*
+** Returns the collected metrics in the Prometheus text exposition format.
+** The caller must free the returned string.
+*/
+char *msMetricsToPrometheus(void) {
+  msStringBuffer *sb = msStringBufferAlloc();
+  int m, i;
+
+  msAcquireLock(TLOCK_METRICS);
+  for (m = 0; m < MS_METRIC_COUNT; m++) {
+    const metricDefinition *def = &msMetricDefinitions[m];
+    const metricSeries *series;
+
+    if (!msMetricFamilies[m].first)
+      continue;
+
+    msStringBufferAppend(sb, "# HELP ");
+    msStringBufferAppend(sb, def->name);
+    msStringBufferAppend(sb, " ");
+    msStringBufferAppend(sb, def->help);
+    msStringBufferAppend(sb, "\n# TYPE ");
+    msStringBufferAppend(sb, def->name);
+    msStringBufferAppend(sb, def->histogram ? " histogram\n" : " counter\n");
+
+    for (series = msMetricFamilies[m].first; series; series = series->next) {
+      if (!def->histogram) {
+        msMetricsAppendSample(sb, def, series, "", NULL, series->value);
+        continue;
+      }
+      for (i = 0; i < MS_METRICS_NUM_BUCKETS; i++) {
+        char le[32];
+        snprintf(le, sizeof(le), "%g", msMetricsBuckets[i]);
+        msMetricsAppendSample(sb, def, series, "_bucket", le,
+                              series->buckets[i]);
+      }
+      msMetricsAppendSample(sb, def, series, "_bucket", "+Inf", series->count);
+      msMetricsAppendSample(sb, def, series, "_sum", NULL, series->value);
+      msMetricsAppendSample(sb, def, series, "_count", NULL, series->count);
+    }
+  }
+  msReleaseLock(TLOCK_METRICS);
+
+  return msStringBufferReleaseStringAndFree(sb);
+}
+
+/*
+** Name of the metrics file of this process: %p in MS_METRICS_FILE is
+** replaced by the process id, and without %p the process id is inserted
+** before the file extension (metrics.prom becomes metrics.1234.prom).
+*/
+static char *msMetricsFileName(const char *pattern) {
+  char pid[32];
+  const char *ext;
+
+  snprintf(pid, sizeof(pid), "%d", (int)getpid());
+  if (strstr(pattern, "%p"))
+    return msReplaceSubstring(msStrdup(pattern), "%p", pid);
+
+  ext = strrchr(pattern, '.');
+  if (!ext || strchr(ext, '/') || strchr(ext, '\\'))
+    ext = pattern + strlen(pattern);
+  {
+    char *filename = msSmallMalloc(strlen(pattern) + strlen(pid) + 2);
+    memcpy(filename, pattern, ext - pattern);
+    sprintf(filename + (ext - pattern), ".%s%s", pid, ext);
+    return filename;
+  }
+}
+
+/*
+** Rewrites the metrics file of this process, see msMetricsFileName(), if
+** MS_METRICS_FILE is set and the file was last written more than
+** MS_METRICS_FILE_INTERVAL seconds (default 15) ago, or if force is set.
+** The file is replaced atomically so that a scraper never reads a partial
+** file.
+**
+** Each FastCGI process writes its own file with its own counters, and all
+** samples carry a pid label. The totals of a server are the sums over the
+** processes, e.g. sum without (pid) (rate(mapserver_requests_total[5m])).
+** Files of exited processes are not removed.
+*/
+int msMetricsWriteFile(int force) {
+  const char *pattern = CPLGetConfigOption("MS_METRICS_FILE", NULL);
+  double now = msMetricsTime(), interval;
+  char *text, *filename, *tmpfilename;
+  VSILFILE *fp;
+  size_t len;
+  int status = MS_SUCCESS;
+
+  if (!pattern || !*pattern)
+    return MS_SUCCESS;
+
+  interval = atof(CPLGetConfigOption("MS_METRICS_FILE_INTERVAL", "15"));
+  msAcquireLock(TLOCK_METRICS);
+  if (!force && now - msMetricsLastWrite < interval) {
+    msReleaseLock(TLOCK_METRICS);
+    return MS_SUCCESS;
+  }
+  msMetricsLastWrite = now;
+  msReleaseLock(TLOCK_METRICS);
+
+  text = msMetricsToPrometheus();
+  len = strlen(text);
+  filename = msMetricsFileName(pattern);
+  tmpfilename = msSmallMalloc(strlen(filename) + 8);
+  sprintf(tmpfilename, "%s.tmp", filename);
+
+  fp = VSIFOpenL(tmpfilename, "wb");
+  if (!fp) {
+    msSetError(MS_IOERR, "Failed to create metrics file (%s).",
+               "msMetricsWriteFile()", tmpfilename);
+    status = MS_FAILURE;
+  } else {
+    if (VSIFWriteL(text, 1, len, fp) != len)
+      status = MS_FAILURE;
+    if (VSIFCloseL(fp) != 0)
+      status = MS_FAILURE;
+    if (status == MS_SUCCESS && VSIRename(tmpfilename, filename) != 0)
+      status = MS_FAILURE;
+    if (status != MS_SUCCESS) {
+      VSIUnlink(tmpfilename);
+      msSetError(MS_IOERR, "Failed to write metrics file (%s).",
+                 "msMetricsWriteFile()", filename);
+    }
+  }
+
+  free(tmpfilename);
+  free(filename);
+  free(text);
+  return status;
+}
+
+/*
+** Tracing: when MS_TRACE_DIR is set, the spans of a request are recorded and
+** written to a Chrome trace-event JSON file in that directory, which can be
+** opened in chrome://tracing or ui.perfetto.dev. Only one request at a time
+** is traced, spans of all threads are recorded while it runs.
+**
+** Each thread records into its own buffer, without locking, and keeps its
+** own copy of the span arguments (layer names...) so that they are copied
+** once per thread rather than once per span. Per-feature calls are folded
+** by msTraceAccumulate() into one span per name and argument.
+*/
+typedef struct {
+  const char *name;
+  const char *arg; /* interned in the thread buffer, or NULL */
+  double start, dur;
+  unsigned long count; /* calls folded in the span, 0 for a single call */
+} traceEvent;
+
+typedef struct traceThreadBuffer {
+  void *threadid;
+  int tid;
+  int sequence; /* request the events belong to, see traceSequence */
+  traceEvent *events;
+  int numevents, maxevents, dropped;
+  traceEvent *aggregates; /* spans of msTraceAccumulate() */
+  int numaggregates, maxaggregates;
+  char **strings; /* interned arguments */
+  int numstrings;
+  struct traceThreadBuffer *next;
+} traceThreadBuffer;
+
+static volatile int traceActive = MS_FALSE;
+static double traceStartTime = 0;
+static traceThreadBuffer *volatile traceBuffers = NULL;
+static int traceNumThreads = 0;
+static volatile int traceSequence = 0;
+
+int msTraceEnabled(void) { return traceActive; }
+
+/*
+** Starts recording the spans of a request if MS_TRACE_DIR is set. Returns
+** MS_TRUE if the caller must call msTraceWrite() when the request is done.
+*/
+int msTraceStart(void) {
+  const char *dir = CPLGetConfigOption("MS_TRACE_DIR", NULL);
+  int started = MS_FALSE;
+
+  if (!dir || !*dir)
+    return MS_FALSE;
+
+  msAcquireLock(TLOCK_METRICS);
+  if (!traceActive) {
+    traceStartTime = msMetricsTime();
+    traceSequence++;
+    traceActive = started = MS_TRUE;
+  }
+  msReleaseLock(TLOCK_METRICS);
+  return started;
+}
+
+/*
+** Returns the buffer of the calling thread, emptied if it still holds the
+** spans of a previous request. Buffers are only added to the list, and
+** freed by msMetricsCleanup(), so the list is walked without locking.
+*/
+static traceThreadBuffer *msTraceGetBuffer(void) {
+  void *threadid = msGetThreadId();
+  traceThreadBuffer *buffer;
+
+  for (buffer = traceBuffers; buffer; buffer = buffer->next) {
+    if (buffer->threadid == threadid)
+      break;
+  }
+  if (!buffer) {
+    buffer = (traceThreadBuffer *)msSmallCalloc(1, sizeof(traceThreadBuffer));
+    buffer->threadid = threadid;
+    msAcquireLock(TLOCK_METRICS);
+    buffer->tid = ++traceNumThreads;
+    buffer->sequence = traceSequence;
+    buffer->next = traceBuffers;
+    traceBuffers = buffer;
+    msReleaseLock(TLOCK_METRICS);
+  }
+  if (buffer->sequence != traceSequence) {
+    buffer->sequence = traceSequence;
+    buffer->numevents = buffer->numaggregates = buffer->dropped = 0;
+  }
+  return buffer;
+}
+
+static const char *msTraceIntern(traceThreadBuffer *buffer, const char *arg) {
+  int i;
+
+  if (!arg)
+    return NULL;
+  for (i = 0; i < buffer->numstrings; i++) {
+    if (strcmp(buffer->strings[i], arg) == 0)
+      return buffer->strings[i];
+  }
+  buffer->strings = (char **)msSmallRealloc(
+      buffer->strings, sizeof(char *) * (buffer->numstrings + 1));
+  buffer->strings[buffer->numstrings] = msStrdup(arg);
+  return buffer->strings[buffer->numstrings++];
+}
+
+/*
+** Records a span named name (a string literal) from start, as returned by
+** msMetricsTime(), to now. arg, typically a layer name, may be NULL.
+** Spans beyond MS_TRACE_MAX_EVENTS (default 100000) per thread are dropped.
+*/
+void msTraceAdd(const char *name, const char *arg, double start) {
+  double end = msMetricsTime();
+  traceThreadBuffer *buffer;
+  traceEvent *event;
+
+  if (!traceActive)
+    return;
+
+  buffer = msTraceGetBuffer();
+  if (buffer->numevents == buffer->maxevents) {
+    int limit = atoi(CPLGetConfigOption("MS_TRACE_MAX_EVENTS", "100000"));
+    if (buffer->maxevents >= limit) {
+      buffer->dropped++;
+      return;
+    }
+    buffer->maxevents = MS_MIN(MS_MAX(buffer->maxevents * 2, 1024), limit);
+    buffer->events = (traceEvent *)msSmallRealloc(
+        buffer->events, sizeof(traceEvent) * buffer->maxevents);
+  }
+
+  event = &buffer->events[buffer->numevents++];
+  event->name = name;
+  event->arg = msTraceIntern(buffer, arg);
+  event->start = start;
+  event->dur = end - start;
+  event->count = 0;
+}
+
+/*
+** Same as msTraceAdd() for calls made once per feature: the calls with the
+** same name and arg are written as one span, starting with the first call,
+** whose duration is the time spent in all the calls and whose count
+** argument is the number of calls.
+*/
+void msTraceAccumulate(const char *name, const char *arg, double start) {
+  double end = msMetricsTime();
+  traceThreadBuffer *buffer;
+  traceEvent *event;
+  int i;
+
+  if (!traceActive)
+    return;
+
+  buffer = msTraceGetBuffer();
+  arg = msTraceIntern(buffer, arg);
+  for (i = 0; i < buffer->numaggregates; i++) {
+    event = &buffer->aggregates[i];
+    if (event->name == name && event->arg == arg) {
+      event->dur += end - start;
+      event->count++;
+      return;
+    }
+  }
+
+  if (buffer->numaggregates == buffer->maxaggregates) {
+    buffer->maxaggregates = MS_MAX(buffer->maxaggregates * 2, 16);
+    buffer->aggregates = (traceEvent *)msSmallRealloc(
+        buffer->aggregates, sizeof(traceEvent) * buffer->maxaggregates);
+  }
+  event = &buffer->aggregates[buffer->numaggregates++];
+  event->name = name;
+  event->arg = arg;
+  event->start = start;
+  event->dur = end - start;
+  event->count = 1;
+}
+
+static void msTraceAppendString(msStringBuffer *sb, const char *str) {
+  char buf[8];
+
+  msStringBufferAppend(sb, "\"");
+  for (; *str; str++) {
+    if (*str == '"' || *str == '\\') {
+      buf[0] = '\\';
+      buf[1] = *str;
+      buf[2] = '\0';
+    } else if ((unsigned char)*str < 0x20) {
+      snprintf(buf, sizeof(buf), "\\u%04x", (unsigned char)*str);
+    } else {
+      buf[0] = *str;
+      buf[1] = '\0';
+    }
+    msStringBufferAppend(sb, buf);
+  }
+  msStringBufferAppend(sb, "\"");
+}
+
+static void msTraceAppendEvent(msStringBuffer *sb, const traceEvent *event,
+                               int tid, int *first) {
+  char buf[256];
+
+  msStringBufferAppend(sb, *first ? "{\"name\":" : "},\n{\"name\":");
+  *first = MS_FALSE;
+  msTraceAppendString(sb, event->name);
+  snprintf(buf, sizeof(buf),
+           ",\"cat\":\"mapserver\",\"ph\":\"X\",\"ts\":%.1f,"
+           "\"dur\":%.1f,\"pid\":%d,\"tid\":%d",
+           (event->start - traceStartTime) * 1.0e6, event->dur * 1.0e6,
+           (int)getpid(), tid);
+  msStringBufferAppend(sb, buf);
+  if (event->arg || event->count) {
+    msStringBufferAppend(sb, ",\"args\":{");
+    if (event->arg) {
+      msStringBufferAppend(sb, "\"name\":");
+      msTraceAppendString(sb, event->arg);
+    }
+    if (event->count) {
+      snprintf(buf, sizeof(buf), "%s\"count\":%lu", event->arg ? "," : "",
+               event->count);
+      msStringBufferAppend(sb, buf);
+    }
+    msStringBufferAppend(sb, "}");
+  }
+}
+
+/*
+** Stops recording and writes the spans of the request to
+** MS_TRACE_DIR/mapserver-<pid>-<n>.json. The threads that worked for the
+** request must be done with it.
+*/
+int msTraceWrite(void) {
+  const char *dir = CPLGetConfigOption("MS_TRACE_DIR", NULL);
+  const traceThreadBuffer *buffer;
+  msStringBuffer *sb;
+  char *text, *filename;
+  VSILFILE *fp;
+  size_t len;
+  int i, first = MS_TRUE, dropped = 0, status = MS_SUCCESS;
+
+  msAcquireLock(TLOCK_METRICS);
+  if (!traceActive) {
+    msReleaseLock(TLOCK_METRICS);
+    return MS_SUCCESS;
+  }
+  traceActive = MS_FALSE;
+
+  sb = msStringBufferAlloc();
+  msStringBufferAppend(sb, "{\"traceEvents\":[\n");
+  for (buffer = traceBuffers; buffer; buffer = buffer->next) {
+    if (buffer->sequence != traceSequence)
+      continue;
+    for (i = 0; i < buffer->numevents; i++)
+      msTraceAppendEvent(sb, &buffer->events[i], buffer->tid, &first);
+    for (i = 0; i < buffer->numaggregates; i++)
+      msTraceAppendEvent(sb, &buffer->aggregates[i], buffer->tid, &first);
+    dropped += buffer->dropped;
+  }
+  msStringBufferAppend(sb, first ? "" : "}\n");
+  msStringBufferAppend(sb, "],\"displayTimeUnit\":\"ms\"");
+  if (dropped > 0) {
+    char buf[64];
+    snprintf(buf, sizeof(buf), ",\"droppedEvents\":%d", dropped);
+    msStringBufferAppend(sb, buf);
+  }
+  msStringBufferAppend(sb, "}\n");
+  filename = msSmallMalloc(strlen(dir ? dir : "") + 64);
+  sprintf(filename, "%s/mapserver-%d-%d.json", dir ? dir : ".", (int)getpid(),
+          traceSequence);
+  msReleaseLock(TLOCK_METRICS);
+
+  text = msStringBufferReleaseStringAndFree(sb);
+  len = strlen(text);
+  fp = VSIFOpenL(filename, "wb");
+  if (!fp || VSIFWriteL(text, 1, len, fp) != len)
+    status = MS_FAILURE;
+  if (fp && VSIFCloseL(fp) != 0)
+    status = MS_FAILURE;
+  if (status != MS_SUCCESS)
+    msSetError(MS_IOERR, "Failed to write trace file (%s).", "msTraceWrite()",
+               filename);
+
+  free(filename);
+  free(text);
+  return status;
+}
+
+/*
+** Frees the collected metrics. The metrics file is not written here: the
+** application calls msMetricsWriteFile() while it serves requests.
+*/
+void msMetricsCleanup(void) {
+  int m;
+
+  msAcquireLock(TLOCK_METRICS);
+  for (m = 0; m < MS_METRIC_COUNT; m++) {
+    metricSeries *series = msMetricFamilies[m].first;
+    while (series) {
+      metricSeries *next = series->next;
+      free(series->label);
+      free(series);
+      series = next;
+    }
+    msMetricFamilies[m].first = msMetricFamilies[m].last = NULL;
+    msMetricFamilies[m].numseries = 0;
+  }
+  msMetricsLastWrite = 0;
+  traceActive = MS_FALSE;
+  while (traceBuffers) {
+    traceThreadBuffer *buffer = traceBuffers;
+    int i;
+    traceBuffers = buffer->next;
+    for (i = 0; i < buffer->numstrings; i++)
+      free(buffer->strings[i]);
+    free(buffer->strings);
+    free(buffer->events);
+    free(buffer->aggregates);
+    free(buffer);
+  }
+  traceNumThreads = 0;
+  msReleaseLock(TLOCK_METRICS);
+}
@@ -0,0 +1,77 @@
+/******************************************************************************
+ * $Id$
+ *
+ * Project:  MapServer
+ * Purpose:  Request performance metrics and tracing declarations.
+ * Author:   MapServer Project
+ *
+ ******************************************************************************
+ * Copyright (c) 2026, MapServer Project
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies of this Software or works derived from this Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ ****************************************************************************/
+
+#ifndef MAPMETRICS_H
+#define MAPMETRICS_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+** Counters and latency histograms aggregated in-process (so across the
+** requests served by a FastCGI process) and exported in the Prometheus text
+** exposition format. Collection is enabled by setting MS_METRICS_FILE or
+** MS_METRICS_PATH, see msMetricsEnabled().
+*/
+typedef enum {
+  MS_METRIC_REQUESTS = 0,         /* counter, by request type */
+  MS_METRIC_REQUEST_DURATION,     /* histogram, by request type */
+  MS_METRIC_RESPONSE_BYTES,       /* counter, by request type */
+  MS_METRIC_LOADMAP_DURATION,     /* histogram */
+  MS_METRIC_LAYER_WHICHSHAPES,    /* histogram, by layer */
+  MS_METRIC_LAYER_NEXTSHAPE,      /* histogram, by layer */
+  MS_METRIC_LAYER_DRAW,           /* histogram, by layer */
+  MS_METRIC_LAYER_FEATURES_READ,  /* counter, by layer */
+  MS_METRIC_LAYER_FEATURES_DRAWN, /* counter, by layer */
+  MS_METRIC_LABELCACHE_DURATION,  /* histogram */
+  MS_METRIC_ENCODE_DURATION,      /* histogram, by output format */
+  MS_METRIC_COUNT
+} MS_METRIC;
+
+MS_DLL_EXPORT int msMetricsEnabled(void);
+MS_DLL_EXPORT double msMetricsTime(void);
+MS_DLL_EXPORT void msMetricsAdd(MS_METRIC metric, const char *label,
+                                double value);
+MS_DLL_EXPORT char *msMetricsToPrometheus(void);
+MS_DLL_EXPORT int msMetricsWriteFile(int force);
+MS_DLL_EXPORT void msMetricsCleanup(void);
+
+MS_DLL_EXPORT int msTraceEnabled(void);
+MS_DLL_EXPORT int msTraceStart(void);
+MS_DLL_EXPORT void msTraceAdd(const char *name, const char *arg, double start);
+MS_DLL_EXPORT void msTraceAccumulate(const char *name, const char *arg,
+                                     double start);
+MS_DLL_EXPORT int msTraceWrite(void);
+
+#ifdef __cplusplus
+} /* extern C */
+#endif
+
+#endif /* MAPMETRICS_H */
@@ -31,7 +31,6 @@
 #include "maptile.h"
 
 #ifdef USE_PBF
-#include "vector_tile.pb-c.h"
 #include "mapows.h"
 #include "uthash.h"
 #include <float.h>
@@ -40,8 +39,6 @@
 #define LINETO 2
 #define CLOSEPATH 7
 
-#define FEATURES_INCREMENT_SIZE 5
-
 enum MS_RING_DIRECTION {
   MS_DIRECTION_INVALID_RING,
   MS_DIRECTION_CLOCKWISE,
@@ -210,57 +207,229 @@ static int mvtClipShape(shapeObj *shape, int layer_type, int buffer,
     return MS_FAILURE;
 }
 
-static void freeMvtFeature(VectorTile__Tile__Feature *mvt_feature) {
-  if (mvt_feature->tags)
-    msFree(mvt_feature->tags);
-  if (mvt_feature->geometry)
-    msFree(mvt_feature->geometry);
+/* ==================================================================== */
+/*      Protocol buffer encoding.                                       */
+/*                                                                      */
+/*      Tiles are written directly in the vector tile protobuf wire     */
+/*      format, fields in the same order as protobuf-c would pack them. */
+/* ==================================================================== */
+
+/* field numbers, see vector_tile.proto */
+#define MVT_TILE_LAYERS 3
+#define MVT_LAYER_NAME 1
+#define MVT_LAYER_FEATURES 2
+#define MVT_LAYER_KEYS 3
+#define MVT_LAYER_VALUES 4
+#define MVT_LAYER_EXTENT 5
+#define MVT_LAYER_VERSION 15
+#define MVT_FEATURE_ID 1
+#define MVT_FEATURE_TAGS 2
+#define MVT_FEATURE_TYPE 3
+#define MVT_FEATURE_GEOMETRY 4
+#define MVT_VALUE_STRING 1
+#define MVT_VALUE_FLOAT 2
+#define MVT_VALUE_INT 4
+#define MVT_VALUE_SINT 6
+#define MVT_VALUE_BOOL 7
+
+/* wire types */
+#define MVT_WIRE_VARINT 0
+#define MVT_WIRE_FIXED32 5
+#define MVT_WIRE_LENGTH 2
+
+/* geometry types */
+#define MVT_GEOM_POINT 1
+#define MVT_GEOM_LINESTRING 2
+#define MVT_GEOM_POLYGON 3
+
+typedef struct {
+  bufferObj features; /* encoded features */
+  bufferObj values;   /* encoded values */
+  value_lookup_table value_lookup_cache;
+  unsigned int n_values;
+  uint32_t *geometry; /* scratch space for geometry commands */
+  long int geometry_size;
+  uint32_t *tags; /* scratch space for tags */
+  int tags_size;
+} mvt_layer_writer;
+
+static void mvtWriteVarint(bufferObj *buf, uint64_t value) {
+  if (buf->available < buf->size + 10)
+    msBufferResize(buf, buf->size + 10);
+  while (value >= 0x80) {
+    buf->data[buf->size++] = (unsigned char)(value | 0x80);
+    value >>= 7;
+  }
+  buf->data[buf->size++] = (unsigned char)value;
+}
+
+static size_t mvtVarintSize(uint64_t value) {
+  size_t size = 1;
+  while (value >= 0x80) {
+    value >>= 7;
+    size++;
+  }
+  return size;
+}
+
+static void mvtWriteKey(bufferObj *buf, int field, int wire_type) {
+  mvtWriteVarint(buf, ((uint32_t)field << 3) | wire_type);
+}
+
+static void mvtWriteBytes(bufferObj *buf, int field, const void *data,
+                          size_t length) {
+  mvtWriteKey(buf, field, MVT_WIRE_LENGTH);
+  mvtWriteVarint(buf, length);
+  msBufferAppend(buf, (void *)data, length);
 }
 
-static void freeMvtValue(VectorTile__Tile__Value *mvt_value) {
-  if (mvt_value->string_value)
-    msFree(mvt_value->string_value);
+static void mvtWritePackedUInt32(bufferObj *buf, int field,
+                                 const uint32_t *values, long int count) {
+  size_t length = 0;
+  long int i;
+
+  if (count == 0)
+    return;
+  for (i = 0; i < count; i++)
+    length += mvtVarintSize(values[i]);
+  mvtWriteKey(buf, field, MVT_WIRE_LENGTH);
+  mvtWriteVarint(buf, length);
+  for (i = 0; i < count; i++)
+    mvtWriteVarint(buf, values[i]);
 }
 
-static void freeMvtLayer(VectorTile__Tile__Layer *mvt_layer) {
-  if (mvt_layer->keys) {
-    for (unsigned i = 0; i < mvt_layer->n_keys; i++) {
-      msFree(mvt_layer->keys[i]);
+/*
+** Encode a value message and append it to the layer value table.
+*/
+static void mvtWriteValue(mvt_layer_writer *writer, gmlItemObj *item,
+                          const char *value) {
+  unsigned char msg[16];
+  size_t length = 0;
+  bufferObj *buf = &writer->values;
+
+  if (item->type && (EQUAL(item->type, "Integer") ||
+                     EQUAL(item->type, "Long") ||
+                     EQUAL(item->type, "Boolean"))) {
+    uint64_t v;
+    int field;
+    if (EQUAL(item->type, "Integer")) {
+      field = MVT_VALUE_INT;
+      v = (uint64_t)(int64_t)atoi(value);
+    } else if (EQUAL(item->type, "Long")) { /* signed */
+      int64_t n = atol(value);
+      field = MVT_VALUE_SINT;
+      v = ((uint64_t)n << 1) ^ (uint64_t)(n >> 63);
+    } else {
+      field = MVT_VALUE_BOOL;
+      v = (EQUAL(value, "0") || EQUAL(value, "false")) ? 0 : 1;
     }
-    msFree(mvt_layer->keys);
-  }
-  if (mvt_layer->values) {
-    for (unsigned i = 0; i < mvt_layer->n_values; i++) {
-      freeMvtValue(mvt_layer->values[i]);
-      msFree(mvt_layer->values[i]);
+    msg[length++] = (field << 3) | MVT_WIRE_VARINT;
+    while (v >= 0x80) {
+      msg[length++] = (unsigned char)(v | 0x80);
+      v >>= 7;
     }
-    msFree(mvt_layer->values);
+    msg[length++] = (unsigned char)v;
+    mvtWriteBytes(buf, MVT_LAYER_VALUES, msg, length);
+  } else if (item->type && EQUAL(item->type, "Real")) {
+    float f = (float)atof(value);
+    uint32_t bits;
+    memcpy(&bits, &f, sizeof(bits));
+    msg[length++] = (MVT_VALUE_FLOAT << 3) | MVT_WIRE_FIXED32;
+    msg[length++] = (unsigned char)bits;
+    msg[length++] = (unsigned char)(bits >> 8);
+    msg[length++] = (unsigned char)(bits >> 16);
+    msg[length++] = (unsigned char)(bits >> 24);
+    mvtWriteBytes(buf, MVT_LAYER_VALUES, msg, length);
+  } else {
+    size_t value_length = strlen(value);
+    mvtWriteKey(buf, MVT_LAYER_VALUES, MVT_WIRE_LENGTH);
+    mvtWriteVarint(buf, 1 + mvtVarintSize(value_length) + value_length);
+    mvtWriteBytes(buf, MVT_VALUE_STRING, value, value_length);
   }
-  if (mvt_layer->features) {
-    for (unsigned i = 0; i < mvt_layer->n_features; i++) {
-      freeMvtFeature(mvt_layer->features[i]);
-      msFree(mvt_layer->features[i]);
-    }
-    msFree(mvt_layer->features);
+}
+
+/*
+** Return the index of a value in the layer value table, adding it if needed.
+** Values are looked up by item type and string so that a same string read
+** from items of different types gets its own typed entry.
+*/
+static unsigned int mvtGetValueIndex(mvt_layer_writer *writer,
+                                     gmlItemObj *item, const char *value) {
+  value_lookup *lookup;
+  char *key;
+  size_t type_length = item->type ? strlen(item->type) : 0;
+  size_t value_length = strlen(value);
+
+  key = msSmallMalloc(type_length + value_length + 2);
+  if (type_length)
+    memcpy(key, item->type, type_length);
+  key[type_length] = '|';
+  memcpy(key + type_length + 1, value, value_length + 1);
+
+  UT_HASH_FIND_STR(writer->value_lookup_cache.cache, key, lookup);
+  if (lookup) {
+    msFree(key);
+    return lookup->index;
   }
+
+  lookup = msSmallMalloc(sizeof(value_lookup));
+  lookup->value = key;
+  lookup->index = writer->n_values++;
+  UT_HASH_ADD_KEYPTR(hh, writer->value_lookup_cache.cache, lookup->value,
+                     strlen(lookup->value), lookup);
+  mvtWriteValue(writer, item, value);
+
+  return lookup->index;
+}
+
+static void mvtInitLayerWriter(mvt_layer_writer *writer) {
+  memset(writer, 0, sizeof(*writer));
+  msBufferInit(&writer->features);
+  msBufferInit(&writer->values);
+}
+
+/*
+** Reset a layer writer for the next layer, keeping its allocations.
+*/
+static void mvtResetLayerWriter(mvt_layer_writer *writer) {
+  value_lookup *cur_value_lookup, *tmp_value_lookup;
+
+  UT_HASH_ITER(hh, writer->value_lookup_cache.cache, cur_value_lookup,
+               tmp_value_lookup) {
+    msFree(cur_value_lookup->value);
+    UT_HASH_DEL(writer->value_lookup_cache.cache, cur_value_lookup);
+    msFree(cur_value_lookup);
+  }
+  writer->features.size = 0;
+  writer->values.size = 0;
+  writer->n_values = 0;
+}
+
+static void mvtFreeLayerWriter(mvt_layer_writer *writer) {
+  mvtResetLayerWriter(writer);
+  msBufferFree(&writer->features);
+  msBufferFree(&writer->values);
+  msFree(writer->geometry);
+  msFree(writer->tags);
 }
 
-int mvtWriteShape(layerObj *layer, shapeObj *shape,
-                  VectorTile__Tile__Layer *mvt_layer, gmlItemListObj *item_list,
-                  value_lookup_table *value_lookup_cache,
-                  rectObj *unbuffered_bbox, int buffer) {
-  VectorTile__Tile__Feature *mvt_feature;
-  int i, j, iout;
-  value_lookup *value;
+static int mvtWriteShape(layerObj *layer, shapeObj *shape,
+                         mvt_layer_writer *writer, gmlItemListObj *item_list,
+                         rectObj *unbuffered_bbox, int buffer,
+                         int mvt_layer_extent) {
+  int i, j, iout, idx;
   long int n_geometry;
+  uint32_t *geometry;
+  size_t length;
+  int geom_type;
 
   /* could consider an intersection test here */
 
   if (mvtTransformShape(shape, unbuffered_bbox, layer->type,
-                        mvt_layer->extent) != MS_SUCCESS) {
+                        mvt_layer_extent) != MS_SUCCESS) {
     return MS_SUCCESS; /* degenerate shape */
   }
-  if (mvtClipShape(shape, layer->type, buffer, mvt_layer->extent) !=
+  if (mvtClipShape(shape, layer->type, buffer, mvt_layer_extent) !=
       MS_SUCCESS) {
     return MS_SUCCESS; /* no features left after clipping */
   }
@@ -287,85 +456,49 @@ int mvtWriteShape(layerObj *layer, shapeObj *shape,
   if (n_geometry == 0)
     return MS_SUCCESS;
 
-  mvt_layer->features[mvt_layer->n_features++] =
-      msSmallMalloc(sizeof(VectorTile__Tile__Feature));
-  mvt_feature = mvt_layer->features[mvt_layer->n_features - 1];
-  vector_tile__tile__feature__init(mvt_feature);
-  mvt_feature->n_tags = mvt_layer->n_keys * 2;
-  mvt_feature->tags = msSmallMalloc(mvt_feature->n_tags * sizeof(uint32_t));
-  mvt_feature->id = shape->index;
-  mvt_feature->has_id = 1;
-
   if (layer->type == MS_LAYER_POLYGON)
-    mvt_feature->type = VECTOR_TILE__TILE__GEOM_TYPE__POLYGON;
+    geom_type = MVT_GEOM_POLYGON;
   else if (layer->type == MS_LAYER_LINE)
-    mvt_feature->type = VECTOR_TILE__TILE__GEOM_TYPE__LINESTRING;
+    geom_type = MVT_GEOM_LINESTRING;
   else
-    mvt_feature->type = VECTOR_TILE__TILE__GEOM_TYPE__POINT;
-  mvt_feature->has_type = 1;
+    geom_type = MVT_GEOM_POINT;
 
   /* output values */
+  if (writer->tags_size < item_list->numitems * 2) {
+    writer->tags_size = item_list->numitems * 2;
+    writer->tags = msSmallRealloc(writer->tags,
+                                  writer->tags_size * sizeof(uint32_t));
+  }
   for (i = 0, iout = 0; i < item_list->numitems; i++) {
     gmlItemObj *item = item_list->items + i;
 
     if (!item->visible)
       continue;
 
-    UT_HASH_FIND_STR(value_lookup_cache->cache, shape->values[i], value);
-    if (!value) {
-      VectorTile__Tile__Value *mvt_value;
-      value = msSmallMalloc(sizeof(value_lookup));
-      value->value = msStrdup(shape->values[i]);
-      value->index = mvt_layer->n_values;
-      mvt_layer->values = msSmallRealloc(mvt_layer->values,
-                                         (++mvt_layer->n_values) *
-                                             sizeof(VectorTile__Tile__Value *));
-      mvt_layer->values[mvt_layer->n_values - 1] =
-          msSmallMalloc(sizeof(VectorTile__Tile__Value));
-      mvt_value = mvt_layer->values[mvt_layer->n_values - 1];
-      vector_tile__tile__value__init(mvt_value);
-
-      if (item->type && EQUAL(item->type, "Integer")) {
-        mvt_value->int_value = atoi(value->value);
-        mvt_value->has_int_value = 1;
-      } else if (item->type && EQUAL(item->type, "Long")) { /* signed */
-        mvt_value->sint_value = atol(value->value);
-        mvt_value->has_sint_value = 1;
-      } else if (item->type && EQUAL(item->type, "Real")) {
-        mvt_value->float_value = atof(value->value);
-        mvt_value->has_float_value = 1;
-      } else if (item->type && EQUAL(item->type, "Boolean")) {
-        if (EQUAL(value->value, "0") || EQUAL(value->value, "false"))
-          mvt_value->bool_value = 0;
-        else
-          mvt_value->bool_value = 1;
-        mvt_value->has_bool_value = 1;
-      } else {
-        mvt_value->string_value = msStrdup(value->value);
-      }
-      UT_HASH_ADD_KEYPTR(hh, value_lookup_cache->cache, value->value,
-                         strlen(value->value), value);
-    }
-    mvt_feature->tags[iout * 2] = iout;
-    mvt_feature->tags[iout * 2 + 1] = value->index;
+    writer->tags[iout * 2] = iout;
+    writer->tags[iout * 2 + 1] =
+        mvtGetValueIndex(writer, item, shape->values[i]);
 
     iout++;
   }
 
   /* output geom */
-  mvt_feature->n_geometry = n_geometry;
-  mvt_feature->geometry =
-      msSmallMalloc(mvt_feature->n_geometry * sizeof(uint32_t));
+  if (writer->geometry_size < n_geometry) {
+    writer->geometry_size = n_geometry;
+    writer->geometry = msSmallRealloc(writer->geometry,
+                                      writer->geometry_size * sizeof(uint32_t));
+  }
+  geometry = writer->geometry;
+  idx = 0;
 
   if (layer->type == MS_LAYER_POINT) {
-    int idx = 0, lastx = 0, lasty = 0;
-    mvt_feature->geometry[idx++] =
-        COMMAND(MOVETO, (mvt_feature->n_geometry - 1) / 2);
+    int lastx = 0, lasty = 0;
+    geometry[idx++] = COMMAND(MOVETO, (n_geometry - 1) / 2);
     for (i = 0; i < shape->numlines; i++) {
       for (j = 0; j < shape->line[i].numpoints; j++) {
-        mvt_feature->geometry[idx++] =
+        geometry[idx++] =
             PARAMETER(MS_NINT(shape->line[i].point[j].x) - lastx);
-        mvt_feature->geometry[idx++] =
+        geometry[idx++] =
             PARAMETER(MS_NINT(shape->line[i].point[j].y) - lasty);
         lastx = MS_NINT(shape->line[i].point[j].x);
         lasty = MS_NINT(shape->line[i].point[j].y);
@@ -373,7 +506,7 @@ int mvtWriteShape(layerObj *layer, shapeObj *shape,
     }
   } else { /* MS_LAYER_LINE or MS_LAYER_POLYGON */
     int numpoints;
-    int idx = 0, lastx = 0, lasty = 0;
+    int lastx = 0, lasty = 0;
     for (i = 0; i < shape->numlines; i++) {
 
       if ((layer->type == MS_LAYER_LINE && !(shape->line[i].numpoints >= 2)) ||
@@ -388,46 +521,117 @@ int mvtWriteShape(layerObj *layer, shapeObj *shape,
                          1); /* don't consider last point for polygons */
       for (j = 0; j < numpoints; j++) {
         if (j == 0) {
-          mvt_feature->geometry[idx++] = COMMAND(MOVETO, 1);
+          geometry[idx++] = COMMAND(MOVETO, 1);
         } else if (j == 1) {
-          mvt_feature->geometry[idx++] = COMMAND(LINETO, numpoints - 1);
+          geometry[idx++] = COMMAND(LINETO, numpoints - 1);
         }
-        mvt_feature->geometry[idx++] =
+        geometry[idx++] =
             PARAMETER(MS_NINT(shape->line[i].point[j].x) - lastx);
-        mvt_feature->geometry[idx++] =
+        geometry[idx++] =
             PARAMETER(MS_NINT(shape->line[i].point[j].y) - lasty);
         lastx = MS_NINT(shape->line[i].point[j].x);
         lasty = MS_NINT(shape->line[i].point[j].y);
       }
       if (layer->type == MS_LAYER_POLYGON) {
-        mvt_feature->geometry[idx++] = COMMAND(CLOSEPATH, 1);
+        geometry[idx++] = COMMAND(CLOSEPATH, 1);
       }
     }
   }
 
+  /* feature message: id, tags, type, geometry */
+  length = 1 + mvtVarintSize((uint64_t)shape->index) + 1 + 1;
+  if (iout > 0) {
+    size_t tags_length = 0;
+    for (i = 0; i < iout * 2; i++)
+      tags_length += mvtVarintSize(writer->tags[i]);
+    length += 1 + mvtVarintSize(tags_length) + tags_length;
+  }
+  {
+    size_t geometry_length = 0;
+    for (i = 0; i < n_geometry; i++)
+      geometry_length += mvtVarintSize(geometry[i]);
+    length += 1 + mvtVarintSize(geometry_length) + geometry_length;
+  }
+
+  mvtWriteKey(&writer->features, MVT_LAYER_FEATURES, MVT_WIRE_LENGTH);
+  mvtWriteVarint(&writer->features, length);
+  mvtWriteKey(&writer->features, MVT_FEATURE_ID, MVT_WIRE_VARINT);
+  mvtWriteVarint(&writer->features, (uint64_t)shape->index);
+  mvtWritePackedUInt32(&writer->features, MVT_FEATURE_TAGS, writer->tags,
+                       iout * 2);
+  mvtWriteKey(&writer->features, MVT_FEATURE_TYPE, MVT_WIRE_VARINT);
+  mvtWriteVarint(&writer->features, geom_type);
+  mvtWritePackedUInt32(&writer->features, MVT_FEATURE_GEOMETRY, geometry,
+                       n_geometry);
+
   return MS_SUCCESS;
 }
 
-static void freeMvtTile(VectorTile__Tile *mvt_tile) {
-  for (unsigned iLayer = 0; iLayer < mvt_tile->n_layers; iLayer++) {
-    freeMvtLayer(mvt_tile->layers[iLayer]);
-    msFree(mvt_tile->layers[iLayer]);
+/*
+** Append a complete layer message to the tile.
+*/
+static void mvtWriteLayer(bufferObj *tile, layerObj *layer,
+                          mvt_layer_writer *writer, gmlItemListObj *item_list,
+                          int mvt_layer_extent) {
+  size_t length, name_length = strlen(layer->name);
+  int i;
+
+  length = 1 + mvtVarintSize(name_length) + name_length;
+  length += writer->features.size + writer->values.size;
+  for (i = 0; i < item_list->numitems; i++) {
+    gmlItemObj *item = item_list->items + i;
+    size_t key_length;
+    if (!item->visible)
+      continue;
+    key_length = strlen(item->alias ? item->alias : item->name);
+    length += 1 + mvtVarintSize(key_length) + key_length;
+  }
+  length += 1 + mvtVarintSize(mvt_layer_extent);
+  length += 1 + 1; /* version */
+
+  mvtWriteKey(tile, MVT_TILE_LAYERS, MVT_WIRE_LENGTH);
+  mvtWriteVarint(tile, length);
+  mvtWriteBytes(tile, MVT_LAYER_NAME, layer->name, name_length);
+  msBufferAppend(tile, writer->features.data, writer->features.size);
+  for (i = 0; i < item_list->numitems; i++) {
+    gmlItemObj *item = item_list->items + i;
+    const char *key;
+    if (!item->visible)
+      continue;
+    key = item->alias ? item->alias : item->name;
+    mvtWriteBytes(tile, MVT_LAYER_KEYS, key, strlen(key));
   }
-  msFree(mvt_tile->layers);
+  msBufferAppend(tile, writer->values.data, writer->values.size);
+  mvtWriteKey(tile, MVT_LAYER_EXTENT, MVT_WIRE_VARINT);
+  mvtWriteVarint(tile, mvt_layer_extent);
+  mvtWriteKey(tile, MVT_LAYER_VERSION, MVT_WIRE_VARINT);
+  mvtWriteVarint(tile, 2);
 }
 
 int msMVTWriteTile(mapObj *map, int sendheaders) {
+  return msMVTWriteTileEx(map, sendheaders, NULL);
+}
+
+/*
+** As msMVTWriteTile(), also returning in *numfeatures (if not NULL) the
+** number of features written: layers overlapping the tile are written even
+** when none of their features fall in it.
+*/
+int msMVTWriteTileEx(mapObj *map, int sendheaders, int *numfeatures) {
   int iLayer, retcode = MS_SUCCESS;
-  unsigned len;
-  void *buf;
   const char *mvt_extent =
       msGetOutputFormatOption(map->outputformat, "EXTENT", "4096");
   const char *mvt_buffer =
       msGetOutputFormatOption(map->outputformat, "EDGE_BUFFER", "10");
   int buffer = MS_ABS(atoi(mvt_buffer));
-  VectorTile__Tile mvt_tile = VECTOR_TILE__TILE__INIT;
-  mvt_tile.layers =
-      msSmallCalloc(map->numlayers, sizeof(VectorTile__Tile__Layer *));
+  int extent = MS_ABS(atoi(mvt_extent));
+  bufferObj tile;
+  mvt_layer_writer writer;
+
+  msBufferInit(&tile);
+  mvtInitLayerWriter(&writer);
+  if (numfeatures)
+    *numfeatures = 0;
 
   /* make sure we have a scale and cellsize computed */
   map->cellsize = MS_CELLSIZE(map->extent.minx, map->extent.maxx, map->width);
@@ -447,16 +651,12 @@ int msMVTWriteTile(mapObj *map, int sendheaders) {
     int i;
     shapeObj shape;
     gmlItemListObj *item_list = NULL;
-    VectorTile__Tile__Layer *mvt_layer;
-    value_lookup_table value_lookup_cache = {NULL};
-    value_lookup *cur_value_lookup, *tmp_value_lookup;
     rectObj rect;
+    int layer_started = MS_FALSE;
 
     int nclasses = 0;
     int *classgroup = NULL;
 
-    unsigned features_size = 0;
-
     if (!msLayerIsVisible(map, layer))
       continue;
 
@@ -497,35 +697,12 @@ int msMVTWriteTile(mapObj *map, int sendheaders) {
       goto layer_cleanup;
     }
 
-    mvt_tile.layers[mvt_tile.n_layers++] =
-        msSmallMalloc(sizeof(VectorTile__Tile__Layer));
-    mvt_layer = mvt_tile.layers[mvt_tile.n_layers - 1];
-    vector_tile__tile__layer__init(mvt_layer);
-    mvt_layer->version = 2;
-    mvt_layer->name = layer->name;
-
-    mvt_layer->extent = MS_ABS(atoi(mvt_extent));
-    mvt_layer->has_extent = 1;
-
     /* -------------------------------------------------------------------- */
     /*      Create appropriate attributes on this layer.                    */
     /* -------------------------------------------------------------------- */
     item_list = msGMLGetItems(layer, "G");
     assert(item_list->numitems == layer->numitems);
-
-    mvt_layer->keys = msSmallMalloc(layer->numitems * sizeof(char *));
-
-    for (i = 0; i < layer->numitems; i++) {
-      gmlItemObj *item = item_list->items + i;
-
-      if (!item->visible)
-        continue;
-
-      if (item->alias)
-        mvt_layer->keys[mvt_layer->n_keys++] = msStrdup(item->alias);
-      else
-        mvt_layer->keys[mvt_layer->n_keys++] = msStrdup(item->name);
-    }
+    layer_started = MS_TRUE;
 
     /* -------------------------------------------------------------------- */
     /*      Setup joins if needed.  This is likely untested.                */
@@ -547,10 +724,6 @@ int msMVTWriteTile(mapObj *map, int sendheaders) {
     if (layer->classgroup && layer->numclasses > 0)
       classgroup = msAllocateValidClassGroups(layer, &nclasses);
 
-    mvt_layer->features = msSmallCalloc(FEATURES_INCREMENT_SIZE,
-                                        sizeof(VectorTile__Tile__Feature *));
-    features_size = FEATURES_INCREMENT_SIZE;
-
     msInitShape(&shape);
     i = 0;
     for (;;) {
@@ -593,14 +766,6 @@ int msMVTWriteTile(mapObj *map, int sendheaders) {
         }
       }
 
-      if (mvt_layer->n_features ==
-          features_size) { /* need to allocate more space */
-        features_size += FEATURES_INCREMENT_SIZE;
-        mvt_layer->features = msSmallRealloc(
-            mvt_layer->features,
-            sizeof(VectorTile__Tile__Feature *) * (features_size));
-      }
-
       if (layer->project) {
         if (layer->reprojectorLayerToMap == NULL) {
           layer->reprojectorLayerToMap =
@@ -612,8 +777,11 @@ int msMVTWriteTile(mapObj *map, int sendheaders) {
           status = MS_FAILURE;
       }
       if (status == MS_SUCCESS) {
-        status = mvtWriteShape(layer, &shape, mvt_layer, item_list,
-                               &value_lookup_cache, &map->extent, buffer);
+        const size_t written = writer.features.size;
+        status = mvtWriteShape(layer, &shape, &writer, item_list,
+                               &map->extent, buffer, extent);
+        if (numfeatures && writer.features.size > written)
+          (*numfeatures)++;
       }
 
     feature_cleanup:
@@ -622,36 +790,29 @@ int msMVTWriteTile(mapObj *map, int sendheaders) {
         goto layer_cleanup;
     } /* next shape */
   layer_cleanup:
+    if (retcode == MS_SUCCESS && layer_started)
+      mvtWriteLayer(&tile, layer, &writer, item_list, extent);
+    mvtResetLayerWriter(&writer);
     if (classgroup)
       msFree(classgroup);
     msLayerClose(layer);
     msGMLFreeItems(item_list);
-    UT_HASH_ITER(hh, value_lookup_cache.cache, cur_value_lookup,
-                 tmp_value_lookup) {
-      msFree(cur_value_lookup->value);
-      UT_HASH_DEL(value_lookup_cache.cache, cur_value_lookup);
-      msFree(cur_value_lookup);
-    }
     if (retcode != MS_SUCCESS)
       goto cleanup;
   } /* next layer */
 
-  len = vector_tile__tile__get_packed_size(
-      &mvt_tile); // This is the calculated packing length
-
-  buf = msSmallMalloc(len); // Allocate memory
-  vector_tile__tile__pack(&mvt_tile, buf);
   if (sendheaders) {
     msIO_fprintf(stdout,
                  "Content-Length: %d\r\n"
                  "Content-Type: %s\r\n\r\n",
-                 len, MS_IMAGE_MIME_TYPE(map->outputformat));
+                 (int)tile.size, MS_IMAGE_MIME_TYPE(map->outputformat));
   }
-  msIO_fwrite(buf, len, 1, stdout);
-  msFree(buf);
+  if (tile.size > 0)
+    msIO_fwrite(tile.data, tile.size, 1, stdout);
 
 cleanup:
-  freeMvtTile(&mvt_tile);
+  mvtFreeLayerWriter(&writer);
+  msBufferFree(&tile);
 
   return retcode;
 }
@@ -676,4 +837,9 @@ int msMVTWriteTile(mapObj *map, int sendheaders) {
              "msMVTWriteTile()");
   return MS_FAILURE;
 }
+
+int msMVTWriteTileEx(mapObj *map, int sendheaders, int *numfeatures) {
+  (void)numfeatures;
+  return msMVTWriteTile(map, sendheaders);
+}
 #endif
@@ -149,6 +149,24 @@ void msFreeMap(mapObj *map) {
   msFree(map);
 }
 
+/* set when requests are processed concurrently, see below */
+static int ms_config_options_per_thread = MS_FALSE;
+
+/************************************************************************/
+/*                   msSetMapConfigOptionsPerThread()                   */
+/*                                                                      */
+/*      Called by servers before they start processing requests in      */
+/*      several threads: the CONFIG options of a map are then only      */
+/*      set for the thread using it, until msResetMapConfigOptions(),   */
+/*      and PROJ_DATA, which is process-wide, is refused.               */
+/************************************************************************/
+
+void msSetMapConfigOptionsPerThread(int per_thread)
+
+{
+  ms_config_options_per_thread = per_thread;
+}
+
 /************************************************************************/
 /*                         msGetConfigOption()                          */
 /************************************************************************/
@@ -169,6 +187,13 @@ int msSetConfigOption(mapObj *map, const char *key, const char *value)
   /* We have special "early" handling of this so that it will be */
   /* in effect when the projection blocks are parsed and pj_init is called. */
   if (strcasecmp(key, "PROJ_DATA") == 0 || strcasecmp(key, "PROJ_LIB") == 0) {
+    if (ms_config_options_per_thread) {
+      msSetError(MS_MISCERR,
+                 "CONFIG %s is process-wide and cannot be set by a mapfile "
+                 "served by several threads, set it in the config file.",
+                 "msSetConfigOption()", key);
+      return MS_FAILURE;
+    }
     /* value may be relative to map path */
     msSetPROJ_DATA(value, map->mappath);
   }
@@ -224,12 +249,36 @@ void msApplyMapConfigOptions(mapObj *map)
       msSetPROJ_DATA(value, map->mappath);
     } else if (strcasecmp(key, "MS_ERRORFILE") == 0) {
       msSetErrorFile(value, map->mappath);
+    } else if (ms_config_options_per_thread) {
+      CPLSetThreadLocalConfigOption(key, value);
     } else {
       CPLSetConfigOption(key, value);
     }
   }
 }
 
+/************************************************************************/
+/*                      msResetMapConfigOptions()                       */
+/*                                                                      */
+/*      Unsets the CONFIG options of a map for the calling thread,      */
+/*      once it is done with the map, when they are set per thread.     */
+/************************************************************************/
+
+void msResetMapConfigOptions(mapObj *map)
+
+{
+  const char *key;
+
+  if (!ms_config_options_per_thread)
+    return;
+
+  for (key = msFirstKeyFromHashTable(&(map->configoptions)); key != NULL;
+       key = msNextKeyFromHashTable(&(map->configoptions), key)) {
+    if (strcasecmp(key, "MS_ERRORFILE") != 0)
+      CPLSetThreadLocalConfigOption(key, NULL);
+  }
+}
+
 /************************************************************************/
 /*                         msMapIgnoreMissingData() */
 /************************************************************************/
@@ -3026,7 +3026,7 @@ OGCAPIFormat msOGCAPIGetOutputFormat(const cgiRequestObj *request) {
 
   // if f= query parameter is not specified, use HTTP Accept header if available
   if (p == nullptr) {
-    const char *accept = getenv("HTTP_ACCEPT");
+    const char *accept = msIO_getenv("HTTP_ACCEPT");
     if (accept) {
       if (strcmp(accept, "*/*") == 0)
         p = OGCAPI_MIMETYPE_JSON;
@@ -281,6 +281,7 @@ static int msApplySldLayerToMapLayer(layerObj *sldLayer, layerObj *lp) {
       }
     }
     lp->numclasses = 0;
+    msLayerFreeClassDispatch(lp);
 
     if (bSLDHasNamedClass && sldLayer->classgroup) {
       /* Set the class group to the class that has UserStyle.IsDefaultf
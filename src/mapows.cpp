@@ -668,7 +668,7 @@ int msOWSRequestIsEnabled(mapObj *map, layerObj *layer, const char *namespaces,
   if (request == NULL)
     return MS_FALSE;
 
-  remote_ip = getenv("REMOTE_ADDR");
+  remote_ip = msIO_getenv("REMOTE_ADDR");
 
   /* First, we check in the layer metadata */
   if (layer && check_all_layers == MS_FALSE) {
@@ -795,7 +795,7 @@ void msOWSRequestLayersEnabled(mapObj *map, const char *namespaces,
   if (request == NULL || (map == NULL) || (map->numlayers <= 0))
     return;
 
-  remote_ip = getenv("REMOTE_ADDR");
+  remote_ip = msIO_getenv("REMOTE_ADDR");
 
   enable_request =
       msOWSLookupMetadata(&map->web.metadata, namespaces, "enable_request");
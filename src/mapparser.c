@@ -3054,7 +3054,8 @@ int yylex(YYSTYPE *lvalp, parseObj *p)
     else
     {
       token = NUMBER;
-      (*lvalp).dblval = atof(p->shape->values[p->expr->curtoken->tokenval.bindval.index]);
+      if (!msShapeGetNumericValue(p->shape, p->expr->curtoken->tokenval.bindval.index, &(*lvalp).dblval))
+        (*lvalp).dblval = atof(p->shape->values[p->expr->curtoken->tokenval.bindval.index]);
     }
     break;
   case MS_TOKEN_BINDING_STRING:
@@ -138,6 +138,75 @@ static void msPostGISCloseConnection(void *pgconn) {
   PQfinish((PGconn *)pgconn);
 }
 
+/*
+** msPostGISConnectionEventProc()
+**
+** libpq event procedure keeping the statement_timeout (in milliseconds, 0
+** for the server default) set on a connection by
+** msPostGISSetStatementTimeout(). The connection may be pooled and shared
+** by several layers and requests, so the state lives with it rather than
+** with a layer.
+*/
+static int msPostGISConnectionEventProc(PGEventId evtId, void *evtInfo,
+                                        void *passThrough) {
+  (void)passThrough;
+  switch (evtId) {
+  case PGEVT_REGISTER: {
+    PGconn *pgconn = ((PGEventRegister *)evtInfo)->conn;
+    return PQsetInstanceData(pgconn, msPostGISConnectionEventProc,
+                             msSmallCalloc(1, sizeof(long)));
+  }
+  case PGEVT_CONNRESET: {
+    PGconn *pgconn = ((PGEventConnReset *)evtInfo)->conn;
+    long *timeout =
+        (long *)PQinstanceData(pgconn, msPostGISConnectionEventProc);
+    if (timeout)
+      *timeout = 0;
+    break;
+  }
+  case PGEVT_CONNDESTROY: {
+    PGconn *pgconn = ((PGEventConnDestroy *)evtInfo)->conn;
+    free(PQinstanceData(pgconn, msPostGISConnectionEventProc));
+    break;
+  }
+  default:
+    break;
+  }
+  return 1;
+}
+
+/*
+** msPostGISSetStatementTimeout()
+**
+** Bounds the next statement of the layer by what is left of the request
+** time budget. The SET is only issued when the budget has dropped by more
+** than a tenth of the timeout already set on the connection, or has grown
+** past it, and the timeout is reset once the request has no budget.
+*/
+static void msPostGISSetStatementTimeout(layerObj *layer) {
+  msPostGISLayerInfo *layerinfo = (msPostGISLayerInfo *)layer->layerinfo;
+  long *current = (long *)PQinstanceData(layerinfo->pgconn,
+                                         msPostGISConnectionEventProc);
+  if (!current)
+    return;
+
+  const double remaining = msMapGetRemainingTime(layer->map);
+  const long wanted =
+      remaining > 0 ? static_cast<long>(remaining * 1000) + 1 : 0;
+  if (wanted == *current ||
+      (wanted > 0 && wanted < *current && *current - wanted <= wanted / 10))
+    return;
+
+  const std::string strSQL =
+      wanted > 0 ? "SET statement_timeout = " + std::to_string(wanted)
+                 : "RESET statement_timeout";
+  PGresult *pgresult = PQexecParams(layerinfo->pgconn, strSQL.c_str(), 0,
+                                    nullptr, nullptr, nullptr, nullptr, 0);
+  if (pgresult && PQresultStatus(pgresult) == PGRES_COMMAND_OK)
+    *current = wanted;
+  PQclear(pgresult);
+}
+
 /*
 ** msPostGISCreateLayerInfo()
 */
@@ -2439,6 +2508,10 @@ static int msPostGISLayerOpen(layerObj *layer) {
     PQsetNoticeProcessor(layerinfo->pgconn, postresqlNoticeHandler,
                          (void *)layer);
 
+    /* Keep track of the statement_timeout set on the connection. */
+    PQregisterEventProc(layerinfo->pgconn, msPostGISConnectionEventProc,
+                        "mapserver", nullptr);
+
     /* Save this connection in the pool for later. */
     msConnPoolRegister(layer, layerinfo->pgconn, msPostGISCloseConnection);
   } else {
@@ -2625,6 +2698,11 @@ static PGresult *runPQexecParamsWithBindSubstitution(layerObj *layer,
   PGresult *pgresult = nullptr;
   msPostGISLayerInfo *layerinfo = (msPostGISLayerInfo *)layer->layerinfo;
 
+  if (msMapCheckDeadline(layer->map,
+                         "runPQexecParamsWithBindSubstitution()") != MS_SUCCESS)
+    return nullptr;
+  msPostGISSetStatementTimeout(layer);
+
   const auto layer_bind_values = buildBindValues(layer);
 
   if (!layer_bind_values.empty()) {
@@ -32,6 +32,7 @@
 #ifdef USE_POSTGIS
 
 #include "libpq-fe.h"
+#include "libpq-events.h"
 #include <string>
 
 #ifndef LITTLE_ENDIAN
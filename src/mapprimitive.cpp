@@ -113,6 +113,8 @@ shapeObj &shapeObj::operator=(shapeObj &&other) {
   /* attribute component */
   std::swap(values, other.values);
   std::swap(numvalues, other.numvalues);
+  std::swap(typedvalues, other.typedvalues);
+  std::swap(numtypedvalues, other.numtypedvalues);
 
   std::swap(geometry, other.geometry);
   std::swap(renderer_cache, other.renderer_cache);
@@ -142,6 +144,8 @@ void msInitShape(shapeObj *shape) {
   /* attribute component */
   shape->values = NULL;
   shape->numvalues = 0;
+  shape->typedvalues = NULL;
+  shape->numtypedvalues = 0;
 
   shape->geometry = NULL;
   shape->renderer_cache = NULL;
@@ -189,6 +193,12 @@ int msCopyShape(const shapeObj *from, shapeObj *to) {
     to->numvalues = from->numvalues;
   }
 
+  msShapeAllocTypedValues(to, from->typedvalues ? from->numtypedvalues : 0);
+  if (from->typedvalues) {
+    memcpy(to->typedvalues, from->typedvalues,
+           sizeof(attributeValueObj) * from->numtypedvalues);
+  }
+
   to->geometry = NULL; /* GEOS code will build automatically if necessary */
   to->scratch = from->scratch;
 
@@ -208,6 +218,7 @@ void msFreeShape(shapeObj *shape) {
     free(shape->line);
   if (shape->values)
     msFreeCharArray(shape->values, shape->numvalues);
+  msFree(shape->typedvalues);
   if (shape->text)
     free(shape->text);
 
@@ -231,11 +242,84 @@ int msGetShapeRAMSize(shapeObj *shape) {
     if (shape->values[i])
       size += strlen(shape->values[i]) + 1;
   }
+  size += shape->numtypedvalues * sizeof(attributeValueObj);
   if (shape->text)
     size += strlen(shape->text) + 1;
   return size;
 }
 
+/*
+** Allocate the typed values of a shape, all initialized as
+** MS_ATTRIBUTE_UNKNOWN. With 0 values, drops those parsed so far: to be
+** called when the string values of a shape are changed in place.
+*/
+attributeValueObj *msShapeAllocTypedValues(shapeObj *shape, int numvalues) {
+  msFree(shape->typedvalues);
+  shape->typedvalues = NULL;
+  shape->numtypedvalues = 0;
+  if (numvalues <= 0)
+    return NULL;
+  shape->typedvalues = (attributeValueObj *)msSmallCalloc(
+      numvalues, sizeof(attributeValueObj));
+  shape->numtypedvalues = numvalues;
+  return shape->typedvalues;
+}
+
+/*
+** Reorder the typed values of a shape after its values were rebuilt from
+** itemindexes, as done by the layers wrapping other layers. Entries with
+** no matching source value become MS_ATTRIBUTE_UNKNOWN.
+*/
+void msShapeRemapTypedValues(shapeObj *shape, const int *itemindexes,
+                             int numitems) {
+  attributeValueObj *from = shape->typedvalues;
+  int numfrom = shape->numtypedvalues;
+  int i;
+
+  if (!from)
+    return;
+  shape->typedvalues = NULL;
+  msShapeAllocTypedValues(shape, numitems);
+  for (i = 0; i < numitems; i++) {
+    if (itemindexes[i] >= 0 && itemindexes[i] < numfrom)
+      shape->typedvalues[i] = from[itemindexes[i]];
+  }
+  msFree(from);
+}
+
+/*
+** Return MS_TRUE and set value if attribute i is a number, MS_FALSE if the
+** caller has to fall back to the string value. The string is parsed on the
+** first call for an item, the result is kept with the shape so that classes,
+** styles and expressions using the same item do not parse it again.
+*/
+int msShapeGetNumericValue(shapeObj *shape, int i, double *value) {
+  attributeValueObj *typed;
+
+  if (i < 0 || i >= shape->numvalues || !shape->values || !shape->values[i])
+    return MS_FALSE;
+  if (i >= shape->numtypedvalues) {
+    shape->typedvalues = (attributeValueObj *)msSmallRealloc(
+        shape->typedvalues, sizeof(attributeValueObj) * shape->numvalues);
+    memset(shape->typedvalues + shape->numtypedvalues, 0,
+           sizeof(attributeValueObj) *
+               (shape->numvalues - shape->numtypedvalues));
+    shape->numtypedvalues = shape->numvalues;
+  }
+
+  typed = shape->typedvalues + i;
+  if (typed->type == MS_ATTRIBUTE_UNKNOWN) {
+    char *end;
+    typed->dblval = strtod(shape->values[i], &end);
+    typed->type =
+        end == shape->values[i] ? MS_ATTRIBUTE_STRING : MS_ATTRIBUTE_DOUBLE;
+  }
+  if (typed->type != MS_ATTRIBUTE_DOUBLE)
+    return MS_FALSE;
+  *value = typed->dblval;
+  return MS_TRUE;
+}
+
 void msFreeLabelPathObj(labelPathObj *path) {
   msFreeShape(&(path->bounds));
   msFree(path->path.point);
@@ -76,6 +76,20 @@ typedef struct {
 #endif
 } lineObj;
 
+#ifndef SWIG
+/* parsed form of an attribute value, see shapeObj.typedvalues */
+enum MS_ATTRIBUTE_TYPE {
+  MS_ATTRIBUTE_UNKNOWN = 0, /* not parsed yet */
+  MS_ATTRIBUTE_STRING,      /* not a number, use the string value */
+  MS_ATTRIBUTE_DOUBLE
+};
+
+typedef struct {
+  int type;      /* one of MS_ATTRIBUTE_TYPE */
+  double dblval; /* set for MS_ATTRIBUTE_DOUBLE */
+} attributeValueObj;
+#endif /*SWIG*/
+
 /**
 Each feature of a layer's data is a :class:`shapeObj`. Each part of the shape is
 a closed :class:`lineObj`.
@@ -85,6 +99,10 @@ struct shapeObj {
 #ifndef SWIG
   lineObj *line;
   char **values;
+  /* numbers parsed from values on first use by msShapeGetNumericValue(),
+   * values remains the reference and is always set */
+  attributeValueObj *typedvalues;
+  int numtypedvalues;
   void *geometry;
   void *renderer_cache;
 #endif
@@ -1049,9 +1049,16 @@ int msQueryByFilter(mapObj *map) {
     if (lp->minfeaturesize > 0)
       minfeaturesize = Pix2LayerGeoref(map, lp, lp->minfeaturesize);
 
+    int nshapes = 0;
     while ((status = msLayerNextShape(lp, &shape)) ==
            MS_SUCCESS) { /* step through the shapes - if necessary the filter is
                             applied in msLayerNextShape(...) */
+      if ((++nshapes & 63) == 0 &&
+          msMapCheckDeadline(map, "msQueryByFilter()") != MS_SUCCESS) {
+        msFreeShape(&shape);
+        status = MS_FAILURE;
+        break;
+      }
 
       /* Check if the shape size is ok to be drawn */
       if ((shape.type == MS_SHAPE_LINE || shape.type == MS_SHAPE_POLYGON) &&
@@ -1371,6 +1378,12 @@ int msQueryByRect(mapObj *map) {
     while ((status = msLayerNextShape(lp, &shape)) ==
            MS_SUCCESS) { /* step through the shapes */
       numresultstotal++;
+      if ((numresultstotal & 63) == 0 &&
+          msMapCheckDeadline(map, "msQueryByRect()") != MS_SUCCESS) {
+        msFreeShape(&shape);
+        status = MS_FAILURE;
+        break;
+      }
       /* Check if the shape size is ok to be drawn */
       if ((shape.type == MS_SHAPE_LINE || shape.type == MS_SHAPE_POLYGON) &&
           (minfeaturesize > 0)) {
@@ -1693,8 +1706,15 @@ int msQueryByFeatures(mapObj *map) {
       if (lp->minfeaturesize > 0)
         minfeaturesize = Pix2LayerGeoref(map, lp, lp->minfeaturesize);
 
+      int nshapes = 0;
       while ((status = msLayerNextShape(lp, &shape)) ==
              MS_SUCCESS) { /* step through the shapes */
+        if ((++nshapes & 63) == 0 &&
+            msMapCheckDeadline(map, "msQueryByFeatures()") != MS_SUCCESS) {
+          msFreeShape(&shape);
+          status = MS_FAILURE;
+          break;
+        }
 
         /* check for dups when there are multiple selection shapes */
         if (i > 0 &&
@@ -2250,11 +2270,18 @@ int msQueryByPoint(mapObj *map) {
         (lp->minfeaturesize > 0) ? Pix2LayerGeoref(map, lp, lp->minfeaturesize)
                                  : -1;
 
+    int nshapes = 0;
     while (true) { /* step through the shapes */
 
       shapeObj shape;
       if ((status = msLayerNextShape(lp, &shape)) != MS_SUCCESS)
         break;
+      if ((++nshapes & 63) == 0 &&
+          msMapCheckDeadline(map, "msQueryByPoint()") != MS_SUCCESS) {
+        msFreeShape(&shape);
+        status = MS_FAILURE;
+        break;
+      }
 
       /* Check if the shape size is ok to be drawn */
       if ((shape.type == MS_SHAPE_LINE || shape.type == MS_SHAPE_POLYGON) &&
@@ -2645,8 +2672,15 @@ int msQueryByShape(mapObj *map) {
     if (lp->minfeaturesize > 0)
       minfeaturesize = Pix2LayerGeoref(map, lp, lp->minfeaturesize);
 
+    int nshapes = 0;
     while ((status = msLayerNextShape(lp, &shape)) ==
            MS_SUCCESS) { /* step through the shapes */
+      if ((++nshapes & 63) == 0 &&
+          msMapCheckDeadline(map, "msQueryByShape()") != MS_SUCCESS) {
+        msFreeShape(&shape);
+        status = MS_FAILURE;
+        break;
+      }
 
       /* Check if the shape size is ok to be drawn */
       if ((shape.type == MS_SHAPE_LINE || shape.type == MS_SHAPE_POLYGON) &&
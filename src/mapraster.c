@@ -113,7 +113,7 @@ static int msGetClass_String(layerObj *layer, colorObj *color,
 
     /* Empty expression - always matches */
     if (layer->class[idx] -> expression.string == NULL)
-      return (i);
+      return (idx);
 
     switch (layer->class[idx] -> expression.type) {
 
@@ -602,17 +602,16 @@ msDrawRasterLayerLowCheckDataset(mapObj *map, layerObj *layer, GDALDatasetH hDS,
 }
 
 /************************************************************************/
-/*              msDrawRasterLayerLowOpenDataset()                       */
+/*              msDrawRasterLayerLowGetDatasetPath()                    */
+/*                                                                      */
+/*      Return the decrypted path of the raster to open, or NULL.       */
 /************************************************************************/
 
-void *msDrawRasterLayerLowOpenDataset(mapObj *map, layerObj *layer,
-                                      const char *filename,
-                                      char szPath[MS_MAXPATHLEN],
-                                      char **p_decrypted_path) {
+static char *msDrawRasterLayerLowGetDatasetPath(mapObj *map, layerObj *layer,
+                                                const char *filename,
+                                                char szPath[MS_MAXPATHLEN]) {
   const char *pszPath;
 
-  msGDALInitialize();
-
   if (layer->debug)
     msDebug("msDrawRasterLayerLow(%s): Filename is: %s\n", layer->name,
             filename);
@@ -633,7 +632,21 @@ void *msDrawRasterLayerLowOpenDataset(mapObj *map, layerObj *layer,
   ** components. But that is mostly ok, since stuff like sde,postgres and
   ** oracle georaster do not use real paths.
   */
-  *p_decrypted_path = msDecryptStringTokens(map, pszPath);
+  return msDecryptStringTokens(map, pszPath);
+}
+
+/************************************************************************/
+/*              msDrawRasterLayerLowOpenDataset()                       */
+/************************************************************************/
+
+void *msDrawRasterLayerLowOpenDataset(mapObj *map, layerObj *layer,
+                                      const char *filename,
+                                      char szPath[MS_MAXPATHLEN],
+                                      char **p_decrypted_path) {
+  msGDALInitialize();
+
+  *p_decrypted_path =
+      msDrawRasterLayerLowGetDatasetPath(map, layer, filename, szPath);
   if (*p_decrypted_path == NULL)
     return NULL;
 
@@ -785,6 +798,375 @@ int msDrawRasterLayerLowCheckIfMustDraw(mapObj *map, layerObj *layer) {
   return 1;
 }
 
+/************************************************************************/
+/*                 msDrawRasterLayerLowDrawDataset()                    */
+/*                                                                      */
+/*      Draw an opened dataset, resampling it if needed.                */
+/************************************************************************/
+
+static int msDrawRasterLayerLowDrawDataset(mapObj *map, layerObj *layer,
+                                           imageObj *image,
+                                           rasterBufferObj *rb,
+                                           GDALDatasetH hDS) {
+  double adfGeoTransform[6];
+
+  msGetGDALGeoTransform(hDS, map, layer, adfGeoTransform);
+
+  /*
+  ** We want to resample if the source image is rotated, if
+  ** the projections differ or if resampling has been explicitly
+  ** requested, or if the image has north-down instead of north-up.
+  */
+
+  if (((adfGeoTransform[2] != 0.0 || adfGeoTransform[4] != 0.0 ||
+        adfGeoTransform[5] > 0.0 || adfGeoTransform[1] < 0.0) &&
+       layer->transform) ||
+      msProjectionsDiffer(&(map->projection), &(layer->projection)) ||
+      CSLFetchNameValue(layer->processing, "RESAMPLE") != NULL) {
+    return msResampleGDALToMap(map, layer, image, rb, hDS);
+  }
+
+  if (adfGeoTransform[2] != 0.0 || adfGeoTransform[4] != 0.0) {
+    if (layer->debug || map->debug)
+      msDebug("Layer %s has rotational coefficients but we\n"
+              "are unable to use them, projections support\n"
+              "needs to be built in.",
+              layer->name);
+  }
+  return msDrawRasterLayerGDAL(map, layer, image, rb, hDS);
+}
+
+/* ==================================================================== */
+/*      Tile index read-ahead.                                          */
+/*                                                                      */
+/*      The members of a raster tile index that intersect the map       */
+/*      extent are opened, and the part of them covering the map is     */
+/*      read into the GDAL block cache, by a bounded pool of worker     */
+/*      threads. The calling thread still draws the tiles one at a      */
+/*      time, under TLOCK_GDAL and in tile index order, so the output   */
+/*      is the same as with sequential reads.                           */
+/* ==================================================================== */
+
+#define MS_RASTER_TILE_READ_THREADS_MAX 64
+#define MS_RASTER_TILE_READ_AHEAD_MAX_BYTES (64 * 1024 * 1024)
+
+typedef struct {
+  char *filename;             /* tile index value */
+  char *tilesrsname;          /* TILESRS value, or "" */
+  char *decrypted_path;       /* path handed to GDAL, may be NULL */
+  char szPath[MS_MAXPATHLEN]; /* path reported in error messages */
+  GDALDatasetH hDS;
+  char *pszErrorMsg; /* GDAL error message if hDS is NULL */
+  int bDone;
+} msRasterTileReadJob;
+
+typedef struct {
+  msRasterTileReadJob *pasJobs;
+  int nJobs;
+  int nNextJob;  /* next job to be picked up */
+  int nConsumed; /* jobs already drawn by the calling thread */
+  int nMaxAhead; /* bound on jobs read ahead of the drawing */
+  int bAbort;
+  CPLMutex *hMutex;
+  CPLCond *hCond;
+
+  int bReadWindow; /* warm the block cache for the map window */
+  rectObj extent;
+  double cellsize;
+} msRasterTileReadPool;
+
+/************************************************************************/
+/*                   msDrawRasterGetTileReadThreads()                   */
+/*                                                                      */
+/*      Number of threads to use for reading tile index members, from   */
+/*      PROCESSING "TILE_READ_THREADS" or MS_RASTER_TILE_READ_THREADS.  */
+/************************************************************************/
+
+static int msDrawRasterGetTileReadThreads(layerObj *layer) {
+  const char *pszValue;
+  int nThreads;
+
+  if (layer->connectiontype == MS_KERNELDENSITY ||
+      layer->connectiontype == MS_IDW || layer->connectiontype == MS_KRIGING)
+    return 1;
+
+  pszValue = msLayerGetProcessingKey(layer, "TILE_READ_THREADS");
+  if (pszValue == NULL)
+    pszValue = CPLGetConfigOption("MS_RASTER_TILE_READ_THREADS", NULL);
+  if (pszValue == NULL)
+    return 1;
+
+  if (EQUAL(pszValue, "ALL_CPUS"))
+    nThreads = CPLGetNumCPUs();
+  else
+    nThreads = atoi(pszValue);
+
+  return MS_MAX(1, MS_MIN(nThreads, MS_RASTER_TILE_READ_THREADS_MAX));
+}
+
+/************************************************************************/
+/*                    msDrawRasterReadAheadWindow()                     */
+/*                                                                      */
+/*      Read the part of a dataset covering the map extent at about     */
+/*      the map resolution, so that GDAL picks the same overview and    */
+/*      caches the same blocks as the later draw. The data itself is    */
+/*      discarded.                                                      */
+/************************************************************************/
+
+static void msDrawRasterReadAheadWindow(msRasterTileReadPool *psPool,
+                                        GDALDatasetH hDS) {
+  double adfGT[6];
+  double dfXOff, dfYOff, dfXEnd, dfYEnd;
+  int nXOff, nYOff, nXSize, nYSize, nBufXSize, nBufYSize;
+  int nBands = GDALGetRasterCount(hDS);
+  GByte *pabyBuf;
+
+  if (nBands <= 0 || GDALGetGeoTransform(hDS, adfGT) != CE_None)
+    return;
+  if (adfGT[2] != 0.0 || adfGT[4] != 0.0 || adfGT[1] <= 0.0 ||
+      adfGT[5] >= 0.0)
+    return;
+
+  dfXOff = floor((psPool->extent.minx - adfGT[0]) / adfGT[1]);
+  dfYOff = floor((psPool->extent.maxy - adfGT[3]) / adfGT[5]);
+  dfXEnd = ceil((psPool->extent.maxx - adfGT[0]) / adfGT[1]);
+  dfYEnd = ceil((psPool->extent.miny - adfGT[3]) / adfGT[5]);
+
+  nXOff = (int)MS_MAX(0.0, dfXOff);
+  nYOff = (int)MS_MAX(0.0, dfYOff);
+  nXSize = (int)MS_MIN((double)GDALGetRasterXSize(hDS), dfXEnd) - nXOff;
+  nYSize = (int)MS_MIN((double)GDALGetRasterYSize(hDS), dfYEnd) - nYOff;
+  if (nXSize <= 0 || nYSize <= 0)
+    return;
+
+  nBufXSize = (int)ceil(nXSize * adfGT[1] / psPool->cellsize);
+  nBufYSize = (int)ceil(nYSize * -adfGT[5] / psPool->cellsize);
+  nBufXSize = MS_MAX(1, MS_MIN(nBufXSize, nXSize));
+  nBufYSize = MS_MAX(1, MS_MIN(nBufYSize, nYSize));
+  if ((double)nBufXSize * nBufYSize * nBands >
+      MS_RASTER_TILE_READ_AHEAD_MAX_BYTES)
+    return;
+
+  pabyBuf = (GByte *)malloc((size_t)nBufXSize * nBufYSize * nBands);
+  if (pabyBuf == NULL)
+    return;
+  GDALDatasetRasterIO(hDS, GF_Read, nXOff, nYOff, nXSize, nYSize, pabyBuf,
+                      nBufXSize, nBufYSize, GDT_Byte, nBands, NULL, 0, 0, 0);
+  free(pabyBuf);
+}
+
+/************************************************************************/
+/*                      msDrawRasterRunTileReadJob()                    */
+/************************************************************************/
+
+static void msDrawRasterRunTileReadJob(msRasterTileReadPool *psPool,
+                                       msRasterTileReadJob *psJob) {
+  GDALDatasetH hDS = NULL;
+  char *pszErrorMsg = NULL;
+
+  /* Private, non shared, handles: they are used by two threads in turn. */
+  CPLErrorReset();
+  if (psJob->decrypted_path != NULL)
+    hDS = GDALOpenEx(psJob->decrypted_path, GDAL_OF_RASTER, NULL, NULL, NULL);
+  if (hDS == NULL)
+    pszErrorMsg = msStrdup(CPLGetLastErrorMsg());
+  else if (psPool->bReadWindow)
+    msDrawRasterReadAheadWindow(psPool, hDS);
+
+  CPLAcquireMutex(psPool->hMutex, 1000.0);
+  psJob->hDS = hDS;
+  psJob->pszErrorMsg = pszErrorMsg;
+  psJob->bDone = MS_TRUE;
+  CPLCondBroadcast(psPool->hCond);
+  CPLReleaseMutex(psPool->hMutex);
+}
+
+/************************************************************************/
+/*                      msDrawRasterTileReadWorker()                    */
+/************************************************************************/
+
+static void msDrawRasterTileReadWorker(void *pData) {
+  msRasterTileReadPool *psPool = (msRasterTileReadPool *)pData;
+
+  CPLPushErrorHandler(CPLQuietErrorHandler);
+  while (MS_TRUE) {
+    msRasterTileReadJob *psJob;
+
+    CPLAcquireMutex(psPool->hMutex, 1000.0);
+    while (!psPool->bAbort && psPool->nNextJob < psPool->nJobs &&
+           psPool->nNextJob >= psPool->nConsumed + psPool->nMaxAhead)
+      CPLCondWait(psPool->hCond, psPool->hMutex);
+    if (psPool->bAbort || psPool->nNextJob >= psPool->nJobs) {
+      CPLReleaseMutex(psPool->hMutex);
+      break;
+    }
+    psJob = psPool->pasJobs + psPool->nNextJob++;
+    CPLReleaseMutex(psPool->hMutex);
+
+    msDrawRasterRunTileReadJob(psPool, psJob);
+  }
+  CPLPopErrorHandler();
+}
+
+/************************************************************************/
+/*                    msDrawRasterTileIndexPrefetch()                   */
+/*                                                                      */
+/*      Draw all the tiles of a tile index, with threads prefetching    */
+/*      them: the workers only open the tiles and warm the GDAL block   */
+/*      cache, the tiles are resampled and drawn by the calling thread. */
+/************************************************************************/
+
+static int msDrawRasterTileIndexPrefetch(mapObj *map, layerObj *layer,
+                                         imageObj *image, rasterBufferObj *rb,
+                                         layerObj *tlp, int tileitemindex,
+                                         int tilesrsindex) {
+  msRasterTileReadPool sPool;
+  CPLJoinableThread **pahThreads = NULL;
+  char tilename[MS_MAXPATHLEN], tilesrsname[1024];
+  shapeObj tshp;
+  int nJobsAlloc = 0, nThreads = 0, nMaxThreads, i, status;
+  int final_status = MS_SUCCESS;
+
+  memset(&sPool, 0, sizeof(sPool));
+  msInitShape(&tshp);
+
+  /* Collect the tiles to draw, in tile index order. */
+  while (MS_TRUE) {
+    msRasterTileReadJob *psJob;
+
+    status = msDrawRasterIterateTileIndex(
+        layer, tlp, &tshp, tileitemindex, tilesrsindex, tilename,
+        sizeof(tilename), tilesrsname, sizeof(tilesrsname));
+    if (status == MS_FAILURE)
+      final_status = MS_FAILURE;
+    if (status != MS_SUCCESS)
+      break;
+    if (strlen(tilename) == 0)
+      continue;
+
+    if (sPool.nJobs == nJobsAlloc) {
+      nJobsAlloc = nJobsAlloc * 2 + 16;
+      sPool.pasJobs = (msRasterTileReadJob *)msSmallRealloc(
+          sPool.pasJobs, sizeof(msRasterTileReadJob) * nJobsAlloc);
+    }
+    psJob = sPool.pasJobs + sPool.nJobs++;
+    memset(psJob, 0, sizeof(*psJob));
+    psJob->filename = msStrdup(tilename);
+    psJob->tilesrsname = msStrdup(tilesrsname);
+    psJob->decrypted_path = msDrawRasterLayerLowGetDatasetPath(
+        map, layer, tilename, psJob->szPath);
+  }
+
+  if (final_status != MS_SUCCESS || sPool.nJobs == 0)
+    goto cleanup;
+
+  /*
+  ** The map window can only be located in the tiles beforehand when
+  ** they are drawn without resampling.
+  */
+  sPool.bReadWindow =
+      tilesrsindex < 0 && map->cellsize > 0 &&
+      !(layer->projection.numargs > 0 &&
+        EQUAL(layer->projection.args[0], "auto")) &&
+      !msProjectionsDiffer(&(map->projection), &(layer->projection)) &&
+      CSLFetchNameValue(layer->processing, "RESAMPLE") == NULL;
+  sPool.extent = map->extent;
+  sPool.cellsize = map->cellsize;
+
+  nMaxThreads = MS_MIN(msDrawRasterGetTileReadThreads(layer), sPool.nJobs);
+  sPool.nMaxAhead = 2 * nMaxThreads;
+  sPool.hMutex = CPLCreateMutex(); /* created acquired */
+  CPLReleaseMutex(sPool.hMutex);
+  sPool.hCond = CPLCreateCond();
+
+  pahThreads = (CPLJoinableThread **)msSmallCalloc(
+      nMaxThreads, sizeof(CPLJoinableThread *));
+  for (nThreads = 0; nThreads < nMaxThreads; nThreads++) {
+    pahThreads[nThreads] =
+        CPLCreateJoinableThread(msDrawRasterTileReadWorker, &sPool);
+    if (pahThreads[nThreads] == NULL)
+      break;
+  }
+
+  if (layer->debug)
+    msDebug(
+        "msDrawRasterLayerLow(%s): prefetching %d tiles with %d threads.\n",
+        layer->name, sPool.nJobs, nThreads);
+
+  for (i = 0; i < sPool.nJobs; i++) {
+    msRasterTileReadJob *psJob = sPool.pasJobs + i;
+    CheckDatasetReturnType eRet;
+    int bRunHere = MS_FALSE;
+
+    /* Wait for the tile, or read it here if no worker picked it up yet. */
+    CPLAcquireMutex(sPool.hMutex, 1000.0);
+    if (sPool.nNextJob == i) {
+      sPool.nNextJob++;
+      bRunHere = MS_TRUE;
+    } else {
+      while (!psJob->bDone)
+        CPLCondWait(sPool.hCond, sPool.hMutex);
+    }
+    CPLReleaseMutex(sPool.hMutex);
+    if (bRunHere)
+      msDrawRasterRunTileReadJob(&sPool, psJob);
+
+    msAcquireLock(TLOCK_GDAL);
+    if (psJob->hDS == NULL)
+      CPLErrorSetState(CE_Failure, CPLE_AppDefined,
+                       psJob->pszErrorMsg ? psJob->pszErrorMsg : "");
+    eRet = msDrawRasterLayerLowCheckDataset(
+        map, layer, psJob->hDS,
+        psJob->decrypted_path ? psJob->decrypted_path : psJob->szPath,
+        psJob->szPath);
+    if (eRet == CDRT_OK) {
+      if (msDrawRasterLoadProjection(layer, psJob->hDS, psJob->filename,
+                                     tilesrsindex,
+                                     psJob->tilesrsname) != MS_SUCCESS ||
+          msDrawRasterLayerLowDrawDataset(map, layer, image, rb,
+                                          psJob->hDS) == -1)
+        eRet = CDRT_RETURN_MS_FAILURE;
+      GDALClose(psJob->hDS);
+      psJob->hDS = NULL;
+    }
+    msReleaseLock(TLOCK_GDAL);
+
+    if (eRet == CDRT_RETURN_MS_FAILURE) {
+      final_status = MS_FAILURE;
+      break;
+    }
+
+    CPLAcquireMutex(sPool.hMutex, 1000.0);
+    sPool.nConsumed = i + 1;
+    CPLCondBroadcast(sPool.hCond);
+    CPLReleaseMutex(sPool.hMutex);
+  }
+
+  CPLAcquireMutex(sPool.hMutex, 1000.0);
+  sPool.bAbort = MS_TRUE;
+  CPLCondBroadcast(sPool.hCond);
+  CPLReleaseMutex(sPool.hMutex);
+  for (i = 0; i < nThreads; i++)
+    CPLJoinThread(pahThreads[i]);
+  msFree(pahThreads);
+  CPLDestroyCond(sPool.hCond);
+  CPLDestroyMutex(sPool.hMutex);
+
+cleanup:
+  for (i = 0; i < sPool.nJobs; i++) {
+    msRasterTileReadJob *psJob = sPool.pasJobs + i;
+    if (psJob->hDS)
+      GDALClose(psJob->hDS);
+    msFree(psJob->filename);
+    msFree(psJob->tilesrsname);
+    msFree(psJob->decrypted_path);
+    msFree(psJob->pszErrorMsg);
+  }
+  msFree(sPool.pasJobs);
+
+  return final_status;
+}
+
 /************************************************************************/
 /*                        msDrawRasterLayerLow()                        */
 /*                                                                      */
@@ -817,7 +1199,6 @@ int msDrawRasterLayerLowWithDataset(mapObj *map, layerObj *layer,
 
   rectObj searchrect;
   GDALDatasetH hDS;
-  double adfGeoTransform[6];
   void *kernel_density_cleanup_ptr = NULL;
 
   if (layer->debug > 0 || map->debug > 1)
@@ -841,6 +1222,12 @@ int msDrawRasterLayerLowWithDataset(mapObj *map, layerObj *layer,
         final_status = status;
       goto cleanup;
     }
+
+    if (hDatasetIn == NULL && msDrawRasterGetTileReadThreads(layer) > 1) {
+      final_status = msDrawRasterTileIndexPrefetch(
+          map, layer, image, rb, tlp, tileitemindex, tilesrsindex);
+      goto cleanup;
+    }
   }
 
   done = MS_FALSE;
@@ -927,30 +1314,7 @@ int msDrawRasterLayerLowWithDataset(mapObj *map, layerObj *layer,
       break;
     }
 
-    msGetGDALGeoTransform(hDS, map, layer, adfGeoTransform);
-
-    /*
-    ** We want to resample if the source image is rotated, if
-    ** the projections differ or if resampling has been explicitly
-    ** requested, or if the image has north-down instead of north-up.
-    */
-
-    if (((adfGeoTransform[2] != 0.0 || adfGeoTransform[4] != 0.0 ||
-          adfGeoTransform[5] > 0.0 || adfGeoTransform[1] < 0.0) &&
-         layer->transform) ||
-        msProjectionsDiffer(&(map->projection), &(layer->projection)) ||
-        CSLFetchNameValue(layer->processing, "RESAMPLE") != NULL) {
-      status = msResampleGDALToMap(map, layer, image, rb, hDS);
-    } else {
-      if (adfGeoTransform[2] != 0.0 || adfGeoTransform[4] != 0.0) {
-        if (layer->debug || map->debug)
-          msDebug("Layer %s has rotational coefficients but we\n"
-                  "are unable to use them, projections support\n"
-                  "needs to be built in.",
-                  layer->name);
-      }
-      status = msDrawRasterLayerGDAL(map, layer, image, rb, hDS);
-    }
+    status = msDrawRasterLayerLowDrawDataset(map, layer, image, rb, hDS);
 
     if (status == -1) {
       if (hDatasetIn == NULL) {
@@ -79,7 +79,8 @@ int InvGeoTransform(double *gt_in, double *gt_out)
 static int msNearestRasterResampler(
     imageObj *psSrcImage, rasterBufferObj *src_rb, imageObj *psDstImage,
     rasterBufferObj *dst_rb, SimpleTransformer pfnTransform, void *pCBData,
-    int debug, rasterBufferObj *mask_rb, int bWrapAtLeftRight)
+    int debug, rasterBufferObj *mask_rb, int bWrapAtLeftRight,
+    const mapObj *map)
 
 {
   double *x, *y;
@@ -90,6 +91,7 @@ static int msNearestRasterResampler(
   int nSrcXSize = psSrcImage->width;
   int nSrcYSize = psSrcImage->height;
   int nFailedPoints = 0, nSetPoints = 0;
+  int status = MS_SUCCESS;
   assert(!MS_RENDERER_PLUGIN(psSrcImage->format) ||
          src_rb->type == MS_BUFFER_BYTE_RGBA);
 
@@ -98,6 +100,12 @@ static int msNearestRasterResampler(
   panSuccess = (int *)msSmallMalloc(sizeof(int) * nDstXSize);
 
   for (nDstY = 0; nDstY < nDstYSize; nDstY++) {
+    if ((nDstY & 15) == 0 &&
+        msMapCheckDeadline(map, "msNearestRasterResampler()") != MS_SUCCESS) {
+      status = MS_FAILURE;
+      break;
+    }
+
     for (nDstX = 0; nDstX < nDstXSize; nDstX++) {
       x[nDstX] = nDstX + 0.5;
       y[nDstX] = nDstY + 0.5;
@@ -212,7 +220,7 @@ static int msNearestRasterResampler(
             nFailedPoints, nSetPoints);
   }
 
-  return 0;
+  return status;
 }
 
 /************************************************************************/
@@ -293,7 +301,8 @@ static void msSourceSample(imageObj *psSrcImage, rasterBufferObj *rb, int iSrcX,
 static int msBilinearRasterResampler(
     imageObj *psSrcImage, rasterBufferObj *src_rb, imageObj *psDstImage,
     rasterBufferObj *dst_rb, SimpleTransformer pfnTransform, void *pCBData,
-    int debug, rasterBufferObj *mask_rb, int bWrapAtLeftRight)
+    int debug, rasterBufferObj *mask_rb, int bWrapAtLeftRight,
+    const mapObj *map)
 
 {
   double *x, *y;
@@ -304,6 +313,7 @@ static int msBilinearRasterResampler(
   int nSrcXSize = psSrcImage->width;
   int nSrcYSize = psSrcImage->height;
   int nFailedPoints = 0, nSetPoints = 0;
+  int status = MS_SUCCESS;
   double *padfPixelSum;
   int bandCount = MS_MAX(4, psSrcImage->format->bands);
 
@@ -314,6 +324,12 @@ static int msBilinearRasterResampler(
   panSuccess = (int *)msSmallMalloc(sizeof(int) * nDstXSize);
 
   for (nDstY = 0; nDstY < nDstYSize; nDstY++) {
+    if ((nDstY & 15) == 0 &&
+        msMapCheckDeadline(map, "msBilinearRasterResampler()") != MS_SUCCESS) {
+      status = MS_FAILURE;
+      break;
+    }
+
     for (nDstX = 0; nDstX < nDstXSize; nDstX++) {
       x[nDstX] = nDstX + 0.5;
       y[nDstX] = nDstY + 0.5;
@@ -444,7 +460,7 @@ static int msBilinearRasterResampler(
             nFailedPoints, nSetPoints);
   }
 
-  return 0;
+  return status;
 }
 
 /************************************************************************/
@@ -507,7 +523,8 @@ static int
 msAverageRasterResampler(imageObj *psSrcImage, rasterBufferObj *src_rb,
                          imageObj *psDstImage, rasterBufferObj *dst_rb,
                          SimpleTransformer pfnTransform, void *pCBData,
-                         int debug, rasterBufferObj *mask_rb)
+                         int debug, rasterBufferObj *mask_rb,
+                         const mapObj *map)
 
 {
   double *x1, *y1, *x2, *y2;
@@ -516,6 +533,7 @@ msAverageRasterResampler(imageObj *psSrcImage, rasterBufferObj *src_rb,
   int nDstXSize = psDstImage->width;
   int nDstYSize = psDstImage->height;
   int nFailedPoints = 0, nSetPoints = 0;
+  int status = MS_SUCCESS;
   double *padfPixelSum;
 
   int bandCount = MS_MAX(4, psSrcImage->format->bands);
@@ -530,6 +548,12 @@ msAverageRasterResampler(imageObj *psSrcImage, rasterBufferObj *src_rb,
   panSuccess2 = (int *)msSmallMalloc(sizeof(int) * (nDstXSize + 1));
 
   for (nDstY = 0; nDstY < nDstYSize; nDstY++) {
+    if ((nDstY & 15) == 0 &&
+        msMapCheckDeadline(map, "msAverageRasterResampler()") != MS_SUCCESS) {
+      status = MS_FAILURE;
+      break;
+    }
+
     for (nDstX = 0; nDstX <= nDstXSize; nDstX++) {
       x1[nDstX] = nDstX;
       y1[nDstX] = nDstY;
@@ -632,7 +656,7 @@ msAverageRasterResampler(imageObj *psSrcImage, rasterBufferObj *src_rb,
             nFailedPoints, nSetPoints);
   }
 
-  return 0;
+  return status;
 }
 
 /************************************************************************/
@@ -735,11 +759,16 @@ void msFreeProjTransformer(void *pCBData)
 }
 
 /************************************************************************/
-/*                          msProjTransformer                           */
+/*                      msProjTransformerToGeoref()                     */
+/*                                                                      */
+/*      Transform destination pixel/line coordinates into               */
+/*      georeferenced coordinates of the source projection.  Points     */
+/*      that fail to transform are flagged in panSuccess and left at    */
+/*      HUGE_VAL.                                                       */
 /************************************************************************/
 
-int msProjTransformer(void *pCBData, int nPoints, double *x, double *y,
-                      int *panSuccess)
+static int msProjTransformerToGeoref(void *pCBData, int nPoints, double *x,
+                                     double *y, int *panSuccess)
 
 {
   int i;
@@ -775,9 +804,24 @@ int msProjTransformer(void *pCBData, int nPoints, double *x, double *y,
     }
   }
 
-  /* -------------------------------------------------------------------- */
-  /*      Transform to source raster space.                               */
-  /* -------------------------------------------------------------------- */
+  return 1;
+}
+
+/************************************************************************/
+/*                     msProjTransformerFromGeoref()                    */
+/*                                                                      */
+/*      Apply the inverse source geotransform to the output of          */
+/*      msProjTransformerToGeoref().                                    */
+/************************************************************************/
+
+static void msProjTransformerFromGeoref(msProjTransformInfo *psPTInfo,
+                                        int nPoints, double *x, double *y,
+                                        int *panSuccess)
+
+{
+  int i;
+  double x_out;
+
   for (i = 0; i < nPoints; i++) {
     if (panSuccess[i]) {
       x_out = psPTInfo->adfInvSrcGeoTransform[0] +
@@ -792,6 +836,25 @@ int msProjTransformer(void *pCBData, int nPoints, double *x, double *y,
       y[i] = -1;
     }
   }
+}
+
+/************************************************************************/
+/*                          msProjTransformer                           */
+/************************************************************************/
+
+int msProjTransformer(void *pCBData, int nPoints, double *x, double *y,
+                      int *panSuccess)
+
+{
+  msProjTransformInfo *psPTInfo = (msProjTransformInfo *)pCBData;
+
+  if (!msProjTransformerToGeoref(pCBData, nPoints, x, y, panSuccess))
+    return MS_FALSE;
+
+  /* -------------------------------------------------------------------- */
+  /*      Transform to source raster space.                               */
+  /* -------------------------------------------------------------------- */
+  msProjTransformerFromGeoref(psPTInfo, nPoints, x, y, panSuccess);
 
   return 1;
 }
@@ -807,6 +870,11 @@ typedef struct {
   void *pBaseCBData;
 
   double dfMaxError;
+
+  /* Linear part of the transformation from the base transformer output */
+  /* space to the space in which dfMaxError is expressed. Identity when  */
+  /* the base transformer already outputs source pixel/line coordinates. */
+  double adfErrorScale[4];
 } msApproxTransformInfo;
 
 /************************************************************************/
@@ -824,6 +892,10 @@ static void *msInitApproxTransformer(SimpleTransformer pfnBaseTransformer,
   psATInfo->pfnBaseTransformer = pfnBaseTransformer;
   psATInfo->pBaseCBData = pBaseCBData;
   psATInfo->dfMaxError = dfMaxError;
+  psATInfo->adfErrorScale[0] = 1.0;
+  psATInfo->adfErrorScale[1] = 0.0;
+  psATInfo->adfErrorScale[2] = 0.0;
+  psATInfo->adfErrorScale[3] = 1.0;
 
   return psATInfo;
 }
@@ -847,7 +919,8 @@ static int msApproxTransformer(void *pCBData, int nPoints, double *x, double *y,
 
 {
   msApproxTransformInfo *psATInfo = (msApproxTransformInfo *)pCBData;
-  double x2[3], y2[3], dfDeltaX, dfDeltaY, dfError, dfDist;
+  double x2[3], y2[3], dfDeltaX, dfDeltaY, dfDist;
+  double dfError, dfErrorX, dfErrorY;
   int nMiddle, anSuccess2[3], i, bSuccess;
 
   nMiddle = (nPoints - 1) / 2;
@@ -885,8 +958,12 @@ static int msApproxTransformer(void *pCBData, int nPoints, double *x, double *y,
   dfDeltaX = (x2[2] - x2[0]) / (x[nPoints - 1] - x[0]);
   dfDeltaY = (y2[2] - y2[0]) / (x[nPoints - 1] - x[0]);
 
-  dfError = fabs((x2[0] + dfDeltaX * (x[nMiddle] - x[0])) - x2[1]) +
-            fabs((y2[0] + dfDeltaY * (x[nMiddle] - x[0])) - y2[1]);
+  dfErrorX = (x2[0] + dfDeltaX * (x[nMiddle] - x[0])) - x2[1];
+  dfErrorY = (y2[0] + dfDeltaY * (x[nMiddle] - x[0])) - y2[1];
+  dfError = fabs(psATInfo->adfErrorScale[0] * dfErrorX +
+                 psATInfo->adfErrorScale[1] * dfErrorY) +
+            fabs(psATInfo->adfErrorScale[2] * dfErrorX +
+                 psATInfo->adfErrorScale[3] * dfErrorY);
 
   if (dfError > psATInfo->dfMaxError) {
     bSuccess = msApproxTransformer(psATInfo, nMiddle, x, y, panSuccess);
@@ -920,6 +997,462 @@ static int msApproxTransformer(void *pCBData, int nPoints, double *x, double *y,
   return 1;
 }
 
+/************************************************************************/
+/* ==================================================================== */
+/*      Reprojection grid cache.                                        */
+/*                                                                      */
+/*      The approximate transformer output for a whole destination      */
+/*      grid, expressed as georeferenced coordinates in the source      */
+/*      projection, only depends on the two projections, the           */
+/*      destination geotransform and size, and the approximation        */
+/*      error budget.  Successive requests for the same tile can thus   */
+/*      reuse it and skip nearly all the PROJ calls.  Grids are kept    */
+/*      in a process wide LRU list bounded by                           */
+/*      MS_RESAMPLE_GRID_CACHE_SIZE (in megabytes, 0 to disable).       */
+/* ==================================================================== */
+/************************************************************************/
+
+#define MS_RESAMPLE_GRID_CACHE_DEFAULT_SIZE 32
+
+typedef struct msReprojGridObj msReprojGridObj;
+
+struct msReprojGridObj {
+  char *pszSrcProj;
+  char *pszDstProj;
+  double adfDstGeoTransform[6];
+  double adfErrorScale[4];
+  double dfMaxError;
+  double dfOffset; /* 0.5 for pixel centers, 0.0 for pixel corners */
+  int nXSize;      /* number of points per row */
+  int nYSize;      /* number of rows */
+
+  double *padfX;
+  double *padfY;
+  unsigned char *pabySuccess;
+  unsigned char *pabyRowDone; /* NULL once the grid is complete */
+  size_t nBytes;
+
+  int nRefCount;
+  msReprojGridObj *psPrev;
+  msReprojGridObj *psNext;
+};
+
+static msReprojGridObj *psGridCacheHead = NULL;
+static msReprojGridObj *psGridCacheTail = NULL;
+static size_t nGridCacheBytes = 0;
+
+/************************************************************************/
+/*                      msResampleGridCacheMaxBytes()                   */
+/************************************************************************/
+
+static size_t msResampleGridCacheMaxBytes(void)
+
+{
+  const char *pszSize = CPLGetConfigOption("MS_RESAMPLE_GRID_CACHE_SIZE", NULL);
+  int nSizeMB = MS_RESAMPLE_GRID_CACHE_DEFAULT_SIZE;
+
+  if (pszSize != NULL)
+    nSizeMB = atoi(pszSize);
+
+  if (nSizeMB <= 0)
+    return 0;
+
+  return (size_t)nSizeMB * 1024 * 1024;
+}
+
+/************************************************************************/
+/*                          msFreeReprojGrid()                          */
+/************************************************************************/
+
+static void msFreeReprojGrid(msReprojGridObj *psGrid)
+
+{
+  if (psGrid == NULL)
+    return;
+  msFree(psGrid->pszSrcProj);
+  msFree(psGrid->pszDstProj);
+  msFree(psGrid->padfX);
+  msFree(psGrid->padfY);
+  msFree(psGrid->pabySuccess);
+  msFree(psGrid->pabyRowDone);
+  msFree(psGrid);
+}
+
+/************************************************************************/
+/*                     msReprojGridCacheUnlink()                        */
+/*                                                                      */
+/*      Must be called with TLOCK_RESAMPLE held.                        */
+/************************************************************************/
+
+static void msReprojGridCacheUnlink(msReprojGridObj *psGrid)
+
+{
+  if (psGrid->psPrev)
+    psGrid->psPrev->psNext = psGrid->psNext;
+  else
+    psGridCacheHead = psGrid->psNext;
+  if (psGrid->psNext)
+    psGrid->psNext->psPrev = psGrid->psPrev;
+  else
+    psGridCacheTail = psGrid->psPrev;
+  psGrid->psPrev = psGrid->psNext = NULL;
+  nGridCacheBytes -= psGrid->nBytes;
+}
+
+/************************************************************************/
+/*                      msReprojGridMatchesKey()                        */
+/************************************************************************/
+
+static int msReprojGridMatchesKey(const msReprojGridObj *psGrid,
+                                  const msReprojGridObj *psKey)
+
+{
+  return psGrid->nXSize == psKey->nXSize && psGrid->nYSize == psKey->nYSize &&
+         psGrid->dfOffset == psKey->dfOffset &&
+         psGrid->dfMaxError == psKey->dfMaxError &&
+         memcmp(psGrid->adfDstGeoTransform, psKey->adfDstGeoTransform,
+                sizeof(psKey->adfDstGeoTransform)) == 0 &&
+         memcmp(psGrid->adfErrorScale, psKey->adfErrorScale,
+                sizeof(psKey->adfErrorScale)) == 0 &&
+         strcmp(psGrid->pszSrcProj, psKey->pszSrcProj) == 0 &&
+         strcmp(psGrid->pszDstProj, psKey->pszDstProj) == 0;
+}
+
+/************************************************************************/
+/*                        msReprojGridCacheGet()                        */
+/*                                                                      */
+/*      Return a referenced cached grid matching the key, or NULL.      */
+/************************************************************************/
+
+static msReprojGridObj *msReprojGridCacheGet(const msReprojGridObj *psKey)
+
+{
+  msReprojGridObj *psGrid;
+
+  msAcquireLock(TLOCK_RESAMPLE);
+  for (psGrid = psGridCacheHead; psGrid != NULL; psGrid = psGrid->psNext) {
+    if (msReprojGridMatchesKey(psGrid, psKey)) {
+      /* Move to the head of the LRU list */
+      if (psGrid != psGridCacheHead) {
+        msReprojGridCacheUnlink(psGrid);
+        psGrid->psNext = psGridCacheHead;
+        psGridCacheHead->psPrev = psGrid;
+        psGridCacheHead = psGrid;
+        nGridCacheBytes += psGrid->nBytes;
+      }
+      psGrid->nRefCount++;
+      break;
+    }
+  }
+  msReleaseLock(TLOCK_RESAMPLE);
+
+  return psGrid;
+}
+
+/************************************************************************/
+/*                      msReprojGridCacheRelease()                      */
+/*                                                                      */
+/*      Drop a reference on a grid. Grids no longer referenced and      */
+/*      no longer in the cache are destroyed.                           */
+/************************************************************************/
+
+static void msReprojGridCacheRelease(msReprojGridObj *psGrid)
+
+{
+  int bFree;
+
+  msAcquireLock(TLOCK_RESAMPLE);
+  psGrid->nRefCount--;
+  bFree = (psGrid->nRefCount == 0 && psGrid->psPrev == NULL &&
+           psGrid != psGridCacheHead);
+  msReleaseLock(TLOCK_RESAMPLE);
+
+  if (bFree)
+    msFreeReprojGrid(psGrid);
+}
+
+/************************************************************************/
+/*                        msReprojGridCacheAdd()                        */
+/*                                                                      */
+/*      Insert a completed grid at the head of the cache, evicting      */
+/*      least recently used grids to honour the size limit.  The        */
+/*      grid is destroyed if it cannot be cached.                       */
+/************************************************************************/
+
+static void msReprojGridCacheAdd(msReprojGridObj *psGrid)
+
+{
+  size_t nMaxBytes = msResampleGridCacheMaxBytes();
+  msReprojGridObj *psEvicted = NULL;
+
+  if (psGrid->nBytes > nMaxBytes) {
+    msFreeReprojGrid(psGrid);
+    return;
+  }
+
+  msAcquireLock(TLOCK_RESAMPLE);
+
+  /* Another request may have computed the same grid in the meantime */
+  {
+    msReprojGridObj *psIter;
+    for (psIter = psGridCacheHead; psIter != NULL; psIter = psIter->psNext) {
+      if (msReprojGridMatchesKey(psIter, psGrid))
+        break;
+    }
+    if (psIter != NULL) {
+      msReleaseLock(TLOCK_RESAMPLE);
+      msFreeReprojGrid(psGrid);
+      return;
+    }
+  }
+
+  while (psGridCacheTail != NULL &&
+         nGridCacheBytes + psGrid->nBytes > nMaxBytes) {
+    msReprojGridObj *psLast = psGridCacheTail;
+    msReprojGridCacheUnlink(psLast);
+    if (psLast->nRefCount == 0) {
+      psLast->psNext = psEvicted;
+      psEvicted = psLast;
+    }
+  }
+
+  psGrid->nRefCount = 0;
+  psGrid->psPrev = NULL;
+  psGrid->psNext = psGridCacheHead;
+  if (psGridCacheHead)
+    psGridCacheHead->psPrev = psGrid;
+  else
+    psGridCacheTail = psGrid;
+  psGridCacheHead = psGrid;
+  nGridCacheBytes += psGrid->nBytes;
+
+  msReleaseLock(TLOCK_RESAMPLE);
+
+  while (psEvicted != NULL) {
+    msReprojGridObj *psNext = psEvicted->psNext;
+    msFreeReprojGrid(psEvicted);
+    psEvicted = psNext;
+  }
+}
+
+/************************************************************************/
+/*                     msResampleGridCacheCleanup()                     */
+/************************************************************************/
+
+void msResampleGridCacheCleanup(void)
+
+{
+  msAcquireLock(TLOCK_RESAMPLE);
+  while (psGridCacheHead != NULL) {
+    msReprojGridObj *psGrid = psGridCacheHead;
+    msReprojGridCacheUnlink(psGrid);
+    /* Grids still in use are destroyed by their last user */
+    if (psGrid->nRefCount == 0)
+      msFreeReprojGrid(psGrid);
+  }
+  msReleaseLock(TLOCK_RESAMPLE);
+}
+
+/************************************************************************/
+/* ==================================================================== */
+/*      Grid caching transformer.                                       */
+/*                                                                      */
+/*      Wraps an approximate transformer working in source              */
+/*      georeferenced space.  Whole destination rows are served         */
+/*      from, or recorded into, a msReprojGridObj, and then             */
+/*      converted to source pixel/line space.                           */
+/* ==================================================================== */
+/************************************************************************/
+
+typedef struct {
+  msProjTransformInfo *psPTInfo;
+  void *pGeorefApproxCBData;
+  msReprojGridObj *psGrid;
+  int bGridFromCache;
+} msGridCacheTransformInfo;
+
+/************************************************************************/
+/*                    msInitGridCacheTransformer()                      */
+/*                                                                      */
+/*      Returns NULL if grid caching is disabled or does not apply,     */
+/*      in which case the caller should use the plain approximate       */
+/*      transformer.                                                    */
+/************************************************************************/
+
+static void *msInitGridCacheTransformer(void *pProjCBData, double dfOffset,
+                                        int nXSize, int nYSize,
+                                        double dfMaxError)
+
+{
+  msProjTransformInfo *psPTInfo = (msProjTransformInfo *)pProjCBData;
+  msGridCacheTransformInfo *psGCInfo;
+  msApproxTransformInfo *psATInfo;
+  msReprojGridObj sKey, *psGrid;
+  size_t nPoints;
+
+  if (!psPTInfo->bUseProj || nXSize <= 0 || nYSize <= 0 ||
+      msResampleGridCacheMaxBytes() == 0)
+    return NULL;
+
+  memset(&sKey, 0, sizeof(sKey));
+  sKey.pszSrcProj = msGetProjectionString(psPTInfo->psSrcProjObj);
+  sKey.pszDstProj = msGetProjectionString(psPTInfo->psDstProjObj);
+  memcpy(sKey.adfDstGeoTransform, psPTInfo->adfDstGeoTransform,
+         sizeof(sKey.adfDstGeoTransform));
+  sKey.adfErrorScale[0] = psPTInfo->adfInvSrcGeoTransform[1];
+  sKey.adfErrorScale[1] = psPTInfo->adfInvSrcGeoTransform[2];
+  sKey.adfErrorScale[2] = psPTInfo->adfInvSrcGeoTransform[4];
+  sKey.adfErrorScale[3] = psPTInfo->adfInvSrcGeoTransform[5];
+  sKey.dfMaxError = dfMaxError;
+  sKey.dfOffset = dfOffset;
+  sKey.nXSize = nXSize;
+  sKey.nYSize = nYSize;
+
+  if (sKey.pszSrcProj == NULL || sKey.pszDstProj == NULL) {
+    msFree(sKey.pszSrcProj);
+    msFree(sKey.pszDstProj);
+    return NULL;
+  }
+
+  psGCInfo = (msGridCacheTransformInfo *)msSmallCalloc(
+      1, sizeof(msGridCacheTransformInfo));
+  psGCInfo->psPTInfo = psPTInfo;
+
+  /* The approximation is done in source georeferenced space, but its */
+  /* error is still measured in source pixels, so that the result     */
+  /* does not depend on whether the grid comes from the cache or not. */
+  psATInfo = (msApproxTransformInfo *)msInitApproxTransformer(
+      msProjTransformerToGeoref, pProjCBData, dfMaxError);
+  memcpy(psATInfo->adfErrorScale, sKey.adfErrorScale,
+         sizeof(sKey.adfErrorScale));
+  psGCInfo->pGeorefApproxCBData = psATInfo;
+
+  psGrid = msReprojGridCacheGet(&sKey);
+  if (psGrid != NULL) {
+    msFree(sKey.pszSrcProj);
+    msFree(sKey.pszDstProj);
+    psGCInfo->psGrid = psGrid;
+    psGCInfo->bGridFromCache = MS_TRUE;
+    return psGCInfo;
+  }
+
+  nPoints = (size_t)nXSize * nYSize;
+  psGrid = (msReprojGridObj *)msSmallMalloc(sizeof(msReprojGridObj));
+  memcpy(psGrid, &sKey, sizeof(sKey));
+  psGrid->padfX = (double *)malloc(sizeof(double) * nPoints);
+  psGrid->padfY = (double *)malloc(sizeof(double) * nPoints);
+  psGrid->pabySuccess = (unsigned char *)malloc(nPoints);
+  psGrid->pabyRowDone = (unsigned char *)calloc(nYSize, 1);
+  psGrid->nBytes = sizeof(msReprojGridObj) + nPoints * (2 * sizeof(double) + 1);
+  if (psGrid->padfX == NULL || psGrid->padfY == NULL ||
+      psGrid->pabySuccess == NULL || psGrid->pabyRowDone == NULL) {
+    /* Not fatal: just proceed without caching */
+    msFreeReprojGrid(psGrid);
+    psGrid = NULL;
+  }
+  psGCInfo->psGrid = psGrid;
+
+  return psGCInfo;
+}
+
+/************************************************************************/
+/*                    msFreeGridCacheTransformer()                      */
+/************************************************************************/
+
+static void msFreeGridCacheTransformer(void *pCBData)
+
+{
+  msGridCacheTransformInfo *psGCInfo = (msGridCacheTransformInfo *)pCBData;
+  msReprojGridObj *psGrid;
+
+  if (psGCInfo == NULL)
+    return;
+
+  psGrid = psGCInfo->psGrid;
+  if (psGrid != NULL) {
+    if (psGCInfo->bGridFromCache)
+      msReprojGridCacheRelease(psGrid);
+    else {
+      /* Only publish grids for which all rows have been computed */
+      int iRow;
+      for (iRow = 0; iRow < psGrid->nYSize; iRow++) {
+        if (!psGrid->pabyRowDone[iRow])
+          break;
+      }
+      if (iRow == psGrid->nYSize) {
+        msFree(psGrid->pabyRowDone);
+        psGrid->pabyRowDone = NULL;
+        msReprojGridCacheAdd(psGrid);
+      } else
+        msFreeReprojGrid(psGrid);
+    }
+  }
+
+  msFreeApproxTransformer(psGCInfo->pGeorefApproxCBData);
+  free(psGCInfo);
+}
+
+/************************************************************************/
+/*                        msGridCacheTransformer                        */
+/************************************************************************/
+
+static int msGridCacheTransformer(void *pCBData, int nPoints, double *x,
+                                  double *y, int *panSuccess)
+
+{
+  msGridCacheTransformInfo *psGCInfo = (msGridCacheTransformInfo *)pCBData;
+  msReprojGridObj *psGrid = psGCInfo->psGrid;
+  int i, iRow = -1;
+  size_t nRowOffset;
+
+  /* -------------------------------------------------------------------- */
+  /*      Is this a full row of our grid?                                 */
+  /* -------------------------------------------------------------------- */
+  if (psGrid != NULL && nPoints == psGrid->nXSize) {
+    double dfRow = y[0] - psGrid->dfOffset;
+    if (dfRow >= 0 && dfRow < psGrid->nYSize && dfRow == (int)dfRow) {
+      iRow = (int)dfRow;
+      for (i = 0; i < nPoints; i++) {
+        if (x[i] != psGrid->dfOffset + i || y[i] != y[0]) {
+          iRow = -1;
+          break;
+        }
+      }
+    }
+  }
+
+  if (iRow < 0) {
+    if (!msApproxTransformer(psGCInfo->pGeorefApproxCBData, nPoints, x, y,
+                             panSuccess))
+      return MS_FALSE;
+    msProjTransformerFromGeoref(psGCInfo->psPTInfo, nPoints, x, y,
+                                panSuccess);
+    return 1;
+  }
+
+  nRowOffset = (size_t)iRow * psGrid->nXSize;
+  if (psGrid->pabyRowDone == NULL || psGrid->pabyRowDone[iRow]) {
+    memcpy(x, psGrid->padfX + nRowOffset, sizeof(double) * nPoints);
+    memcpy(y, psGrid->padfY + nRowOffset, sizeof(double) * nPoints);
+    for (i = 0; i < nPoints; i++)
+      panSuccess[i] = psGrid->pabySuccess[nRowOffset + i];
+  } else {
+    /* The return value is not needed here: failed points are flagged */
+    /* in panSuccess. */
+    msApproxTransformer(psGCInfo->pGeorefApproxCBData, nPoints, x, y,
+                        panSuccess);
+    memcpy(psGrid->padfX + nRowOffset, x, sizeof(double) * nPoints);
+    memcpy(psGrid->padfY + nRowOffset, y, sizeof(double) * nPoints);
+    for (i = 0; i < nPoints; i++)
+      psGrid->pabySuccess[nRowOffset + i] = (unsigned char)panSuccess[i];
+    psGrid->pabyRowDone[iRow] = 1;
+  }
+
+  msProjTransformerFromGeoref(psGCInfo->psPTInfo, nPoints, x, y, panSuccess);
+
+  return 1;
+}
+
 /************************************************************************/
 /*                       msTransformMapToSource()                       */
 /*                                                                      */
@@ -1194,6 +1727,8 @@ int msResampleGDALToMap(mapObj *map, layerObj *layer, imageObj *image,
   imageObj *srcImage;
   void *pTCBData;
   void *pACBData;
+  void *pGCBData = NULL;
+  SimpleTransformer pfnTransformer = msApproxTransformer;
   char **papszAlteredProcessing = NULL;
   int nLoadImgXSize, nLoadImgYSize;
   double dfOversampleRatio;
@@ -1609,6 +2144,28 @@ int msResampleGDALToMap(mapObj *map, layerObj *layer, imageObj *image,
   /* -------------------------------------------------------------------- */
   pACBData = msInitApproxTransformer(msProjTransformer, pTCBData, 0.333);
 
+  /* -------------------------------------------------------------------- */
+  /*      When reprojecting, try to reuse the grid computed by a          */
+  /*      previous request for the same destination image.  The           */
+  /*      average resampler samples pixel corners, the others pixel       */
+  /*      centers.                                                        */
+  /* -------------------------------------------------------------------- */
+  if (EQUAL(resampleMode, "AVERAGE"))
+    pGCBData = msInitGridCacheTransformer(pTCBData, 0.0, nDstXSize + 1,
+                                          nDstYSize + 1, 0.333);
+  else
+    pGCBData =
+        msInitGridCacheTransformer(pTCBData, 0.5, nDstXSize, nDstYSize, 0.333);
+
+  if (pGCBData != NULL) {
+    if (layer->debug)
+      msDebug("msResampleGDALToMap(): %s reprojection grid.\n",
+              ((msGridCacheTransformInfo *)pGCBData)->bGridFromCache
+                  ? "Reusing cached"
+                  : "Computing");
+    pfnTransformer = msGridCacheTransformer;
+  }
+
   if (msProjIsGeographicCRS(&(layer->projection))) {
     /* Does the raster cover a whole 360 deg range ? */
     if (nSrcXSize == (int)(adfInvSrcGeoTransform[1] * 360 + 0.5))
@@ -1618,18 +2175,23 @@ int msResampleGDALToMap(mapObj *map, layerObj *layer, imageObj *image,
   /* -------------------------------------------------------------------- */
   /*      Perform the resampling.                                         */
   /* -------------------------------------------------------------------- */
+  if (pGCBData != NULL) {
+    msFreeApproxTransformer(pACBData);
+    pACBData = pGCBData;
+  }
+
   if (EQUAL(resampleMode, "AVERAGE"))
     result = msAverageRasterResampler(srcImage, psrc_rb, image, rb,
-                                      msApproxTransformer, pACBData,
-                                      layer->debug, mask_rb);
+                                      pfnTransformer, pACBData, layer->debug,
+                                      mask_rb, map);
   else if (EQUAL(resampleMode, "BILINEAR"))
     result = msBilinearRasterResampler(srcImage, psrc_rb, image, rb,
-                                       msApproxTransformer, pACBData,
-                                       layer->debug, mask_rb, bWrapAtLeftRight);
+                                       pfnTransformer, pACBData, layer->debug,
+                                       mask_rb, bWrapAtLeftRight, map);
   else
     result = msNearestRasterResampler(srcImage, psrc_rb, image, rb,
-                                      msApproxTransformer, pACBData,
-                                      layer->debug, mask_rb, bWrapAtLeftRight);
+                                      pfnTransformer, pACBData, layer->debug,
+                                      mask_rb, bWrapAtLeftRight, map);
 
   /* -------------------------------------------------------------------- */
   /*      cleanup                                                         */
@@ -1640,8 +2202,11 @@ int msResampleGDALToMap(mapObj *map, layerObj *layer, imageObj *image,
     msFreeRasterBuffer(psrc_rb);
   msFreeImage(srcImage);
 
+  if (pGCBData != NULL)
+    msFreeGridCacheTransformer(pGCBData);
+  else
+    msFreeApproxTransformer(pACBData);
   msFreeProjTransformer(pTCBData);
-  msFreeApproxTransformer(pACBData);
 
   return result;
 }
@@ -177,6 +177,10 @@ imageObj *msDrawScalebar(mapObj *map) {
   strokeStyle.patternlength = 0;
   initTextSymbol(&ts);
 
+  /* unless embedded in a map whose labels still reference glyphs */
+  if (msLabelCacheIsEmpty(&(map->labelcache)))
+    msFontCacheQuiesce();
+
   if ((int)map->units == -1) {
     msSetError(MS_MISCERR, "Map units not set.", "msDrawScalebar()");
     return (NULL);
@@ -137,6 +137,8 @@
   /// logical or string expression. Returns :data:`MS_SUCCESS` or :data:`MS_FAILURE`
   int setExpression(char *expression) 
   {
+    if (self->layer)
+       msLayerFreeClassDispatch(self->layer);
     if (!expression || strlen(expression) == 0) {
        msFreeExpression(&self->expression);
        return MS_SUCCESS;
@@ -187,6 +187,16 @@
         return msMapSetRotation( self, rotation_angle );
     }
 
+    /**
+    Give the map a time budget of *seconds* from now. Drawing, labelling, raster 
+    resampling and queries fail with a :data:`MS_TIMEOUTERR` once it is exhausted. 
+    A value <= 0 removes the limit.
+    */
+    void setTimeout(double seconds)
+    {
+        msMapSetTimeout(self, seconds);
+    }
+
     %newobject getLayer;
     /// Returns a reference to the layer at index *i*.
     layerObj *getLayer(int i) {
@@ -303,6 +303,8 @@
         {
             msFree(self->values[i]);
             self->values[i] = msStrdup(value);
+            if (i < self->numtypedvalues)
+                self->typedvalues[i].type = MS_ATTRIBUTE_UNKNOWN;
             if (!self->values[i])
             {
                 return MS_FAILURE;
@@ -325,6 +327,7 @@
         if(self->values) msFreeCharArray(self->values, self->numvalues);
         self->values = NULL;
         self->numvalues = 0;
+        msShapeAllocTypedValues(self, 0);
         
         /* Allocate memory for the values */
         if (numvalues > 0) {
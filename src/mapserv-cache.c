@@ -0,0 +1,834 @@
+/******************************************************************************
+ * $Id$
+ *
+ * Project:  MapServer
+ * Purpose:  Rendered response cache for mapserv.
+ * Author:   MapServer Project
+ *
+ ******************************************************************************
+ * Copyright (c) 2026, MapServer Project
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies of this Software or works derived from this Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ ****************************************************************************/
+
+/*
+** Cache of the complete responses (headers and body, as written through
+** msIO) of idempotent GET requests: GetCapabilities, WMS GetMap and
+** GetLegendGraphic, WMTS style GetTile and the map, tile and legend CGI
+** modes. Responses are keyed on the normalized request parameters, the
+** server variables used to build online resource URLs, the mapfile path,
+** size and modification time, and the modification time of the file based
+** data of the requested layers. Files INCLUDEd by the mapfile are not
+** tracked. Cookies are left out of the key, unless the mapfile validates
+** them for runtime substitution or a requested WMS or WFS layer forwards
+** them to the cascaded server.
+**
+** MS_RESPONSE_CACHE selects the storage: MEMORY is an LRU private to the
+** process, DISK a directory (MS_RESPONSE_CACHE_DIR) that can be shared by
+** several processes. MS_RESPONSE_CACHE_SIZE bounds the size of either, and
+** of any single response stored, to 1/8th of it. Disk entries only hold a
+** SHA-256 digest of their key, not the key itself. The disk cache is swept
+** from time to time: expired entries are removed, then the oldest ones
+** until it fits. Entries live MS_RESPONSE_CACHE_TTL
+** seconds (default 300), overridden by the "cache_ttl" metadata of the map
+** WEB object, and lowered to the smallest "cache_ttl" metadata of the
+** requested layers. A TTL of 0 disables caching.
+**
+** With MS_CONDITIONAL_GET set, the same key also provides the ETag and the
+** Last-Modified date sent with these responses, so that a request carrying
+** a matching If-None-Match (or, without one, an If-Modified-Since date not
+** older than the data) is answered with a 304 before the map is rendered.
+** As changes to database or remote data would go unnoticed, no validators
+** are sent when a requested layer is not a shapefile, raster or inline one.
+*/
+
+#include <time.h>
+
+#include "mapserver.h"
+#include "apps/mapserv.h"
+#include "mapows.h"
+#include "mapthread.h"
+#include "uthash.h"
+
+#include "cpl_conv.h"
+#include "cpl_sha256.h"
+#include "cpl_time.h"
+#include "cpl_string.h"
+#include "cpl_vsi.h"
+
+#define MS_RESPONSE_CACHE_MAGIC "MSRESPONSECACHE2\n"
+
+typedef struct responseCacheEntry {
+  char *key;
+  unsigned char *data;
+  size_t size;
+  time_t expires;
+  struct responseCacheEntry *prev, *next; /* LRU, most recent first */
+  UT_hash_handle hh;
+} responseCacheEntry;
+
+struct responseCacheRequest {
+  char *key;
+  int ttl;       /* 0 when the response is not to be stored */
+  char *headers; /* ETag and Last-Modified, if any */
+  msIOContext *old_context;
+};
+
+static responseCacheEntry *responseCacheHash = NULL;
+static responseCacheEntry *responseCacheHead = NULL;
+static responseCacheEntry *responseCacheTail = NULL;
+static size_t responseCacheBytes = 0;
+static time_t responseCacheLastSweep = 0;
+
+static size_t msResponseCacheMaxSize(void) {
+  const char *size = CPLGetConfigOption("MS_RESPONSE_CACHE_SIZE", "67108864");
+  return (size_t)CPLAtoGIntBig(size);
+}
+
+static const char *msResponseCacheGetParam(mapservObj *mapserv,
+                                           const char *name) {
+  for (int i = 0; i < mapserv->request->NumParams; i++) {
+    if (strcasecmp(mapserv->request->ParamNames[i], name) == 0)
+      return mapserv->request->ParamValues[i];
+  }
+  return NULL;
+}
+
+/* Is this a request whose response only depends on its parameters? */
+static int msResponseCacheIsCacheable(mapservObj *mapserv) {
+  const char *method = msIO_getenv("REQUEST_METHOD");
+  const char *request, *mode;
+
+  if (!method || strcmp(method, "GET") != 0 ||
+      mapserv->request->api_path_length > 1)
+    return MS_FALSE;
+
+  request = msResponseCacheGetParam(mapserv, "REQUEST");
+  if (request)
+    return strcasecmp(request, "GetCapabilities") == 0 ||
+           strcasecmp(request, "GetMap") == 0 ||
+           strcasecmp(request, "GetTile") == 0 ||
+           strcasecmp(request, "GetLegendGraphic") == 0;
+
+  mode = msResponseCacheGetParam(mapserv, "MODE");
+  return mode && (strcasecmp(mode, "map") == 0 ||
+                  strcasecmp(mode, "tile") == 0 ||
+                  strcasecmp(mode, "legend") == 0);
+}
+
+static int msResponseCacheParseTTL(hashTableObj *metadata, int ttl) {
+  const char *value = msLookupHashTable(metadata, "cache_ttl");
+  return value ? atoi(value) : ttl;
+}
+
+/* Modification time of a file based data source, 0 if unknown. */
+static time_t msResponseCacheGetDataTime(mapObj *map, const char *data,
+                                         int shapefile) {
+  char path[MS_MAXPATHLEN], *shp;
+  VSIStatBufL stat;
+  time_t mtime = 0;
+
+  if (!data || !*data)
+    return 0;
+  msBuildPath3(path, map->mappath, map->shapepath, data);
+  if (VSIStatL(path, &stat) == 0)
+    return stat.st_mtime;
+  if (shapefile) {
+    shp = msStringConcatenate(msStrdup(path), ".shp");
+    if (VSIStatL(shp, &stat) == 0)
+      mtime = stat.st_mtime;
+    free(shp);
+  }
+  return mtime;
+}
+
+/*
+** Walks the DEFAULT layers and the layers (or groups) named by LAYERS or
+** LAYER. The TTL of a response is the map default lowered to the smallest
+** TTL of these layers, *mtime is set to the most recent modification time of
+** their shapefile, raster or tile index files. Database backed layers are
+** not looked at: *filebased is cleared if one of them is such a layer, and
+** *forwardcookies set if one of them is a WMS or WFS client forwarding the
+** cookies of the client ("http_cookie" metadata set to "forward").
+*/
+static int msResponseCacheScanLayers(mapservObj *mapserv, time_t *mtime,
+                                     int *filebased, int *forwardcookies) {
+  mapObj *map = mapserv->map;
+  const char *names = msResponseCacheGetParam(mapserv, "LAYERS");
+  char **tokens = NULL;
+  int numtokens = 0, ttl;
+
+  *mtime = 0;
+  *filebased = MS_TRUE;
+  *forwardcookies = MS_FALSE;
+  ttl = atoi(CPLGetConfigOption("MS_RESPONSE_CACHE_TTL", "300"));
+  ttl = msResponseCacheParseTTL(&(map->web.metadata), ttl);
+
+  if (!names)
+    names = msResponseCacheGetParam(mapserv, "LAYER");
+  if (names)
+    tokens = msStringSplit(names, ',', &numtokens);
+
+  for (int i = 0; i < map->numlayers; i++) {
+    layerObj *layer = GET_LAYER(map, i);
+    int requested = (layer->status == MS_DEFAULT);
+    for (int j = 0; j < numtokens && !requested; j++) {
+      requested = (layer->name && strcasecmp(layer->name, tokens[j]) == 0) ||
+                  (layer->group && strcasecmp(layer->group, tokens[j]) == 0);
+    }
+    if (!requested)
+      continue;
+    ttl = MS_MIN(ttl, msResponseCacheParseTTL(&(layer->metadata), ttl));
+    if (layer->connectiontype == MS_WMS || layer->connectiontype == MS_WFS) {
+      const char *ns = layer->connectiontype == MS_WMS ? "MO" : "FO";
+      const char *cookie =
+          msOWSLookupMetadata(&(layer->metadata), ns, "http_cookie");
+      if (!cookie)
+        cookie = msOWSLookupMetadata(&(map->web.metadata), ns, "http_cookie");
+      if (cookie && strcasecmp(cookie, "forward") == 0)
+        *forwardcookies = MS_TRUE;
+    }
+    if (layer->connectiontype == MS_SHAPEFILE ||
+        layer->connectiontype == MS_TILED_SHAPEFILE ||
+        layer->connectiontype == MS_RASTER) {
+      const int shapefile = layer->connectiontype != MS_RASTER;
+      *mtime = MS_MAX(*mtime,
+                      msResponseCacheGetDataTime(map, layer->data, shapefile));
+      *mtime = MS_MAX(*mtime, msResponseCacheGetDataTime(map, layer->tileindex,
+                                                         MS_TRUE));
+    } else if (layer->connectiontype != MS_INLINE) {
+      *filebased = MS_FALSE;
+    }
+  }
+
+  msFreeCharArray(tokens, numtokens);
+  return ttl;
+}
+
+/* Path of the mapfile, resolved the same way as in msCGILoadMap(). */
+static const char *msResponseCacheGetMapfile(mapservObj *mapserv,
+                                             configObj *config,
+                                             char *pathBuf) {
+  const char *map_value = msResponseCacheGetParam(mapserv, "MAP");
+
+  if (!map_value)
+    return CPLGetConfigOption("MS_MAPFILE", NULL);
+  if (msConfigGetMap(config, map_value, pathBuf))
+    return pathBuf;
+  return map_value;
+}
+
+static int msResponseCacheCompareParams(const void *a, const void *b) {
+  const char *const *pa = (const char *const *)a;
+  const char *const *pb = (const char *const *)b;
+  int ret = strcasecmp(pa[0], pb[0]);
+  return ret ? ret : strcmp(pa[1] ? pa[1] : "", pb[1] ? pb[1] : "");
+}
+
+/* Is a cookie validated, and so substituted, by the map, a layer or class? */
+static int msResponseCacheIsValidated(mapObj *map, const char *name) {
+  if (msLookupHashTable(&(map->web.validation), name))
+    return MS_TRUE;
+  for (int i = 0; i < map->numlayers; i++) {
+    layerObj *layer = GET_LAYER(map, i);
+    if (msLookupHashTable(&(layer->validation), name))
+      return MS_TRUE;
+    for (int j = 0; j < layer->numclasses; j++) {
+      if (msLookupHashTable(&(layer->class[j]->validation), name))
+        return MS_TRUE;
+    }
+  }
+  return MS_FALSE;
+}
+
+/*
+** The cache key: mapfile and data identity, the server variables that
+** msBuildOnlineResource() looks at and the request parameters sorted by
+** name, with case insensitive names. Cookies only take part when they are
+** validated by the mapfile, or all of them when they are forwarded to
+** cascaded servers. On input *mtime is the modification time of the layer
+** data, it is raised to the one of the mapfile.
+*/
+static char *msResponseCacheBuildKey(mapservObj *mapserv, configObj *config,
+                                     time_t *mtime, int forwardcookies) {
+  static const char *const envNames[] = {
+      "HTTP_X_FORWARDED_HOST", "SERVER_NAME",  "HTTP_X_FORWARDED_PORT",
+      "SERVER_PORT",           "SCRIPT_NAME",  "PATH_INFO",
+      "HTTPS",                 "HTTP_X_FORWARDED_PROTO"};
+  char pathBuf[MS_MAXPATHLEN], buf[128];
+  const char *mapfile = msResponseCacheGetMapfile(mapserv, config, pathBuf);
+  const int numparams = mapserv->request->NumParams;
+  int numkeyparams = 0;
+  msStringBuffer *sb;
+  const char **params;
+  VSIStatBufL stat;
+
+  if (!mapfile || VSIStatL(mapfile, &stat) != 0)
+    return NULL;
+
+  sb = msStringBufferAlloc();
+  msStringBufferAppend(sb, mapfile);
+  snprintf(buf, sizeof(buf), "|%lld|%lld|%lld|%d|", (long long)stat.st_mtime,
+           (long long)stat.st_size, (long long)*mtime, mapserv->sendheaders);
+  msStringBufferAppend(sb, buf);
+  *mtime = MS_MAX(*mtime, stat.st_mtime);
+
+  for (size_t i = 0; i < sizeof(envNames) / sizeof(envNames[0]); i++) {
+    const char *value = msIO_getenv(envNames[i]);
+    if (value)
+      msStringBufferAppend(sb, value);
+    msStringBufferAppend(sb, "|");
+  }
+
+  params = (const char **)msSmallMalloc(sizeof(char *) * 2 *
+                                        MS_MAX(numparams, 1));
+  for (int i = 0; i < numparams; i++) {
+    if (mapserv->request->ParamSources[i] == MS_PARAM_SOURCE_COOKIE &&
+        !msResponseCacheIsValidated(mapserv->map,
+                                    mapserv->request->ParamNames[i]))
+      continue;
+    params[2 * numkeyparams] = mapserv->request->ParamNames[i];
+    params[2 * numkeyparams + 1] = mapserv->request->ParamValues[i];
+    numkeyparams++;
+  }
+  qsort(params, numkeyparams, 2 * sizeof(char *),
+        msResponseCacheCompareParams);
+  for (int i = 0; i < numkeyparams; i++) {
+    char *name = msStrdup(params[2 * i]);
+    msStringToLower(name);
+    msStringBufferAppend(sb, name);
+    msStringBufferAppend(sb, "=");
+    if (params[2 * i + 1])
+      msStringBufferAppend(sb, params[2 * i + 1]);
+    msStringBufferAppend(sb, "&");
+    free(name);
+  }
+  free(params);
+
+  if (forwardcookies && mapserv->request->httpcookiedata) {
+    msStringBufferAppend(sb, "|");
+    msStringBufferAppend(sb, mapserv->request->httpcookiedata);
+  }
+
+  return msStringBufferReleaseStringAndFree(sb);
+}
+
+/* Two FNV-1a hashes of the key, as 32 hexadecimal digits. */
+static void msResponseCacheHashKey(const char *key, char hash[33]) {
+  unsigned long long h1 = 14695981039346656037ULL, h2 = 0x84222325cbf29ce4ULL;
+
+  for (const unsigned char *c = (const unsigned char *)key; *c; c++) {
+    h1 = (h1 ^ *c) * 1099511628211ULL;
+    h2 = (h2 ^ *c) * 1099511628211ULL;
+  }
+  snprintf(hash, 33, "%016llx%016llx", h1, h2);
+}
+
+/* SHA-256 digest of the key, as 64 hexadecimal digits. */
+static void msResponseCacheDigestKey(const char *key, char digest[65]) {
+  GByte hash[CPL_SHA256_HASH_SIZE];
+
+  CPL_SHA256(key, strlen(key), hash);
+  for (int i = 0; i < CPL_SHA256_HASH_SIZE; i++)
+    snprintf(digest + 2 * i, 3, "%02x", hash[i]);
+}
+
+/* File name of a disk cache entry. */
+static char *msResponseCacheGetFilename(const char *key) {
+  const char *dir = CPLGetConfigOption("MS_RESPONSE_CACHE_DIR", ".");
+  char hash[33], *filename;
+
+  msResponseCacheHashKey(key, hash);
+  filename = (char *)msSmallMalloc(strlen(dir) + 48);
+  sprintf(filename, "%s/%s.cache", dir, hash);
+  return filename;
+}
+
+/*
+** Parses an HTTP date in the preferred format of RFC 9110, as sent in our
+** Last-Modified headers ("Sun, 06 Nov 1994 08:49:37 GMT"). Returns -1 for
+** other formats.
+*/
+static time_t msResponseCacheParseDate(const char *date) {
+  static const char months[] = "JanFebMarAprMayJunJulAugSepOctNovDec";
+  char month[4];
+  const char *m;
+  int day, year, hour, minute, second, mon;
+  long long y, era, yoe, doy, doe, days;
+
+  if (sscanf(date, "%*3s, %d %3s %d %d:%d:%d GMT", &day, month, &year, &hour,
+             &minute, &second) != 6 ||
+      strlen(month) != 3 || (m = strstr(months, month)) == NULL ||
+      (m - months) % 3 != 0)
+    return (time_t)-1;
+  mon = (int)(m - months) / 3 + 1;
+
+  /* days since the epoch in the proleptic Gregorian calendar, the year
+   * starting in March so that leap days come last */
+  y = year - (mon <= 2);
+  era = (y >= 0 ? y : y - 399) / 400;
+  yoe = y - era * 400;
+  doy = (153 * (mon > 2 ? mon - 3 : mon + 9) + 2) / 5 + day - 1;
+  doe = yoe * 365 + yoe / 4 - yoe / 100 + doy;
+  days = era * 146097 + doe - 719468;
+  return (time_t)(days * 86400 + hour * 3600 + minute * 60 + second);
+}
+
+/*
+** Is the resource unchanged for the client? If-None-Match takes precedence,
+** its tags being compared weakly with our weak ETag, else the resource is
+** unchanged if its data was last modified at or before the
+** If-Modified-Since date.
+*/
+static int msResponseCacheIsNotModified(const char *etag, time_t mtime) {
+  const char *ifnonematch = msIO_getenv("HTTP_IF_NONE_MATCH");
+  const char *ifmodifiedsince = msIO_getenv("HTTP_IF_MODIFIED_SINCE");
+  int match = MS_FALSE, numtokens = 0;
+  char **tokens;
+
+  if (!ifnonematch) {
+    const time_t since =
+        ifmodifiedsince ? msResponseCacheParseDate(ifmodifiedsince) : -1;
+    return since != (time_t)-1 && mtime <= since;
+  }
+
+  tokens = msStringSplit(ifnonematch, ',', &numtokens);
+  for (int i = 0; i < numtokens && !match; i++) {
+    const char *tag = tokens[i];
+    msStringTrim(tokens[i]);
+    if (strncmp(tag, "W/", 2) == 0) /* weak comparison */
+      tag += 2;
+    match = strcmp(tag, "*") == 0 || strcmp(tag, etag + 2) == 0;
+  }
+  msFreeCharArray(tokens, numtokens);
+  return match;
+}
+
+static int msResponseCacheIsDisk(void) {
+  return EQUAL(CPLGetConfigOption("MS_RESPONSE_CACHE", ""), "DISK");
+}
+
+static void msResponseCacheUnlink(responseCacheEntry *entry) {
+  if (entry->prev)
+    entry->prev->next = entry->next;
+  else
+    responseCacheHead = entry->next;
+  if (entry->next)
+    entry->next->prev = entry->prev;
+  else
+    responseCacheTail = entry->prev;
+  entry->prev = entry->next = NULL;
+}
+
+static void msResponseCacheLink(responseCacheEntry *entry) {
+  entry->next = responseCacheHead;
+  if (responseCacheHead)
+    responseCacheHead->prev = entry;
+  responseCacheHead = entry;
+  if (!responseCacheTail)
+    responseCacheTail = entry;
+}
+
+static void msResponseCacheRemove(responseCacheEntry *entry) {
+  UT_HASH_DEL(responseCacheHash, entry);
+  msResponseCacheUnlink(entry);
+  responseCacheBytes -= entry->size;
+  free(entry->key);
+  free(entry->data);
+  free(entry);
+}
+
+/*
+** A disk cache entry is the magic string, the expiry time padded to 64
+** bytes and the 64 digits of the digest of the key, followed by the response.
+*/
+static int msResponseCacheReadHeader(VSILFILE *fp, long long *expires) {
+  const size_t magiclen = strlen(MS_RESPONSE_CACHE_MAGIC);
+  char header[64];
+
+  return VSIFReadL(header, 1, magiclen, fp) == magiclen &&
+         memcmp(header, MS_RESPONSE_CACHE_MAGIC, magiclen) == 0 &&
+         VSIFReadL(header, 1, sizeof(header), fp) == sizeof(header) &&
+         sscanf(header, "%lld", expires) == 1;
+}
+
+typedef struct {
+  char *filename;
+  time_t mtime;
+  size_t size;
+} responseCacheFile;
+
+static int msResponseCacheCompareFiles(const void *a, const void *b) {
+  const responseCacheFile *fa = (const responseCacheFile *)a;
+  const responseCacheFile *fb = (const responseCacheFile *)b;
+  return fa->mtime < fb->mtime ? -1 : fa->mtime > fb->mtime ? 1 : 0;
+}
+
+/*
+** Removes the expired entries of the disk cache, and temporary files left
+** over for an hour, then the oldest entries until the cache fits in maxsize.
+*/
+static int msResponseCacheHasSuffix(const char *name, const char *suffix) {
+  const size_t len = strlen(name), suffixlen = strlen(suffix);
+  return len > suffixlen && strcmp(name + len - suffixlen, suffix) == 0;
+}
+
+static void msResponseCacheSweep(const char *dir, size_t maxsize) {
+  char **names = VSIReadDir(dir);
+  const int numnames = CSLCount(names);
+  const time_t now = time(NULL);
+  responseCacheFile *files;
+  int numfiles = 0;
+  size_t total = 0;
+
+  files = (responseCacheFile *)msSmallMalloc(sizeof(responseCacheFile) *
+                                             MS_MAX(numnames, 1));
+  for (int i = 0; i < numnames; i++) {
+    const int tmp = msResponseCacheHasSuffix(names[i], ".tmp");
+    char *filename;
+    VSIStatBufL stat;
+    VSILFILE *fp;
+    long long expires = 0;
+    int expired;
+
+    if (!tmp && !msResponseCacheHasSuffix(names[i], ".cache"))
+      continue;
+    filename = msStringConcatenate(msStrdup(dir), "/");
+    filename = msStringConcatenate(filename, names[i]);
+    if (VSIStatL(filename, &stat) != 0) {
+      free(filename);
+      continue;
+    }
+
+    if (tmp) {
+      expired = stat.st_mtime + 3600 < now;
+    } else {
+      fp = VSIFOpenL(filename, "rb");
+      expired = fp && (!msResponseCacheReadHeader(fp, &expires) ||
+                       expires <= (long long)now);
+      if (fp)
+        VSIFCloseL(fp);
+    }
+
+    if (expired) {
+      VSIUnlink(filename);
+      free(filename);
+    } else if (tmp) {
+      free(filename);
+    } else {
+      files[numfiles].filename = filename;
+      files[numfiles].mtime = stat.st_mtime;
+      files[numfiles].size = (size_t)stat.st_size;
+      total += files[numfiles].size;
+      numfiles++;
+    }
+  }
+
+  qsort(files, numfiles, sizeof(responseCacheFile),
+        msResponseCacheCompareFiles);
+  for (int i = 0; i < numfiles; i++) {
+    if (total > maxsize) {
+      VSIUnlink(files[i].filename);
+      total -= files[i].size;
+    }
+    free(files[i].filename);
+  }
+  free(files);
+  CSLDestroy(names);
+}
+
+/* Writes a cached response to the client, returns MS_TRUE on a hit. */
+static int msResponseCacheServe(const char *key) {
+  int hit = MS_FALSE;
+
+  if (msResponseCacheIsDisk()) {
+    char *filename = msResponseCacheGetFilename(key);
+    VSILFILE *fp = VSIFOpenL(filename, "rb");
+    if (fp) {
+      char digest[65], filedigest[64];
+      long long expires = 0;
+
+      msResponseCacheDigestKey(key, digest);
+      if (msResponseCacheReadHeader(fp, &expires) &&
+          VSIFReadL(filedigest, 1, sizeof(filedigest), fp) ==
+              sizeof(filedigest) &&
+          memcmp(filedigest, digest, sizeof(filedigest)) == 0) {
+        if (expires > (long long)time(NULL)) {
+          char buf[65536];
+          size_t n;
+          hit = MS_TRUE;
+          while ((n = VSIFReadL(buf, 1, sizeof(buf), fp)) > 0)
+            msIO_fwrite(buf, 1, n, stdout);
+        } else {
+          VSIFCloseL(fp);
+          fp = NULL;
+          VSIUnlink(filename);
+        }
+      }
+      if (fp)
+        VSIFCloseL(fp);
+    }
+    free(filename);
+    return hit;
+  }
+
+  {
+    responseCacheEntry *entry = NULL;
+    unsigned char *data = NULL;
+    size_t size = 0;
+
+    msAcquireLock(TLOCK_RESPCACHE);
+    UT_HASH_FIND_STR(responseCacheHash, key, entry);
+    if (entry && entry->expires <= time(NULL)) {
+      msResponseCacheRemove(entry);
+      entry = NULL;
+    }
+    if (entry) {
+      msResponseCacheUnlink(entry);
+      msResponseCacheLink(entry);
+      /* copied so that the client is not written to under the lock */
+      size = entry->size;
+      data = (unsigned char *)msSmallMalloc(size);
+      memcpy(data, entry->data, size);
+      hit = MS_TRUE;
+    }
+    msReleaseLock(TLOCK_RESPCACHE);
+
+    if (data)
+      msIO_fwrite(data, 1, size, stdout);
+    free(data);
+  }
+  return hit;
+}
+
+static void msResponseCacheStore(const char *key, int ttl,
+                                 const unsigned char *data, size_t size) {
+  const size_t maxsize = msResponseCacheMaxSize();
+
+  if (size == 0 || size > maxsize / 8)
+    return;
+
+  if (msResponseCacheIsDisk()) {
+    char *filename = msResponseCacheGetFilename(key);
+    char *tmpfilename = (char *)msSmallMalloc(strlen(filename) + 32);
+    const size_t magiclen = strlen(MS_RESPONSE_CACHE_MAGIC);
+    char header[64], hash[33], digest[65];
+    VSILFILE *fp;
+    int ok, sweep;
+
+    memset(header, 0, sizeof(header));
+    snprintf(header, sizeof(header), "%lld\n", (long long)time(NULL) + ttl);
+    sprintf(tmpfilename, "%s.%d.tmp", filename, (int)getpid());
+    msResponseCacheDigestKey(key, digest);
+
+    fp = VSIFOpenL(tmpfilename, "wb");
+    if (fp) {
+      ok = VSIFWriteL(MS_RESPONSE_CACHE_MAGIC, 1, magiclen, fp) == magiclen &&
+           VSIFWriteL(header, 1, sizeof(header), fp) == sizeof(header) &&
+           VSIFWriteL(digest, 1, 64, fp) == 64 &&
+           VSIFWriteL(data, 1, size, fp) == size;
+      if (VSIFCloseL(fp) != 0)
+        ok = MS_FALSE;
+      /* readers see either the previous file or the complete new one */
+      if (!ok || VSIRename(tmpfilename, filename) != 0)
+        VSIUnlink(tmpfilename);
+    }
+    free(tmpfilename);
+    free(filename);
+
+    /*
+    ** One store in 16, going by the hash of its key, sweeps the directory:
+    ** at most once a minute in a given process.
+    */
+    msResponseCacheHashKey(key, hash);
+    if (hash[0] == '0') {
+      const time_t now = time(NULL);
+      msAcquireLock(TLOCK_RESPCACHE);
+      sweep = now - responseCacheLastSweep >= 60;
+      if (sweep)
+        responseCacheLastSweep = now;
+      msReleaseLock(TLOCK_RESPCACHE);
+      if (sweep)
+        msResponseCacheSweep(
+            CPLGetConfigOption("MS_RESPONSE_CACHE_DIR", "."), maxsize);
+    }
+    return;
+  }
+
+  msAcquireLock(TLOCK_RESPCACHE);
+  {
+    responseCacheEntry *entry = NULL;
+    UT_HASH_FIND_STR(responseCacheHash, key, entry);
+    if (entry)
+      msResponseCacheRemove(entry);
+
+    while (responseCacheTail && responseCacheBytes + size > maxsize)
+      msResponseCacheRemove(responseCacheTail);
+
+    entry = (responseCacheEntry *)msSmallCalloc(1, sizeof(responseCacheEntry));
+    entry->key = msStrdup(key);
+    entry->data = (unsigned char *)msSmallMalloc(size);
+    memcpy(entry->data, data, size);
+    entry->size = size;
+    entry->expires = time(NULL) + ttl;
+    UT_HASH_ADD_KEYPTR(hh, responseCacheHash, entry->key,
+                       strlen(entry->key), entry);
+    msResponseCacheLink(entry);
+    responseCacheBytes += size;
+  }
+  msReleaseLock(TLOCK_RESPCACHE);
+}
+
+/*
+** Called before dispatching a request. Returns MS_DONE if the response was
+** served from the cache. Otherwise *request is set when the response is to be
+** cached: stdout is then captured until msResponseCacheEnd() is called.
+*/
+int msResponseCacheBegin(mapservObj *mapserv, configObj *config,
+                         responseCacheRequest **request) {
+  const char *storage = CPLGetConfigOption("MS_RESPONSE_CACHE", "");
+  int cache = EQUAL(storage, "MEMORY") || EQUAL(storage, "DISK");
+  int conditional =
+      mapserv->sendheaders &&
+      CPLTestBool(CPLGetConfigOption("MS_CONDITIONAL_GET", "NO"));
+  char *key, *headers = NULL;
+  time_t mtime;
+  int ttl, filebased, forwardcookies;
+
+  *request = NULL;
+  if ((!cache && !conditional) || !mapserv->map ||
+      !msResponseCacheIsCacheable(mapserv))
+    return MS_SUCCESS;
+
+  ttl = msResponseCacheScanLayers(mapserv, &mtime, &filebased,
+                                  &forwardcookies);
+  conditional = conditional && filebased;
+  if (ttl <= 0)
+    cache = MS_FALSE;
+  if (!cache && !conditional)
+    return MS_SUCCESS;
+
+  key = msResponseCacheBuildKey(mapserv, config, &mtime, forwardcookies);
+  if (!key)
+    return MS_SUCCESS;
+
+  if (conditional) {
+    char hash[33], etag[40], lastmodified[64];
+    struct tm gmt;
+
+    /* weak, as the same response may be sent with different content
+     * encodings (MS_HTTP_COMPRESSION) */
+    msResponseCacheHashKey(key, hash);
+    snprintf(etag, sizeof(etag), "W/\"%s\"", hash);
+    CPLUnixTimeToYMDHMS((GIntBig)mtime, &gmt);
+    if (!strftime(lastmodified, sizeof(lastmodified),
+                  "%a, %d %b %Y %H:%M:%S GMT", &gmt))
+      lastmodified[0] = '\0';
+
+    if (msResponseCacheIsNotModified(etag, mtime)) {
+      msIO_setHeader("Status", "304 Not Modified");
+      msIO_setHeader("ETag", "%s", etag);
+      if (lastmodified[0])
+        msIO_setHeader("Last-Modified", "%s", lastmodified);
+      msIO_sendHeaders();
+      if (mapserv->map->debug >= MS_DEBUGLEVEL_V)
+        msDebug("msResponseCacheBegin(): resource not modified.\n");
+      free(key);
+      return MS_DONE;
+    }
+
+    headers = msStringConcatenate(NULL, "ETag: ");
+    headers = msStringConcatenate(headers, etag);
+    headers = msStringConcatenate(headers, "\r\n");
+    if (lastmodified[0]) {
+      headers = msStringConcatenate(headers, "Last-Modified: ");
+      headers = msStringConcatenate(headers, lastmodified);
+      headers = msStringConcatenate(headers, "\r\n");
+    }
+  }
+
+  if (cache && msResponseCacheServe(key)) {
+    if (mapserv->map->debug >= MS_DEBUGLEVEL_V)
+      msDebug("msResponseCacheBegin(): response served from the cache.\n");
+    free(key);
+    free(headers);
+    return MS_DONE;
+  }
+
+  *request = (responseCacheRequest *)msSmallMalloc(sizeof(**request));
+  (*request)->key = key;
+  (*request)->ttl = cache ? ttl : 0;
+  (*request)->headers = headers;
+  (*request)->old_context = msIO_pushStdoutToBufferAndGetOldContext();
+  return MS_SUCCESS;
+}
+
+/*
+** Called once the request is dispatched: prepends the ETag headers to and
+** stores the captured response if the request succeeded, and sends it to
+** the client.
+*/
+void msResponseCacheEnd(responseCacheRequest *request, int success) {
+  msIOContext *ctx;
+  msIOBuffer *buf;
+  size_t headerslen = 0;
+
+  if (!request)
+    return;
+
+  ctx = msIO_getHandler(stdout);
+  buf = (msIOBuffer *)ctx->cbData;
+
+  /* a Status header means an error or a redirect */
+  success = success && buf->data_offset > 0 &&
+            strncasecmp((const char *)buf->data, "Status:", 7) != 0;
+  if (success && request->headers)
+    headerslen = strlen(request->headers);
+
+  if (success && request->ttl > 0) {
+    if (headerslen > 0) {
+      const size_t size = headerslen + buf->data_offset;
+      unsigned char *data = (unsigned char *)msSmallMalloc(size);
+      memcpy(data, request->headers, headerslen);
+      memcpy(data + headerslen, buf->data, buf->data_offset);
+      msResponseCacheStore(request->key, request->ttl, data, size);
+      free(data);
+    } else {
+      msResponseCacheStore(request->key, request->ttl, buf->data,
+                           buf->data_offset);
+    }
+  }
+
+  if (headerslen > 0)
+    msIO_contextWrite(request->old_context, request->headers, headerslen);
+  if (buf->data_offset > 0)
+    msIO_contextWrite(request->old_context, buf->data, buf->data_offset);
+  msIO_restoreOldStdoutContext(request->old_context);
+
+  free(request->key);
+  free(request->headers);
+  free(request);
+}
+
+void msResponseCacheCleanup(void) {
+  msAcquireLock(TLOCK_RESPCACHE);
+  while (responseCacheHead)
+    msResponseCacheRemove(responseCacheHead);
+  msReleaseLock(TLOCK_RESPCACHE);
+}
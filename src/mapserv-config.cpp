@@ -27,6 +27,7 @@
  ****************************************************************************/
 #include "mapserver.h"
 #include "mapfile.h" // format shares a couple of tokens
+#include "maptime.h"
 
 #include "cpl_conv.h"
 
@@ -261,3 +262,109 @@ const char *msConfigGetPlugin(const configObj *config, const char *key) {
     return NULL;
   return msLookupHashTable(&config->plugins, key);
 }
+
+/*
+** Loads a mapfile of the MAPS section and touches what the first requests
+** using it would otherwise pay for and what outlives the mapObj: its
+** reprojections (kept by the pooled PROJ contexts) and layer datasets (kept
+** open by the connection pool for the layers with PROCESSING
+** "CLOSE_CONNECTION=DEFER"). Fonts and pixmap symbols are not loaded, as
+** they are cached per thread or per mapObj. Failures are only logged.
+*/
+static void msConfigPrewarmMap(const configObj *config, const char *key) {
+  char szPath[MS_MAXPATHLEN];
+  struct mstimeval starttime, endtime;
+  int numopened = 0;
+
+  const char *path = msConfigGetMap(config, key, szPath);
+  if (!path) {
+    msDebug("msConfigPrewarm(): no %s entry in the MAPS section.\n", key);
+    return;
+  }
+
+  msGettimeofday(&starttime, NULL);
+  mapObj *map = msLoadMap(path, NULL, config);
+  if (!map) {
+    msDebug("msConfigPrewarm(): failed to load %s.\n", path);
+    msResetErrorList();
+    return;
+  }
+
+  for (int i = 0; i < map->numlayers; i++) {
+    layerObj *layer = GET_LAYER(map, i);
+
+    if (layer->status == MS_DELETE)
+      continue;
+
+    if (msProjectionsDiffer(&(layer->projection), &(map->projection)))
+      msProjectDestroyReprojector(
+          msProjectCreateReprojector(&(layer->projection), &(map->projection)));
+
+    /* remote layers would be fetched, not just opened */
+    if (layer->connectiontype == MS_INLINE ||
+        layer->connectiontype == MS_WMS || layer->connectiontype == MS_WFS ||
+        layer->connectiontype == MS_GRATICULE)
+      continue;
+
+    if (msLayerOpen(layer) == MS_SUCCESS) {
+      numopened++;
+      msLayerClose(layer);
+    } else {
+      msDebug("msConfigPrewarm(): failed to open layer %s of %s.\n",
+              layer->name ? layer->name : "(unnamed)", key);
+    }
+  }
+
+  msGettimeofday(&endtime, NULL);
+  msDebug("msConfigPrewarm(): %s prewarmed in %.3fs, %d of %d layers "
+          "opened.\n",
+          key,
+          (endtime.tv_sec + endtime.tv_usec / 1.0e6) -
+              (starttime.tv_sec + starttime.tv_usec / 1.0e6),
+          numopened, map->numlayers);
+
+  msFreeMap(map);
+  msResetErrorList();
+}
+
+/**
+ * Prewarm the process before it serves its first request, by loading the
+ * Mapfiles listed in MS_PREWARM_MAPS: a comma separated list of keys of the
+ * MAPS section, or * for all of them.
+ */
+void msConfigPrewarm(const configObj *config) {
+  struct mstimeval starttime, endtime;
+  char **keys = NULL;
+  int numkeys = 0;
+
+  const char *value = msConfigGetEnv(config, "MS_PREWARM_MAPS");
+  if (value == NULL || *value == '\0')
+    return;
+
+  msGettimeofday(&starttime, NULL);
+
+  /* register the drivers now rather than when first needed */
+  msGDALInitialize();
+  msOGRInitialize();
+
+  if (strcmp(value, "*") == 0) {
+    const char *key = msFirstKeyFromHashTable(&config->maps);
+    while (key != NULL) {
+      msConfigPrewarmMap(config, key);
+      numkeys++;
+      key = msNextKeyFromHashTable(&config->maps, key);
+    }
+  } else {
+    keys = msStringSplit(value, ',', &numkeys);
+    for (int i = 0; i < numkeys; i++) {
+      msStringTrim(keys[i]);
+      msConfigPrewarmMap(config, keys[i]);
+    }
+    msFreeCharArray(keys, numkeys);
+  }
+
+  msGettimeofday(&endtime, NULL);
+  msDebug("msConfigPrewarm(): %d map(s) prewarmed in %.3fs.\n", numkeys,
+          (endtime.tv_sec + endtime.tv_usec / 1.0e6) -
+              (starttime.tv_sec + starttime.tv_usec / 1.0e6));
+}
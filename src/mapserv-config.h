@@ -31,6 +31,7 @@ MS_DLL_EXPORT const char *msConfigGetMap(const configObj *config,
                                          const char *key, char *pszReturnPath);
 MS_DLL_EXPORT const char *msConfigGetPlugin(const configObj *config,
                                             const char *key);
+MS_DLL_EXPORT void msConfigPrewarm(const configObj *config);
 
 #ifdef __cplusplus
 } /* extern C */
@@ -434,7 +434,7 @@ int msOGCAPIDispatchMapIndexRequest(mapservObj *mapserv, configObj *config) {
   cgiRequestObj *request = mapserv->request;
 
   if (request->api_path_length != 1) {
-    const char *pathInfo = getenv("PATH_INFO");
+    const char *pathInfo = msIO_getenv("PATH_INFO");
     msSetError(MS_OGCAPIERR, "Invalid PATH_INFO format: \"%s\"",
                "msOGCAPIDispatchMapIndexRequest()", pathInfo);
     return MS_FAILURE;
@@ -2200,6 +2200,7 @@ struct layerObj {
 
 #ifndef SWIG
   int classitemindex;
+  void *classdispatch; /* CLASSITEM value to classes index, see maputil.c */
   resultCacheObj
       *resultcache;   /* holds the results of a query against this layer */
   double scalefactor; /* computed, not set */
@@ -2374,6 +2375,9 @@ struct layerObj {
 #ifndef SWIG
 void msFontCacheSetup();
 void msFontCacheCleanup();
+void msFontCacheQuiesce();
+void msFontCacheBoundGlyphStore();
+void msFontCacheThreadCleanup();
 
 typedef struct {
   double minx, miny, maxx, maxy, advance;
@@ -2448,6 +2452,8 @@ struct mapObj { /* structure for a map */
       encryption_key[MS_ENCRYPTION_KEY_SIZE]; /* 128bits encryption key */
   queryObj query;
   projectionContext *projContext;
+  double deadline; /* msGettimeofday() time past which the request is
+                      abandoned, 0 for no limit, see msMapSetTimeout() */
 
 #endif /* SWIG */
 
@@ -2699,6 +2705,8 @@ MS_DLL_EXPORT int msSetConfigOption(mapObj *map, const char *key,
 MS_DLL_EXPORT int msTestConfigOption(mapObj *map, const char *key,
                                      int default_result);
 MS_DLL_EXPORT void msApplyMapConfigOptions(mapObj *map);
+MS_DLL_EXPORT void msResetMapConfigOptions(mapObj *map);
+MS_DLL_EXPORT void msSetMapConfigOptionsPerThread(int per_thread);
 MS_DLL_EXPORT int msMapComputeGeotransform(mapObj *map);
 int msMapComputeGeotransformEx(mapObj *map, double resolutionX,
                                double resolutionY);
@@ -2773,6 +2781,7 @@ void msReplaceFreeableStr(char **ppszStr, char *pszNewStr);
 MS_DLL_EXPORT char **msTokenizeMap(char *filename, int *numtokens);
 MS_DLL_EXPORT int msInitLabelCache(labelCacheObj *cache);
 MS_DLL_EXPORT int msFreeLabelCache(labelCacheObj *cache);
+MS_DLL_EXPORT int msLabelCacheIsEmpty(labelCacheObj *cache);
 MS_DLL_EXPORT int msCheckConnection(
     layerObj *layer); /* connection pooling functions (mapfile.c) */
 MS_DLL_EXPORT void msCloseConnections(mapObj *map);
@@ -2781,6 +2790,12 @@ MS_DLL_EXPORT void msOGRInitialize(void);
 MS_DLL_EXPORT void msOGRCleanup(void);
 MS_DLL_EXPORT void msGDALCleanup(void);
 MS_DLL_EXPORT void msGDALInitialize(void);
+MS_DLL_EXPORT void msResampleGridCacheCleanup(void); /* in mapresample.c */
+MS_DLL_EXPORT void msRasterClassLUTCacheCleanup(void); /* in mapdrawgdal.c */
+MS_DLL_EXPORT void msTextLayoutCacheCleanup(void);     /* in textlayout.c */
+MS_DLL_EXPORT void msResponseCacheCleanup(void); /* in mapserv-cache.c */
+MS_DLL_EXPORT void msTextLayoutCacheGetStats(unsigned long *hits,
+                                             unsigned long *misses);
 
 MS_DLL_EXPORT imageObj *msDrawScalebar(mapObj *map); /* in mapscale.c */
 MS_DLL_EXPORT int msCalculateScale(rectObj extent, int units, int width,
@@ -3077,6 +3092,13 @@ MS_DLL_EXPORT char *msShapeToWKT(shapeObj *shape);
 MS_DLL_EXPORT void msInitShape(shapeObj *shape);
 MS_DLL_EXPORT void msShapeDeleteLine(shapeObj *shape, int line);
 MS_DLL_EXPORT int msCopyShape(const shapeObj *from, shapeObj *to);
+MS_DLL_EXPORT attributeValueObj *msShapeAllocTypedValues(shapeObj *shape,
+                                                         int numvalues);
+MS_DLL_EXPORT void msShapeRemapTypedValues(shapeObj *shape,
+                                           const int *itemindexes,
+                                           int numitems);
+MS_DLL_EXPORT int msShapeGetNumericValue(shapeObj *shape, int i,
+                                         double *value);
 MS_DLL_EXPORT int msIsOuterRing(shapeObj *shape, int r);
 MS_DLL_EXPORT int *msGetOuterList(shapeObj *shape);
 MS_DLL_EXPORT int *msGetInnerList(shapeObj *shape, int r, int *outerlist);
@@ -3200,6 +3222,7 @@ MS_DLL_EXPORT bool msLayerPropertyIsNumeric(layerObj *layer,
                                             const char *property);
 MS_DLL_EXPORT void msLayerClose(layerObj *layer);
 MS_DLL_EXPORT void msLayerFreeExpressions(layerObj *layer);
+MS_DLL_EXPORT void msLayerFreeClassDispatch(layerObj *layer);
 MS_DLL_EXPORT int msLayerWhichShapes(layerObj *layer, rectObj rect,
                                      int isQuery);
 MS_DLL_EXPORT int msLayerGetItemIndex(layerObj *layer, char *item);
@@ -3528,6 +3551,9 @@ MS_DLL_EXPORT int msIntegerInArray(const int value, int *array,
 MS_DLL_EXPORT int msExtentsOverlap(mapObj *map, layerObj *layer);
 MS_DLL_EXPORT char *msBuildOnlineResource(const mapObj *map,
                                           const cgiRequestObj *req);
+MS_DLL_EXPORT void msMapSetTimeout(mapObj *map, double seconds);
+MS_DLL_EXPORT double msMapGetRemainingTime(const mapObj *map);
+MS_DLL_EXPORT int msMapCheckDeadline(const mapObj *map, const char *routine);
 
 /* For mapswf */
 MS_DLL_EXPORT int getRgbColor(mapObj *map, int i, int *r, int *g,
@@ -4016,6 +4042,8 @@ MS_DLL_EXPORT int msPopulateRendererVTableOGR(rendererVTableObj *renderer);
 MS_DLL_EXPORT int msPopulateRendererVTableMVT(rendererVTableObj *renderer);
 
 MS_DLL_EXPORT int msMVTWriteTile(mapObj *map, int sendheaders);
+MS_DLL_EXPORT int msMVTWriteTileEx(mapObj *map, int sendheaders,
+                                   int *numfeatures);
 
 #ifdef USE_CAIRO
 MS_DLL_EXPORT void msCairoCleanup(void);
@@ -418,7 +418,7 @@ int msCGIIsAPIRequest(mapservObj *mapserv) {
   char **tmp_api_path = NULL;
   int i, n, tmp_api_path_length = 0;
 
-  mapserv->request->path_info = getenv("PATH_INFO");
+  mapserv->request->path_info = msIO_getenv("PATH_INFO");
   if (mapserv->request->path_info != NULL &&
       strlen(mapserv->request->path_info) > 0) {
     tmp_api_path =
@@ -483,6 +483,42 @@ int msCGIDispatchAPIRequest(mapservObj *mapserv) {
   return MS_FAILURE;
 }
 
+/*
+** Short description of a request used to label the request metrics and the
+** replay reports, like "WMS_GetMap", "OGCAPI" or the CGI mode.
+*/
+void msCGIGetRequestType(mapservObj *mapserv, char *type, size_t size) {
+  const char *service = NULL, *request = NULL, *mode = NULL;
+  char *c;
+
+  if (mapserv->request->api_path_length > 1) {
+    strlcpy(type, "OGCAPI", size);
+    return;
+  }
+
+  for (int i = 0; i < mapserv->request->NumParams; i++) {
+    const char *name = mapserv->request->ParamNames[i];
+    if (strcasecmp(name, "service") == 0)
+      service = mapserv->request->ParamValues[i];
+    else if (strcasecmp(name, "request") == 0)
+      request = mapserv->request->ParamValues[i];
+    else if (strcasecmp(name, "mode") == 0)
+      mode = mapserv->request->ParamValues[i];
+  }
+
+  if (service && request)
+    snprintf(type, size, "%s_%s", service, request);
+  else if (request) /* WMS allows SERVICE to be omitted */
+    strlcpy(type, request, size);
+  else
+    strlcpy(type, mode ? mode : "BROWSE", size);
+
+  for (c = type; *c; c++) {
+    if (!isalnum((unsigned char)*c) && *c != '_' && *c != '-')
+      *c = '_';
+  }
+}
+
 /*
 ** Process common parameters that can apply to CGI and WxS calls - there are
 *just a few and affect the mapObj directly.
@@ -2079,6 +2079,349 @@ int msShapefileWhichShapes(shapefileObj *shpfile, rectObj rect, int debug) {
   return (MS_SUCCESS); /* success */
 }
 
+/*
+** Process wide pool of idle shapefile handles, used for the tiles and the
+** tile index of tiled shapefile layers so that they are not reopened and
+** their headers parsed again on every request. A handle belongs to a single
+** layer between msShapefilePoolOpen() and msShapefilePoolRelease(), and is
+** reused only while none of the .shp, .shx, .dbf and .qix files changed.
+** MS_SHAPEFILE_POOL_SIZE sets the number of idle handles kept (default 32,
+** 0 disables the pool).
+*/
+#define MS_SHAPEFILE_STAMP_FILES 4
+
+/*
+** Modification time and size of the files of a shapefile. A missing .qix is
+** recorded with a size of -1.
+*/
+typedef struct {
+  time_t mtime[MS_SHAPEFILE_STAMP_FILES];
+  GIntBig size[MS_SHAPEFILE_STAMP_FILES];
+} shapefileStamp;
+
+typedef struct shapefilePoolEntry {
+  shapefileObj shpfile;
+  shapefileStamp stamp;
+  struct shapefilePoolEntry *prev, *next;
+} shapefilePoolEntry;
+
+/*
+** Bounds of the tiles of a tile index, so that the tiles intersecting a
+** request are found without reading the tile index .qix or .shp again.
+*/
+typedef struct tileIndexBounds {
+  char source[MS_PATH_LENGTH];
+  shapefileStamp stamp;
+  int numshapes;
+  rectObj *bounds;
+  ms_bitarray valid; /* MS_FALSE for NULL shapes */
+  struct tileIndexBounds *next;
+} tileIndexBounds;
+
+static shapefilePoolEntry *shapefilePoolHead = NULL; /* most recently used */
+static shapefilePoolEntry *shapefilePoolTail = NULL;
+static int shapefilePoolCount = 0;
+static tileIndexBounds *tileIndexBoundsList = NULL; /* most recently used */
+static int tileIndexBoundsCount = 0;
+
+static int msShapefilePoolSize(void) {
+  return atoi(CPLGetConfigOption("MS_SHAPEFILE_POOL_SIZE", "32"));
+}
+
+/*
+** Stat the files of the shapefile named like msSHPOpen() accepts it, with or
+** without extension. Returns MS_FAILURE if the .shp, .shx or .dbf is missing.
+*/
+static int msShapefilePoolStamp(const char *filename, shapefileStamp *stamp) {
+  static const char *const extensions[MS_SHAPEFILE_STAMP_FILES] = {
+      "shp", "shx", "dbf", "qix"};
+  char path[MS_MAXPATHLEN];
+  VSIStatBufL stat;
+  size_t length;
+  int i, j;
+
+  length = strlen(filename);
+  for (i = (int)length - 1;
+       i > 0 && filename[i] != '.' && filename[i] != '/' && filename[i] != '\\';
+       i--) {
+  }
+  if (i > 0 && filename[i] == '.')
+    length = i;
+  if (length + 5 > sizeof(path))
+    return MS_FAILURE;
+
+  for (i = 0; i < MS_SHAPEFILE_STAMP_FILES; i++) {
+    memcpy(path, filename, length);
+    path[length] = '.';
+    strcpy(path + length + 1, extensions[i]);
+    if (VSIStatL(path, &stat) != 0) {
+      for (j = length + 1; path[j]; j++)
+        path[j] = toupper((unsigned char)path[j]);
+      if (VSIStatL(path, &stat) != 0) {
+        if (i < MS_SHAPEFILE_STAMP_FILES - 1)
+          return MS_FAILURE; /* only the .qix is optional */
+        stamp->mtime[i] = 0;
+        stamp->size[i] = -1;
+        continue;
+      }
+    }
+    stamp->mtime[i] = stat.st_mtime;
+    stamp->size[i] = (GIntBig)stat.st_size;
+  }
+
+  return MS_SUCCESS;
+}
+
+static int msShapefilePoolSameFile(const shapefileStamp *a,
+                                   const shapefileStamp *b) {
+  int i;
+
+  for (i = 0; i < MS_SHAPEFILE_STAMP_FILES; i++) {
+    if (a->mtime[i] != b->mtime[i] || a->size[i] != b->size[i])
+      return MS_FALSE;
+  }
+  return MS_TRUE;
+}
+
+static void msShapefilePoolUnlink(shapefilePoolEntry *entry) {
+  if (entry->prev)
+    entry->prev->next = entry->next;
+  else
+    shapefilePoolHead = entry->next;
+  if (entry->next)
+    entry->next->prev = entry->prev;
+  else
+    shapefilePoolTail = entry->prev;
+  shapefilePoolCount--;
+}
+
+int msShapefilePoolOpen(shapefileObj *shpfile, const char *filename,
+                        int log_failures) {
+  shapefilePoolEntry *entry = NULL;
+  shapefileStamp stamp;
+
+  if (filename && msShapefilePoolSize() > 0 &&
+      msShapefilePoolStamp(filename, &stamp) == MS_SUCCESS) {
+    msAcquireLock(TLOCK_SHPPOOL);
+    for (entry = shapefilePoolHead; entry; entry = entry->next) {
+      if (strcmp(entry->shpfile.source, filename) == 0 &&
+          msShapefilePoolSameFile(&entry->stamp, &stamp)) {
+        msShapefilePoolUnlink(entry);
+        break;
+      }
+    }
+    msReleaseLock(TLOCK_SHPPOOL);
+  }
+
+  if (!entry)
+    return msShapefileOpen(shpfile, "rb", filename, log_failures);
+
+  *shpfile = entry->shpfile;
+  shpfile->lastshape = -1;
+  free(entry);
+  return 0;
+}
+
+void msShapefilePoolRelease(shapefileObj *shpfile) {
+  shapefilePoolEntry *entry, *evicted = NULL;
+  shapefileStamp stamp;
+  int size = msShapefilePoolSize();
+
+  if (!shpfile || shpfile->isopen != MS_TRUE)
+    return;
+  if (size <= 0 ||
+      msShapefilePoolStamp(shpfile->source, &stamp) != MS_SUCCESS) {
+    msShapefileClose(shpfile);
+    return;
+  }
+
+  free(shpfile->status);
+  shpfile->status = NULL;
+  shpfile->lastshape = -1;
+
+  entry = (shapefilePoolEntry *)msSmallCalloc(1, sizeof(shapefilePoolEntry));
+  entry->shpfile = *shpfile;
+  entry->stamp = stamp;
+  shpfile->isopen = MS_FALSE; /* the pool owns the handles now */
+
+  msAcquireLock(TLOCK_SHPPOOL);
+  entry->next = shapefilePoolHead;
+  if (shapefilePoolHead)
+    shapefilePoolHead->prev = entry;
+  shapefilePoolHead = entry;
+  if (!shapefilePoolTail)
+    shapefilePoolTail = entry;
+  shapefilePoolCount++;
+  while (shapefilePoolCount > size) {
+    shapefilePoolEntry *last = shapefilePoolTail;
+    msShapefilePoolUnlink(last);
+    last->next = evicted;
+    evicted = last;
+  }
+  msReleaseLock(TLOCK_SHPPOOL);
+
+  while (evicted) {
+    entry = evicted;
+    evicted = evicted->next;
+    msShapefileClose(&entry->shpfile);
+    free(entry);
+  }
+}
+
+static void msFreeTileIndexBounds(tileIndexBounds *tib) {
+  free(tib->bounds);
+  free(tib->valid);
+  free(tib);
+}
+
+void msShapefilePoolCleanup(void) {
+  msAcquireLock(TLOCK_SHPPOOL);
+  while (shapefilePoolHead) {
+    shapefilePoolEntry *entry = shapefilePoolHead;
+    msShapefilePoolUnlink(entry);
+    msShapefileClose(&entry->shpfile);
+    free(entry);
+  }
+  while (tileIndexBoundsList) {
+    tileIndexBounds *tib = tileIndexBoundsList;
+    tileIndexBoundsList = tib->next;
+    msFreeTileIndexBounds(tib);
+  }
+  tileIndexBoundsCount = 0;
+  msReleaseLock(TLOCK_SHPPOOL);
+}
+
+static tileIndexBounds *msLoadTileIndexBounds(shapefileObj *tileshpfile,
+                                              const shapefileStamp *stamp) {
+  tileIndexBounds *tib;
+  int i;
+
+  tib = (tileIndexBounds *)msSmallCalloc(1, sizeof(tileIndexBounds));
+  strlcpy(tib->source, tileshpfile->source, sizeof(tib->source));
+  tib->stamp = *stamp;
+  tib->numshapes = tileshpfile->numshapes;
+  tib->bounds =
+      (rectObj *)msSmallMalloc(sizeof(rectObj) * MS_MAX(tib->numshapes, 1));
+  tib->valid = msAllocBitArray(MS_MAX(tib->numshapes, 1));
+  if (!tib->valid) {
+    msFreeTileIndexBounds(tib);
+    return NULL;
+  }
+
+  for (i = 0; i < tib->numshapes; i++) {
+    if (msSHPReadBounds(tileshpfile->hSHP, i, &tib->bounds[i]) != MS_SUCCESS) {
+      if (msSHXReadSize(tileshpfile->hSHP, i) == 4) /* NULL shape */
+        continue;
+      msFreeTileIndexBounds(tib);
+      return NULL;
+    }
+    msSetBit(tib->valid, i, 1);
+  }
+
+  return tib;
+}
+
+/*
+** Find the cached bounds of a tile index and make them the most recently
+** used, dropping them if stale. Must be called with TLOCK_SHPPOOL held.
+*/
+static tileIndexBounds *msFindTileIndexBounds(const shapefileObj *tileshpfile,
+                                              const shapefileStamp *stamp) {
+  tileIndexBounds *tib, **prev;
+
+  for (prev = &tileIndexBoundsList; *prev; prev = &(*prev)->next) {
+    if (strcmp((*prev)->source, tileshpfile->source) == 0)
+      break;
+  }
+  tib = *prev;
+  if (!tib)
+    return NULL;
+  *prev = tib->next;
+  if (!msShapefilePoolSameFile(&tib->stamp, stamp) ||
+      tib->numshapes != tileshpfile->numshapes) {
+    tileIndexBoundsCount--;
+    msFreeTileIndexBounds(tib); /* stale */
+    return NULL;
+  }
+  tib->next = tileIndexBoundsList;
+  tileIndexBoundsList = tib;
+  return tib;
+}
+
+/*
+** Same as msShapefileWhichShapes() for a tile index, using the tile bounds
+** cached with the shapefile pool. The bounds of at most
+** MS_SHAPEFILE_POOL_SIZE tile indexes are kept, and they are read without
+** holding TLOCK_SHPPOOL.
+*/
+static int msTiledSHPWhichTiles(shapefileObj *tileshpfile, rectObj rect,
+                                int debug) {
+  tileIndexBounds *tib, *loaded = NULL;
+  shapefileStamp stamp;
+  const int size = msShapefilePoolSize();
+  int i;
+
+  if (size <= 0 ||
+      msShapefilePoolStamp(tileshpfile->source, &stamp) != MS_SUCCESS)
+    return msShapefileWhichShapes(tileshpfile, rect, debug);
+
+  free(tileshpfile->status);
+  tileshpfile->status = NULL;
+  tileshpfile->lastshape = -1;
+
+  if (msRectOverlap(&tileshpfile->bounds, &rect) != MS_TRUE)
+    return (MS_DONE);
+
+  msAcquireLock(TLOCK_SHPPOOL);
+  tib = msFindTileIndexBounds(tileshpfile, &stamp);
+  if (!tib) {
+    msReleaseLock(TLOCK_SHPPOOL);
+    loaded = msLoadTileIndexBounds(tileshpfile, &stamp);
+    if (!loaded) {
+      msResetErrorList();
+      return msShapefileWhichShapes(tileshpfile, rect, debug);
+    }
+    msAcquireLock(TLOCK_SHPPOOL);
+    /* another thread may have loaded them meanwhile */
+    tib = msFindTileIndexBounds(tileshpfile, &stamp);
+    if (!tib) {
+      tib = loaded;
+      loaded = NULL;
+      tib->next = tileIndexBoundsList;
+      tileIndexBoundsList = tib;
+      tileIndexBoundsCount++;
+      if (tileIndexBoundsCount > size) { /* drop the least recently used */
+        tileIndexBounds **last = &tileIndexBoundsList;
+        while ((*last)->next)
+          last = &(*last)->next;
+        msFreeTileIndexBounds(*last);
+        *last = NULL;
+        tileIndexBoundsCount--;
+      }
+    }
+  }
+
+  tileshpfile->status = msAllocBitArray(MS_MAX(tib->numshapes, 1));
+  if (tileshpfile->status) {
+    for (i = 0; i < tib->numshapes; i++) {
+      if (msGetBit(tib->valid, i) &&
+          msRectOverlap(&tib->bounds[i], &rect) == MS_TRUE)
+        msSetBit(tileshpfile->status, i, 1);
+    }
+  }
+  msReleaseLock(TLOCK_SHPPOOL);
+
+  if (loaded)
+    msFreeTileIndexBounds(loaded);
+
+  if (!tileshpfile->status) {
+    msSetError(MS_MEMERR, NULL, "msTiledSHPWhichTiles()");
+    return (MS_FAILURE);
+  }
+
+  return (MS_SUCCESS);
+}
+
 /* Return the absolute path to the given layer's tileindex file's directory */
 void msTileIndexAbsoluteDir(char *tiFileAbsDir, layerObj *layer) {
   char tiFileAbsPath[MS_MAXPATHLEN];
@@ -2111,17 +2454,17 @@ static int msTiledSHPTryOpen(shapefileObj *shpfile, layerObj *layer,
   if (ignore_missing == MS_MISSING_DATA_IGNORE)
     log_failures = MS_FALSE;
 
-  if (msShapefileOpen(shpfile, "rb",
-                      msBuildPath3(szPath, layer->map->mappath,
-                                   layer->map->shapepath, filename),
-                      log_failures) == -1) {
-    if (msShapefileOpen(
-            shpfile, "rb",
+  if (msShapefilePoolOpen(shpfile,
+                          msBuildPath3(szPath, layer->map->mappath,
+                                       layer->map->shapepath, filename),
+                          log_failures) == -1) {
+    if (msShapefilePoolOpen(
+            shpfile,
             msBuildPath3(szPath, tiFileAbsDir, layer->map->shapepath, filename),
             log_failures) == -1) {
-      if (msShapefileOpen(shpfile, "rb",
-                          msBuildPath(szPath, layer->map->mappath, filename),
-                          log_failures) == -1) {
+      if (msShapefilePoolOpen(
+              shpfile, msBuildPath(szPath, layer->map->mappath, filename),
+              log_failures) == -1) {
         if (ignore_missing == MS_MISSING_DATA_FAIL) {
           msSetError(
               MS_IOERR,
@@ -2259,12 +2602,13 @@ static int msTiledSHPOpenFile(layerObj *layer) {
       return MS_FAILURE;
     }
 
-    if (msShapefileOpen(tSHP->tileshpfile, "rb",
-                        msBuildPath3(szPath, layer->map->mappath,
-                                     layer->map->shapepath, layer->tileindex),
-                        MS_TRUE) == -1)
-      if (msShapefileOpen(
-              tSHP->tileshpfile, "rb",
+    if (msShapefilePoolOpen(tSHP->tileshpfile,
+                            msBuildPath3(szPath, layer->map->mappath,
+                                         layer->map->shapepath,
+                                         layer->tileindex),
+                            MS_TRUE) == -1)
+      if (msShapefilePoolOpen(
+              tSHP->tileshpfile,
               msBuildPath(szPath, layer->map->mappath, layer->tileindex),
               MS_TRUE) == -1)
         return (MS_FAILURE);
@@ -2332,7 +2676,7 @@ static int msTiledSHPWhichShapes(layerObj *layer, rectObj rect, int isQuery) {
     return (MS_FAILURE);
   }
 
-  msShapefileClose(tSHP->shpfile); /* close previously opened files */
+  msShapefilePoolRelease(tSHP->shpfile); /* close previously opened files */
 
   tSHP->searchrect = rect; /* save the search extent */
 
@@ -2372,7 +2716,7 @@ static int msTiledSHPWhichShapes(layerObj *layer, rectObj rect, int isQuery) {
       status = msShapefileWhichShapes(tSHP->shpfile, rectTile, layer->debug);
       if (status == MS_DONE) {
         /* Close and continue to next tile */
-        msShapefileClose(tSHP->shpfile);
+        msShapefilePoolRelease(tSHP->shpfile);
         continue;
       } else if (status != MS_SUCCESS) {
         msShapefileClose(tSHP->shpfile);
@@ -2389,7 +2733,7 @@ static int msTiledSHPWhichShapes(layerObj *layer, rectObj rect, int isQuery) {
   } else { /* or reference a shapefile directly */
     int try_open;
 
-    status = msShapefileWhichShapes(tSHP->tileshpfile, rect, layer->debug);
+    status = msTiledSHPWhichTiles(tSHP->tileshpfile, rect, layer->debug);
     if (status != MS_SUCCESS)
       return (status); /* could be MS_DONE or MS_FAILURE */
 
@@ -2418,7 +2762,7 @@ static int msTiledSHPWhichShapes(layerObj *layer, rectObj rect, int isQuery) {
         status = msShapefileWhichShapes(tSHP->shpfile, rectTile, layer->debug);
         if (status == MS_DONE) {
           /* Close and continue to next tile */
-          msShapefileClose(tSHP->shpfile);
+          msShapefilePoolRelease(tSHP->shpfile);
           continue;
         } else if (status != MS_SUCCESS) {
           msShapefileClose(tSHP->shpfile);
@@ -2466,7 +2810,7 @@ static int msTiledSHPNextShape(layerObj *layer, shapeObj *shape) {
 
     if (i ==
         tSHP->shpfile->numshapes) {    /* done with this tile, need a new one */
-      msShapefileClose(tSHP->shpfile); /* clean up */
+      msShapefilePoolRelease(tSHP->shpfile); /* clean up */
 
       /* position the source to the NEXT shapefile based on the tileindex */
       if (tSHP->tilelayerindex !=
@@ -2501,7 +2845,7 @@ static int msTiledSHPNextShape(layerObj *layer, shapeObj *shape) {
               msShapefileWhichShapes(tSHP->shpfile, rectTile, layer->debug);
           if (status == MS_DONE) {
             /* Close and continue to next tile */
-            msShapefileClose(tSHP->shpfile);
+            msShapefilePoolRelease(tSHP->shpfile);
             continue;
           } else if (status != MS_SUCCESS) {
             msShapefileClose(tSHP->shpfile);
@@ -2551,7 +2895,7 @@ static int msTiledSHPNextShape(layerObj *layer, shapeObj *shape) {
                 msShapefileWhichShapes(tSHP->shpfile, rectTile, layer->debug);
             if (status == MS_DONE) {
               /* Close and continue to next tile */
-              msShapefileClose(tSHP->shpfile);
+              msShapefilePoolRelease(tSHP->shpfile);
               continue;
             } else if (status != MS_SUCCESS) {
               msShapefileClose(tSHP->shpfile);
@@ -2641,7 +2985,7 @@ static int msTiledSHPGetShape(layerObj *layer, shapeObj *shape,
   if (tileindex !=
       tSHP->tileshpfile->lastshape) { /* correct tile is not currently open so
                                          open the correct tile */
-    msShapefileClose(tSHP->shpfile);  /* close current tile */
+    msShapefilePoolRelease(tSHP->shpfile); /* close current tile */
 
     filename =
         msTiledSHPLoadEntry(layer, tileindex, tilename, sizeof(tilename));
@@ -2650,17 +2994,18 @@ static int msTiledSHPGetShape(layerObj *layer, shapeObj *shape,
      * generated if that tile does not exist */
     if (strlen(filename) == 0)
       return (MS_FAILURE);
-    if (msShapefileOpen(
-            tSHP->shpfile, "rb",
+    if (msShapefilePoolOpen(
+            tSHP->shpfile,
             msBuildPath3(szPath, tiFileAbsDir, layer->map->shapepath, filename),
             MS_TRUE) == -1) {
-      if (msShapefileOpen(tSHP->shpfile, "rb",
-                          msBuildPath3(szPath, layer->map->mappath,
-                                       layer->map->shapepath, filename),
-                          MS_TRUE) == -1) {
-        if (msShapefileOpen(tSHP->shpfile, "rb",
-                            msBuildPath(szPath, layer->map->mappath, filename),
-                            MS_TRUE) == -1) {
+      if (msShapefilePoolOpen(tSHP->shpfile,
+                              msBuildPath3(szPath, layer->map->mappath,
+                                           layer->map->shapepath, filename),
+                              MS_TRUE) == -1) {
+        if (msShapefilePoolOpen(
+                tSHP->shpfile,
+                msBuildPath(szPath, layer->map->mappath, filename),
+                MS_TRUE) == -1) {
           return (MS_FAILURE);
         }
       }
@@ -2702,7 +3047,7 @@ static void msTiledSHPClose(layerObj *layer) {
 
   tSHP = layer->layerinfo;
   if (tSHP) {
-    msShapefileClose(tSHP->shpfile);
+    msShapefilePoolRelease(tSHP->shpfile);
     free(tSHP->shpfile);
 
     if (tSHP->tilelayerindex != -1) {
@@ -2712,7 +3057,7 @@ static void msTiledSHPClose(layerObj *layer) {
       tlp = (GET_LAYER(layer->map, tSHP->tilelayerindex));
       msLayerClose(tlp);
     } else {
-      msShapefileClose(tSHP->tileshpfile);
+      msShapefilePoolRelease(tSHP->tileshpfile);
       free(tSHP->tileshpfile);
     }
 
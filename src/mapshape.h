@@ -35,6 +35,7 @@
 #include "mapproject.h"
 
 #include "cpl_vsi.h"
+#include "cpl_virtualmem.h"
 
 #ifdef __cplusplus
 extern "C" {
@@ -149,6 +150,9 @@ typedef struct {
   int nStringFieldLen;
 
   char *pszEncoding;
+
+  CPLVirtualMem *psMap; /* read-only mapping of the file, or NULL */
+  const char *pabyMap;  /* start of the mapping */
 #endif /* not SWIG */
 } DBFInfo;
 
@@ -208,6 +212,10 @@ MS_DLL_EXPORT int msShapefileOpen(shapefileObj *shpfile, const char *mode,
 MS_DLL_EXPORT int msShapefileCreate(shapefileObj *shpfile, char *filename,
                                     int type);
 MS_DLL_EXPORT void msShapefileClose(shapefileObj *shpfile);
+MS_DLL_EXPORT int msShapefilePoolOpen(shapefileObj *shpfile,
+                                      const char *filename, int log_failures);
+MS_DLL_EXPORT void msShapefilePoolRelease(shapefileObj *shpfile);
+MS_DLL_EXPORT void msShapefilePoolCleanup(void);
 MS_DLL_EXPORT int msShapefileWhichShapes(shapefileObj *shpfile, rectObj rect,
                                          int debug);
 
@@ -4126,12 +4126,12 @@ static char *processLine(mapservObj *mapserv, const char *instr, FILE *stream,
     msFree(ol);
   }
 
-  if (getenv("HTTP_HOST")) {
-    snprintf(repstr, PROCESSLINE_BUFLEN, "%s", getenv("HTTP_HOST"));
+  if (msIO_getenv("HTTP_HOST")) {
+    snprintf(repstr, PROCESSLINE_BUFLEN, "%s", msIO_getenv("HTTP_HOST"));
     outstr = msReplaceSubstring(outstr, "[host]", repstr);
   }
-  if (getenv("SERVER_PORT")) {
-    snprintf(repstr, PROCESSLINE_BUFLEN, "%s", getenv("SERVER_PORT"));
+  if (msIO_getenv("SERVER_PORT")) {
+    snprintf(repstr, PROCESSLINE_BUFLEN, "%s", msIO_getenv("SERVER_PORT"));
     outstr = msReplaceSubstring(outstr, "[port]", repstr);
   }
 
@@ -69,8 +69,16 @@ void msReleaseLock(int);
 #define TLOCK_FRIBIDI 16
 #define TLOCK_WxS 17
 #define TLOCK_GEOS 18
+#define TLOCK_RESAMPLE 19
+#define TLOCK_RASTERLUT 20
+#define TLOCK_TEXTLAYOUT 21
+#define TLOCK_GLYPHCACHE 22
+#define TLOCK_SHPPOOL 23
+#define TLOCK_METRICS 24
+#define TLOCK_RESPCACHE 25
+#define TLOCK_FCGI 26
 
-#define TLOCK_STATIC_MAX 20
+#define TLOCK_STATIC_MAX 30
 #define TLOCK_MAX 100
 
 #ifdef __cplusplus
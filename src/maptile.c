@@ -122,9 +122,10 @@ static void msTileGetParams(const mapservObj *msObj, tileParams *params) {
 /************************************************************************
  *                            msTileExtractSubTile                      *
  *                                                                      *
+ *  Clip the tile addressed by msObj->TileCoords out of a metatile      *
+ *  drawn for the extent set by msTileSetExtent().                      *
  ************************************************************************/
-static imageObj *msTileExtractSubTile(const mapservObj *msObj,
-                                      const imageObj *img) {
+imageObj *msTileExtractSubTile(const mapservObj *msObj, const imageObj *img) {
 
   int width, mini, minj;
   int zoom = 2;
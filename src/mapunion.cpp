@@ -33,6 +33,10 @@
 #include <assert.h>
 #include "mapserver.h"
 
+#ifdef USE_THREAD
+#include "cpl_multiproc.h"
+#endif
+
 #define MSUNION_NUMITEMS 3
 #define MSUNION_SOURCELAYERNAME "Union_SourceLayerName"
 #define MSUNION_SOURCELAYERNAMEINDEX -100
@@ -41,6 +45,9 @@
 #define MSUNION_SOURCELAYERVISIBLE "Union_SourceLayerVisible"
 #define MSUNION_SOURCELAYERVISIBLEINDEX -102
 
+/* upper bound of PROCESSING "UNION_READ_THREADS" */
+#define MSUNION_READ_THREADS_MAX 32
+
 typedef struct {
   int layerIndex;   /* current source layer index */
   int classIndex;   /* current class index */
@@ -361,6 +368,176 @@ int msUnionLayerInitItemInfo(layerObj *const layer) {
   return MS_SUCCESS;
 }
 
+/* number of threads issuing the source layer queries */
+static int msUnionLayerGetReadThreads(layerObj *const layer) {
+#ifdef USE_THREAD
+  const char *value = msLayerGetProcessingKey(layer, "UNION_READ_THREADS");
+  if (value == NULL)
+    return 1;
+
+  const int threads = EQUAL(value, "ALL_CPUS") ? CPLGetNumCPUs() : atoi(value);
+  return MS_MAX(1, MS_MIN(threads, MSUNION_READ_THREADS_MAX));
+#else
+  (void)layer;
+  return 1;
+#endif
+}
+
+typedef struct {
+  layerObj *layer;
+  rectObj rect;
+  int isQuery;
+  int *status;
+  /* next job sharing the connection of this one, -1 if none */
+  int next;
+  /* error raised by the query, reported by the calling thread */
+  int errorCode;
+  char errorRoutine[ROUTINELENGTH];
+  char errorMessage[MESSAGELENGTH];
+} msUnionWhichShapesJob;
+
+#ifdef USE_THREAD
+typedef struct {
+  msUnionWhichShapesJob *jobs;
+  /* first job of each group of jobs sharing a connection */
+  int *groups;
+  int numGroups;
+  int nextGroup;
+  CPLMutex *mutex;
+} msUnionWhichShapesPool;
+
+/*
+** Source layers with the same CONNECTIONTYPE and CONNECTION may get the
+** same handle from the connection pool (they are all opened by the calling
+** thread), which must not be used by two threads at once.
+*/
+static int msUnionLayersShareConnection(const layerObj *a,
+                                        const layerObj *b) {
+  return a->connectiontype == b->connectiontype && a->connection &&
+         b->connection && strcasecmp(a->connection, b->connection) == 0;
+}
+
+static void msUnionWhichShapesWorker(void *arg) {
+  msUnionWhichShapesPool *pool = static_cast<msUnionWhichShapesPool *>(arg);
+  for (;;) {
+    CPLAcquireMutex(pool->mutex, 1000.0);
+    const int group = pool->nextGroup++;
+    CPLReleaseMutex(pool->mutex);
+    if (group >= pool->numGroups)
+      break;
+
+    /* the jobs of a group are run one after the other */
+    for (int i = pool->groups[group]; i >= 0; i = pool->jobs[i].next) {
+      msUnionWhichShapesJob *job = &pool->jobs[i];
+      *job->status = msLayerWhichShapes(job->layer, job->rect, job->isQuery);
+      if (*job->status == MS_FAILURE) {
+        const errorObj *error = msGetErrorObj();
+        job->errorCode = error->code;
+        strlcpy(job->errorRoutine, error->routine, sizeof(job->errorRoutine));
+        strlcpy(job->errorMessage, error->message, sizeof(job->errorMessage));
+        msResetErrorList();
+      }
+    }
+  }
+  /* errors were copied to the jobs, don't leave them on this thread */
+  msResetErrorList();
+}
+#endif
+
+/*
+** Issue the queries of the source layers, concurrently when
+** PROCESSING "UNION_READ_THREADS" asks for it. Source layers sharing a
+** connection are queried by the same thread. The shapes are still read
+** in source layer order by msUnionLayerNextShape().
+*/
+static int msUnionLayerRunWhichShapes(layerObj *const layer,
+                                      msUnionWhichShapesJob *jobs,
+                                      int numJobs) {
+  int threads = MS_MIN(msUnionLayerGetReadThreads(layer), numJobs);
+#ifdef USE_THREAD
+  int *groups = NULL;
+  int numGroups = 0;
+
+  if (threads > 1) {
+    /* chain the jobs sharing a connection behind the first one */
+    groups = static_cast<int *>(msSmallMalloc(numJobs * sizeof(int)));
+    for (int i = 0; i < numJobs; i++) {
+      int g = 0;
+      jobs[i].next = -1;
+      while (g < numGroups && !msUnionLayersShareConnection(
+                                  jobs[groups[g]].layer, jobs[i].layer))
+        g++;
+      if (g == numGroups) {
+        groups[numGroups++] = i;
+      } else {
+        int last = groups[g];
+        while (jobs[last].next >= 0)
+          last = jobs[last].next;
+        jobs[last].next = i;
+      }
+    }
+    threads = MS_MIN(threads, numGroups);
+    if (threads <= 1)
+      msFree(groups);
+  }
+#endif
+
+  if (threads <= 1) {
+    for (int i = 0; i < numJobs; i++) {
+      *jobs[i].status =
+          msLayerWhichShapes(jobs[i].layer, jobs[i].rect, jobs[i].isQuery);
+      if (*jobs[i].status == MS_FAILURE)
+        return MS_FAILURE;
+    }
+    return MS_SUCCESS;
+  }
+
+#ifdef USE_THREAD
+  if (layer->debug >= MS_DEBUGLEVEL_V)
+    msDebug("msUnionLayerWhichShapes(): querying %d source layers (%d "
+            "connections) with %d threads.\n",
+            numJobs, numGroups, threads);
+
+  msUnionWhichShapesPool pool;
+  pool.jobs = jobs;
+  pool.groups = groups;
+  pool.numGroups = numGroups;
+  pool.nextGroup = 0;
+  pool.mutex = CPLCreateMutex(); /* created acquired */
+  CPLReleaseMutex(pool.mutex);
+
+  CPLJoinableThread **handles = static_cast<CPLJoinableThread **>(
+      msSmallCalloc(threads, sizeof(CPLJoinableThread *)));
+  for (int i = 0; i < threads; i++)
+    handles[i] = CPLCreateJoinableThread(msUnionWhichShapesWorker, &pool);
+  for (int i = 0; i < threads; i++) {
+    if (handles[i])
+      CPLJoinThread(handles[i]);
+  }
+  msFree(handles);
+  CPLDestroyMutex(pool.mutex);
+
+  /* the jobs no thread could be started for */
+  for (int g = pool.nextGroup; g < numGroups; g++) {
+    for (int i = groups[g]; i >= 0; i = jobs[i].next)
+      *jobs[i].status =
+          msLayerWhichShapes(jobs[i].layer, jobs[i].rect, jobs[i].isQuery);
+  }
+  msFree(groups);
+
+  /* report the first failure in source layer order */
+  for (int i = 0; i < numJobs; i++) {
+    if (*jobs[i].status == MS_FAILURE) {
+      if (jobs[i].errorCode != 0)
+        msSetError(jobs[i].errorCode, "%s", jobs[i].errorRoutine,
+                   jobs[i].errorMessage);
+      return MS_FAILURE;
+    }
+  }
+#endif
+  return MS_SUCCESS;
+}
+
 // cppcheck-suppress passedByValue
 int msUnionLayerWhichShapes(layerObj *const layer, rectObj rect, int isQuery) {
   msUnionLayerInfo *layerinfo = (msUnionLayerInfo *)layer->layerinfo;
@@ -368,6 +545,11 @@ int msUnionLayerWhichShapes(layerObj *const layer, rectObj rect, int isQuery) {
   if (!layerinfo || !layer->map)
     return MS_FAILURE;
 
+  msUnionWhichShapesJob *jobs = static_cast<msUnionWhichShapesJob *>(
+      msSmallCalloc(MS_MAX(1, layerinfo->layerCount),
+                    sizeof(msUnionWhichShapesJob)));
+  int numJobs = 0;
+
   for (int i = 0; i < layerinfo->layerCount; i++) {
     layerObj *const srclayer = &layerinfo->layers[i];
 
@@ -379,8 +561,10 @@ int msUnionLayerWhichShapes(layerObj *const layer, rectObj rect, int isQuery) {
       msUnionLayerFreeExpressionTokens(srclayer);
 
       /* get only the required items */
-      if (msLayerWhichItems(srclayer, MS_FALSE, NULL) != MS_SUCCESS)
+      if (msLayerWhichItems(srclayer, MS_FALSE, NULL) != MS_SUCCESS) {
+        msFree(jobs);
         return MS_FAILURE;
+      }
     }
 
     rectObj srcRect = rect;
@@ -391,11 +575,18 @@ int msUnionLayerWhichShapes(layerObj *const layer, rectObj rect, int isQuery) {
       msProjectRect(&layer->projection, &srclayer->projection,
                     &srcRect); /* project the searchrect to source coords */
 
-    layerinfo->status[i] = msLayerWhichShapes(srclayer, srcRect, isQuery);
-    if (layerinfo->status[i] == MS_FAILURE)
-      return MS_FAILURE;
+    jobs[numJobs].layer = srclayer;
+    jobs[numJobs].rect = srcRect;
+    jobs[numJobs].isQuery = isQuery;
+    jobs[numJobs].status = &layerinfo->status[i];
+    ++numJobs;
   }
 
+  const int status = msUnionLayerRunWhichShapes(layer, jobs, numJobs);
+  msFree(jobs);
+  if (status != MS_SUCCESS)
+    return MS_FAILURE;
+
   layerinfo->layerIndex = 0;
   layerObj *const srclayer = &layerinfo->layers[0];
 
@@ -441,6 +632,7 @@ static int BuildFeatureAttributes(layerObj *const layer,
 
   shape->values = values;
   shape->numvalues = layer->numitems;
+  msShapeRemapTypedValues(shape, itemindexes, layer->numitems);
 
   return MS_SUCCESS;
 }
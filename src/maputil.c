@@ -37,8 +37,10 @@
 #include "mapserver.h"
 #include "maptime.h"
 #include "mapthread.h"
+#include "mapmetrics.h"
 #include "mapcopy.h"
 #include "mapows.h"
+#include "uthash.h"
 
 #include "gdal.h"
 #include "cpl_conv.h"
@@ -77,7 +79,13 @@ int msScaleInBounds(double scale, double minscale, double maxscale) {
 /*
 ** Helper functions to convert from strings to other types or objects.
 */
-static int bindIntegerAttribute(int *attribute, const char *value) {
+static int bindIntegerAttribute(int *attribute, shapeObj *shape, int index) {
+  const char *value = shape->values[index];
+  double number;
+  if (msShapeGetNumericValue(shape, index, &number)) {
+    *attribute = MS_NINT(number);
+    return MS_SUCCESS;
+  }
   if (!value || strlen(value) == 0)
     return MS_FAILURE;
   *attribute =
@@ -85,7 +93,10 @@ static int bindIntegerAttribute(int *attribute, const char *value) {
   return MS_SUCCESS;
 }
 
-static int bindDoubleAttribute(double *attribute, const char *value) {
+static int bindDoubleAttribute(double *attribute, shapeObj *shape, int index) {
+  const char *value = shape->values[index];
+  if (msShapeGetNumericValue(shape, index, attribute))
+    return MS_SUCCESS;
   if (!value || strlen(value) == 0)
     return MS_FAILURE;
   *attribute = atof(value);
@@ -154,21 +165,18 @@ static void bindStyle(layerObj *layer, shapeObj *shape, styleObj *style,
     }
     if (style->bindings[MS_STYLE_BINDING_ANGLE].index != -1) {
       style->angle = 360.0;
-      bindDoubleAttribute(
-          &style->angle,
-          shape->values[style->bindings[MS_STYLE_BINDING_ANGLE].index]);
+      bindDoubleAttribute(&style->angle, shape,
+                          style->bindings[MS_STYLE_BINDING_ANGLE].index);
     }
     if (style->bindings[MS_STYLE_BINDING_SIZE].index != -1) {
       style->size = 1;
-      bindDoubleAttribute(
-          &style->size,
-          shape->values[style->bindings[MS_STYLE_BINDING_SIZE].index]);
+      bindDoubleAttribute(&style->size, shape,
+                          style->bindings[MS_STYLE_BINDING_SIZE].index);
     }
     if (style->bindings[MS_STYLE_BINDING_WIDTH].index != -1) {
       style->width = 1;
-      bindDoubleAttribute(
-          &style->width,
-          shape->values[style->bindings[MS_STYLE_BINDING_WIDTH].index]);
+      bindDoubleAttribute(&style->width, shape,
+                          style->bindings[MS_STYLE_BINDING_WIDTH].index);
     }
     if (style->bindings[MS_STYLE_BINDING_COLOR].index != -1 &&
         !MS_DRAW_QUERY(drawmode)) {
@@ -186,41 +194,35 @@ static void bindStyle(layerObj *layer, shapeObj *shape, styleObj *style,
     }
     if (style->bindings[MS_STYLE_BINDING_OUTLINEWIDTH].index != -1) {
       style->outlinewidth = 1;
-      bindDoubleAttribute(
-          &style->outlinewidth,
-          shape->values[style->bindings[MS_STYLE_BINDING_OUTLINEWIDTH].index]);
+      bindDoubleAttribute(&style->outlinewidth, shape,
+                          style->bindings[MS_STYLE_BINDING_OUTLINEWIDTH].index);
     }
     if (style->bindings[MS_STYLE_BINDING_OPACITY].index != -1) {
       style->opacity = 100;
-      bindIntegerAttribute(
-          &style->opacity,
-          shape->values[style->bindings[MS_STYLE_BINDING_OPACITY].index]);
+      bindIntegerAttribute(&style->opacity, shape,
+                           style->bindings[MS_STYLE_BINDING_OPACITY].index);
     }
     if (style->bindings[MS_STYLE_BINDING_OFFSET_X].index != -1) {
       style->offsetx = 0;
-      bindDoubleAttribute(
-          &style->offsetx,
-          shape->values[style->bindings[MS_STYLE_BINDING_OFFSET_X].index]);
+      bindDoubleAttribute(&style->offsetx, shape,
+                          style->bindings[MS_STYLE_BINDING_OFFSET_X].index);
     }
     if (style->bindings[MS_STYLE_BINDING_OFFSET_Y].index != -1) {
       style->offsety = 0;
-      bindDoubleAttribute(
-          &style->offsety,
-          shape->values[style->bindings[MS_STYLE_BINDING_OFFSET_Y].index]);
+      bindDoubleAttribute(&style->offsety, shape,
+                          style->bindings[MS_STYLE_BINDING_OFFSET_Y].index);
     }
     if (style->bindings[MS_STYLE_BINDING_POLAROFFSET_PIXEL].index != -1) {
       style->polaroffsetpixel = 0;
       bindDoubleAttribute(
-          &style->polaroffsetpixel,
-          shape->values[style->bindings[MS_STYLE_BINDING_POLAROFFSET_PIXEL]
-                            .index]);
+          &style->polaroffsetpixel, shape,
+          style->bindings[MS_STYLE_BINDING_POLAROFFSET_PIXEL].index);
     }
     if (style->bindings[MS_STYLE_BINDING_POLAROFFSET_ANGLE].index != -1) {
       style->polaroffsetangle = 0;
       bindDoubleAttribute(
-          &style->polaroffsetangle,
-          shape->values[style->bindings[MS_STYLE_BINDING_POLAROFFSET_ANGLE]
-                            .index]);
+          &style->polaroffsetangle, shape,
+          style->bindings[MS_STYLE_BINDING_POLAROFFSET_ANGLE].index);
     }
   }
   if (style->nexprbindings > 0) {
@@ -289,16 +291,14 @@ static void bindLabel(layerObj *layer, shapeObj *shape, labelObj *label,
   if (label->numbindings > 0) {
     if (label->bindings[MS_LABEL_BINDING_ANGLE].index != -1) {
       label->angle = 0.0;
-      bindDoubleAttribute(
-          &label->angle,
-          shape->values[label->bindings[MS_LABEL_BINDING_ANGLE].index]);
+      bindDoubleAttribute(&label->angle, shape,
+                          label->bindings[MS_LABEL_BINDING_ANGLE].index);
     }
 
     if (label->bindings[MS_LABEL_BINDING_SIZE].index != -1) {
       label->size = 1;
-      bindIntegerAttribute(
-          &label->size,
-          shape->values[label->bindings[MS_LABEL_BINDING_SIZE].index]);
+      bindIntegerAttribute(&label->size, shape,
+                           label->bindings[MS_LABEL_BINDING_SIZE].index);
     }
 
     if (label->bindings[MS_LABEL_BINDING_COLOR].index != -1) {
@@ -323,43 +323,37 @@ static void bindLabel(layerObj *layer, shapeObj *shape, labelObj *label,
 
     if (label->bindings[MS_LABEL_BINDING_PRIORITY].index != -1) {
       label->priority = MS_DEFAULT_LABEL_PRIORITY;
-      bindIntegerAttribute(
-          &label->priority,
-          shape->values[label->bindings[MS_LABEL_BINDING_PRIORITY].index]);
+      bindIntegerAttribute(&label->priority, shape,
+                           label->bindings[MS_LABEL_BINDING_PRIORITY].index);
     }
 
     if (label->bindings[MS_LABEL_BINDING_SHADOWSIZEX].index != -1) {
       label->shadowsizex = 1;
-      bindIntegerAttribute(
-          &label->shadowsizex,
-          shape->values[label->bindings[MS_LABEL_BINDING_SHADOWSIZEX].index]);
+      bindIntegerAttribute(&label->shadowsizex, shape,
+                           label->bindings[MS_LABEL_BINDING_SHADOWSIZEX].index);
     }
     if (label->bindings[MS_LABEL_BINDING_SHADOWSIZEY].index != -1) {
       label->shadowsizey = 1;
-      bindIntegerAttribute(
-          &label->shadowsizey,
-          shape->values[label->bindings[MS_LABEL_BINDING_SHADOWSIZEY].index]);
+      bindIntegerAttribute(&label->shadowsizey, shape,
+                           label->bindings[MS_LABEL_BINDING_SHADOWSIZEY].index);
     }
 
     if (label->bindings[MS_LABEL_BINDING_OFFSET_X].index != -1) {
       label->offsetx = 0;
-      bindIntegerAttribute(
-          &label->offsetx,
-          shape->values[label->bindings[MS_LABEL_BINDING_OFFSET_X].index]);
+      bindIntegerAttribute(&label->offsetx, shape,
+                           label->bindings[MS_LABEL_BINDING_OFFSET_X].index);
     }
 
     if (label->bindings[MS_LABEL_BINDING_OFFSET_Y].index != -1) {
       label->offsety = 0;
-      bindIntegerAttribute(
-          &label->offsety,
-          shape->values[label->bindings[MS_LABEL_BINDING_OFFSET_Y].index]);
+      bindIntegerAttribute(&label->offsety, shape,
+                           label->bindings[MS_LABEL_BINDING_OFFSET_Y].index);
     }
 
     if (label->bindings[MS_LABEL_BINDING_ALIGN].index != -1) {
       int tmpAlign = 0;
-      bindIntegerAttribute(
-          &tmpAlign,
-          shape->values[label->bindings[MS_LABEL_BINDING_ALIGN].index]);
+      bindIntegerAttribute(&tmpAlign, shape,
+                           label->bindings[MS_LABEL_BINDING_ALIGN].index);
       if (tmpAlign != 0) { /* is this test sufficient? */
         label->align = tmpAlign;
       } else { /* Integer binding failed, look for strings like cc, ul, lr,
@@ -381,9 +375,8 @@ static void bindLabel(layerObj *layer, shapeObj *shape, labelObj *label,
 
     if (label->bindings[MS_LABEL_BINDING_POSITION].index != -1) {
       int tmpPosition = 0;
-      bindIntegerAttribute(
-          &tmpPosition,
-          shape->values[label->bindings[MS_LABEL_BINDING_POSITION].index]);
+      bindIntegerAttribute(&tmpPosition, shape,
+                           label->bindings[MS_LABEL_BINDING_POSITION].index);
       if (tmpPosition != 0) { /* is this test sufficient? */
         label->position = tmpPosition;
       } else { /* Integer binding failed, look for strings like cc, ul, lr,
@@ -800,6 +793,227 @@ int *msAllocateValidClassGroups(layerObj *lp, int *nclasses) {
   return NULL;
 }
 
+/*
+** Layers with at least this number of classes, all plain string or list
+** expressions on the CLASSITEM (or without expression), are classified
+** through a hash of the CLASSITEM values instead of testing every class.
+*/
+#define MS_CLASS_DISPATCH_MIN_CLASSES 8
+
+typedef struct {
+  char *value;
+  int *classes; /* ascending class indexes */
+  int numclasses;
+  UT_hash_handle hh;
+} classDispatchValue;
+
+typedef struct {
+  int usable; /* MS_FALSE if the classes can't be dispatched by value */
+  int numclasses;
+  int classitemindex;
+  classDispatchValue *values;
+  int *always; /* classes without expression, ascending */
+  int numalways;
+  /* copy of the last classgroup and position of each class within it */
+  int *classgroup;
+  int numclassgroup;
+  int *positions;
+  int positionsusable;
+} classDispatchObj;
+
+void msLayerFreeClassDispatch(layerObj *layer) {
+  classDispatchObj *dispatch = (classDispatchObj *)layer->classdispatch;
+  classDispatchValue *cur, *tmp;
+
+  if (!dispatch)
+    return;
+  UT_HASH_ITER(hh, dispatch->values, cur, tmp) {
+    UT_HASH_DEL(dispatch->values, cur);
+    msFree(cur->value);
+    msFree(cur->classes);
+    msFree(cur);
+  }
+  msFree(dispatch->always);
+  msFree(dispatch->classgroup);
+  msFree(dispatch->positions);
+  msFree(dispatch);
+  layer->classdispatch = NULL;
+}
+
+static void msClassDispatchAdd(classDispatchObj *dispatch, const char *value,
+                               int length, int iclass) {
+  classDispatchValue *entry;
+
+  UT_HASH_FIND(hh, dispatch->values, value, length, entry);
+  if (!entry) {
+    entry = (classDispatchValue *)msSmallCalloc(1, sizeof(classDispatchValue));
+    entry->value = (char *)msSmallMalloc(length + 1);
+    memcpy(entry->value, value, length);
+    entry->value[length] = '\0';
+    UT_HASH_ADD_KEYPTR(hh, dispatch->values, entry->value, length, entry);
+  } else if (entry->classes[entry->numclasses - 1] == iclass) {
+    return; /* same value listed twice in a class */
+  }
+  entry->classes = (int *)msSmallRealloc(
+      entry->classes, sizeof(int) * (entry->numclasses + 1));
+  entry->classes[entry->numclasses++] = iclass;
+}
+
+/*
+** The index is kept until the layer expressions are freed, and is dropped
+** by msInsertClass(), msRemoveClass(), msMoveClassUp/Down(), the mapscript
+** class setExpression(), runtime substitutions and SLD application. The
+** class count and CLASSITEM index are checked as a last resort.
+*/
+static classDispatchObj *msLayerGetClassDispatch(layerObj *layer) {
+  classDispatchObj *dispatch = (classDispatchObj *)layer->classdispatch;
+  int i;
+
+  if (dispatch && dispatch->numclasses == layer->numclasses &&
+      dispatch->classitemindex == layer->classitemindex)
+    return dispatch->usable ? dispatch : NULL;
+
+  msLayerFreeClassDispatch(layer);
+  dispatch = (classDispatchObj *)msSmallCalloc(1, sizeof(classDispatchObj));
+  dispatch->numclasses = layer->numclasses;
+  dispatch->classitemindex = layer->classitemindex;
+  layer->classdispatch = dispatch;
+
+  if (layer->numclasses < MS_CLASS_DISPATCH_MIN_CLASSES ||
+      layer->classitemindex < 0)
+    return NULL;
+
+  for (i = 0; i < layer->numclasses; i++) {
+    expressionObj *expression = &(layer->class[i] -> expression);
+
+    if (MS_STRING_IS_NULL_OR_EMPTY(expression->string) ||
+        expression->native_string != NULL) {
+      dispatch->always = (int *)msSmallRealloc(
+          dispatch->always, sizeof(int) * (dispatch->numalways + 1));
+      dispatch->always[dispatch->numalways++] = i;
+    } else if (expression->type == MS_STRING &&
+               !(expression->flags & MS_EXP_INSENSITIVE)) {
+      msClassDispatchAdd(dispatch, expression->string,
+                         strlen(expression->string), i);
+    } else if (expression->type == MS_LIST) {
+      const char *start = expression->string, *end;
+      while ((end = strchr(start, ',')) != NULL) {
+        msClassDispatchAdd(dispatch, start, end - start, i);
+        start = end + 1;
+      }
+      msClassDispatchAdd(dispatch, start, strlen(start), i);
+    } else {
+      return NULL; /* not usable, the classes are tested in order */
+    }
+  }
+  dispatch->usable = MS_TRUE;
+
+  return dispatch;
+}
+
+/*
+** Position of each class within classgroup, cached while the same
+** classgroup is passed. Returns MS_FALSE if a class appears twice.
+*/
+static int msClassDispatchSetClassGroup(classDispatchObj *dispatch,
+                                        const int *classgroup,
+                                        int numclasses) {
+  int i;
+
+  if (dispatch->classgroup && dispatch->numclassgroup == numclasses &&
+      memcmp(dispatch->classgroup, classgroup, sizeof(int) * numclasses) == 0)
+    return dispatch->positionsusable;
+
+  dispatch->classgroup = (int *)msSmallRealloc(dispatch->classgroup,
+                                               sizeof(int) * numclasses);
+  memcpy(dispatch->classgroup, classgroup, sizeof(int) * numclasses);
+  dispatch->numclassgroup = numclasses;
+  if (!dispatch->positions)
+    dispatch->positions =
+        (int *)msSmallMalloc(sizeof(int) * dispatch->numclasses);
+  for (i = 0; i < dispatch->numclasses; i++)
+    dispatch->positions[i] = -1;
+
+  dispatch->positionsusable = MS_TRUE;
+  for (i = 0; i < numclasses; i++) {
+    if (classgroup[i] < 0 || classgroup[i] >= dispatch->numclasses)
+      continue;
+    if (dispatch->positions[classgroup[i]] != -1)
+      dispatch->positionsusable = MS_FALSE;
+    dispatch->positions[classgroup[i]] = i;
+  }
+
+  return dispatch->positionsusable;
+}
+
+/*
+** Checks done on a class whose expression matched or is about to be
+** evaluated: scale range, MINFEATURESIZE and deleted classes.
+*/
+static int msClassIsApplicable(layerObj *layer, mapObj *map, shapeObj *shape,
+                               int iclass) {
+  if (!msScaleInBounds(map->scaledenom, layer->class[iclass] -> minscaledenom,
+                       layer -> class[iclass] -> maxscaledenom)) {
+    return MS_FALSE;
+  }
+
+  /* verify the minfeaturesize */
+  if ((shape->type == MS_SHAPE_LINE || shape->type == MS_SHAPE_POLYGON) &&
+      (layer->class[iclass] -> minfeaturesize > 0)) {
+    double minfeaturesize =
+        Pix2LayerGeoref(map, layer, layer->class[iclass] -> minfeaturesize);
+    if (msShapeCheckSize(shape, minfeaturesize) == MS_FALSE)
+      return MS_FALSE; /* skip this one, next class */
+  }
+
+  return layer->class[iclass] -> status != MS_DELETE;
+}
+
+/*
+** Same result as the linear scan of msShapeGetNextClass(): among the classes
+** whose value matches, the first one after currentclass in classgroup order
+** that is applicable. Returns -2 if the dispatch can't be used.
+*/
+static int msShapeDispatchClass(classDispatchObj *dispatch, int currentclass,
+                                layerObj *layer, mapObj *map, shapeObj *shape,
+                                int *classgroup, int numclasses) {
+  const char *value;
+  classDispatchValue *entry;
+  int i = 0, j = 0, numhits, iclass, position;
+  int best = -1, bestposition = numclasses;
+
+  if (layer->classitemindex >= shape->numvalues)
+    return -2; /* let msEvalExpression() report the error */
+  if (classgroup &&
+      !msClassDispatchSetClassGroup(dispatch, classgroup, numclasses))
+    return -2;
+
+  value = shape->values[layer->classitemindex];
+  UT_HASH_FIND_STR(dispatch->values, value, entry);
+  numhits = entry ? entry->numclasses : 0;
+
+  /* merge the matching and the always matching classes, in class order */
+  while (i < numhits || j < dispatch->numalways) {
+    if (j >= dispatch->numalways ||
+        (i < numhits && entry->classes[i] < dispatch->always[j]))
+      iclass = entry->classes[i++];
+    else
+      iclass = dispatch->always[j++];
+
+    position = classgroup ? dispatch->positions[iclass] : iclass;
+    if (position <= currentclass || position >= bestposition)
+      continue;
+    if (!msClassIsApplicable(layer, map, shape, iclass))
+      continue;
+    best = iclass;
+    bestposition = position;
+    if (!classgroup)
+      break; /* class order is classgroup order */
+  }
+
+  return best;
+}
+
 int msShapeGetClass(layerObj *layer, mapObj *map, shapeObj *shape,
                     int *classgroup, int numclasses) {
   return msShapeGetNextClass(-1, layer, map, shape, classgroup, numclasses);
@@ -808,6 +1022,7 @@ int msShapeGetClass(layerObj *layer, mapObj *map, shapeObj *shape,
 int msShapeGetNextClass(int currentclass, layerObj *layer, mapObj *map,
                         shapeObj *shape, int *classgroup, int numclasses) {
   int i, iclass;
+  classDispatchObj *dispatch;
 
   if (currentclass < 0)
     currentclass = -1;
@@ -816,6 +1031,18 @@ int msShapeGetNextClass(int currentclass, layerObj *layer, mapObj *map,
     if (classgroup == NULL || numclasses <= 0)
       numclasses = layer->numclasses;
 
+    dispatch = msLayerGetClassDispatch(layer);
+    if (dispatch) {
+      iclass = msShapeDispatchClass(dispatch, currentclass, layer, map, shape,
+                                    classgroup, numclasses);
+      if (iclass != -2) {
+        if (iclass != -1 && layer->class[iclass] -> isfallback &&
+            currentclass != -1)
+          return -1;
+        return iclass;
+      }
+    }
+
     for (i = currentclass + 1; i < numclasses; i++) {
       if (classgroup)
         iclass = classgroup[i];
@@ -825,26 +1052,11 @@ int msShapeGetNextClass(int currentclass, layerObj *layer, mapObj *map,
       if (iclass < 0 || iclass >= layer->numclasses)
         continue; /* this should never happen but just in case */
 
-      if (!msScaleInBounds(map->scaledenom,
-                           layer->class[iclass] -> minscaledenom,
-                           layer -> class[iclass] -> maxscaledenom)) {
+      if (!msClassIsApplicable(layer, map, shape, iclass))
         continue;
-      }
 
-      /* verify the minfeaturesize */
-      if ((shape->type == MS_SHAPE_LINE || shape->type == MS_SHAPE_POLYGON) &&
-          (layer->class[iclass] -> minfeaturesize > 0)) {
-        double minfeaturesize =
-            Pix2LayerGeoref(map, layer, layer->class[iclass] -> minfeaturesize);
-        if (msShapeCheckSize(shape, minfeaturesize) == MS_FALSE)
-          continue; /* skip this one, next class */
-      }
-
-      if (layer->class[iclass] -> status != MS_DELETE &&
-                                      msEvalExpression(
-                                          layer, shape,
-                                          &(layer->class[iclass] -> expression),
-                                          layer->classitemindex) == MS_TRUE) {
+      if (msEvalExpression(layer, shape, &(layer->class[iclass] -> expression),
+                           layer->classitemindex) == MS_TRUE) {
         if (layer->class[iclass] -> isfallback && currentclass != -1) {
           // Class is not applicable if it is flagged as fallback (<ElseFilter/>
           // tag in SLD) but other classes have been applied before.
@@ -1103,10 +1315,15 @@ int msSaveImage(mapObj *map, imageObj *img, const char *filename) {
   int nReturnVal = MS_FAILURE;
   char szPath[MS_MAXPATHLEN];
   struct mstimeval starttime = {0}, endtime = {0};
+  const int metrics = msMetricsEnabled();
+  const int trace = msTraceEnabled();
+  double metricsstart = 0;
 
   if (map && map->debug >= MS_DEBUGLEVEL_TUNING) {
     msGettimeofday(&starttime, NULL);
   }
+  if (metrics || trace)
+    metricsstart = msMetricsTime();
 
   if (img) {
     if (MS_DRIVER_GDAL(img->format)) {
@@ -1166,6 +1383,11 @@ int msSaveImage(mapObj *map, imageObj *img, const char *filename) {
             (endtime.tv_sec + endtime.tv_usec / 1.0e6) -
                 (starttime.tv_sec + starttime.tv_usec / 1.0e6));
   }
+  if (metrics && img && nReturnVal == MS_SUCCESS)
+    msMetricsAdd(MS_METRIC_ENCODE_DURATION, img->format->name,
+                 msMetricsTime() - metricsstart);
+  if (trace && img)
+    msTraceAdd("msSaveImage", img->format->name, metricsstart);
 
   return nReturnVal;
 }
@@ -2179,6 +2401,12 @@ void msCleanup() {
   msyylex_destroy();
 
   msOGRCleanup();
+  msResampleGridCacheCleanup();
+  msRasterClassLUTCacheCleanup();
+  msTextLayoutCacheCleanup();
+  msShapefilePoolCleanup();
+  msMetricsCleanup();
+  msResponseCacheCleanup();
   msGDALCleanup();
 
   /* Release both GDAL and OGR resources */
@@ -2612,7 +2840,7 @@ void *msSmallCalloc(size_t nCount, size_t nSize) {
 char *msBuildOnlineResource(const mapObj *map, const cgiRequestObj *req) {
   (void)map; // unused parameter
 
-  const char *pathinfo = getenv("PATH_INFO");
+  const char *pathinfo = msIO_getenv("PATH_INFO");
   if (!pathinfo) {
     pathinfo = "";
   }
@@ -2679,9 +2907,9 @@ char *msBuildOnlineResource(const mapObj *map, const cgiRequestObj *req) {
   const char *value, *protocol = "http";
   char **hostname_array = NULL;
   int mapparam_len = 0, hostname_array_len = 0;
-  const char *hostname = getenv("HTTP_X_FORWARDED_HOST");
+  const char *hostname = msIO_getenv("HTTP_X_FORWARDED_HOST");
   if (!hostname)
-    hostname = getenv("SERVER_NAME");
+    hostname = msIO_getenv("SERVER_NAME");
   else {
     if (strchr(hostname, ',')) {
       hostname_array = msStringSplit(hostname, ',', &hostname_array_len);
@@ -2689,19 +2917,19 @@ char *msBuildOnlineResource(const mapObj *map, const cgiRequestObj *req) {
     }
   }
 
-  const char *port = getenv("HTTP_X_FORWARDED_PORT");
+  const char *port = msIO_getenv("HTTP_X_FORWARDED_PORT");
   if (!port)
-    port = getenv("SERVER_PORT");
+    port = msIO_getenv("SERVER_PORT");
 
-  const char *script = getenv("SCRIPT_NAME");
+  const char *script = msIO_getenv("SCRIPT_NAME");
 
   /* HTTPS is set by Apache to "on" in an HTTPS server ... if not set */
   /* then check SERVER_PORT: 443 is the default https port. */
-  if (((value = getenv("HTTPS")) && strcasecmp(value, "on") == 0) ||
-      ((value = getenv("SERVER_PORT")) && atoi(value) == 443)) {
+  if (((value = msIO_getenv("HTTPS")) && strcasecmp(value, "on") == 0) ||
+      ((value = msIO_getenv("SERVER_PORT")) && atoi(value) == 443)) {
     protocol = "https";
   }
-  if ((value = getenv("HTTP_X_FORWARDED_PROTO"))) {
+  if ((value = msIO_getenv("HTTP_X_FORWARDED_PROTO"))) {
     protocol = value;
   }
 
@@ -2739,6 +2967,58 @@ char *msBuildOnlineResource(const mapObj *map, const cgiRequestObj *req) {
   return online_resource;
 }
 
+/************************************************************************/
+/*                           msMapSetTimeout()                          */
+/*                                                                      */
+/*      Give the map a time budget of "seconds" from now, checked by    */
+/*      msMapCheckDeadline() in the rendering and query loops. A value  */
+/*      <= 0 removes the limit.                                         */
+/************************************************************************/
+
+void msMapSetTimeout(mapObj *map, double seconds) {
+  struct mstimeval now;
+
+  if (seconds <= 0) {
+    map->deadline = 0;
+    return;
+  }
+  msGettimeofday(&now, NULL);
+  map->deadline = now.tv_sec + now.tv_usec / 1.0e6 + seconds;
+}
+
+/************************************************************************/
+/*                        msMapGetRemainingTime()                       */
+/*                                                                      */
+/*      Seconds left before the map deadline, -1 if there is none and   */
+/*      0 once it has passed.                                           */
+/************************************************************************/
+
+double msMapGetRemainingTime(const mapObj *map) {
+  struct mstimeval now;
+  double remaining;
+
+  if (!map || map->deadline <= 0)
+    return -1;
+  msGettimeofday(&now, NULL);
+  remaining = map->deadline - (now.tv_sec + now.tv_usec / 1.0e6);
+  return remaining > 0 ? remaining : 0;
+}
+
+/************************************************************************/
+/*                          msMapCheckDeadline()                        */
+/*                                                                      */
+/*      Returns MS_FAILURE, with an MS_TIMEOUTERR set, once the map     */
+/*      deadline has passed so that long loops can abort cleanly.       */
+/************************************************************************/
+
+int msMapCheckDeadline(const mapObj *map, const char *routine) {
+  if (!map || map->deadline <= 0 || msMapGetRemainingTime(map) > 0)
+    return MS_SUCCESS;
+  msSetError(MS_TIMEOUTERR, "Request exceeded its time budget, aborting.",
+             routine);
+  return MS_FAILURE;
+}
+
 /************************************************************************/
 /*                             msIntegerInArray()                        */
 /************************************************************************/
@@ -32,6 +32,9 @@
 #include <stdlib.h> /* for atof() and atoi() */
 #include <math.h>
 
+#include "cpl_conv.h"
+#include "cpl_error.h"
+#include "cpl_string.h"
 #include "cpl_vsi.h"
 
 static inline void IGUR_sizet(size_t ignored) {
@@ -146,6 +149,9 @@ DBFHandle msDBFOpenVirtualFile(VSILFILE *fp) {
 
   psDBF->pszEncoding = NULL;
 
+  psDBF->psMap = NULL;
+  psDBF->pabyMap = NULL;
+
   /* -------------------------------------------------------------------- */
   /*  Read Table Header info                                              */
   /* -------------------------------------------------------------------- */
@@ -274,6 +280,39 @@ char *msReadCPGEncoding(char *cpgFilename) {
   return msStrdup(szEncoding);
 }
 
+/************************************************************************/
+/*                              msDBFMapFile()                          */
+/*                                                                      */
+/*      Map a read-only .dbf file in memory so that attributes are      */
+/*      read in place instead of through a seek and read of the whole   */
+/*      record.  Only done for complete local files, when enabled       */
+/*      with MS_DBF_MMAP: a file truncated while it is mapped (e.g.     */
+/*      rewritten in place) raises SIGBUS on access instead of a read   */
+/*      error, and pooled handles can keep a mapping for long.          */
+/************************************************************************/
+static void msDBFMapFile(DBFHandle psDBF) {
+  vsi_l_offset nDataSize, nFileSize;
+
+  if (!CPLIsVirtualMemFileMapAvailable() ||
+      !CPLTestBool(CPLGetConfigOption("MS_DBF_MMAP", "NO")))
+    return;
+
+  nDataSize = (vsi_l_offset)psDBF->nHeaderLength +
+              (vsi_l_offset)psDBF->nRecordLength * psDBF->nRecords;
+  if (psDBF->nRecords == 0 || VSIFSeekL(psDBF->fp, 0, SEEK_END) != 0)
+    return;
+  nFileSize = VSIFTellL(psDBF->fp);
+  if (nFileSize < nDataSize || (vsi_l_offset)(size_t)nDataSize != nDataSize)
+    return;
+
+  CPLPushErrorHandler(CPLQuietErrorHandler);
+  psDBF->psMap = CPLVirtualMemFileMapNew(psDBF->fp, 0, nDataSize,
+                                         VIRTUALMEM_READONLY, NULL, NULL);
+  CPLPopErrorHandler();
+  if (psDBF->psMap)
+    psDBF->pabyMap = (const char *)CPLVirtualMemGetAddr(psDBF->psMap);
+}
+
 /************************************************************************/
 /*                              msDBFOpen()                             */
 /*                                                                      */
@@ -336,6 +375,10 @@ DBFHandle msDBFOpen(const char *pszFilename, const char *pszAccess)
     msFree(pszCPGFilename);
   }
 
+  if (dbfHandle && strchr(pszAccess, '+') == NULL &&
+      !STARTS_WITH(pszDBFFilename, "/vsi"))
+    msDBFMapFile(dbfHandle);
+
   msFree(pszDBFFilename);
   return dbfHandle;
 }
@@ -379,6 +422,8 @@ void msDBFClose(DBFHandle psDBF) {
   /* -------------------------------------------------------------------- */
   /*      Close, and free resources.                                      */
   /* -------------------------------------------------------------------- */
+  if (psDBF->psMap)
+    CPLVirtualMemFree(psDBF->psMap);
   VSIFCloseL(psDBF->fp);
 
   if (psDBF->panFieldOffset != NULL) {
@@ -459,6 +504,9 @@ DBFHandle msDBFCreate(const char *pszFilename)
   psDBF->bNoHeader = MS_TRUE;
   psDBF->bUpdated = MS_FALSE;
 
+  psDBF->psMap = NULL;
+  psDBF->pabyMap = NULL;
+
   return (psDBF);
 }
 
@@ -551,34 +599,97 @@ int msDBFAddField(DBFHandle psDBF, const char *pszFieldName, DBFFieldType eType,
 }
 
 /************************************************************************/
-/*                         DBFIsValueNULL()                             */
-/*                                                                      */
-/*      Return TRUE if value is NULL (in DBF terms).                    */
+/*                            msDBFGetRecord()                          */
 /*                                                                      */
-/*      Based on DBFIsAttributeNULL of shapelib                         */
+/*      Return the raw bytes of a record, either in place from the      */
+/*      file mapping or read into the current record buffer.            */
 /************************************************************************/
+static const char *msDBFGetRecord(DBFHandle psDBF, int hEntity,
+                                  const char *pszCaller)
+
+{
+  unsigned int nRecordOffset;
 
-static int DBFIsValueNULL(const char *pszValue, char type)
+  if (hEntity < 0 || hEntity >= psDBF->nRecords) {
+    msSetError(MS_DBFERR, "Invalid record number %d.", pszCaller, hEntity);
+    return (NULL);
+  }
+
+  if (psDBF->pabyMap)
+    return psDBF->pabyMap + psDBF->nHeaderLength +
+           (size_t)psDBF->nRecordLength * hEntity;
+
+  /* -------------------------------------------------------------------- */
+  /*  Have we read the record?              */
+  /* -------------------------------------------------------------------- */
+  if (psDBF->nCurrentRecord != hEntity) {
+    flushRecord(psDBF);
+
+    nRecordOffset = psDBF->nRecordLength * hEntity + psDBF->nHeaderLength;
+
+    VSIFSeekL(psDBF->fp, nRecordOffset, 0);
+    if (VSIFReadL(psDBF->pszCurrentRecord, psDBF->nRecordLength, 1,
+                  psDBF->fp) != 1) {
+      msSetError(MS_DBFERR, "Cannot read record %d.", pszCaller, hEntity);
+      return (NULL);
+    }
+
+    psDBF->nCurrentRecord = hEntity;
+  }
+
+  return psDBF->pszCurrentRecord;
+}
+
+/************************************************************************/
+/*                            msDBFGetField()                           */
+/*                                                                      */
+/*      Locate a field value within a record without copying it.        */
+/*      Blanks are trimmed (leading ones only on numeric types) and     */
+/*      NULL numeric and date values are returned as "0".               */
+/************************************************************************/
+static const char *msDBFGetField(DBFHandle psDBF, const char *pszRecord,
+                                 int iField, int *pnLength, int *pbNull)
 
 {
-  switch (type) {
-  case 'N':
-  case 'F':
-    /* NULL numeric fields have value "****************" */
-    return pszValue[0] == '*';
+  const char *pszValue = pszRecord + psDBF->panFieldOffset[iField];
+  const char *pszEnd;
+  char chType = psDBF->pachFieldType[iField];
+  int nLength = psDBF->panFieldSize[iField];
 
-  case 'D':
-    /* NULL date fields have value "00000000" */
-    return strncmp(pszValue, "00000000", 8) == 0;
+  pszEnd = memchr(pszValue, '\0', nLength);
+  if (pszEnd)
+    nLength = pszEnd - pszValue;
 
-  case 'L':
-    /* NULL boolean fields have value "?" */
-    return pszValue[0] == '?';
+  /*
+  ** Trim trailing blanks (SDL Modification)
+  */
+  while (nLength > 0 && pszValue[nLength - 1] == ' ')
+    nLength--;
+
+  *pbNull = MS_FALSE;
+  if (chType == 'N' || chType == 'F' || chType == 'D') {
+    /*
+    ** Trim/skip leading blanks (SDL/DM Modification - only on numeric types)
+    */
+    while (nLength > 0 && *pszValue == ' ') {
+      pszValue++;
+      nLength--;
+    }
 
-  default:
-    /* empty string fields are considered NULL */
-    return strlen(pszValue) == 0;
+    /*  detect null values, see DBFIsAttributeNULL of shapelib */
+    if ((chType == 'D' && nLength >= 8 &&
+         strncmp(pszValue, "00000000", 8) == 0) ||
+        (chType != 'D' && nLength > 0 && pszValue[0] == '*')) {
+      *pbNull = MS_TRUE;
+      pszValue = "0";
+      nLength = 1;
+    }
+  } else if (nLength == 0 || (chType == 'L' && pszValue[0] == '?')) {
+    *pbNull = MS_TRUE;
   }
+
+  *pnLength = nLength;
+  return pszValue;
 }
 
 /************************************************************************/
@@ -589,10 +700,8 @@ static int DBFIsValueNULL(const char *pszValue, char type)
 static const char *msDBFReadAttribute(DBFHandle psDBF, int hEntity, int iField)
 
 {
-  int i;
-  unsigned int nRecordOffset;
-  const uchar *pabyRec;
-  const char *pReturnField = NULL;
+  const char *pszRecord, *pszValue;
+  int nLength, bNull;
 
   /* -------------------------------------------------------------------- */
   /*  Is the request valid?                             */
@@ -603,34 +712,9 @@ static const char *msDBFReadAttribute(DBFHandle psDBF, int hEntity, int iField)
     return (NULL);
   }
 
-  if (hEntity < 0 || hEntity >= psDBF->nRecords) {
-    msSetError(MS_DBFERR, "Invalid record number %d.", "msDBFReadAttribute()",
-               hEntity);
+  pszRecord = msDBFGetRecord(psDBF, hEntity, "msDBFReadAttribute()");
+  if (pszRecord == NULL)
     return (NULL);
-  }
-
-  /* -------------------------------------------------------------------- */
-  /*  Have we read the record?              */
-  /* -------------------------------------------------------------------- */
-  if (psDBF->nCurrentRecord != hEntity) {
-    flushRecord(psDBF);
-
-    nRecordOffset = psDBF->nRecordLength * hEntity + psDBF->nHeaderLength;
-
-    VSIFSeekL(psDBF->fp, nRecordOffset, 0);
-    if (VSIFReadL(psDBF->pszCurrentRecord, psDBF->nRecordLength, 1,
-                  psDBF->fp) != 1) {
-      msSetError(MS_DBFERR, "Cannot read record %d.", "msDBFReadAttribute()",
-                 hEntity);
-      return (NULL);
-    }
-
-    psDBF->nCurrentRecord = hEntity;
-  }
-
-  pabyRec = (const uchar *)psDBF->pszCurrentRecord;
-  /* DEBUG */
-  /* printf("CurrentRecord(%c):%s\n", psDBF->pachFieldType[iField], pabyRec); */
 
   /* -------------------------------------------------------------------- */
   /*  Ensure our field buffer is large enough to hold this buffer.      */
@@ -644,46 +728,11 @@ static const char *msDBFReadAttribute(DBFHandle psDBF, int hEntity, int iField)
   /* -------------------------------------------------------------------- */
   /*  Extract the requested field.              */
   /* -------------------------------------------------------------------- */
-  strncpy(psDBF->pszStringField,
-          (const char *)pabyRec + psDBF->panFieldOffset[iField],
-          psDBF->panFieldSize[iField]);
-  psDBF->pszStringField[psDBF->panFieldSize[iField]] = '\0';
+  pszValue = msDBFGetField(psDBF, pszRecord, iField, &nLength, &bNull);
+  memcpy(psDBF->pszStringField, pszValue, nLength);
+  psDBF->pszStringField[nLength] = '\0';
 
-  /*
-  ** Trim trailing blanks (SDL Modification)
-  */
-  for (i = strlen(psDBF->pszStringField) - 1; i >= 0; i--) {
-    if (psDBF->pszStringField[i] != ' ') {
-      psDBF->pszStringField[i + 1] = '\0';
-      break;
-    }
-  }
-
-  if (i == -1)
-    psDBF->pszStringField[0] = '\0'; /* whole string is blank (SDL fix)       */
-
-  /*
-  ** Trim/skip leading blanks (SDL/DM Modification - only on numeric types)
-  */
-  if (psDBF->pachFieldType[iField] == 'N' ||
-      psDBF->pachFieldType[iField] == 'F' ||
-      psDBF->pachFieldType[iField] == 'D') {
-    for (i = 0; psDBF->pszStringField[i] != '\0'; i++) {
-      if (psDBF->pszStringField[i] != ' ')
-        break;
-    }
-    pReturnField = psDBF->pszStringField + i;
-  } else
-    pReturnField = psDBF->pszStringField;
-
-  /*  detect null values */
-  if (DBFIsValueNULL(pReturnField, psDBF->pachFieldType[iField])) {
-    if (psDBF->pachFieldType[iField] == 'N' ||
-        psDBF->pachFieldType[iField] == 'F' ||
-        psDBF->pachFieldType[iField] == 'D')
-      pReturnField = "0";
-  }
-  return (pReturnField);
+  return (psDBF->pszStringField);
 }
 
 /************************************************************************/
@@ -932,6 +981,7 @@ char **msDBFGetItems(DBFHandle dbffile) {
 */
 char **msDBFGetValues(DBFHandle dbffile, int record) {
   char **values;
+  int *itemindexes;
   int i, nFields;
 
   if ((nFields = msDBFGetFieldCount(dbffile)) == 0) {
@@ -939,11 +989,12 @@ char **msDBFGetValues(DBFHandle dbffile, int record) {
     return (NULL);
   }
 
-  values = (char **)malloc(sizeof(char *) * nFields);
-  MS_CHECK_ALLOC(values, sizeof(char *) * nFields, NULL);
+  itemindexes = (int *)msSmallMalloc(sizeof(int) * nFields);
 
   for (i = 0; i < nFields; i++)
-    values[i] = msStrdup(msDBFReadStringAttribute(dbffile, record, i));
+    itemindexes[i] = i;
+  values = msDBFGetValueList(dbffile, record, itemindexes, nFields);
+  msFree(itemindexes);
 
   return (values);
 }
@@ -970,23 +1021,33 @@ int *msDBFGetItemIndexes(DBFHandle dbffile, char **items, int numitems) {
 
 char **msDBFGetValueList(DBFHandle dbffile, int record, int *itemindexes,
                          int numitems) {
-  const char *value;
+  const char *pszRecord, *pszValue;
   char **values = NULL;
-  int i;
+  int i, nLength, bNull;
 
   if (numitems == 0)
     return (NULL);
 
+  /* only the requested fields are extracted, straight from the record */
+  pszRecord = msDBFGetRecord(dbffile, record, "msDBFGetValueList()");
+  if (pszRecord == NULL)
+    return NULL;
+
   values = (char **)malloc(sizeof(char *) * numitems);
   MS_CHECK_ALLOC(values, sizeof(char *) * numitems, NULL);
 
   for (i = 0; i < numitems; i++) {
-    value = msDBFReadStringAttribute(dbffile, record, itemindexes[i]);
-    if (value == NULL) {
-      free(values);
-      return NULL; /* Error already reported by msDBFReadStringAttribute() */
+    if (itemindexes[i] < 0 || itemindexes[i] >= dbffile->nFields) {
+      msSetError(MS_DBFERR, "Invalid field index %d.", "msDBFGetValueList()",
+                 itemindexes[i]);
+      msFreeCharArray(values, i);
+      return NULL;
     }
-    values[i] = msStrdup(value);
+    pszValue =
+        msDBFGetField(dbffile, pszRecord, itemindexes[i], &nLength, &bNull);
+    values[i] = (char *)msSmallMalloc(nLength + 1);
+    memcpy(values[i], pszValue, nLength);
+    values[i][nLength] = '\0';
   }
 
   return (values);
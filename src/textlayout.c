@@ -28,6 +28,7 @@
 
 #include <float.h>
 #include "mapserver.h"
+#include "mapthread.h"
 
 #ifdef USE_ICONV
 #include <iconv.h>
@@ -520,6 +521,261 @@ struct line_desc {
   int rtl;
 };
 
+/* ==================================================================== */
+/*      Shaped text cache.                                              */
+/*                                                                      */
+/*      Labels from a same layer tend to repeat the same few strings    */
+/*      (road names, place names) across requests. The result of the    */
+/*      layout (bidi, shaping, line wrapping and alignment) is kept in  */
+/*      a process wide cache, in a thread independent form: fonts are   */
+/*      stored by key and glyphs by index, and are resolved against the */
+/*      calling thread's font cache on a hit.                           */
+/* ==================================================================== */
+
+typedef struct {
+  unsigned int codepoint;
+  int face; /* index in faces[] */
+  pointObj pnt;
+} shaped_glyph;
+
+typedef struct shaped_text shaped_text;
+struct shaped_text {
+  char *key;
+  char **faces; /* font keys */
+  int numfaces;
+  shaped_glyph *glyphs;
+  int numglyphs;
+  int numlines;
+  rectObj bbox;
+  size_t size;
+  int refcount;
+  int evicted; /* no longer in the cache, free when released */
+  shaped_text *prev, *next; /* LRU list, most recently used first */
+  UT_hash_handle hh;
+};
+
+static shaped_text *shaped_text_cache = NULL;
+static shaped_text *shaped_text_lru_head = NULL;
+static shaped_text *shaped_text_lru_tail = NULL;
+static size_t shaped_text_cache_size = 0;
+static unsigned long shaped_text_hits = 0;
+static unsigned long shaped_text_misses = 0;
+
+static size_t msShapedTextCacheMaxBytes(void) {
+  const char *size = CPLGetConfigOption("MS_TEXT_LAYOUT_CACHE_SIZE", NULL);
+  if (size == NULL)
+    return 8 * 1024 * 1024;
+  return (size_t)MS_MAX(0, atoi(size)) * 1024 * 1024;
+}
+
+static void msFreeShapedText(shaped_text *st) {
+  int i;
+  for (i = 0; i < st->numfaces; i++)
+    msFree(st->faces[i]);
+  msFree(st->faces);
+  msFree(st->glyphs);
+  msFree(st->key);
+  msFree(st);
+}
+
+/* must be called with TLOCK_TEXTLAYOUT held */
+static void msShapedTextCacheUnlink(shaped_text *st) {
+  UT_HASH_DEL(shaped_text_cache, st);
+  if (st->prev)
+    st->prev->next = st->next;
+  else
+    shaped_text_lru_head = st->next;
+  if (st->next)
+    st->next->prev = st->prev;
+  else
+    shaped_text_lru_tail = st->prev;
+  st->prev = st->next = NULL;
+  shaped_text_cache_size -= st->size;
+  if (st->refcount > 0)
+    st->evicted = MS_TRUE;
+  else
+    msFreeShapedText(st);
+}
+
+/*
+** Build the cache key for a text symbol, or return NULL if the cache is
+** disabled. The key holds everything the layout depends on.
+*/
+static char *msShapedTextCacheKey(mapObj *map, textSymbolObj *ts,
+                                  textPathObj *tgret) {
+  char prefix[128];
+  char *key;
+
+  if (msShapedTextCacheMaxBytes() == 0)
+    return NULL;
+
+  snprintf(prefix, sizeof(prefix), "%d|%d|%d|%d|%d|", tgret->glyph_size,
+           tgret->line_height, ts->label->wrap, ts->label->maxlength,
+           ts->label->align);
+  key = msStrdup(prefix);
+  if (map) {
+    key = msStringConcatenate(key, map->mappath ? map->mappath : "");
+    key = msStringConcatenate(key, "|");
+    key = msStringConcatenate(key,
+                              map->fontset.filename ? map->fontset.filename
+                                                    : "");
+  }
+  key = msStringConcatenate(key, "|");
+  key = msStringConcatenate(key, ts->label->font ? ts->label->font : "");
+  key = msStringConcatenate(key, "|");
+  return msStringConcatenate(key, ts->annotext);
+}
+
+static shaped_text *msShapedTextCacheGet(const char *key) {
+  shaped_text *st;
+
+  msAcquireLock(TLOCK_TEXTLAYOUT);
+  UT_HASH_FIND_STR(shaped_text_cache, key, st);
+  if (st) {
+    shaped_text_hits++;
+    st->refcount++;
+    if (st->prev) { /* move to the front of the LRU list */
+      st->prev->next = st->next;
+      if (st->next)
+        st->next->prev = st->prev;
+      else
+        shaped_text_lru_tail = st->prev;
+      st->prev = NULL;
+      st->next = shaped_text_lru_head;
+      shaped_text_lru_head->prev = st;
+      shaped_text_lru_head = st;
+    }
+  } else {
+    shaped_text_misses++;
+  }
+  msReleaseLock(TLOCK_TEXTLAYOUT);
+  return st;
+}
+
+static void msShapedTextCacheRelease(shaped_text *st) {
+  msAcquireLock(TLOCK_TEXTLAYOUT);
+  st->refcount--;
+  if (st->refcount == 0 && st->evicted)
+    msFreeShapedText(st);
+  msReleaseLock(TLOCK_TEXTLAYOUT);
+}
+
+/*
+** Store the layout of a text path. Takes ownership of key.
+*/
+static void msShapedTextCacheAdd(char *key, textPathObj *tgret) {
+  const size_t max_size = msShapedTextCacheMaxBytes();
+  shaped_text *st, *existing;
+  int i, j;
+
+  st = msSmallCalloc(1, sizeof(shaped_text));
+  st->key = key;
+  st->numglyphs = tgret->numglyphs;
+  st->numlines = tgret->numlines;
+  st->bbox = tgret->bounds.bbox;
+  st->glyphs = msSmallMalloc(st->numglyphs * sizeof(shaped_glyph));
+  st->size = sizeof(shaped_text) + strlen(key) + 1 +
+             st->numglyphs * sizeof(shaped_glyph);
+  for (i = 0; i < tgret->numglyphs; i++) {
+    glyphObj *g = &tgret->glyphs[i];
+    for (j = 0; j < st->numfaces; j++) {
+      if (!strcmp(st->faces[j], g->face->font))
+        break;
+    }
+    if (j == st->numfaces) {
+      st->faces =
+          msSmallRealloc(st->faces, (st->numfaces + 1) * sizeof(char *));
+      st->faces[st->numfaces++] = msStrdup(g->face->font);
+      st->size += sizeof(char *) + strlen(g->face->font) + 1;
+    }
+    st->glyphs[i].codepoint = g->glyph->key.codepoint;
+    st->glyphs[i].face = j;
+    st->glyphs[i].pnt = g->pnt;
+  }
+
+  if (st->size > max_size) {
+    msFreeShapedText(st);
+    return;
+  }
+
+  msAcquireLock(TLOCK_TEXTLAYOUT);
+  UT_HASH_FIND_STR(shaped_text_cache, st->key, existing);
+  if (existing) { /* added concurrently by another thread */
+    msReleaseLock(TLOCK_TEXTLAYOUT);
+    msFreeShapedText(st);
+    return;
+  }
+  while (shaped_text_lru_tail &&
+         shaped_text_cache_size + st->size > max_size)
+    msShapedTextCacheUnlink(shaped_text_lru_tail);
+  UT_HASH_ADD_KEYPTR(hh, shaped_text_cache, st->key, strlen(st->key), st);
+  st->next = shaped_text_lru_head;
+  if (shaped_text_lru_head)
+    shaped_text_lru_head->prev = st;
+  shaped_text_lru_head = st;
+  if (!shaped_text_lru_tail)
+    shaped_text_lru_tail = st;
+  shaped_text_cache_size += st->size;
+  msReleaseLock(TLOCK_TEXTLAYOUT);
+}
+
+/*
+** Fill a text path from a cached layout.
+*/
+static int msShapedTextApply(shaped_text *st, fontSetObj *fontset,
+                             textPathObj *tgret) {
+  face_element *static_faces[8];
+  face_element **faces = static_faces;
+  int i, ret = MS_SUCCESS;
+
+  if (st->numfaces > 8)
+    faces = msSmallMalloc(st->numfaces * sizeof(face_element *));
+  for (i = 0; i < st->numfaces; i++) {
+    faces[i] = msGetFontFace(st->faces[i], fontset);
+    if (!faces[i]) {
+      ret = MS_FAILURE;
+      goto cleanup;
+    }
+  }
+
+  tgret->glyphs = msSmallMalloc(st->numglyphs * sizeof(glyphObj));
+  for (i = 0; i < st->numglyphs; i++) {
+    glyphObj *g = &tgret->glyphs[i];
+    g->face = faces[st->glyphs[i].face];
+    g->glyph = msGetGlyphByIndex(g->face, tgret->glyph_size,
+                                 st->glyphs[i].codepoint);
+    if (!g->glyph) {
+      ret = MS_FAILURE;
+      break;
+    }
+    g->pnt = st->glyphs[i].pnt;
+    g->rot = 0.0;
+    tgret->numglyphs++;
+  }
+  tgret->numlines = st->numlines;
+  tgret->bounds.bbox = st->bbox;
+
+cleanup:
+  if (faces != static_faces)
+    msFree(faces);
+  return ret;
+}
+
+void msTextLayoutCacheGetStats(unsigned long *hits, unsigned long *misses) {
+  msAcquireLock(TLOCK_TEXTLAYOUT);
+  *hits = shaped_text_hits;
+  *misses = shaped_text_misses;
+  msReleaseLock(TLOCK_TEXTLAYOUT);
+}
+
+void msTextLayoutCacheCleanup(void) {
+  msAcquireLock(TLOCK_TEXTLAYOUT);
+  while (shaped_text_lru_tail)
+    msShapedTextCacheUnlink(shaped_text_lru_tail);
+  shaped_text_hits = shaped_text_misses = 0;
+  msReleaseLock(TLOCK_TEXTLAYOUT);
+}
+
 int msLayoutTextSymbol(mapObj *map, textSymbolObj *ts, textPathObj *tgret) {
 #define STATIC_GLYPHS 100
 #define STATIC_LINES 10
@@ -547,6 +803,7 @@ int msLayoutTextSymbol(mapObj *map, textSymbolObj *ts, textPathObj *tgret) {
 
   TextInfo glyphs;
   int num_glyphs = 0;
+  char *cache_key = NULL;
 
   assert(
       ts->annotext &&
@@ -595,6 +852,17 @@ int msLayoutTextSymbol(mapObj *map, textSymbolObj *ts, textPathObj *tgret) {
   if (text_num_bytes == 0)
     return 0;
 
+  cache_key = msShapedTextCacheKey(map, ts, tgret);
+  if (cache_key) {
+    shaped_text *cached = msShapedTextCacheGet(cache_key);
+    if (cached) {
+      ret = msShapedTextApply(cached, fontset, tgret);
+      msShapedTextCacheRelease(cached);
+      msFree(cache_key);
+      return ret;
+    }
+  }
+
   if (text_num_bytes > STATIC_GLYPHS) {
 #ifdef USE_FRIBIDI
     glyphs.bidi_levels = msSmallMalloc(text_num_bytes * sizeof(FriBidiLevel));
@@ -974,6 +1242,10 @@ int msLayoutTextSymbol(mapObj *map, textSymbolObj *ts, textPathObj *tgret) {
    */
 
 cleanup:
+  if (ret == MS_SUCCESS && cache_key && tgret->numglyphs > 0)
+    msShapedTextCacheAdd(cache_key, tgret);
+  else
+    msFree(cache_key);
   if (line_descs != static_line_descs)
     free(line_descs);
   if (glyphs.codepoints != static_codepoints) {
@@ -0,0 +1,801 @@
+/******************************************************************************
+ * $Id$
+ *
+ * Project:  MapServer
+ * Purpose:  Microbenchmarks of the core read, query, render and output paths.
+ * Author:   MapServer Project
+ *
+ ******************************************************************************
+ * Copyright (c) 2026, MapServer Project
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies of this Software or works derived from this Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ ****************************************************************************/
+
+/*
+** Runs each benchmark in batches until a repetition lasts --min-time
+** seconds, and writes the wall clock and processor time per iteration of
+** the repetitions as JSON, in the layout of the Google Benchmark reports so
+** that the usual comparison tools can be used on two runs. The data is
+** generated with a fixed seed in a temporary directory, the fonts and
+** symbols come from tests/.
+*/
+
+#include "../../src/mapserver.h"
+#include "../../src/mapio.h"
+#include "../../src/mapows.h"
+#include "../../src/maptree.h"
+
+#include "cpl_conv.h"
+#include "cpl_vsi.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <ctime>
+#include <functional>
+#include <string>
+#include <vector>
+
+#ifndef MS_BENCHMARK_DATA_DIR
+#define MS_BENCHMARK_DATA_DIR "tests"
+#endif
+
+/* ----------------------------------------------------------------------- */
+
+// xorshift64*, so that the data set is the same on every platform
+class Random {
+public:
+  explicit Random(uint64_t seed) : m_state(seed) {}
+
+  double next() {
+    m_state ^= m_state >> 12;
+    m_state ^= m_state << 25;
+    m_state ^= m_state >> 27;
+    return ((m_state * 2685821657736338717ULL) >> 11) *
+           (1.0 / 9007199254740992.0);
+  }
+
+  double range(double lo, double hi) { return lo + (hi - lo) * next(); }
+
+private:
+  uint64_t m_state;
+};
+
+struct Options {
+  double minTime = 0.5; // seconds per repetition
+  int repetitions = 5;
+  int scale = 1; // multiplies the synthetic feature counts
+  const char *filter = nullptr;
+  const char *output = nullptr;
+  std::string dataDir = MS_BENCHMARK_DATA_DIR;
+};
+
+struct Result {
+  std::string name;
+  long iterations; // per repetition
+  double items;    // items processed by an iteration
+  std::vector<double> times;    // ns per iteration, one per repetition
+  std::vector<double> cpuTimes; // processor ns per iteration
+};
+
+static const rectObj gExtent = {-10, 40, 10, 60};
+static const char *const gKinds[] = {"forest", "water", "urban", "field"};
+
+/* ----------------------------------------------------------------------- */
+
+static double elapsedSince(std::chrono::steady_clock::time_point start) {
+  return std::chrono::duration<double>(std::chrono::steady_clock::now() -
+                                       start)
+      .count();
+}
+
+/* Wall clock and, if cpuSeconds is set, processor time of a batch. */
+static bool runBatch(const std::function<bool()> &fn, long iterations,
+                     double *seconds, double *cpuSeconds = nullptr) {
+  const std::clock_t cpuStart = std::clock();
+  const auto start = std::chrono::steady_clock::now();
+  for (long i = 0; i < iterations; i++) {
+    if (!fn())
+      return false;
+  }
+  *seconds = elapsedSince(start);
+  if (cpuSeconds)
+    *cpuSeconds = (double)(std::clock() - cpuStart) / CLOCKS_PER_SEC;
+  return true;
+}
+
+/*
+** Runs fn(), which returns false on failure, for opt.repetitions batches of
+** at least opt.minTime seconds each, after a warm-up call.
+*/
+static void runBenchmark(const Options &opt, const char *name, double items,
+                         const std::function<bool()> &fn,
+                         std::vector<Result> &results) {
+  double seconds = 0;
+  long iterations = 1;
+
+  if (opt.filter && strstr(name, opt.filter) == nullptr)
+    return;
+
+  fprintf(stderr, "%-24s", name);
+  if (!runBatch(fn, 1, &seconds)) {
+    fprintf(stderr, " failed\n");
+    msWriteError(stderr);
+    msResetErrorList();
+    return;
+  }
+
+  /* size the batches from a tenth of the time budget */
+  while (runBatch(fn, iterations, &seconds) && seconds < opt.minTime / 10 &&
+         iterations < 1000000000L)
+    iterations *= 2;
+  if (seconds > 0)
+    iterations = std::max(1L, (long)std::ceil(iterations * opt.minTime /
+                                              seconds));
+
+  Result result{name, iterations, items, {}, {}};
+  for (int r = 0; r < opt.repetitions; r++) {
+    double cpuSeconds = 0;
+    if (!runBatch(fn, iterations, &seconds, &cpuSeconds)) {
+      fprintf(stderr, " failed\n");
+      msWriteError(stderr);
+      msResetErrorList();
+      return;
+    }
+    result.times.push_back(seconds * 1e9 / iterations);
+    result.cpuTimes.push_back(cpuSeconds * 1e9 / iterations);
+  }
+
+  std::vector<double> sorted(result.times);
+  std::sort(sorted.begin(), sorted.end());
+  fprintf(stderr, " %14.0f ns/iter %10ld iterations\n",
+          sorted[sorted.size() / 2], iterations);
+  results.push_back(result);
+}
+
+/* ----------------------------------------------------------------------- */
+
+static std::string jsonEscape(const char *s) {
+  std::string out;
+  for (; *s; s++) {
+    if (*s == '"' || *s == '\\')
+      out += '\\';
+    if ((unsigned char)*s >= 0x20)
+      out += *s;
+  }
+  return out;
+}
+
+/*
+** Reports the repetitions, followed by their median and minimum, as the
+** "aggregate" entries of a Google Benchmark report. As there, the
+** aggregates of the wall clock and processor times are computed separately.
+*/
+static void writeResults(FILE *fp, const Options &opt,
+                         const std::vector<Result> &results) {
+  char date[32];
+  const time_t now = time(nullptr);
+  strftime(date, sizeof(date), "%Y-%m-%dT%H:%M:%S", localtime(&now));
+
+  fprintf(fp, "{\n  \"context\": {\n");
+  fprintf(fp, "    \"date\": \"%s\",\n", date);
+  fprintf(fp, "    \"mapserver_version\": \"%s\",\n",
+          jsonEscape(msGetVersion()).c_str());
+  fprintf(fp, "    \"scale\": %d,\n", opt.scale);
+  fprintf(fp, "    \"min_time\": %g,\n", opt.minTime);
+  fprintf(fp, "    \"repetitions\": %d\n", opt.repetitions);
+  fprintf(fp, "  },\n  \"benchmarks\": [");
+
+  bool first = true;
+  for (const Result &result : results) {
+    std::vector<double> sorted(result.times), sortedCpu(result.cpuTimes);
+    std::sort(sorted.begin(), sorted.end());
+    std::sort(sortedCpu.begin(), sortedCpu.end());
+
+    struct Entry {
+      std::string name;
+      double time, cpuTime;
+    };
+    std::vector<Entry> entries;
+    for (size_t r = 0; r < result.times.size(); r++)
+      entries.push_back({"", result.times[r], result.cpuTimes[r]});
+    entries.push_back(
+        {"median", sorted[sorted.size() / 2], sortedCpu[sortedCpu.size() / 2]});
+    entries.push_back({"min", sorted.front(), sortedCpu.front()});
+
+    for (const Entry &entry : entries) {
+      const bool aggregate = !entry.name.empty();
+      fprintf(fp, "%s\n    {\n", first ? "" : ",");
+      first = false;
+      fprintf(fp, "      \"name\": \"%s%s%s\",\n", result.name.c_str(),
+              aggregate ? "_" : "", entry.name.c_str());
+      fprintf(fp, "      \"run_name\": \"%s\",\n", result.name.c_str());
+      fprintf(fp, "      \"run_type\": \"%s\",\n",
+              aggregate ? "aggregate" : "iteration");
+      if (aggregate)
+        fprintf(fp, "      \"aggregate_name\": \"%s\",\n",
+                entry.name.c_str());
+      fprintf(fp, "      \"iterations\": %ld,\n", result.iterations);
+      fprintf(fp, "      \"real_time\": %.1f,\n", entry.time);
+      fprintf(fp, "      \"cpu_time\": %.1f,\n", entry.cpuTime);
+      fprintf(fp, "      \"time_unit\": \"ns\",\n");
+      fprintf(fp, "      \"items_per_second\": %.1f\n",
+              entry.time > 0 ? result.items * 1e9 / entry.time : 0);
+      fprintf(fp, "    }");
+    }
+  }
+  fprintf(fp, "\n  ]\n}\n");
+}
+
+/* ----------------------------------------------------------------------- */
+
+/*
+** Writes count random features (star shaped polygons, random walk lines or
+** points) in the extent, with NAME, KIND and POP attributes.
+*/
+static bool writeShapefile(const std::string &path, int shptype, int count,
+                           Random &rnd) {
+  SHPHandle hSHP = msSHPCreate((path + ".shp").c_str(), shptype);
+  DBFHandle hDBF = msDBFCreate((path + ".dbf").c_str());
+
+  if (hSHP == nullptr || hDBF == nullptr) {
+    fprintf(stderr, "Unable to create %s.\n", path.c_str());
+    if (hSHP)
+      msSHPClose(hSHP);
+    if (hDBF)
+      msDBFClose(hDBF);
+    return false;
+  }
+
+  msDBFAddField(hDBF, "NAME", FTString, 24, 0);
+  msDBFAddField(hDBF, "KIND", FTString, 12, 0);
+  msDBFAddField(hDBF, "POP", FTInteger, 10, 0);
+
+  for (int i = 0; i < count; i++) {
+    const double cx = rnd.range(gExtent.minx, gExtent.maxx);
+    const double cy = rnd.range(gExtent.miny, gExtent.maxy);
+    std::vector<pointObj> points;
+
+    if (shptype == SHP_POLYGON) {
+      const int n = 8 + (int)rnd.range(0, 56);
+      const double radius = rnd.range(0.02, 0.2);
+      for (int j = 0; j < n; j++) {
+        const double angle = 2 * MS_PI * j / n;
+        const double r = radius * rnd.range(0.5, 1.0);
+        points.push_back({cx + r * cos(angle), cy + r * sin(angle), 0, 0});
+      }
+      points.push_back(points.front());
+    } else if (shptype == SHP_ARC) {
+      const int n = 16 + (int)rnd.range(0, 240);
+      pointObj p = {cx, cy, 0, 0};
+      for (int j = 0; j < n; j++) {
+        p.x += rnd.range(-0.01, 0.01);
+        p.y += rnd.range(-0.01, 0.01);
+        points.push_back(p);
+      }
+    } else {
+      points.push_back({cx, cy, 0, 0});
+    }
+
+    if (shptype == SHP_POINT) {
+      msSHPWritePoint(hSHP, &points[0]);
+    } else {
+      shapeObj shape;
+      lineObj line;
+      msInitShape(&shape);
+      shape.type = shptype == SHP_POLYGON ? MS_SHAPE_POLYGON : MS_SHAPE_LINE;
+      line.numpoints = (int)points.size();
+      line.point = points.data();
+      msAddLine(&shape, &line);
+      msSHPWriteShape(hSHP, &shape);
+      msFreeShape(&shape);
+    }
+
+    char name[24];
+    snprintf(name, sizeof(name), "Feature %d", i);
+    msDBFWriteStringAttribute(hDBF, i, 0, name);
+    msDBFWriteStringAttribute(hDBF, i, 1, gKinds[i % 4]);
+    msDBFWriteIntegerAttribute(hDBF, i, 2, (int)rnd.range(0, 100000));
+  }
+
+  msSHPClose(hSHP);
+  msDBFClose(hDBF);
+  return true;
+}
+
+static std::string buildMapfile(const std::string &shapePath) {
+  std::string s;
+  s += "MAP\n";
+  s += "  NAME \"benchmark\"\n";
+  s += "  EXTENT -10 40 10 60\n";
+  s += "  SIZE 1024 1024\n";
+  s += "  UNITS DD\n";
+  s += "  IMAGETYPE \"png\"\n";
+  s += "  IMAGECOLOR 255 255 255\n";
+  s += "  SHAPEPATH \"" + shapePath + "\"\n";
+  s += "  FONTSET \"fonts.txt\"\n";
+  s += "  SYMBOLSET \"symbols.txt\"\n";
+  s += "  PROJECTION \"init=epsg:4326\" END\n";
+  s += "  OUTPUTFORMAT\n";
+  s += "    NAME \"geojson\"\n";
+  s += "    DRIVER \"OGR/GEOJSON\"\n";
+  s += "    MIMETYPE \"application/json\"\n";
+  s += "    FORMATOPTION \"STORAGE=stream\"\n";
+  s += "    FORMATOPTION \"FORM=SIMPLE\"\n";
+  s += "  END\n";
+  s += "  LAYER\n";
+  s += "    NAME \"polygons\"\n";
+  s += "    TYPE POLYGON\n";
+  s += "    DATA \"polygons\"\n";
+  s += "    STATUS ON\n";
+  s += "    TEMPLATE \"none\"\n";
+  s += "    METADATA\n";
+  s += "      \"gml_include_items\" \"all\"\n";
+  s += "      \"gml_types\" \"auto\"\n";
+  s += "    END\n";
+  s += "    CLASS\n";
+  s += "      EXPRESSION ([POP] < 20000 AND \"[KIND]\" = \"urban\")\n";
+  s += "      STYLE COLOR 220 120 120 OUTLINECOLOR 80 80 80 END\n";
+  s += "    END\n";
+  s += "    CLASS\n";
+  s += "      EXPRESSION (\"[KIND]\" IN \"forest,field\" OR [POP] > 90000)\n";
+  s += "      STYLE COLOR 120 200 120 OUTLINECOLOR 80 80 80 END\n";
+  s += "    END\n";
+  s += "    CLASS\n";
+  s += "      EXPRESSION (\"[NAME]\" ~ \"7$\")\n";
+  s += "      STYLE COLOR 120 120 220 END\n";
+  s += "    END\n";
+  s += "    CLASS\n";
+  s += "      STYLE COLOR 200 200 200 END\n";
+  s += "    END\n";
+  s += "  END\n";
+  s += "  LAYER\n";
+  s += "    NAME \"lines\"\n";
+  s += "    TYPE LINE\n";
+  s += "    DATA \"lines\"\n";
+  s += "    STATUS ON\n";
+  s += "    CLASS\n";
+  s += "      STYLE COLOR 40 40 40 WIDTH 2 END\n";
+  s += "    END\n";
+  s += "  END\n";
+  s += "  LAYER\n";
+  s += "    NAME \"points\"\n";
+  s += "    TYPE POINT\n";
+  s += "    DATA \"points\"\n";
+  s += "    STATUS OFF\n";
+  s += "    LABELITEM \"NAME\"\n";
+  s += "    CLASS\n";
+  s += "      LABEL\n";
+  s += "        TYPE TRUETYPE FONT \"Vera\" SIZE 8 COLOR 0 0 0\n";
+  s += "        OUTLINECOLOR 255 255 255 POSITION AUTO PARTIALS FALSE\n";
+  s += "      END\n";
+  s += "    END\n";
+  s += "  END\n";
+  s += "END\n";
+  return s;
+}
+
+/* ----------------------------------------------------------------------- */
+
+static void setLayersStatus(mapObj *map, int polygons, int lines,
+                            int points) {
+  GET_LAYER(map, 0)->status = polygons;
+  GET_LAYER(map, 1)->status = lines;
+  GET_LAYER(map, 2)->status = points;
+}
+
+/* Reads the shapes of a layer in the map extent. */
+static std::vector<shapeObj> readLayerShapes(mapObj *map, layerObj *layer) {
+  std::vector<shapeObj> shapes;
+  shapeObj shape;
+
+  if (msLayerOpen(layer) != MS_SUCCESS ||
+      msLayerWhichItems(layer, MS_FALSE, nullptr) != MS_SUCCESS ||
+      msLayerWhichShapes(layer, map->extent, MS_FALSE) != MS_SUCCESS)
+    return shapes;
+
+  msInitShape(&shape);
+  while (msLayerNextShape(layer, &shape) == MS_SUCCESS) {
+    shapes.push_back(shape);
+    msInitShape(&shape);
+  }
+  return shapes;
+}
+
+static void freeShapes(std::vector<shapeObj> &shapes) {
+  for (shapeObj &shape : shapes)
+    msFreeShape(&shape);
+  shapes.clear();
+}
+
+/* Converts the shapes to image coordinates, as the renderers expect. */
+static void toImageCoordinates(mapObj *map, imageObj *image,
+                               std::vector<shapeObj> &shapes) {
+  const double cellsize = MS_CELLSIZE(map->extent.minx, map->extent.maxx,
+                                      map->width);
+  for (shapeObj &shape : shapes)
+    msTransformShape(&shape, map->extent, cellsize, image);
+}
+
+static void benchmarkShapefile(const Options &opt, const std::string &dir,
+                               std::vector<Result> &results) {
+  const std::string path = dir + "/polygons";
+  int numShapes = 0, type = 0;
+
+  SHPHandle hSHP = msSHPOpen((path + ".shp").c_str(), "rb");
+  DBFHandle hDBF = msDBFOpen((path + ".dbf").c_str(), "rb");
+  if (hSHP == nullptr || hDBF == nullptr) {
+    fprintf(stderr, "Unable to open %s.\n", path.c_str());
+    return;
+  }
+  msSHPGetInfo(hSHP, &numShapes, &type);
+
+  runBenchmark(opt, "shapefile_read", numShapes,
+               [&]() {
+                 shapeObj shape;
+                 msInitShape(&shape);
+                 for (int i = 0; i < numShapes; i++) {
+                   msSHPReadShape(hSHP, i, &shape);
+                   msFreeShape(&shape);
+                 }
+                 return true;
+               },
+               results);
+
+  runBenchmark(opt, "dbf_read", numShapes,
+               [&]() {
+                 const int numFields = msDBFGetFieldCount(hDBF);
+                 for (int i = 0; i < numShapes; i++) {
+                   char **values = msDBFGetValues(hDBF, i);
+                   if (values == nullptr)
+                     return false;
+                   msFreeCharArray(values, numFields);
+                 }
+                 return true;
+               },
+               results);
+
+  msSHPClose(hSHP);
+  msDBFClose(hDBF);
+
+  shapefileObj shapefile;
+  if (msShapefileOpen(&shapefile, "rb", path.c_str(), MS_TRUE) == -1)
+    return;
+  treeObj *tree = msCreateTree(&shapefile, 0);
+
+  std::vector<rectObj> rects;
+  Random rnd(42);
+  for (int i = 0; i < 1000; i++) {
+    const double x = rnd.range(gExtent.minx, gExtent.maxx - 0.5);
+    const double y = rnd.range(gExtent.miny, gExtent.maxy - 0.5);
+    rects.push_back({x, y, x + 0.5, y + 0.5});
+  }
+
+  runBenchmark(opt, "quadtree_search", rects.size(),
+               [&]() {
+                 for (const rectObj &rect : rects)
+                   msFree(msSearchTree(tree, rect));
+                 return true;
+               },
+               results);
+
+  msDestroyTree(tree);
+  msShapefileClose(&shapefile);
+}
+
+static void benchmarkExpressions(const Options &opt, mapObj *map,
+                                 std::vector<Result> &results) {
+  layerObj *layer = GET_LAYER(map, 0);
+  std::vector<shapeObj> shapes = readLayerShapes(map, layer);
+
+  runBenchmark(opt, "expression_eval", shapes.size(),
+               [&]() {
+                 for (shapeObj &shape : shapes)
+                   msShapeGetClass(layer, map, &shape, nullptr, 0);
+                 return true;
+               },
+               results);
+
+  freeShapes(shapes);
+  msLayerClose(layer);
+}
+
+static void benchmarkReprojection(const Options &opt, mapObj *map,
+                                  std::vector<Result> &results) {
+  layerObj *layer = GET_LAYER(map, 1);
+  std::vector<shapeObj> shapes = readLayerShapes(map, layer);
+  std::vector<shapeObj> work(shapes.size());
+  projectionObj out;
+  size_t numPoints = 0;
+
+  msInitProjection(&out);
+  msProjectionInheritContextFrom(&out, &map->projection);
+  if (msLoadProjectionStringEPSG(&out, "EPSG:3857") != MS_SUCCESS) {
+    msFreeProjection(&out);
+    freeShapes(shapes);
+    msLayerClose(layer);
+    return;
+  }
+  reprojectionObj *reprojector =
+      msProjectCreateReprojector(&map->projection, &out);
+
+  for (size_t i = 0; i < shapes.size(); i++) {
+    msInitShape(&work[i]);
+    msCopyShape(&shapes[i], &work[i]);
+    for (int j = 0; j < shapes[i].numlines; j++)
+      numPoints += shapes[i].line[j].numpoints;
+  }
+
+  runBenchmark(opt, "reprojection", numPoints,
+               [&]() {
+                 for (size_t i = 0; i < shapes.size(); i++) {
+                   for (int j = 0; j < shapes[i].numlines; j++)
+                     memcpy(work[i].line[j].point, shapes[i].line[j].point,
+                            sizeof(pointObj) * shapes[i].line[j].numpoints);
+                   if (msProjectShapeEx(reprojector, &work[i]) != MS_SUCCESS)
+                     return false;
+                 }
+                 return true;
+               },
+               results);
+
+  msProjectDestroyReprojector(reprojector);
+  msFreeProjection(&out);
+  freeShapes(work);
+  freeShapes(shapes);
+  msLayerClose(layer);
+}
+
+static void benchmarkRendering(const Options &opt, mapObj *map,
+                               std::vector<Result> &results) {
+  outputFormatObj *format = msSelectOutputFormat(map, "png");
+  if (format == nullptr || !MS_DRIVER_AGG(format)) {
+    fprintf(stderr, "No AGG/PNG output format, skipping rendering.\n");
+    return;
+  }
+
+  imageObj *image =
+      msImageCreate(map->width, map->height, format, nullptr, nullptr,
+                    map->resolution, map->defresolution, &map->imagecolor);
+  if (image == nullptr)
+    return;
+
+  for (int l = 0; l < 2; l++) {
+    layerObj *layer = GET_LAYER(map, l);
+    styleObj *style = layer->_class[layer->numclasses - 1]->styles[0];
+    std::vector<shapeObj> shapes = readLayerShapes(map, layer);
+    toImageCoordinates(map, image, shapes);
+
+    if (l == 0)
+      runBenchmark(opt, "agg_polygon_render", shapes.size(),
+                   [&]() {
+                     for (shapeObj &shape : shapes) {
+                       if (msDrawShadeSymbol(map, image, &shape, style, 1.0) !=
+                           MS_SUCCESS)
+                         return false;
+                     }
+                     return true;
+                   },
+                   results);
+    else
+      runBenchmark(opt, "agg_line_render", shapes.size(),
+                   [&]() {
+                     for (shapeObj &shape : shapes) {
+                       if (msDrawLineSymbol(map, image, &shape, style, 1.0) !=
+                           MS_SUCCESS)
+                         return false;
+                     }
+                     return true;
+                   },
+                   results);
+
+    freeShapes(shapes);
+    msLayerClose(layer);
+  }
+  msFreeImage(image);
+
+  /* label placement dominates drawing a layer with labels only, one label
+   * per point */
+  std::vector<shapeObj> points = readLayerShapes(map, GET_LAYER(map, 2));
+  const size_t numPoints = points.size();
+  freeShapes(points);
+  msLayerClose(GET_LAYER(map, 2));
+
+  setLayersStatus(map, MS_OFF, MS_OFF, MS_ON);
+  runBenchmark(opt, "label_placement", numPoints,
+               [&]() {
+                 imageObj *labels = msDrawMap(map, MS_FALSE);
+                 msFreeImage(labels);
+                 return labels != nullptr;
+               },
+               results);
+  setLayersStatus(map, MS_ON, MS_ON, MS_OFF);
+}
+
+static void benchmarkEncoding(const Options &opt, mapObj *map,
+                              std::vector<Result> &results) {
+  const char *const names[] = {"png", "jpeg"};
+
+  for (const char *name : names) {
+    outputFormatObj *format = msSelectOutputFormat(map, name);
+    if (format == nullptr)
+      continue;
+    msApplyOutputFormat(&map->outputformat, format, MS_NOOVERRIDE);
+
+    imageObj *image = msDrawMap(map, MS_FALSE);
+    if (image == nullptr) {
+      msWriteError(stderr);
+      msResetErrorList();
+      continue;
+    }
+
+    const std::string benchmark = std::string(name) + "_encode";
+    runBenchmark(opt, benchmark.c_str(), 1,
+                 [&]() {
+                   int size = 0;
+                   unsigned char *data =
+                       msSaveImageBuffer(image, &size, image->format);
+                   msFree(data);
+                   return data != nullptr;
+                 },
+                 results);
+    msFreeImage(image);
+  }
+  msApplyOutputFormat(&map->outputformat, msSelectOutputFormat(map, "png"),
+                      MS_NOOVERRIDE);
+}
+
+/* Runs fn with the msIO stdout redirected to a discarded buffer. */
+static bool writeToBuffer(const std::function<int()> &fn) {
+  msIOContext *context = msIO_pushStdoutToBufferAndGetOldContext();
+  const int status = fn();
+  msIO_restoreOldStdoutContext(context);
+  return status == MS_SUCCESS;
+}
+
+static void benchmarkOutput(const Options &opt, mapObj *map,
+                            std::vector<Result> &results) {
+  const rectObj extent = map->extent;
+
+  setLayersStatus(map, MS_ON, MS_ON, MS_OFF);
+  runBenchmark(opt, "mvt_encode", 1,
+               [&]() {
+                 const bool ok = writeToBuffer(
+                     [&]() { return msMVTWriteTile(map, MS_FALSE); });
+                 map->extent = extent; /* expanded by msMVTWriteTile() */
+                 return ok;
+               },
+               results);
+
+  msInitQuery(&map->query);
+  map->query.type = MS_QUERY_BY_RECT;
+  map->query.mode = MS_QUERY_MULTIPLE;
+  map->query.rect = map->extent;
+  map->query.layer = 0;
+  if (msQueryByRect(map) != MS_SUCCESS) {
+    msWriteError(stderr);
+    msResetErrorList();
+    return;
+  }
+  const double numResults = GET_LAYER(map, 0)->resultcache->numresults;
+
+  runBenchmark(opt, "gml_write", numResults,
+               [&]() {
+                 return writeToBuffer([&]() {
+                   return msGMLWriteQuery(map, nullptr, nullptr);
+                 });
+               },
+               results);
+
+  outputFormatObj *format = msSelectOutputFormat(map, "geojson");
+  if (format != nullptr)
+    runBenchmark(opt, "geojson_write", numResults,
+                 [&]() {
+                   return writeToBuffer([&]() {
+                     return msOGRWriteFromQuery(map, format, MS_FALSE);
+                   });
+                 },
+                 results);
+}
+
+/* ----------------------------------------------------------------------- */
+
+static void usage() {
+  printf("Usage: ms_benchmark [--filter substring] [--min-time seconds]\n"
+         "                    [--repetitions n] [--scale n] [--data dir]\n"
+         "                    [--output file.json]\n");
+}
+
+int main(int argc, char *argv[]) {
+  Options opt;
+  std::vector<Result> results;
+
+  for (int i = 1; i < argc; i++) {
+    const bool hasValue = i + 1 < argc;
+    if (strcmp(argv[i], "--filter") == 0 && hasValue)
+      opt.filter = argv[++i];
+    else if (strcmp(argv[i], "--min-time") == 0 && hasValue)
+      opt.minTime = atof(argv[++i]);
+    else if (strcmp(argv[i], "--repetitions") == 0 && hasValue)
+      opt.repetitions = std::max(1, atoi(argv[++i]));
+    else if (strcmp(argv[i], "--scale") == 0 && hasValue)
+      opt.scale = std::max(1, atoi(argv[++i]));
+    else if (strcmp(argv[i], "--data") == 0 && hasValue)
+      opt.dataDir = argv[++i];
+    else if (strcmp(argv[i], "--output") == 0 && hasValue)
+      opt.output = argv[++i];
+    else {
+      usage();
+      return strcmp(argv[i], "--help") == 0 ? 0 : 1;
+    }
+  }
+
+  if (msSetup() != MS_SUCCESS) {
+    msWriteError(stderr);
+    return 1;
+  }
+
+  /* synthetic data, generated with a fixed seed */
+  const std::string dir = CPLGenerateTempFilename("ms_benchmark");
+  Random rnd(1);
+  if (VSIMkdir(dir.c_str(), 0755) != 0 ||
+      !writeShapefile(dir + "/polygons", SHP_POLYGON, 5000 * opt.scale, rnd) ||
+      !writeShapefile(dir + "/lines", SHP_ARC, 2000 * opt.scale, rnd) ||
+      !writeShapefile(dir + "/points", SHP_POINT, 2000 * opt.scale, rnd)) {
+    CPLUnlinkTree(dir.c_str());
+    msCleanup();
+    return 1;
+  }
+
+  std::string mapfile = buildMapfile(dir);
+  std::string mappath = opt.dataDir + "/";
+  mapObj *map = msLoadMapFromString(&mapfile[0], &mappath[0], nullptr);
+  if (map == nullptr) {
+    msWriteError(stderr);
+    CPLUnlinkTree(dir.c_str());
+    msCleanup();
+    return 1;
+  }
+
+  benchmarkShapefile(opt, dir, results);
+  benchmarkExpressions(opt, map, results);
+  benchmarkReprojection(opt, map, results);
+  benchmarkRendering(opt, map, results);
+  benchmarkEncoding(opt, map, results);
+  benchmarkOutput(opt, map, results);
+
+  msFreeMap(map);
+  CPLUnlinkTree(dir.c_str());
+
+  FILE *fp = opt.output ? fopen(opt.output, "w") : stdout;
+  if (fp == nullptr) {
+    fprintf(stderr, "Unable to write %s.\n", opt.output);
+    msCleanup();
+    return 1;
+  }
+  writeResults(fp, opt, results);
+  if (fp != stdout)
+    fclose(fp);
+
+  msCleanup();
+  return 0;
+}